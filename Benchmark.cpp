@@ -0,0 +1,237 @@
+#include "pch.h"
+
+#include "Benchmark.h"
+
+Benchmark::Benchmark( void )
+	: _enabled{ false }
+	, _warmupFrames{ 0 }
+	, _measuredFrames{ 0 }
+	, _frameIndex{ 0 }
+{
+
+}
+
+void Benchmark::configure( const uint32_t warmupFrames, const uint32_t measuredFrames ) noexcept
+{
+	_enabled			= true;
+	_warmupFrames		= warmupFrames;
+	_measuredFrames		= measuredFrames;
+	_frameIndex			= 0;
+
+	_frameTimes.clear();
+	_frameTimes.reserve( measuredFrames );
+	_gpuTimes.clear();
+	_gpuTimes.reserve( measuredFrames );
+	_latencies.clear();
+	_latencies.reserve( measuredFrames );
+
+	for ( auto& phaseTimes : _phaseTimes )
+	{
+		phaseTimes.clear();
+		phaseTimes.reserve( measuredFrames );
+	}
+}
+
+bool Benchmark::isEnabled( void ) const noexcept
+{
+	return _enabled;
+}
+
+bool Benchmark::isMeasuring( void ) const noexcept
+{
+	return ( true == _enabled ) && ( _warmupFrames < _frameIndex ) && ( false == isFinished() );
+}
+
+bool Benchmark::isFinished( void ) const noexcept
+{
+	return ( true == _enabled ) && ( _measuredFrames <= _frameTimes.size() );
+}
+
+void Benchmark::beginFrame( void ) noexcept
+{
+	if ( false == _enabled )
+	{
+		return;
+	}
+
+	// A frame's time is the interval between its begin and the next one, so it covers everything the loop does.
+	const auto now = std::chrono::steady_clock::now();
+
+	if ( true == isMeasuring() )
+	{
+		_frameTimes.push_back( std::chrono::duration<double, std::milli>( now - _lastFrameBegin ).count() );
+	}
+
+	_lastFrameBegin = now;
+	++_frameIndex;
+}
+
+void Benchmark::addPhaseTime( const FramePhase phase, const double milliseconds ) noexcept
+{
+	if ( true == isMeasuring() )
+	{
+		_phaseTimes[static_cast<size_t>( phase )].push_back( milliseconds );
+	}
+}
+
+void Benchmark::addGpuTime( const double milliseconds ) noexcept
+{
+	if ( true == isMeasuring() )
+	{
+		_gpuTimes.push_back( milliseconds );
+	}
+}
+
+void Benchmark::addLatency( const double milliseconds ) noexcept
+{
+	if ( true == isMeasuring() )
+	{
+		_latencies.push_back( milliseconds );
+	}
+}
+
+void Benchmark::writeJson( std::ostream& stream, const BenchmarkContext& context ) const noexcept
+{
+	stream << "{\n";
+	stream << "  \"headless\": " << ( context._headless ? "true" : "false" ) << ",\n";
+	stream << "  \"presentMode\": \"" << context._presentMode << "\",\n";
+	stream << "  \"framesInFlight\": " << context._framesInFlight << ",\n";
+	stream << "  \"lowLatency\": " << ( context._lowLatency ? "true" : "false" ) << ",\n";
+	stream << "  \"sampleCount\": " << context._sampleCount << ",\n";
+	stream << "  \"swapChainImageCount\": " << context._swapChainImageCount << ",\n";
+	stream << "  \"extent\": [" << context._extent.width << ", " << context._extent.height << "],\n";
+	stream << "  \"vertexCount\": " << context._vertexCount << ",\n";
+	stream << "  \"indexCount\": " << context._indexCount << ",\n";
+	stream << "  \"drawCount\": " << context._drawCount << ",\n";
+	stream << "  \"instanceCount\": " << context._instanceCount << ",\n";
+	stream << "  \"gpuCulling\": " << ( context._gpuCulling ? "true" : "false" ) << ",\n";
+	stream << "  \"visibleCount\": " << context._visibleCount << ",\n";
+	stream << "  \"recordThreadCount\": " << context._recordThreadCount << ",\n";
+	stream << "  \"startupMs\": " << context._startupMs << ",\n";
+	stream << "  \"pipelineCriticalMs\": " << context._pipelineCriticalMs << ",\n";
+	stream << "  \"pipelineBackgroundMs\": " << context._pipelineBackgroundMs << ",\n";
+	stream << "  \"pipelineCount\": " << context._pipelineCount << ",\n";
+	stream << "  \"meshLoadMs\": " << context._meshLoadMs << ",\n";
+	stream << "  \"meshMegabytesPerSecond\": " << context._meshMegabytesPerSecond << ",\n";
+	stream << "  \"indexSize\": " << context._indexSize << ",\n";
+	stream << "  \"vertexStride\": " << context._vertexStride << ",\n";
+	stream << "  \"acmr\": " << context._acmr << ",\n";
+	stream << "  \"atvr\": " << context._atvr << ",\n";
+	stream << "  \"textureUploadMBps\": " << context._textureUploadMBps << ",\n";
+	stream << "  \"textureResidentBytes\": " << context._textureResidentBytes << ",\n";
+	stream << "  \"particleCount\": " << context._particleCount << ",\n";
+	stream << "  \"particleSimulateMs\": " << context._particleSimulateMs << ",\n";
+	stream << "  \"particleDrawMs\": " << context._particleDrawMs << ",\n";
+	stream << "  \"warmupFrames\": " << _warmupFrames << ",\n";
+	stream << "  \"measuredFrames\": " << _frameTimes.size() << ",\n";
+
+	stream << "  \"frameMs\": ";
+	writeSummary( stream, _frameTimes );
+	stream << ",\n";
+
+	// Throughput at the median frame time.
+	stream << "  \"instancesPerSecond\": " << ( context._instanceCount * 1000.0 / std::max( getMedian( _frameTimes ), 1e-6 ) ) << ",\n";
+
+	stream << "  \"cpuMs\": {\n";
+	for ( size_t ii = 0; ii < _phaseTimes.size(); ++ii )
+	{
+		stream << "    \"" << getPhaseName( static_cast<FramePhase>( ii ) ) << "\": ";
+		writeSummary( stream, _phaseTimes[ii] );
+		stream << ( ( ii + 1 < _phaseTimes.size() ) ? ",\n" : "\n" );
+	}
+	stream << "  },\n";
+
+	stream << "  \"gpuMs\": ";
+	writeSummary( stream, _gpuTimes );
+	stream << ",\n";
+
+	stream << "  \"latencyMs\": ";
+	writeSummary( stream, _latencies );
+	stream << "\n}" << std::endl;
+}
+
+void Benchmark::writeScaling( std::ostream& stream, const uint32_t itemCount, const std::vector<ScalingSample>& samples ) noexcept
+{
+	double baseline = 0.0;
+
+	stream << "[\n";
+
+	for ( size_t ii = 0; ii < samples.size(); ++ii )
+	{
+		std::vector<double> sorted = samples[ii]._times;
+		std::sort( sorted.begin(), sorted.end() );
+
+		const double median = ( true == sorted.empty() ) ? 0.0 : sorted[sorted.size() / 2];
+		if ( 0 == ii )
+		{
+			baseline = median;
+		}
+
+		stream << "    { \"threads\": " << samples[ii]._threadCount
+			   << ", \"itemsPerMs\": " << ( itemCount / std::max( median, 1e-6 ) )
+			   << ", \"speedup\": " << ( baseline / std::max( median, 1e-6 ) )
+			   << ", \"ms\": ";
+		writeSummary( stream, samples[ii]._times );
+		stream << ( ( ii + 1 < samples.size() ) ? " },\n" : " }\n" );
+	}
+
+	stream << "  ]";
+}
+
+double Benchmark::millisecondsSince( const std::chrono::steady_clock::time_point begin ) noexcept
+{
+	return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - begin ).count();
+}
+
+const char* Benchmark::getPhaseName( const FramePhase phase ) noexcept
+{
+	switch ( phase )
+	{
+	case FramePhase::Acquire:		return "acquire";
+	case FramePhase::FenceWait:		return "fenceWait";
+	case FramePhase::Record:		return "record";
+	case FramePhase::Submit:		return "submit";
+	case FramePhase::Present:		return "present";
+	default:						return "unknown";
+	}
+}
+
+double Benchmark::getMedian( const std::vector<double>& samples ) noexcept
+{
+	if ( true == samples.empty() )
+	{
+		return 0.0;
+	}
+
+	std::vector<double> sorted( samples );
+	std::sort( sorted.begin(), sorted.end() );
+
+	return sorted[sorted.size() / 2];
+}
+
+void Benchmark::writeSummary( std::ostream& stream, const std::vector<double>& samples ) noexcept
+{
+	if ( true == samples.empty() )
+	{
+		stream << "null";
+		return;
+	}
+
+	std::vector<double> sorted( samples );
+	std::sort( sorted.begin(), sorted.end() );
+
+	// Nearest-rank percentile.
+	const auto percentile = [&sorted]( const double p ) noexcept
+	{
+		const size_t rank = static_cast<size_t>( std::ceil( p * sorted.size() ) );
+		return sorted[std::min( sorted.size() - 1, ( 0 < rank ) ? rank - 1 : 0 )];
+	};
+
+	stream << "{ \"samples\": " << sorted.size()
+		   << ", \"min\": " << sorted.front()
+		   << ", \"median\": " << percentile( 0.50 )
+		   << ", \"p95\": " << percentile( 0.95 )
+		   << ", \"p99\": " << percentile( 0.99 )
+		   << ", \"max\": " << sorted.back()
+		   << " }";
+}
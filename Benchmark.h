@@ -0,0 +1,95 @@
+#pragma once
+
+enum class FramePhase : uint32_t
+{
+	Acquire = 0,
+	FenceWait,
+	Record,
+	Submit,
+	Present,
+	Count
+};
+
+struct BenchmarkContext
+{
+	bool			_headless;
+	std::string		_presentMode;
+	uint32_t		_framesInFlight;
+	bool			_lowLatency;
+	uint32_t		_sampleCount;
+	uint32_t		_swapChainImageCount;
+	VkExtent2D		_extent;
+	uint32_t		_vertexCount;
+	uint32_t		_indexCount;
+	uint32_t		_drawCount;
+	uint32_t		_instanceCount;
+	bool			_gpuCulling;
+	uint32_t		_visibleCount;
+	uint32_t		_recordThreadCount;
+	double			_startupMs;
+	// Pipeline compile time the render thread spent, including waits on workers, and the time workers spent beside it.
+	double			_pipelineCriticalMs;
+	double			_pipelineBackgroundMs;
+	uint32_t		_pipelineCount;
+	double			_meshLoadMs;
+	double			_meshMegabytesPerSecond;
+	uint32_t		_indexSize;
+	uint32_t		_vertexStride;
+	double			_acmr;
+	double			_atvr;
+	double			_textureUploadMBps;
+	VkDeviceSize	_textureResidentBytes;
+	uint32_t		_particleCount;
+	double			_particleSimulateMs;
+	double			_particleDrawMs;
+};
+
+// Recording times for one thread count of the recording scaling benchmark.
+struct ScalingSample
+{
+	uint32_t				_threadCount;
+	std::vector<double>		_times;
+};
+
+class Benchmark
+{
+public:
+
+	Benchmark( void );
+
+	void			configure( const uint32_t warmupFrames, const uint32_t measuredFrames ) noexcept;
+
+	bool			isEnabled( void ) const noexcept;
+	bool			isMeasuring( void ) const noexcept;
+	bool			isFinished( void ) const noexcept;
+
+	void			beginFrame( void ) noexcept;
+	void			addPhaseTime( const FramePhase phase, const double milliseconds ) noexcept;
+	void			addGpuTime( const double milliseconds ) noexcept;
+	// From sampling a frame's input to its fence signaling, when the image is ready to be presented.
+	void			addLatency( const double milliseconds ) noexcept;
+
+	void			writeJson( std::ostream& stream, const BenchmarkContext& context ) const noexcept;
+
+	// Writes a JSON array with throughput and speedup relative to the first sample.
+	static void		writeScaling( std::ostream& stream, const uint32_t itemCount, const std::vector<ScalingSample>& samples ) noexcept;
+	static void		writeSummary( std::ostream& stream, const std::vector<double>& samples ) noexcept;
+	static double	getMedian( const std::vector<double>& samples ) noexcept;
+
+	static double	millisecondsSince( const std::chrono::steady_clock::time_point begin ) noexcept;
+	static const char*	getPhaseName( const FramePhase phase ) noexcept;
+
+private:
+
+	bool										_enabled;
+	uint32_t									_warmupFrames;
+	uint32_t									_measuredFrames;
+	uint32_t									_frameIndex;
+
+	std::chrono::steady_clock::time_point		_lastFrameBegin;
+
+	std::vector<double>							_frameTimes;
+	std::vector<double>							_gpuTimes;
+	std::vector<double>							_latencies;
+	std::array<std::vector<double>, static_cast<size_t>( FramePhase::Count )>	_phaseTimes;
+};
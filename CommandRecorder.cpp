@@ -0,0 +1,187 @@
+#include "pch.h"
+
+#include "CommandRecorder.h"
+
+CommandRecorder::CommandRecorder( void )
+	: _device{ VK_NULL_HANDLE }
+	, _jobSystem{ nullptr }
+	, _threadCount{ 0 }
+	, _activeThreadCount{ 0 }
+	, _failed{ false }
+	, _jobFrame{ 0 }
+	, _jobInheritance{}
+	, _jobDrawCount{ 0 }
+	, _jobSliceCount{ 0 }
+	, _jobCallback{ nullptr }
+{
+
+}
+
+bool CommandRecorder::create( const VkDevice device, const uint32_t queueFamilyIndex, const uint32_t frameCount, const uint32_t threadCount, JobSystem& jobSystem ) noexcept
+{
+	_device								= device;
+	_jobSystem							= &jobSystem;
+	_threadCount						= std::max( threadCount, 1u );
+	_activeThreadCount					= _threadCount;
+
+	// Pools are reset wholesale every frame, so nothing is ever freed or reset individually.
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags						= VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex			= queueFamilyIndex;
+
+	_frames.resize( frameCount );
+
+	for ( FrameContext& frame : _frames )
+	{
+		if ( VK_SUCCESS != vkCreateCommandPool( _device, &poolInfo, nullptr, &frame._primaryPool ) )
+		{
+			return false;
+		}
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType					= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool			= frame._primaryPool;
+		allocInfo.level					= VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount	= 1;
+
+		if ( VK_SUCCESS != vkAllocateCommandBuffers( _device, &allocInfo, &frame._primary ) )
+		{
+			return false;
+		}
+
+		frame._slicePools.resize( _threadCount, VK_NULL_HANDLE );
+		frame._secondaries.resize( _threadCount, VK_NULL_HANDLE );
+
+		for ( uint32_t ii = 0; ii < _threadCount; ++ii )
+		{
+			if ( VK_SUCCESS != vkCreateCommandPool( _device, &poolInfo, nullptr, &frame._slicePools[ii] ) )
+			{
+				return false;
+			}
+
+			allocInfo.commandPool		= frame._slicePools[ii];
+			allocInfo.level				= VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+			if ( VK_SUCCESS != vkAllocateCommandBuffers( _device, &allocInfo, &frame._secondaries[ii] ) )
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void CommandRecorder::destroy( void ) noexcept
+{
+	for ( FrameContext& frame : _frames )
+	{
+		for ( VkCommandPool pool : frame._slicePools )
+		{
+			vkDestroyCommandPool( _device, pool, nullptr );
+		}
+
+		vkDestroyCommandPool( _device, frame._primaryPool, nullptr );
+	}
+
+	_frames.clear();
+}
+
+bool CommandRecorder::recordFrame( const uint32_t frame, const VkCommandBufferInheritanceInfo& inheritance, const uint32_t drawCount, const RecordCallback& callback ) noexcept
+{
+	FrameContext& context				= _frames[frame];
+
+	// Resetting the pool recycles every command buffer allocated from it in one call.
+	if ( VK_SUCCESS != vkResetCommandPool( _device, context._primaryPool, 0 ) )
+	{
+		return false;
+	}
+
+	const uint32_t sliceCount			= std::max( std::min( _activeThreadCount, ( drawCount + MIN_DRAWS_PER_THREAD - 1 ) / MIN_DRAWS_PER_THREAD ), 1u );
+
+	for ( uint32_t ii = 0; ii < sliceCount; ++ii )
+	{
+		if ( VK_SUCCESS != vkResetCommandPool( _device, context._slicePools[ii], 0 ) )
+		{
+			return false;
+		}
+	}
+
+	_jobFrame							= frame;
+	_jobInheritance						= inheritance;
+	_jobInheritance.pNext				= nullptr;
+	_jobDrawCount						= drawCount;
+	_jobSliceCount						= sliceCount;
+	_jobCallback						= &callback;
+	_failed								= false;
+
+	// One slice per batch; parallelFor waits for all of them and orders their writes before it returns.
+	_jobSystem->parallelFor( sliceCount, 1, [this]( const uint32_t first, const uint32_t count )
+	{
+		for ( uint32_t slice = first; slice < first + count; ++slice )
+		{
+			if ( false == recordSlice( slice ) )
+			{
+				_failed.store( true, std::memory_order_relaxed );
+			}
+		}
+	} );
+
+	context._secondaryCount				= sliceCount;
+
+	return false == _failed;
+}
+
+void CommandRecorder::executeSecondaries( const uint32_t frame, const VkCommandBuffer primary ) const noexcept
+{
+	const FrameContext& context			= _frames[frame];
+
+	if ( 0 < context._secondaryCount )
+	{
+		vkCmdExecuteCommands( primary, context._secondaryCount, context._secondaries.data() );
+	}
+}
+
+VkCommandBuffer CommandRecorder::getPrimaryCommandBuffer( const uint32_t frame ) const noexcept
+{
+	return _frames[frame]._primary;
+}
+
+uint32_t CommandRecorder::getThreadCount( void ) const noexcept
+{
+	return _threadCount;
+}
+
+uint32_t CommandRecorder::getActiveThreadCount( void ) const noexcept
+{
+	return _activeThreadCount;
+}
+
+void CommandRecorder::setActiveThreadCount( const uint32_t threadCount ) noexcept
+{
+	_activeThreadCount					= std::min( std::max( threadCount, 1u ), _threadCount );
+}
+
+bool CommandRecorder::recordSlice( const uint32_t slice ) noexcept
+{
+	const VkCommandBuffer commandBuffer	= _frames[_jobFrame]._secondaries[slice];
+
+	// Even split; slice sizes differ by at most one draw.
+	const uint32_t firstDraw			= static_cast<uint32_t>( ( static_cast<uint64_t>( _jobDrawCount ) * slice ) / _jobSliceCount );
+	const uint32_t lastDraw				= static_cast<uint32_t>( ( static_cast<uint64_t>( _jobDrawCount ) * ( slice + 1 ) ) / _jobSliceCount );
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags						= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo			= &_jobInheritance;
+
+	if ( VK_SUCCESS != vkBeginCommandBuffer( commandBuffer, &beginInfo ) )
+	{
+		return false;
+	}
+
+	( *_jobCallback )( commandBuffer, firstDraw, lastDraw - firstDraw );
+
+	return VK_SUCCESS == vkEndCommandBuffer( commandBuffer );
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "JobSystem.h"
+
+// Records draws [firstDraw, firstDraw + drawCount) into a secondary command buffer that is already begun.
+typedef std::function<void( VkCommandBuffer commandBuffer, const uint32_t firstDraw, const uint32_t drawCount )> RecordCallback;
+
+// Splits each frame's draws into slices recorded in parallel on the job system, one secondary command buffer
+// and pool per slice. The thread count caps the slices, so it is the most threads that can record at once.
+class CommandRecorder
+{
+public:
+
+	CommandRecorder( void );
+
+	bool				create( const VkDevice device, const uint32_t queueFamilyIndex, const uint32_t frameCount, const uint32_t threadCount, JobSystem& jobSystem ) noexcept;
+	void				destroy( void ) noexcept;
+
+	// Resets the frame's pools and splits the draw list into at most the active thread count of slices. Call from
+	// a job system thread; the frame's previous submission must have completed.
+	bool				recordFrame( const uint32_t frame, const VkCommandBufferInheritanceInfo& inheritance, const uint32_t drawCount, const RecordCallback& callback ) noexcept;
+
+	// Must be called inside a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+	void				executeSecondaries( const uint32_t frame, const VkCommandBuffer primary ) const noexcept;
+
+	VkCommandBuffer		getPrimaryCommandBuffer( const uint32_t frame ) const noexcept;
+
+	uint32_t			getThreadCount( void ) const noexcept;
+	uint32_t			getActiveThreadCount( void ) const noexcept;
+	void				setActiveThreadCount( const uint32_t threadCount ) noexcept;
+
+private:
+
+	// Below this many draws per slice, another job costs more than it saves.
+	static const uint32_t	MIN_DRAWS_PER_THREAD = 64;
+
+	struct FrameContext
+	{
+		VkCommandPool					_primaryPool	= VK_NULL_HANDLE;
+		VkCommandBuffer					_primary		= VK_NULL_HANDLE;
+
+		// Indexed by slice; a slice is recorded by one job, so its pool is never used from two threads at once.
+		std::vector<VkCommandPool>		_slicePools;
+		std::vector<VkCommandBuffer>	_secondaries;
+		uint32_t						_secondaryCount	= 0;
+	};
+
+	bool				recordSlice( const uint32_t slice ) noexcept;
+
+	VkDevice							_device;
+	JobSystem*							_jobSystem;
+	std::vector<FrameContext>			_frames;
+	uint32_t							_threadCount;
+	uint32_t							_activeThreadCount;
+	std::atomic<bool>					_failed;
+
+	// The frame being recorded; written before the slices are handed to the job system, stable until they finish.
+	uint32_t							_jobFrame;
+	VkCommandBufferInheritanceInfo		_jobInheritance;
+	uint32_t							_jobDrawCount;
+	uint32_t							_jobSliceCount;
+	const RecordCallback*				_jobCallback;
+};
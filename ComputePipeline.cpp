@@ -0,0 +1,169 @@
+#include "pch.h"
+
+#include "ComputePipeline.h"
+#include "Benchmark.h"
+
+ComputePipeline::ComputePipeline( void )
+	: _device{ VK_NULL_HANDLE }
+	, _layout{ VK_NULL_HANDLE }
+	, _pipeline{ VK_NULL_HANDLE }
+{
+
+}
+
+bool ComputePipeline::load( const std::string& fileName ) noexcept
+{
+	_fileName = fileName;
+
+	if ( FileError::None != File::map( fileName, _code ) )
+	{
+		return false;
+	}
+
+	if ( ( 0 != ( _code.getSize() % sizeof( uint32_t ) ) ) || ( false == _reflection.reflect( _code.getWords(), _code.getWordCount() ) ) )
+	{
+		std::cerr << "compute: " << fileName << " is not a valid SPIR-V module" << std::endl;
+		return false;
+	}
+
+	if ( VK_SHADER_STAGE_COMPUTE_BIT != _reflection.getStages() )
+	{
+		std::cerr << "compute: " << fileName << " is not a compute shader" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool ComputePipeline::create( const VkDevice device, PipelineCache& pipelineCache, PipelineLayoutCache& layoutCache, const std::vector<ComputeConstant>& constants ) noexcept
+{
+	_device = device;
+
+	// One layout per set up to the highest the shader uses, the same handles the pipeline layout is built from.
+	const std::vector<ShaderBinding>& bindings = _reflection.getBindings();
+	const uint32_t setCount = ( true == bindings.empty() ) ? 0 : bindings.back()._set + 1;
+
+	for ( uint32_t set = 0; set < setCount; ++set )
+	{
+		_setLayouts.push_back( layoutCache.getDescriptorSetLayout( _reflection, set ) );
+	}
+
+	_layout = layoutCache.getPipelineLayout( _reflection );
+
+	if ( ( VK_NULL_HANDLE == _layout ) || ( _setLayouts.end() != std::find( _setLayouts.begin(), _setLayouts.end(), VK_NULL_HANDLE ) ) )
+	{
+		return false;
+	}
+
+	std::vector<VkSpecializationMapEntry> entries;
+
+	for ( size_t ii = 0; ii < constants.size(); ++ii )
+	{
+		const ShaderSpecializationConstant* constant = _reflection.findSpecializationConstant( constants[ii]._id );
+
+		if ( ( nullptr == constant ) || ( sizeof( uint32_t ) != constant->_size ) )
+		{
+			std::cerr << "compute: " << _fileName << " has no 32-bit specialization constant " << constants[ii]._id << std::endl;
+			return false;
+		}
+
+		entries.push_back( VkSpecializationMapEntry{ constants[ii]._id, static_cast<uint32_t>( ii * sizeof( ComputeConstant ) + offsetof( ComputeConstant, _value ) ), sizeof( uint32_t ) } );
+	}
+
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount			= static_cast<uint32_t>( entries.size() );
+	specializationInfo.pMapEntries				= entries.data();
+	specializationInfo.dataSize					= constants.size() * sizeof( ComputeConstant );
+	specializationInfo.pData					= constants.data();
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType							= VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize							= _code.getSize();
+	moduleInfo.pCode							= _code.getWords();
+
+	VkShaderModule shaderModule = VK_NULL_HANDLE;
+	if ( VK_SUCCESS != vkCreateShaderModule( _device, &moduleInfo, nullptr, &shaderModule ) )
+	{
+		return false;
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType							= VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType					= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage					= VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module					= shaderModule;
+	pipelineInfo.stage.pName					= "main";
+	pipelineInfo.stage.pSpecializationInfo		= ( true == entries.empty() ) ? nullptr : &specializationInfo;
+	pipelineInfo.layout							= _layout;
+
+	const auto createBegin						= std::chrono::steady_clock::now();
+	const VkResult result						= vkCreateComputePipelines( _device, pipelineCache.getHandle(), 1, &pipelineInfo, nullptr, &_pipeline );
+
+	vkDestroyShaderModule( _device, shaderModule, nullptr );
+	_code.close();
+
+	if ( VK_SUCCESS != result )
+	{
+		std::cerr << "compute: failed to create the pipeline for " << _fileName << std::endl;
+		return false;
+	}
+
+	pipelineCache.addCreateTime( Benchmark::millisecondsSince( createBegin ) );
+
+	return true;
+}
+
+void ComputePipeline::destroy( void ) noexcept
+{
+	if ( VK_NULL_HANDLE != _pipeline )
+	{
+		vkDestroyPipeline( _device, _pipeline, nullptr );
+	}
+
+	_code.close();
+	_setLayouts.clear();
+	_layout		= VK_NULL_HANDLE;
+	_pipeline	= VK_NULL_HANDLE;
+}
+
+const ShaderReflection& ComputePipeline::getReflection( void ) const noexcept
+{
+	return _reflection;
+}
+
+VkPipeline ComputePipeline::getHandle( void ) const noexcept
+{
+	return _pipeline;
+}
+
+VkPipelineLayout ComputePipeline::getLayout( void ) const noexcept
+{
+	return _layout;
+}
+
+VkDescriptorSetLayout ComputePipeline::getSetLayout( const uint32_t set ) const noexcept
+{
+	return ( set < _setLayouts.size() ) ? _setLayouts[set] : VK_NULL_HANDLE;
+}
+
+void ComputePipeline::bind( const VkCommandBuffer commandBuffer, const uint32_t firstSet, const uint32_t setCount, const VkDescriptorSet* sets ) const noexcept
+{
+	vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline );
+
+	if ( 0 != setCount )
+	{
+		vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _layout, firstSet, setCount, sets, 0, nullptr );
+	}
+}
+
+void ComputePipeline::pushConstants( const VkCommandBuffer commandBuffer, const void* data, const uint32_t size ) const noexcept
+{
+	vkCmdPushConstants( commandBuffer, _layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, size, data );
+}
+
+void ComputePipeline::dispatch( const VkCommandBuffer commandBuffer, const uint32_t itemCount ) const noexcept
+{
+	const uint32_t groupSize = _reflection.getLocalSize()[0];
+
+	vkCmdDispatch( commandBuffer, ( itemCount + groupSize - 1 ) / groupSize, 1, 1 );
+}
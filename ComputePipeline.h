@@ -0,0 +1,51 @@
+#pragma once
+
+#include "File.h"
+#include "ShaderReflection.h"
+#include "PipelineCache.h"
+#include "PipelineLayoutCache.h"
+
+// A specialization constant by id; booleans are passed as VK_TRUE or VK_FALSE.
+struct ComputeConstant
+{
+	uint32_t	_id;
+	uint32_t	_value;
+};
+
+// A compute shader and the pipeline built from it. load() maps and reflects the module so that the caller
+// can check its interface; create() takes the set and pipeline layouts from the layout cache and builds
+// the pipeline. Dispatches are sized from the shader's own local_size.
+class ComputePipeline
+{
+public:
+
+	ComputePipeline( void );
+
+	bool					load( const std::string& fileName ) noexcept;
+	// The module is released afterwards; constants missing from the shader are an error.
+	bool					create( const VkDevice device, PipelineCache& pipelineCache, PipelineLayoutCache& layoutCache, const std::vector<ComputeConstant>& constants ) noexcept;
+	// Layouts belong to the layout cache.
+	void					destroy( void ) noexcept;
+
+	const ShaderReflection&	getReflection( void ) const noexcept;
+	VkPipeline				getHandle( void ) const noexcept;
+	VkPipelineLayout		getLayout( void ) const noexcept;
+	// The layout of one of the shader's sets, for allocating descriptor sets against.
+	VkDescriptorSetLayout	getSetLayout( const uint32_t set ) const noexcept;
+
+	void					bind( const VkCommandBuffer commandBuffer, const uint32_t firstSet, const uint32_t setCount, const VkDescriptorSet* sets ) const noexcept;
+	void					pushConstants( const VkCommandBuffer commandBuffer, const void* data, const uint32_t size ) const noexcept;
+	// Enough workgroups along x to cover itemCount invocations; the shader checks the bound itself.
+	void					dispatch( const VkCommandBuffer commandBuffer, const uint32_t itemCount ) const noexcept;
+
+private:
+
+	std::string							_fileName;
+	MappedFile							_code;
+	ShaderReflection					_reflection;
+
+	VkDevice							_device;
+	std::vector<VkDescriptorSetLayout>	_setLayouts;
+	VkPipelineLayout					_layout;
+	VkPipeline							_pipeline;
+};
@@ -0,0 +1,157 @@
+#include "pch.h"
+
+#include "CullingBenchmark.h"
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+
+namespace
+{
+	const uint32_t WARMUP_ITERATIONS	= 5;
+	const uint32_t MEASURED_ITERATIONS	= 50;
+	const uint32_t DEFAULT_OBJECT_COUNT	= 1 << 20;
+	const uint32_t RANDOM_SEED			= 1234;
+
+	struct KernelSample
+	{
+		CullingKernel			_kernel;
+		uint32_t				_visibleCount;
+		std::vector<double>		_times;
+	};
+
+	std::vector<double> measure( FrustumCuller& culler, JobSystem* jobSystem, uint32_t& visibleCount ) noexcept
+	{
+		const Frustum frustum = Frustum::getClipVolume();
+		std::vector<uint32_t> visible;
+		std::vector<double> times;
+
+		for ( uint32_t ii = 0; ii < WARMUP_ITERATIONS + MEASURED_ITERATIONS; ++ii )
+		{
+			const auto begin	= std::chrono::steady_clock::now();
+
+			visibleCount		= culler.cull( frustum, visible, jobSystem );
+
+			if ( WARMUP_ITERATIONS <= ii )
+			{
+				times.push_back( Benchmark::millisecondsSince( begin ) );
+			}
+		}
+
+		return times;
+	}
+}
+
+void CullingBenchmark::run( const Options& options ) noexcept
+{
+	uint32_t threadCount = options._jobThreads;
+	if ( 0 == threadCount )
+	{
+		threadCount = std::max( std::thread::hardware_concurrency(), 1u );
+	}
+
+	const uint32_t objectCount = ( 1 < options._drawCount ) ? options._drawCount : DEFAULT_OBJECT_COUNT;
+
+	// Spheres scattered over twice the clip volume in every direction, so roughly a fifth survive and
+	// the visibility pattern is random enough to defeat the branch predictor in a naive loop.
+	FrustumCuller culler;
+	culler.resize( objectCount );
+
+	std::mt19937 random( RANDOM_SEED );
+	std::uniform_real_distribution<float> position( -2.0f, 2.0f );
+	std::uniform_real_distribution<float> depth( -0.5f, 1.5f );
+	std::uniform_real_distribution<float> radius( 0.0f, 0.3f );
+
+	for ( uint32_t ii = 0; ii < objectCount; ++ii )
+	{
+		const float x = position( random );
+		const float y = position( random );
+		const float z = depth( random );
+
+		culler.setSphere( ii, glm::vec4( x, y, z, radius( random ) ) );
+	}
+
+	std::vector<KernelSample> kernels;
+
+	for ( uint32_t ii = 0; ii < static_cast<uint32_t>( CullingKernel::Count ); ++ii )
+	{
+		const CullingKernel kernel = static_cast<CullingKernel>( ii );
+		if ( false == FrustumCuller::isSupported( kernel ) )
+		{
+			continue;
+		}
+
+		KernelSample sample{};
+		sample._kernel	= kernel;
+
+		culler.setKernel( kernel );
+		sample._times	= measure( culler, nullptr, sample._visibleCount );
+
+		kernels.push_back( std::move( sample ) );
+	}
+
+	// Thread counts double up to the pool size, which is always measured last.
+	std::vector<uint32_t> threadCounts;
+	for ( uint32_t count = 1; count < threadCount; count *= 2 )
+	{
+		threadCounts.push_back( count );
+	}
+	threadCounts.push_back( threadCount );
+
+	std::vector<ScalingSample> scaling;
+	culler.setKernel( FrustumCuller::getBestKernel() );
+
+	for ( const uint32_t count : threadCounts )
+	{
+		JobSystem jobSystem;
+		jobSystem.create( count );
+
+		ScalingSample sample{};
+		sample._threadCount	= count;
+
+		uint32_t visibleCount = 0;
+		sample._times		= measure( culler, &jobSystem, visibleCount );
+
+		jobSystem.destroy();
+		scaling.push_back( std::move( sample ) );
+	}
+
+	std::ofstream file;
+	if ( false == options._benchmarkOutput.empty() )
+	{
+		file.open( options._benchmarkOutput, std::ios::trunc );
+		if ( false == file.is_open() )
+		{
+			std::cerr << "failed to open " << options._benchmarkOutput << std::endl;
+			return;
+		}
+	}
+
+	std::ostream& stream = ( true == file.is_open() ) ? static_cast<std::ostream&>( file ) : std::cout;
+
+	const double scalarMedian = Benchmark::getMedian( kernels.front()._times );
+
+	stream << "{\n";
+	stream << "  \"objectCount\": " << objectCount << ",\n";
+	stream << "  \"threadCount\": " << threadCount << ",\n";
+	stream << "  \"kernels\": [\n";
+
+	// A kernel that disagrees with the scalar one is fast for the wrong reason.
+
+	for ( size_t ii = 0; ii < kernels.size(); ++ii )
+	{
+		const KernelSample& sample	= kernels[ii];
+		const double median			= Benchmark::getMedian( sample._times );
+
+		stream << "    { \"kernel\": \"" << FrustumCuller::getKernelName( sample._kernel ) << "\", \"visibleCount\": " << sample._visibleCount
+			   << ", \"matchesScalar\": " << ( ( kernels.front()._visibleCount == sample._visibleCount ) ? "true" : "false" )
+			   << ", \"objectsPerMs\": " << ( objectCount / std::max( median, 1e-6 ) )
+			   << ", \"speedup\": " << ( scalarMedian / std::max( median, 1e-6 ) ) << ", \"ms\": ";
+		Benchmark::writeSummary( stream, sample._times );
+		stream << " }" << ( ( ii + 1 < kernels.size() ) ? ",\n" : "\n" );
+	}
+
+	stream << "  ],\n";
+	stream << "  \"threadedKernel\": \"" << FrustumCuller::getKernelName( culler.getKernel() ) << "\",\n";
+	stream << "  \"threaded\": ";
+	Benchmark::writeScaling( stream, objectCount, scaling );
+	stream << "\n}" << std::endl;
+}
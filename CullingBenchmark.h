@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Options.h"
+#include "Benchmark.h"
+
+// Throughput of FrustumCuller's kernels on a synthetic scene: every kernel on one thread against the
+// scalar baseline, then the best kernel split across the job system. Runs without a Vulkan device
+// and reports as JSON.
+class CullingBenchmark
+{
+public:
+
+	static void		run( const Options& options ) noexcept;
+};
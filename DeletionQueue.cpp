@@ -0,0 +1,32 @@
+#include "pch.h"
+
+#include "DeletionQueue.h"
+
+DeletionQueue::DeletionQueue( void )
+{
+
+}
+
+void DeletionQueue::retire( const uint64_t frame, std::function<void( void )> destroy ) noexcept
+{
+	_entries.push_back( Entry{ frame, std::move( destroy ) } );
+}
+
+void DeletionQueue::collect( const uint64_t firstIncompleteFrame ) noexcept
+{
+	while ( ( false == _entries.empty() ) && ( _entries.front()._frame < firstIncompleteFrame ) )
+	{
+		_entries.front()._destroy();
+		_entries.pop_front();
+	}
+}
+
+void DeletionQueue::flush( void ) noexcept
+{
+	collect( UINT64_MAX );
+}
+
+size_t DeletionQueue::getPendingCount( void ) const noexcept
+{
+	return _entries.size();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// Destroys GPU resources once no submitted frame can still use them, instead of idling the device first.
+// A resource retired while frame N is being prepared may still be used by frame N and those before it,
+// so it is destroyed once every frame up to N has completed.
+class DeletionQueue
+{
+public:
+
+	DeletionQueue( void );
+
+	void			retire( const uint64_t frame, std::function<void( void )> destroy ) noexcept;
+
+	// Destroys everything retired before firstIncompleteFrame, the oldest frame the GPU may still be working on.
+	void			collect( const uint64_t firstIncompleteFrame ) noexcept;
+
+	// Destroys everything regardless of frames; only once the device is idle.
+	void			flush( void ) noexcept;
+
+	size_t			getPendingCount( void ) const noexcept;
+
+private:
+
+	struct Entry
+	{
+		uint64_t					_frame;
+		std::function<void( void )>	_destroy;
+	};
+
+	// Retired in frame order, so collection only ever pops from the front.
+	std::deque<Entry>	_entries;
+};
@@ -1,23 +1,310 @@
 #include "pch.h"
 
 #include "File.h"
+#include "JobSystem.h"
 
-std::vector<char> File::readFile( const std::string& fileName ) noexcept
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace
+{
+	// The smallest page size of any supported platform; touching one byte per page faults them all in.
+	const size_t PREFETCH_STRIDE = 4096;
+}
+
+MappedFile::MappedFile( void )
+	: _data{ nullptr }
+	, _size{ 0 }
+	, _isOpen{ false }
+#ifdef _WIN32
+	, _file{ INVALID_HANDLE_VALUE }
+	, _mapping{ nullptr }
+#endif
+{
+
+}
+
+MappedFile::~MappedFile( void )
 {
-	std::ifstream file( fileName, std::ios::ate | std::ios::binary );
+	close();
+}
+
+MappedFile::MappedFile( MappedFile&& other ) noexcept
+	: MappedFile()
+{
+	*this = std::move( other );
+}
 
-	if ( false == file.is_open() )
+MappedFile& MappedFile::operator=( MappedFile&& other ) noexcept
+{
+	if ( this != &other )
 	{
-		return std::vector<char>();
+		close();
+
+		std::swap( _data, other._data );
+		std::swap( _size, other._size );
+		std::swap( _isOpen, other._isOpen );
+#ifdef _WIN32
+		std::swap( _file, other._file );
+		std::swap( _mapping, other._mapping );
+#endif
 	}
 
-	const size_t fileSize = static_cast<size_t>( file.tellg() );
-	std::vector<char> buffer( fileSize );
+	return *this;
+}
 
-	file.seekg( 0 );
-	file.read( buffer.data(), fileSize );
+FileError MappedFile::open( const std::string& fileName ) noexcept
+{
+	close();
 
-	file.close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+	if ( INVALID_HANDLE_VALUE == file )
+	{
+		const DWORD error = GetLastError();
+		if ( ( ERROR_FILE_NOT_FOUND == error ) || ( ERROR_PATH_NOT_FOUND == error ) )
+		{
+			return FileError::NotFound;
+		}
+
+		return ( ERROR_ACCESS_DENIED == error ) ? FileError::AccessDenied : FileError::ReadFailed;
+	}
+
+	LARGE_INTEGER size{};
+	if ( ( FALSE == GetFileSizeEx( file, &size ) ) || ( static_cast<unsigned long long>( size.QuadPart ) > SIZE_MAX ) )
+	{
+		CloseHandle( file );
+		return FileError::ReadFailed;
+	}
+
+	_file		= file;
+	_size		= static_cast<size_t>( size.QuadPart );
+	_isOpen		= true;
+
+	// Windows cannot map an empty file; it is still a valid, empty view.
+	if ( 0 == _size )
+	{
+		return FileError::None;
+	}
+
+	_mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if ( nullptr == _mapping )
+	{
+		close();
+		return FileError::MapFailed;
+	}
+
+	_data = static_cast<const char*>( MapViewOfFile( _mapping, FILE_MAP_READ, 0, 0, 0 ) );
+	if ( nullptr == _data )
+	{
+		close();
+		return FileError::MapFailed;
+	}
+#else
+	const int descriptor = ::open( fileName.c_str(), O_RDONLY | O_CLOEXEC );
+	if ( -1 == descriptor )
+	{
+		if ( ( ENOENT == errno ) || ( ENOTDIR == errno ) )
+		{
+			return FileError::NotFound;
+		}
+
+		return ( ( EACCES == errno ) || ( EPERM == errno ) ) ? FileError::AccessDenied : FileError::ReadFailed;
+	}
+
+	struct stat status{};
+	if ( ( 0 != fstat( descriptor, &status ) ) || ( false == S_ISREG( status.st_mode ) ) || ( static_cast<unsigned long long>( status.st_size ) > SIZE_MAX ) )
+	{
+		::close( descriptor );
+		return FileError::ReadFailed;
+	}
+
+	_size		= static_cast<size_t>( status.st_size );
+	_isOpen		= true;
+
+	if ( 0 < _size )
+	{
+		void* data = mmap( nullptr, _size, PROT_READ, MAP_PRIVATE, descriptor, 0 );
+		if ( MAP_FAILED == data )
+		{
+			::close( descriptor );
+			close();
+			return FileError::MapFailed;
+		}
+
+		// Start readahead now; prefetch() or the first reads will find the pages already on their way.
+		madvise( data, _size, MADV_WILLNEED );
+		_data	= static_cast<const char*>( data );
+	}
+
+	// The mapping keeps the file alive on its own.
+	::close( descriptor );
+#endif
+
+	return FileError::None;
+}
+
+void MappedFile::close( void ) noexcept
+{
+#ifdef _WIN32
+	if ( nullptr != _data )
+	{
+		UnmapViewOfFile( _data );
+	}
+
+	if ( nullptr != _mapping )
+	{
+		CloseHandle( _mapping );
+	}
+
+	if ( INVALID_HANDLE_VALUE != _file )
+	{
+		CloseHandle( _file );
+	}
+
+	_file		= INVALID_HANDLE_VALUE;
+	_mapping	= nullptr;
+#else
+	if ( nullptr != _data )
+	{
+		munmap( const_cast<char*>( _data ), _size );
+	}
+#endif
+
+	_data		= nullptr;
+	_size		= 0;
+	_isOpen		= false;
+}
 
-	return buffer;
+void MappedFile::prefetch( void ) const noexcept
+{
+	// The sum is only there so the compiler cannot drop the reads.
+	volatile unsigned char sink = 0;
+	unsigned char sum = 0;
+
+	for ( size_t offset = 0; offset < _size; offset += PREFETCH_STRIDE )
+	{
+		sum += static_cast<unsigned char>( _data[offset] );
+	}
+
+	sink = sum;
+	( void ) sink;
+}
+
+bool MappedFile::isOpen( void ) const noexcept
+{
+	return _isOpen;
+}
+
+const char* MappedFile::getData( void ) const noexcept
+{
+	return _data;
+}
+
+size_t MappedFile::getSize( void ) const noexcept
+{
+	return _size;
+}
+
+const uint32_t* MappedFile::getWords( void ) const noexcept
+{
+	// Mappings are page aligned, which is what makes reading words in place legal.
+	return reinterpret_cast<const uint32_t*>( _data );
+}
+
+size_t MappedFile::getWordCount( void ) const noexcept
+{
+	return _size / sizeof( uint32_t );
+}
+
+FileReadRequest::FileReadRequest( void )
+	: _error{ FileError::None }
+	, _jobSystem{ nullptr }
+	, _job{ nullptr }
+{
+
+}
+
+FileReadRequest::~FileReadRequest( void )
+{
+	// The job writes into this object, so it has to finish first.
+	wait();
+}
+
+void FileReadRequest::start( const std::string& fileName, JobSystem& jobSystem ) noexcept
+{
+	wait();
+
+	_fileName	= fileName;
+	_error		= FileError::None;
+	_jobSystem	= &jobSystem;
+
+	_job = jobSystem.createJob( nullptr, [this]()
+	{
+		_error = _file.open( _fileName );
+
+		if ( FileError::None == _error )
+		{
+			_file.prefetch();
+		}
+	} );
+
+	jobSystem.run( _job );
+}
+
+FileError FileReadRequest::wait( void ) noexcept
+{
+	if ( nullptr == _job )
+	{
+		return _error;
+	}
+
+	_jobSystem->wait( _job );
+	_job = nullptr;
+
+	if ( FileError::None != _error )
+	{
+		std::cerr << "failed to read " << _fileName << ": " << File::getErrorString( _error ) << std::endl;
+	}
+
+	return _error;
+}
+
+MappedFile& FileReadRequest::getFile( void ) noexcept
+{
+	return _file;
+}
+
+FileError File::map( const std::string& fileName, MappedFile& file ) noexcept
+{
+	const FileError error = file.open( fileName );
+
+	if ( FileError::None != error )
+	{
+		std::cerr << "failed to read " << fileName << ": " << getErrorString( error ) << std::endl;
+	}
+
+	return error;
+}
+
+const char* File::getErrorString( const FileError error ) noexcept
+{
+	switch ( error )
+	{
+	case FileError::None:			return "no error";
+	case FileError::NotFound:		return "file not found";
+	case FileError::AccessDenied:	return "access denied";
+	case FileError::ReadFailed:		return "read failed";
+	case FileError::MapFailed:		return "memory mapping failed";
+	default:						return "unknown error";
+	}
 }
@@ -1,7 +1,92 @@
 #pragma once
 
+struct Job;
+class JobSystem;
+
+enum class FileError : uint32_t
+{
+	None = 0,
+	NotFound,
+	AccessDenied,
+	ReadFailed,
+	MapFailed
+};
+
+// Read-only view of a whole file mapped into memory. The bytes start on a page boundary, so
+// they can be read in place as 32-bit words (SPIR-V, glTF binary chunks) without a copy.
+class MappedFile
+{
+public:
+
+	MappedFile( void );
+	~MappedFile( void );
+
+	MappedFile( MappedFile&& other ) noexcept;
+	MappedFile& operator=( MappedFile&& other ) noexcept;
+
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+
+	// An empty file opens successfully with a null view.
+	FileError			open( const std::string& fileName ) noexcept;
+	void				close( void ) noexcept;
+
+	// Touches every page so that later reads do not fault; run it on a worker to overlap the disk read.
+	void				prefetch( void ) const noexcept;
+
+	bool				isOpen( void ) const noexcept;
+	const char*			getData( void ) const noexcept;
+	size_t				getSize( void ) const noexcept;
+
+	// Whole words only; a trailing partial word is not part of the span.
+	const uint32_t*		getWords( void ) const noexcept;
+	size_t				getWordCount( void ) const noexcept;
+
+private:
+
+	const char*			_data;
+	size_t				_size;
+	bool				_isOpen;
+
+#ifdef _WIN32
+	void*				_file;
+	void*				_mapping;
+#endif
+};
+
+// Opens and prefetches a file on the job system while the caller does other start-up work.
+// Like a Job*, the request has to be waited on before JobSystem::MAX_JOB_COUNT more jobs are
+// created on the thread that started it.
+class FileReadRequest
+{
+public:
+
+	FileReadRequest( void );
+	~FileReadRequest( void );
+
+	FileReadRequest( const FileReadRequest& ) = delete;
+	FileReadRequest& operator=( const FileReadRequest& ) = delete;
+
+	void				start( const std::string& fileName, JobSystem& jobSystem ) noexcept;
+	FileError			wait( void ) noexcept;
+
+	MappedFile&			getFile( void ) noexcept;
+
+private:
+
+	MappedFile			_file;
+	FileError			_error;
+	JobSystem*			_jobSystem;
+	Job*				_job;
+	std::string			_fileName;
+};
+
 class File
 {
 public:
-	static std::vector<char> readFile( const std::string& fileName ) noexcept;
-};
\ No newline at end of file
+
+	// Maps the file and reports any failure with the file name on std::cerr.
+	static FileError	map( const std::string& fileName, MappedFile& file ) noexcept;
+
+	static const char*	getErrorString( const FileError error ) noexcept;
+};
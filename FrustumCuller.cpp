@@ -0,0 +1,317 @@
+#include "pch.h"
+
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __x86_64__ ) || defined( __i386__ )
+#define FRUSTUM_CULLER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC emits any intrinsic regardless of /arch; GCC and Clang need the AVX2 kernel marked for the target.
+#if defined( FRUSTUM_CULLER_X86 ) && !defined( _MSC_VER )
+#define FRUSTUM_CULLER_TARGET_AVX2 __attribute__( ( target( "avx2,fma" ) ) )
+#else
+#define FRUSTUM_CULLER_TARGET_AVX2
+#endif
+
+namespace
+{
+	// A padding sphere fails every plane test, whatever its center.
+	const float NEVER_VISIBLE_RADIUS = -FLT_MAX;
+
+	struct SphereArrays
+	{
+		const float*	_x;
+		const float*	_y;
+		const float*	_z;
+		const float*	_radius;
+	};
+
+	// Visible indices are stored unconditionally and the output only advances for visible ones, which keeps
+	// the loops free of unpredictable branches. The output therefore needs room for every tested sphere.
+	uint32_t cullScalar( const SphereArrays& spheres, const Frustum& frustum, const uint32_t first, const uint32_t count, uint32_t* visible ) noexcept
+	{
+		uint32_t visibleCount = 0;
+
+		for ( uint32_t ii = first; ii < first + count; ++ii )
+		{
+			bool isInside = true;
+
+			for ( const glm::vec4& plane : frustum._planes )
+			{
+				const float distance = spheres._x[ii] * plane.x + spheres._y[ii] * plane.y + spheres._z[ii] * plane.z + plane.w;
+				isInside &= ( distance >= -spheres._radius[ii] );
+			}
+
+			visible[visibleCount]	= ii;
+			visibleCount			+= ( true == isInside ) ? 1 : 0;
+		}
+
+		return visibleCount;
+	}
+
+#ifdef FRUSTUM_CULLER_X86
+	// SSE2 is part of x86-64 and of every x86 target MSVC still builds for, so this kernel needs no check.
+	uint32_t cullSse( const SphereArrays& spheres, const Frustum& frustum, const uint32_t first, const uint32_t count, uint32_t* visible ) noexcept
+	{
+		__m128 planes[6][4];
+		for ( size_t ii = 0; ii < frustum._planes.size(); ++ii )
+		{
+			planes[ii][0] = _mm_set1_ps( frustum._planes[ii].x );
+			planes[ii][1] = _mm_set1_ps( frustum._planes[ii].y );
+			planes[ii][2] = _mm_set1_ps( frustum._planes[ii].z );
+			planes[ii][3] = _mm_set1_ps( frustum._planes[ii].w );
+		}
+
+		const __m128 signBit	= _mm_set1_ps( -0.0f );
+		uint32_t visibleCount	= 0;
+
+		// The arrays are padded, so the last group may read past count.
+		for ( uint32_t ii = first; ii < first + count; ii += 4 )
+		{
+			const __m128 x				= _mm_loadu_ps( spheres._x + ii );
+			const __m128 y				= _mm_loadu_ps( spheres._y + ii );
+			const __m128 z				= _mm_loadu_ps( spheres._z + ii );
+			const __m128 negativeRadius	= _mm_xor_ps( _mm_loadu_ps( spheres._radius + ii ), signBit );
+
+			__m128 isInside				= _mm_cmpeq_ps( x, x );
+
+			for ( size_t jj = 0; jj < 6; ++jj )
+			{
+				const __m128 distance	= _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, planes[jj][0] ), _mm_mul_ps( y, planes[jj][1] ) ), _mm_add_ps( _mm_mul_ps( z, planes[jj][2] ), planes[jj][3] ) );
+				isInside				= _mm_and_ps( isInside, _mm_cmpge_ps( distance, negativeRadius ) );
+			}
+
+			const uint32_t mask			= static_cast<uint32_t>( _mm_movemask_ps( isInside ) );
+
+			for ( uint32_t lane = 0; lane < 4; ++lane )
+			{
+				visible[visibleCount]	= ii + lane;
+				visibleCount			+= ( mask >> lane ) & 1;
+			}
+		}
+
+		return visibleCount;
+	}
+
+	FRUSTUM_CULLER_TARGET_AVX2
+	uint32_t cullAvx2( const SphereArrays& spheres, const Frustum& frustum, const uint32_t first, const uint32_t count, uint32_t* visible ) noexcept
+	{
+		__m256 planes[6][4];
+		for ( size_t ii = 0; ii < frustum._planes.size(); ++ii )
+		{
+			planes[ii][0] = _mm256_set1_ps( frustum._planes[ii].x );
+			planes[ii][1] = _mm256_set1_ps( frustum._planes[ii].y );
+			planes[ii][2] = _mm256_set1_ps( frustum._planes[ii].z );
+			planes[ii][3] = _mm256_set1_ps( frustum._planes[ii].w );
+		}
+
+		const __m256 signBit	= _mm256_set1_ps( -0.0f );
+		uint32_t visibleCount	= 0;
+
+		for ( uint32_t ii = first; ii < first + count; ii += 8 )
+		{
+			const __m256 x				= _mm256_loadu_ps( spheres._x + ii );
+			const __m256 y				= _mm256_loadu_ps( spheres._y + ii );
+			const __m256 z				= _mm256_loadu_ps( spheres._z + ii );
+			const __m256 negativeRadius	= _mm256_xor_ps( _mm256_loadu_ps( spheres._radius + ii ), signBit );
+
+			__m256 isInside				= _mm256_cmp_ps( x, x, _CMP_EQ_OQ );
+
+			for ( size_t jj = 0; jj < 6; ++jj )
+			{
+				const __m256 distance	= _mm256_fmadd_ps( x, planes[jj][0], _mm256_fmadd_ps( y, planes[jj][1], _mm256_fmadd_ps( z, planes[jj][2], planes[jj][3] ) ) );
+				isInside				= _mm256_and_ps( isInside, _mm256_cmp_ps( distance, negativeRadius, _CMP_GE_OQ ) );
+			}
+
+			const uint32_t mask			= static_cast<uint32_t>( _mm256_movemask_ps( isInside ) );
+
+			for ( uint32_t lane = 0; lane < 8; ++lane )
+			{
+				visible[visibleCount]	= ii + lane;
+				visibleCount			+= ( mask >> lane ) & 1;
+			}
+		}
+
+		return visibleCount;
+	}
+
+	bool isAvx2Supported( void ) noexcept
+	{
+#ifdef _MSC_VER
+		int info[4] = {};
+		__cpuid( info, 0 );
+		if ( 7 > info[0] )
+		{
+			return false;
+		}
+
+		// AVX and FMA from leaf 1, and the OS has to save the YMM registers on context switches.
+		__cpuid( info, 1 );
+		const bool hasFma		= 0 != ( info[2] & ( 1 << 12 ) );
+		const bool hasOsxsave	= 0 != ( info[2] & ( 1 << 27 ) );
+		const bool hasAvx		= 0 != ( info[2] & ( 1 << 28 ) );
+
+		if ( ( false == hasFma ) || ( false == hasOsxsave ) || ( false == hasAvx ) || ( 6 != ( _xgetbv( 0 ) & 6 ) ) )
+		{
+			return false;
+		}
+
+		__cpuidex( info, 7, 0 );
+		return 0 != ( info[1] & ( 1 << 5 ) );
+#else
+		return ( 0 != __builtin_cpu_supports( "avx2" ) ) && ( 0 != __builtin_cpu_supports( "fma" ) );
+#endif
+	}
+#endif
+}
+
+Frustum Frustum::getClipVolume( void ) noexcept
+{
+	Frustum frustum;
+
+	frustum._planes[0] = glm::vec4( 1.0f, 0.0f, 0.0f, 1.0f );		// x >= -1
+	frustum._planes[1] = glm::vec4( -1.0f, 0.0f, 0.0f, 1.0f );		// x <= 1
+	frustum._planes[2] = glm::vec4( 0.0f, 1.0f, 0.0f, 1.0f );		// y >= -1
+	frustum._planes[3] = glm::vec4( 0.0f, -1.0f, 0.0f, 1.0f );		// y <= 1
+	frustum._planes[4] = glm::vec4( 0.0f, 0.0f, 1.0f, 0.0f );		// z >= 0
+	frustum._planes[5] = glm::vec4( 0.0f, 0.0f, -1.0f, 1.0f );		// z <= 1
+
+	return frustum;
+}
+
+FrustumCuller::FrustumCuller( void )
+	: _count{ 0 }
+	, _kernel{ getBestKernel() }
+{
+
+}
+
+void FrustumCuller::resize( const uint32_t count ) noexcept
+{
+	const size_t paddedCount = ( static_cast<size_t>( count ) + LANE_COUNT - 1 ) / LANE_COUNT * LANE_COUNT;
+
+	_count = count;
+
+	_centerX.assign( paddedCount, 0.0f );
+	_centerY.assign( paddedCount, 0.0f );
+	_centerZ.assign( paddedCount, 0.0f );
+	_radius.assign( paddedCount, NEVER_VISIBLE_RADIUS );
+}
+
+void FrustumCuller::setSphere( const uint32_t index, const glm::vec4& sphere ) noexcept
+{
+	_centerX[index]	= sphere.x;
+	_centerY[index]	= sphere.y;
+	_centerZ[index]	= sphere.z;
+	_radius[index]	= sphere.w;
+}
+
+uint32_t FrustumCuller::getCount( void ) const noexcept
+{
+	return _count;
+}
+
+uint32_t FrustumCuller::cull( const Frustum& frustum, std::vector<uint32_t>& visible, JobSystem* jobSystem ) noexcept
+{
+	if ( visible.size() < _radius.size() )
+	{
+		visible.resize( _radius.size() );
+	}
+
+	const uint32_t partitionCount = ( _count + PARTITION_SIZE - 1 ) / PARTITION_SIZE;
+
+	if ( ( nullptr == jobSystem ) || ( 1 >= partitionCount ) )
+	{
+		return cullRange( frustum, 0, _count, visible.data() );
+	}
+
+	// Each partition compacts into the front of its own stretch of the output, then the stretches are packed.
+	_partitionCounts.resize( partitionCount );
+
+	jobSystem->parallelFor( partitionCount, 1, [&]( const uint32_t firstPartition, const uint32_t count )
+	{
+		for ( uint32_t ii = firstPartition; ii < firstPartition + count; ++ii )
+		{
+			const uint32_t first	= ii * PARTITION_SIZE;
+			_partitionCounts[ii]	= cullRange( frustum, first, std::min( PARTITION_SIZE, _count - first ), visible.data() + first );
+		}
+	} );
+
+	uint32_t visibleCount = _partitionCounts[0];
+
+	for ( uint32_t ii = 1; ii < partitionCount; ++ii )
+	{
+		std::memmove( visible.data() + visibleCount, visible.data() + static_cast<size_t>( ii ) * PARTITION_SIZE, _partitionCounts[ii] * sizeof( uint32_t ) );
+		visibleCount += _partitionCounts[ii];
+	}
+
+	return visibleCount;
+}
+
+uint32_t FrustumCuller::cullRange( const Frustum& frustum, const uint32_t first, const uint32_t count, uint32_t* visible ) const noexcept
+{
+	const SphereArrays spheres{ _centerX.data(), _centerY.data(), _centerZ.data(), _radius.data() };
+
+	// The kernels write absolute indices, starting at visible[0].
+	switch ( _kernel )
+	{
+#ifdef FRUSTUM_CULLER_X86
+	case CullingKernel::Avx2:	return cullAvx2( spheres, frustum, first, count, visible );
+	case CullingKernel::Sse:	return cullSse( spheres, frustum, first, count, visible );
+#endif
+	default:					return cullScalar( spheres, frustum, first, count, visible );
+	}
+}
+
+void FrustumCuller::setKernel( const CullingKernel kernel ) noexcept
+{
+	_kernel = ( true == isSupported( kernel ) ) ? kernel : getBestKernel();
+}
+
+CullingKernel FrustumCuller::getKernel( void ) const noexcept
+{
+	return _kernel;
+}
+
+bool FrustumCuller::isSupported( const CullingKernel kernel ) noexcept
+{
+	switch ( kernel )
+	{
+	case CullingKernel::Scalar:		return true;
+#ifdef FRUSTUM_CULLER_X86
+	case CullingKernel::Sse:		return true;
+	case CullingKernel::Avx2:
+	{
+		static const bool isAvx2 = isAvx2Supported();
+		return isAvx2;
+	}
+#endif
+	default:						return false;
+	}
+}
+
+CullingKernel FrustumCuller::getBestKernel( void ) noexcept
+{
+	if ( true == isSupported( CullingKernel::Avx2 ) )
+	{
+		return CullingKernel::Avx2;
+	}
+
+	return ( true == isSupported( CullingKernel::Sse ) ) ? CullingKernel::Sse : CullingKernel::Scalar;
+}
+
+const char* FrustumCuller::getKernelName( const CullingKernel kernel ) noexcept
+{
+	switch ( kernel )
+	{
+	case CullingKernel::Scalar:		return "scalar";
+	case CullingKernel::Sse:		return "sse";
+	case CullingKernel::Avx2:		return "avx2";
+	default:						return "unknown";
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+class JobSystem;
+
+// Six planes with inward-facing normals in xyz and the distance in w; a point p is inside when
+// dot( plane.xyz, p ) + plane.w >= 0 for every plane.
+struct Frustum
+{
+	std::array<glm::vec4, 6>	_planes;
+
+	// The Vulkan clip volume: x and y in [-1, 1], depth in [0, 1]. Stands in for a camera frustum until there is one.
+	static Frustum	getClipVolume( void ) noexcept;
+};
+
+enum class CullingKernel : uint32_t
+{
+	Scalar = 0,
+	Sse,		// 4 spheres per iteration
+	Avx2,		// 8 spheres per iteration, with FMA
+	Count
+};
+
+// Bounding spheres in structure-of-arrays layout, so the kernels load a whole register of centers or
+// radii at once. Culling writes the indices of the visible spheres in ascending order and can be
+// split across the job system for large scenes.
+class FrustumCuller
+{
+public:
+
+	FrustumCuller( void );
+
+	void					resize( const uint32_t count ) noexcept;
+	void					setSphere( const uint32_t index, const glm::vec4& sphere ) noexcept;
+	uint32_t				getCount( void ) const noexcept;
+
+	// Returns the number of visible spheres; visible is grown as needed and holds their indices in front.
+	// Without a job system, or for small counts, everything runs on the calling thread.
+	uint32_t				cull( const Frustum& frustum, std::vector<uint32_t>& visible, JobSystem* jobSystem ) noexcept;
+
+	// Falls back to the best supported kernel when the requested one is not available on this CPU.
+	void					setKernel( const CullingKernel kernel ) noexcept;
+	CullingKernel			getKernel( void ) const noexcept;
+
+	static bool				isSupported( const CullingKernel kernel ) noexcept;
+	static CullingKernel	getBestKernel( void ) noexcept;
+	static const char*		getKernelName( const CullingKernel kernel ) noexcept;
+
+private:
+
+	// Spheres per job; a multiple of every kernel's width, so only the last partition has a tail.
+	static const uint32_t	PARTITION_SIZE	= 16384;
+	// The arrays are padded to this many spheres with ones that are never visible.
+	static const uint32_t	LANE_COUNT		= 8;
+
+	uint32_t				cullRange( const Frustum& frustum, const uint32_t first, const uint32_t count, uint32_t* visible ) const noexcept;
+
+	std::vector<float>		_centerX;
+	std::vector<float>		_centerY;
+	std::vector<float>		_centerZ;
+	std::vector<float>		_radius;
+	uint32_t				_count;
+
+	CullingKernel			_kernel;
+
+	// Visible spheres found by each partition, which are then packed together.
+	std::vector<uint32_t>	_partitionCounts;
+};
@@ -0,0 +1,313 @@
+#include "pch.h"
+
+#include "GpuCuller.h"
+
+namespace
+{
+	const char* const CULL_SHADER_FILE		= "./cull.spv";
+
+	// Matches constant_id 0 in cull.comp.
+	const uint32_t COMPACT_CONSTANT_ID		= 0;
+
+	const uint32_t OBJECT_BINDING			= 0;
+	const uint32_t DRAW_BINDING				= 1;
+	const uint32_t COUNT_BINDING			= 2;
+
+	// Layout of the push constant block in cull.comp.
+	struct CullingConstants
+	{
+		glm::vec4	_boundingSphere;
+		uint32_t	_indexCount;
+		uint32_t	_firstIndex;
+		int32_t		_vertexOffset;
+		uint32_t	_objectCount;
+	};
+}
+
+GpuCuller::GpuCuller( void )
+	: _device{ VK_NULL_HANDLE }
+	, _allocator{ nullptr }
+	, _drawIndexedIndirectCount{ nullptr }
+	, _objectBuffer{ VK_NULL_HANDLE }
+	, _countBuffer{ VK_NULL_HANDLE }
+	, _countStride{ 0 }
+	, _descriptorPool{ VK_NULL_HANDLE }
+	, _mesh{}
+	, _objectCount{ 0 }
+	, _expectedVisibleCount{ 0 }
+{
+
+}
+
+bool GpuCuller::isSupported( const VkPhysicalDeviceFeatures& features ) noexcept
+{
+	return ( VK_TRUE == features.multiDrawIndirect ) && ( VK_TRUE == features.drawIndirectFirstInstance );
+}
+
+bool GpuCuller::create( const VkDevice device, MemoryAllocator& allocator, UploadManager& uploadManager, PipelineCache& pipelineCache, PipelineLayoutCache& layoutCache,
+						const std::vector<InstanceData>& objects, const CulledMesh& mesh, const uint32_t frameCount,
+						const PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount ) noexcept
+{
+	_device						= device;
+	_allocator					= &allocator;
+	_drawIndexedIndirectCount	= drawIndexedIndirectCount;
+	_mesh						= mesh;
+	_objectCount				= static_cast<uint32_t>( objects.size() );
+
+	const VkPhysicalDeviceLimits& limits = _allocator->getLimits();
+
+	if ( ( 0 == _objectCount ) || ( limits.maxDrawIndirectCount < _objectCount ) || ( limits.maxComputeWorkGroupCount[0] < ( _objectCount + WORKGROUP_SIZE - 1 ) / WORKGROUP_SIZE ) )
+	{
+		std::cerr << "gpu culling: " << _objectCount << " objects exceed the device's indirect draw limits" << std::endl;
+		return false;
+	}
+
+	_expectedVisibleCount		= static_cast<uint32_t>( std::count_if( objects.begin(), objects.end(), [&mesh]( const InstanceData& object ) { return isVisible( object, mesh._boundingSphere ); } ) );
+
+	const VkDeviceSize objectSize = static_cast<VkDeviceSize>( sizeof( InstanceData ) ) * _objectCount;
+
+	if ( false == _allocator->createBuffer( objectSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _objectBuffer, _objectAllocation ) )
+	{
+		return false;
+	}
+
+	if ( 0 == uploadManager.upload( _objectBuffer, 0, objects.data(), objectSize, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT ) )
+	{
+		return false;
+	}
+
+	// Each frame's count sits at a storage buffer offset of its own.
+	_countStride				= std::max<VkDeviceSize>( limits.minStorageBufferOffsetAlignment, sizeof( uint32_t ) );
+
+	if ( false == _allocator->createBuffer( _countStride * frameCount, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _countBuffer, _countAllocation ) )
+	{
+		return false;
+	}
+
+	std::memset( _countAllocation._mappedData, 0, static_cast<size_t>( _countStride * frameCount ) );
+
+	_frames.resize( frameCount );
+
+	for ( Frame& frame : _frames )
+	{
+		if ( false == _allocator->createBuffer( static_cast<VkDeviceSize>( sizeof( VkDrawIndexedIndirectCommand ) ) * _objectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame._drawBuffer, frame._drawAllocation ) )
+		{
+			return false;
+		}
+	}
+
+	if ( ( false == createPipeline( pipelineCache, layoutCache ) ) || ( false == createDescriptorSets() ) )
+	{
+		return false;
+	}
+
+	std::cout << "gpu culling: " << _objectCount << " objects, " << ( ( true == isCompacted() ) ? "compacted draws with indirect count" : "one indirect draw slot per object" ) << std::endl;
+
+	return true;
+}
+
+bool GpuCuller::createPipeline( PipelineCache& pipelineCache, PipelineLayoutCache& layoutCache ) noexcept
+{
+	if ( false == _pipeline.load( CULL_SHADER_FILE ) )
+	{
+		return false;
+	}
+
+	const ShaderReflection& reflection = _pipeline.getReflection();
+	const std::vector<VkPushConstantRange>& pushConstantRanges = reflection.getPushConstantRanges();
+
+	if ( ( 1 != pushConstantRanges.size() ) || ( sizeof( CullingConstants ) != pushConstantRanges[0].offset + pushConstantRanges[0].size ) || ( 3 != reflection.getBindings().size() ) ||
+		 ( WORKGROUP_SIZE != reflection.getLocalSize()[0] ) )
+	{
+		std::cerr << "gpu culling: " << CULL_SHADER_FILE << " does not match the culling interface" << std::endl;
+		return false;
+	}
+
+	return _pipeline.create( _device, pipelineCache, layoutCache, { ComputeConstant{ COMPACT_CONSTANT_ID, static_cast<VkBool32>( ( true == isCompacted() ) ? VK_TRUE : VK_FALSE ) } } );
+}
+
+bool GpuCuller::createDescriptorSets( void ) noexcept
+{
+	const uint32_t frameCount			= static_cast<uint32_t>( _frames.size() );
+	const VkDescriptorSetLayout setLayout	= _pipeline.getSetLayout( 0 );
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type				= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount	= 3 * frameCount;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType				= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets			= frameCount;
+	poolInfo.poolSizeCount		= 1;
+	poolInfo.pPoolSizes			= &poolSize;
+
+	if ( VK_SUCCESS != vkCreateDescriptorPool( _device, &poolInfo, nullptr, &_descriptorPool ) )
+	{
+		return false;
+	}
+
+	for ( uint32_t ii = 0; ii < frameCount; ++ii )
+	{
+		Frame& frame = _frames[ii];
+
+		VkDescriptorSetAllocateInfo allocateInfo{};
+		allocateInfo.sType					= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.descriptorPool			= _descriptorPool;
+		allocateInfo.descriptorSetCount		= 1;
+		allocateInfo.pSetLayouts			= &setLayout;
+
+		if ( VK_SUCCESS != vkAllocateDescriptorSets( _device, &allocateInfo, &frame._descriptorSet ) )
+		{
+			return false;
+		}
+
+		const VkDescriptorBufferInfo bufferInfos[] =
+		{
+			{ _objectBuffer,		0,						VK_WHOLE_SIZE },
+			{ frame._drawBuffer,	0,						VK_WHOLE_SIZE },
+			{ _countBuffer,			_countStride * ii,		sizeof( uint32_t ) }
+		};
+
+		const uint32_t bindings[] = { OBJECT_BINDING, DRAW_BINDING, COUNT_BINDING };
+
+		std::array<VkWriteDescriptorSet, 3> writes{};
+		for ( size_t jj = 0; jj < writes.size(); ++jj )
+		{
+			writes[jj].sType				= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[jj].dstSet				= frame._descriptorSet;
+			writes[jj].dstBinding			= bindings[jj];
+			writes[jj].descriptorCount		= 1;
+			writes[jj].descriptorType		= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[jj].pBufferInfo			= &bufferInfos[jj];
+		}
+
+		vkUpdateDescriptorSets( _device, static_cast<uint32_t>( writes.size() ), writes.data(), 0, nullptr );
+	}
+
+	return true;
+}
+
+void GpuCuller::destroy( void ) noexcept
+{
+	if ( nullptr == _allocator )
+	{
+		return;
+	}
+
+	_pipeline.destroy();
+
+	if ( VK_NULL_HANDLE != _descriptorPool )
+	{
+		vkDestroyDescriptorPool( _device, _descriptorPool, nullptr );
+	}
+
+	for ( Frame& frame : _frames )
+	{
+		_allocator->destroyBuffer( frame._drawBuffer, frame._drawAllocation );
+	}
+
+	_allocator->destroyBuffer( _countBuffer, _countAllocation );
+	_allocator->destroyBuffer( _objectBuffer, _objectAllocation );
+
+	_frames.clear();
+	_descriptorPool		= VK_NULL_HANDLE;
+	_allocator			= nullptr;
+}
+
+void GpuCuller::recordCulling( const VkCommandBuffer commandBuffer, const uint32_t frame ) const noexcept
+{
+	const VkDeviceSize countOffset	= _countStride * frame;
+
+	vkCmdFillBuffer( commandBuffer, _countBuffer, countOffset, sizeof( uint32_t ), 0 );
+
+	VkBufferMemoryBarrier clearBarrier{};
+	clearBarrier.sType					= VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask			= VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask			= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	clearBarrier.srcQueueFamilyIndex	= VK_QUEUE_FAMILY_IGNORED;
+	clearBarrier.dstQueueFamilyIndex	= VK_QUEUE_FAMILY_IGNORED;
+	clearBarrier.buffer					= _countBuffer;
+	clearBarrier.offset					= countOffset;
+	clearBarrier.size					= sizeof( uint32_t );
+
+	vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &clearBarrier, 0, nullptr );
+
+	CullingConstants constants{};
+	constants._boundingSphere		= _mesh._boundingSphere;
+	constants._indexCount			= _mesh._indexCount;
+	constants._firstIndex			= _mesh._firstIndex;
+	constants._vertexOffset			= _mesh._vertexOffset;
+	constants._objectCount			= _objectCount;
+
+	_pipeline.bind( commandBuffer, 0, 1, &_frames[frame]._descriptorSet );
+	_pipeline.pushConstants( commandBuffer, &constants, sizeof( constants ) );
+	_pipeline.dispatch( commandBuffer, _objectCount );
+}
+
+void GpuCuller::recordDraws( const VkCommandBuffer commandBuffer, const uint32_t frame ) const noexcept
+{
+	const VkBuffer drawBuffer = _frames[frame]._drawBuffer;
+
+	if ( true == isCompacted() )
+	{
+		_drawIndexedIndirectCount( commandBuffer, drawBuffer, 0, _countBuffer, _countStride * frame, _objectCount, sizeof( VkDrawIndexedIndirectCommand ) );
+	}
+	else
+	{
+		vkCmdDrawIndexedIndirect( commandBuffer, drawBuffer, 0, _objectCount, sizeof( VkDrawIndexedIndirectCommand ) );
+	}
+}
+
+uint32_t GpuCuller::getVisibleCount( const uint32_t frame ) const noexcept
+{
+	return *reinterpret_cast<const volatile uint32_t*>( static_cast<const char*>( _countAllocation._mappedData ) + _countStride * frame );
+}
+
+uint32_t GpuCuller::getExpectedVisibleCount( void ) const noexcept
+{
+	return _expectedVisibleCount;
+}
+
+VkBuffer GpuCuller::getObjectBuffer( void ) const noexcept
+{
+	return _objectBuffer;
+}
+
+VkBuffer GpuCuller::getDrawBuffer( const uint32_t frame ) const noexcept
+{
+	return _frames[frame]._drawBuffer;
+}
+
+VkBuffer GpuCuller::getCountBuffer( void ) const noexcept
+{
+	return _countBuffer;
+}
+
+VkDeviceSize GpuCuller::getCountOffset( const uint32_t frame ) const noexcept
+{
+	return _countStride * frame;
+}
+
+uint32_t GpuCuller::getObjectCount( void ) const noexcept
+{
+	return _objectCount;
+}
+
+bool GpuCuller::isCompacted( void ) const noexcept
+{
+	return nullptr != _drawIndexedIndirectCount;
+}
+
+bool GpuCuller::isVisible( const InstanceData& object, const glm::vec4& boundingSphere ) noexcept
+{
+	// Mirrors cull.comp.
+	const glm::vec4& offsetScale	= object._offsetScale;
+	const float centerX				= boundingSphere.x * offsetScale.w + offsetScale.x;
+	const float centerY				= boundingSphere.y * offsetScale.w + offsetScale.y;
+	const float centerZ				= boundingSphere.z + offsetScale.z;
+	const float radius				= boundingSphere.w * offsetScale.w;
+
+	return ( -1.0f <= centerX + radius ) && ( 1.0f >= centerX - radius ) &&
+		   ( -1.0f <= centerY + radius ) && ( 1.0f >= centerY - radius ) &&
+		   ( 0.0f <= centerZ + boundingSphere.w ) && ( 1.0f >= centerZ - boundingSphere.w );
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+#include "UploadManager.h"
+#include "ComputePipeline.h"
+#include "InstanceBuffer.h"
+
+// The one mesh all objects draw, with a clip-space bounding sphere (center in xyz, radius in w).
+struct CulledMesh
+{
+	glm::vec4		_boundingSphere;
+	uint32_t		_indexCount;
+	uint32_t		_firstIndex;
+	int32_t			_vertexOffset;
+};
+
+// GPU-driven drawing: the objects live in a storage buffer, a compute pass frustum-culls them and writes
+// one VkDrawIndexedIndirectCommand per visible object plus a count, and the graphics pass issues them all
+// with a single multi-draw indirect call. The CPU records the same few commands whatever the object count.
+class GpuCuller
+{
+public:
+
+	GpuCuller( void );
+
+	// multiDrawIndirect and drawIndirectFirstInstance are required; indirect count is optional.
+	static bool			isSupported( const VkPhysicalDeviceFeatures& features ) noexcept;
+
+	// The objects are uploaded once through the upload manager; the caller flushes and waits as usual.
+	bool				create( const VkDevice device, MemoryAllocator& allocator, UploadManager& uploadManager, PipelineCache& pipelineCache, PipelineLayoutCache& layoutCache,
+								const std::vector<InstanceData>& objects, const CulledMesh& mesh, const uint32_t frameCount,
+								const PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount ) noexcept;
+	void				destroy( void ) noexcept;
+
+	// Outside a render pass: resets the frame's count and dispatches the culling pass. The caller makes the
+	// commands and the count visible to the draws and the host, see getDrawBuffer() and getCountBuffer().
+	void				recordCulling( const VkCommandBuffer commandBuffer, const uint32_t frame ) const noexcept;
+
+	// Inside the render pass, with the graphics pipeline, vertex and index buffers already bound.
+	void				recordDraws( const VkCommandBuffer commandBuffer, const uint32_t frame ) const noexcept;
+
+	// Objects that passed the frame's last culling pass; only meaningful once its fence has signaled.
+	uint32_t			getVisibleCount( const uint32_t frame ) const noexcept;
+	// What the culling pass should find, computed once on the CPU with the same test.
+	uint32_t			getExpectedVisibleCount( void ) const noexcept;
+
+	// Also bound as the per-instance vertex buffer; the draws select their object with firstInstance.
+	VkBuffer			getObjectBuffer( void ) const noexcept;
+	uint32_t			getObjectCount( void ) const noexcept;
+
+	// What the culling pass writes for a frame: its draw commands, and one count at getCountOffset() in a shared buffer.
+	VkBuffer			getDrawBuffer( const uint32_t frame ) const noexcept;
+	VkBuffer			getCountBuffer( void ) const noexcept;
+	VkDeviceSize		getCountOffset( const uint32_t frame ) const noexcept;
+	bool				isCompacted( void ) const noexcept;
+
+	static bool			isVisible( const InstanceData& object, const glm::vec4& boundingSphere ) noexcept;
+
+private:
+
+	// local_size_x in cull.comp.
+	static const uint32_t	WORKGROUP_SIZE = 64;
+
+	bool				createPipeline( PipelineCache& pipelineCache, PipelineLayoutCache& layoutCache ) noexcept;
+	bool				createDescriptorSets( void ) noexcept;
+
+	struct Frame
+	{
+		VkBuffer			_drawBuffer			= VK_NULL_HANDLE;
+		Allocation			_drawAllocation;
+		VkDescriptorSet		_descriptorSet		= VK_NULL_HANDLE;
+	};
+
+	VkDevice							_device;
+	MemoryAllocator*					_allocator;
+	PFN_vkCmdDrawIndexedIndirectCountKHR	_drawIndexedIndirectCount;
+
+	VkBuffer							_objectBuffer;
+	Allocation							_objectAllocation;
+
+	// One count per frame, host visible so that the result can be checked without a copy.
+	VkBuffer							_countBuffer;
+	Allocation							_countAllocation;
+	VkDeviceSize						_countStride;
+
+	std::vector<Frame>					_frames;
+
+	ComputePipeline						_pipeline;
+	VkDescriptorPool					_descriptorPool;
+
+	CulledMesh							_mesh;
+	uint32_t							_objectCount;
+	uint32_t							_expectedVisibleCount;
+};
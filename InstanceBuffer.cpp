@@ -0,0 +1,80 @@
+#include "pch.h"
+
+#include "InstanceBuffer.h"
+
+VkVertexInputBindingDescription InstanceData::getBindingDescription( const uint32_t binding ) noexcept
+{
+	return VkVertexInputBindingDescription{ binding, sizeof( InstanceData ), VK_VERTEX_INPUT_RATE_INSTANCE };
+}
+
+std::array<VkVertexInputAttributeDescription, 2> InstanceData::getAttributeDescriptions( const uint32_t binding, const uint32_t firstLocation ) noexcept
+{
+	std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
+
+	attributeDescriptions[0].binding	= binding;
+	attributeDescriptions[0].location	= firstLocation;
+	attributeDescriptions[0].format		= VK_FORMAT_R32G32B32A32_SFLOAT;
+	attributeDescriptions[0].offset		= offsetof( InstanceData, _offsetScale );
+
+	attributeDescriptions[1].binding	= binding;
+	attributeDescriptions[1].location	= firstLocation + 1;
+	attributeDescriptions[1].format		= VK_FORMAT_R8G8B8A8_UNORM;
+	attributeDescriptions[1].offset		= offsetof( InstanceData, _color );
+
+	return attributeDescriptions;
+}
+
+InstanceBuffer::InstanceBuffer( void )
+	: _allocator{ nullptr }
+	, _buffer{ VK_NULL_HANDLE }
+	, _capacity{ 0 }
+	, _frameCount{ 0 }
+{
+
+}
+
+bool InstanceBuffer::create( MemoryAllocator& allocator, const uint32_t capacity, const uint32_t frameCount ) noexcept
+{
+	_allocator		= &allocator;
+	_capacity		= std::max( capacity, 1u );
+	_frameCount		= frameCount;
+
+	const VkDeviceSize size = static_cast<VkDeviceSize>( sizeof( InstanceData ) ) * _capacity * _frameCount;
+
+	// Device-local host-visible memory (resizable BAR, integrated GPUs) saves the vertex fetch a trip over the bus.
+	if ( ( false == _allocator->createBuffer( size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _buffer, _allocation ) ) &&
+		 ( false == _allocator->createBuffer( size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _buffer, _allocation ) ) )
+	{
+		return false;
+	}
+
+	return nullptr != _allocation._mappedData;
+}
+
+void InstanceBuffer::destroy( void ) noexcept
+{
+	if ( nullptr != _allocator )
+	{
+		_allocator->destroyBuffer( _buffer, _allocation );
+	}
+}
+
+InstanceData* InstanceBuffer::getFrameData( const uint32_t frame ) const noexcept
+{
+	return static_cast<InstanceData*>( _allocation._mappedData ) + static_cast<size_t>( frame ) * _capacity;
+}
+
+VkDeviceSize InstanceBuffer::getFrameOffset( const uint32_t frame ) const noexcept
+{
+	return static_cast<VkDeviceSize>( sizeof( InstanceData ) ) * _capacity * frame;
+}
+
+VkBuffer InstanceBuffer::getHandle( void ) const noexcept
+{
+	return _buffer;
+}
+
+uint32_t InstanceBuffer::getCapacity( void ) const noexcept
+{
+	return _capacity;
+}
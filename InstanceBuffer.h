@@ -0,0 +1,42 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+
+// Per-instance data of the instanced path, read through its own binding at VK_VERTEX_INPUT_RATE_INSTANCE.
+struct InstanceData
+{
+	glm::vec4	_offsetScale;	// clip-space offset in xyz, xy scale in w
+	uint32_t	_color;			// RGBA8 unorm, multiplies the vertex color
+
+	static VkVertexInputBindingDescription							getBindingDescription( const uint32_t binding ) noexcept;
+	static std::array<VkVertexInputAttributeDescription, 2>		getAttributeDescriptions( const uint32_t binding, const uint32_t firstLocation ) noexcept;
+};
+
+// cull.comp reads the instance buffer as raw floats with OBJECT_STRIDE = 5.
+static_assert( sizeof( InstanceData ) == 5 * sizeof( float ), "InstanceData must match OBJECT_STRIDE in cull.comp" );
+
+// A persistently mapped vertex buffer with one region of instance data per frame in flight. A region is
+// only rewritten after its frame's fence has signaled, so the CPU never writes what the GPU is reading.
+class InstanceBuffer
+{
+public:
+
+	InstanceBuffer( void );
+
+	bool				create( MemoryAllocator& allocator, const uint32_t capacity, const uint32_t frameCount ) noexcept;
+	void				destroy( void ) noexcept;
+
+	InstanceData*		getFrameData( const uint32_t frame ) const noexcept;
+	VkDeviceSize		getFrameOffset( const uint32_t frame ) const noexcept;
+
+	VkBuffer			getHandle( void ) const noexcept;
+	uint32_t			getCapacity( void ) const noexcept;
+
+private:
+
+	MemoryAllocator*	_allocator;
+	VkBuffer			_buffer;
+	Allocation			_allocation;
+	uint32_t			_capacity;
+	uint32_t			_frameCount;
+};
@@ -0,0 +1,170 @@
+#include "pch.h"
+
+#include "JobBenchmark.h"
+#include "JobSystem.h"
+
+namespace
+{
+	const uint32_t WARMUP_ITERATIONS	= 100;
+	const uint32_t LATENCY_ITERATIONS	= 10000;
+	const uint32_t FAN_OUT_ITERATIONS	= 200;
+	const uint32_t FAN_OUT_CHILD_COUNT	= 1000;
+	const uint32_t SCALING_WARMUP		= 3;
+	const uint32_t SCALING_ITERATIONS	= 20;
+	const uint32_t SCALING_ITEM_COUNT	= 1 << 20;
+	const uint32_t SCALING_BATCH_SIZE	= 1024;
+
+	double microsecondsSince( const std::chrono::steady_clock::time_point begin ) noexcept
+	{
+		return Benchmark::millisecondsSince( begin ) * 1000.0;
+	}
+}
+
+void JobBenchmark::run( const Options& options ) noexcept
+{
+	uint32_t threadCount = options._jobThreads;
+	if ( 0 == threadCount )
+	{
+		threadCount = std::max( std::thread::hardware_concurrency(), 1u );
+	}
+
+	std::vector<double> spawnLatency;
+	std::vector<double> fanOut;
+	std::vector<ScalingSample> scaling;
+
+	{
+		JobSystem jobSystem;
+		jobSystem.create( threadCount );
+
+		measureSpawnLatency( jobSystem, spawnLatency );
+		measureFanOut( jobSystem, fanOut );
+
+		jobSystem.destroy();
+	}
+
+	measureScaling( threadCount, scaling );
+
+	std::ofstream file;
+	if ( false == options._benchmarkOutput.empty() )
+	{
+		file.open( options._benchmarkOutput, std::ios::trunc );
+		if ( false == file.is_open() )
+		{
+			std::cerr << "failed to open " << options._benchmarkOutput << std::endl;
+			return;
+		}
+	}
+
+	std::ostream& stream = ( true == file.is_open() ) ? static_cast<std::ostream&>( file ) : std::cout;
+
+	stream << "{\n";
+	stream << "  \"threadCount\": " << threadCount << ",\n";
+	stream << "  \"spawnLatencyUs\": ";
+	Benchmark::writeSummary( stream, spawnLatency );
+	stream << ",\n";
+	stream << "  \"fanOutUsPerChild\": ";
+	Benchmark::writeSummary( stream, fanOut );
+	stream << ",\n";
+	stream << "  \"parallelForItemCount\": " << SCALING_ITEM_COUNT << ",\n";
+	stream << "  \"parallelFor\": ";
+	Benchmark::writeScaling( stream, SCALING_ITEM_COUNT, scaling );
+	stream << "\n}" << std::endl;
+}
+
+void JobBenchmark::measureSpawnLatency( JobSystem& jobSystem, std::vector<double>& samples ) noexcept
+{
+	// Round trip of a single empty job: create, push, pop (or get stolen), run and observe completion.
+	samples.reserve( LATENCY_ITERATIONS );
+
+	for ( uint32_t ii = 0; ii < WARMUP_ITERATIONS + LATENCY_ITERATIONS; ++ii )
+	{
+		const auto begin	= std::chrono::steady_clock::now();
+
+		Job* job			= jobSystem.createJob( nullptr, []() {} );
+		jobSystem.run( job );
+		jobSystem.wait( job );
+
+		if ( WARMUP_ITERATIONS <= ii )
+		{
+			samples.push_back( microsecondsSince( begin ) );
+		}
+	}
+}
+
+void JobBenchmark::measureFanOut( JobSystem& jobSystem, std::vector<double>& samples ) noexcept
+{
+	// Many empty children under one parent, so the other workers have something to steal.
+	samples.reserve( FAN_OUT_ITERATIONS );
+
+	for ( uint32_t ii = 0; ii < WARMUP_ITERATIONS + FAN_OUT_ITERATIONS; ++ii )
+	{
+		const auto begin	= std::chrono::steady_clock::now();
+
+		Job* parent			= jobSystem.createJob( nullptr, []() {} );
+
+		for ( uint32_t jj = 0; jj < FAN_OUT_CHILD_COUNT; ++jj )
+		{
+			jobSystem.run( jobSystem.createJob( parent, []() {} ) );
+		}
+
+		jobSystem.run( parent );
+		jobSystem.wait( parent );
+
+		if ( WARMUP_ITERATIONS <= ii )
+		{
+			samples.push_back( microsecondsSince( begin ) / FAN_OUT_CHILD_COUNT );
+		}
+	}
+}
+
+void JobBenchmark::measureScaling( const uint32_t maxThreadCount, std::vector<ScalingSample>& samples ) noexcept
+{
+	std::vector<float> results( SCALING_ITEM_COUNT, 0.0f );
+
+	// Enough arithmetic per item that the batches, not the scheduler, dominate.
+	auto work = [&results]( const uint32_t first, const uint32_t count )
+	{
+		for ( uint32_t ii = first; ii < first + count; ++ii )
+		{
+			float value = static_cast<float>( ii );
+
+			for ( uint32_t jj = 0; jj < 32; ++jj )
+			{
+				value = std::sqrt( value * 1.0001f + 1.0f );
+			}
+
+			results[ii] = value;
+		}
+	};
+
+	std::vector<uint32_t> threadCounts;
+	for ( uint32_t count = 1; count < maxThreadCount; count *= 2 )
+	{
+		threadCounts.push_back( count );
+	}
+	threadCounts.push_back( maxThreadCount );
+
+	for ( const uint32_t threadCount : threadCounts )
+	{
+		JobSystem jobSystem;
+		jobSystem.create( threadCount );
+
+		ScalingSample sample{};
+		sample._threadCount = threadCount;
+
+		for ( uint32_t ii = 0; ii < SCALING_WARMUP + SCALING_ITERATIONS; ++ii )
+		{
+			const auto begin = std::chrono::steady_clock::now();
+
+			jobSystem.parallelFor( SCALING_ITEM_COUNT, SCALING_BATCH_SIZE, work );
+
+			if ( SCALING_WARMUP <= ii )
+			{
+				sample._times.push_back( Benchmark::millisecondsSince( begin ) );
+			}
+		}
+
+		jobSystem.destroy();
+		samples.push_back( std::move( sample ) );
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Options.h"
+#include "Benchmark.h"
+
+class JobSystem;
+
+// Microbenchmarks for JobSystem: spawn latency, fan-out cost and parallelFor scaling.
+// Runs without a Vulkan device and reports as JSON.
+class JobBenchmark
+{
+public:
+
+	static void		run( const Options& options ) noexcept;
+
+private:
+
+	static void		measureSpawnLatency( JobSystem& jobSystem, std::vector<double>& samples ) noexcept;
+	static void		measureFanOut( JobSystem& jobSystem, std::vector<double>& samples ) noexcept;
+	static void		measureScaling( const uint32_t maxThreadCount, std::vector<ScalingSample>& samples ) noexcept;
+};
@@ -0,0 +1,330 @@
+#include "pch.h"
+
+#include "JobSystem.h"
+
+namespace
+{
+	// Failed steal rounds an idle worker spins through before going to sleep.
+	const uint32_t IDLE_SPIN_COUNT = 64;
+
+	thread_local uint32_t			t_threadIndex	= 0;
+
+	uint32_t nextRandom( uint32_t& state ) noexcept
+	{
+		// xorshift32; only used to spread steal attempts.
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+}
+
+JobSystem::JobSystem( void )
+	: _generation{ 0 }
+	, _sleepingCount{ 0 }
+	, _quit{ false }
+	, _backgroundPending{ 0 }
+{
+
+}
+
+JobSystem::~JobSystem( void )
+{
+	// Joins the workers if destroy() was never reached, e.g. after a failed initialization.
+	destroy();
+}
+
+bool JobSystem::create( const uint32_t threadCount ) noexcept
+{
+	const uint32_t count = std::max( threadCount, 1u );
+
+	_quit = false;
+	_workers.reserve( count );
+
+	for ( uint32_t ii = 0; ii < count; ++ii )
+	{
+		_workers.push_back( std::make_unique<Worker>() );
+		_workers.back()->_randomState = 0x9E3779B9u * ( ii + 1 );
+	}
+
+	t_threadIndex	= 0;
+
+	for ( uint32_t ii = 1; ii < count; ++ii )
+	{
+		_threads.emplace_back( &JobSystem::workerLoop, this, ii );
+	}
+
+	return true;
+}
+
+void JobSystem::destroy( void ) noexcept
+{
+	{
+		std::lock_guard<std::mutex> lock( _sleepMutex );
+		_quit = true;
+	}
+
+	_wakeUp.notify_all();
+
+	for ( std::thread& thread : _threads )
+	{
+		thread.join();
+	}
+
+	_threads.clear();
+	_workers.clear();
+	_backgroundTasks.clear();
+	_backgroundPending = 0;
+}
+
+Job* JobSystem::createJob( Job* parent, const JobFunction function ) noexcept
+{
+	Worker& worker			= getCurrentWorker();
+	Job* job				= &worker._jobs[worker._allocatedJobs++ & ( MAX_JOB_COUNT - 1 )];
+
+	job->_function			= function;
+	job->_parent			= parent;
+	job->_unfinishedJobs.store( 1, std::memory_order_relaxed );
+
+	if ( nullptr != parent )
+	{
+		parent->_unfinishedJobs.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	return job;
+}
+
+void JobSystem::run( Job* job ) noexcept
+{
+	Worker& worker = getCurrentWorker();
+
+	if ( false == worker._queue.push( job ) )
+	{
+		// Queue full: running it here keeps progress without growing anything.
+		execute( job );
+		return;
+	}
+
+	_generation.fetch_add( 1, std::memory_order_seq_cst );
+
+	if ( 0 < _sleepingCount.load( std::memory_order_seq_cst ) )
+	{
+		// Taking the lock orders this wake-up after a sleeper's final check of _generation.
+		{
+			std::lock_guard<std::mutex> lock( _sleepMutex );
+		}
+
+		_wakeUp.notify_one();
+	}
+}
+
+void JobSystem::wait( const Job* job ) noexcept
+{
+	Worker& worker = getCurrentWorker();
+
+	while ( false == isComplete( job ) )
+	{
+		Job* next = findJob( worker );
+
+		if ( nullptr != next )
+		{
+			execute( next );
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::runBackground( std::function<void( void )>&& task ) noexcept
+{
+	if ( true == _threads.empty() )
+	{
+		task();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( _backgroundMutex );
+		_backgroundTasks.push_back( std::move( task ) );
+		++_backgroundPending;
+	}
+
+	// Wakes the sleepers the same way run() does.
+	_generation.fetch_add( 1, std::memory_order_seq_cst );
+
+	{
+		std::lock_guard<std::mutex> lock( _sleepMutex );
+	}
+
+	_wakeUp.notify_all();
+}
+
+void JobSystem::waitBackground( void ) noexcept
+{
+	std::unique_lock<std::mutex> lock( _backgroundMutex );
+
+	_backgroundIdle.wait( lock, [this]()
+	{
+		return 0 == _backgroundPending;
+	} );
+}
+
+bool JobSystem::isComplete( const Job* job ) const noexcept
+{
+	return 0 == job->_unfinishedJobs.load( std::memory_order_acquire );
+}
+
+uint32_t JobSystem::getThreadCount( void ) const noexcept
+{
+	return static_cast<uint32_t>( _workers.size() );
+}
+
+uint32_t JobSystem::getThreadIndex( void ) const noexcept
+{
+	return t_threadIndex;
+}
+
+void JobSystem::workerLoop( const uint32_t threadIndex ) noexcept
+{
+	t_threadIndex			= threadIndex;
+
+	Worker& worker			= *_workers[threadIndex];
+	uint32_t idleRounds		= 0;
+
+	while ( false == _quit.load( std::memory_order_relaxed ) )
+	{
+		const uint64_t generation = _generation.load( std::memory_order_seq_cst );
+		Job* job			= findJob( worker );
+
+		if ( nullptr != job )
+		{
+			execute( job );
+			idleRounds		= 0;
+		}
+		else if ( true == runBackgroundTask() )
+		{
+			idleRounds		= 0;
+		}
+		else if ( IDLE_SPIN_COUNT > ++idleRounds )
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			sleep( generation );
+			idleRounds		= 0;
+		}
+	}
+}
+
+Job* JobSystem::findJob( Worker& worker ) noexcept
+{
+	Job* job = worker._queue.pop();
+
+	if ( nullptr != job )
+	{
+		return job;
+	}
+
+	const uint32_t workerCount	= static_cast<uint32_t>( _workers.size() );
+	if ( 1 == workerCount )
+	{
+		return nullptr;
+	}
+
+	// One pass over the other workers, starting at a random victim.
+	const uint32_t start		= nextRandom( worker._randomState ) % workerCount;
+
+	for ( uint32_t ii = 0; ii < workerCount; ++ii )
+	{
+		Worker& victim			= *_workers[( start + ii ) % workerCount];
+
+		if ( &victim == &worker )
+		{
+			continue;
+		}
+
+		job						= victim._queue.steal();
+
+		if ( nullptr != job )
+		{
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+bool JobSystem::runBackgroundTask( void ) noexcept
+{
+	std::function<void( void )> task;
+
+	{
+		std::lock_guard<std::mutex> lock( _backgroundMutex );
+
+		if ( true == _backgroundTasks.empty() )
+		{
+			return false;
+		}
+
+		task = std::move( _backgroundTasks.front() );
+		_backgroundTasks.pop_front();
+	}
+
+	task();
+
+	{
+		std::lock_guard<std::mutex> lock( _backgroundMutex );
+
+		if ( 0 < --_backgroundPending )
+		{
+			return true;
+		}
+	}
+
+	_backgroundIdle.notify_all();
+
+	return true;
+}
+
+void JobSystem::execute( Job* job ) noexcept
+{
+	job->_function( *job, job->_payload.data() );
+	finish( job );
+}
+
+void JobSystem::finish( Job* job ) noexcept
+{
+	// Once the counter hits zero a waiter may recycle the job, so nothing is read from it afterwards.
+	Job* parent						= job->_parent;
+
+	// acq_rel so a waiter that observes zero also observes everything the job and its children wrote.
+	const int32_t unfinishedJobs	= job->_unfinishedJobs.fetch_sub( 1, std::memory_order_acq_rel ) - 1;
+
+	if ( ( 0 == unfinishedJobs ) && ( nullptr != parent ) )
+	{
+		finish( parent );
+	}
+}
+
+void JobSystem::sleep( const uint64_t observedGeneration ) noexcept
+{
+	std::unique_lock<std::mutex> lock( _sleepMutex );
+
+	_sleepingCount.fetch_add( 1, std::memory_order_seq_cst );
+
+	_wakeUp.wait( lock, [&]()
+	{
+		return ( true == _quit.load( std::memory_order_relaxed ) ) ||
+			   ( observedGeneration != _generation.load( std::memory_order_seq_cst ) );
+	} );
+
+	_sleepingCount.fetch_sub( 1, std::memory_order_seq_cst );
+}
+
+JobSystem::Worker& JobSystem::getCurrentWorker( void ) noexcept
+{
+	return *_workers[t_threadIndex];
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "WorkStealingQueue.h"
+
+struct Job;
+
+typedef void ( *JobFunction )( Job& job, void* data );
+
+// One cache line: entry point, parent link, completion counter and an inline payload for the closure.
+struct alignas( 64 ) Job
+{
+	static constexpr size_t		PAYLOAD_SIZE	= 64 - sizeof( JobFunction ) - sizeof( Job* ) - sizeof( std::atomic<int32_t> ) * 2;
+
+	JobFunction								_function;
+	Job*									_parent;
+	// 1 for the job itself plus 1 per unfinished child; the job is complete at 0.
+	std::atomic<int32_t>					_unfinishedJobs;
+	int32_t									_padding;
+	alignas( 8 ) std::array<unsigned char, PAYLOAD_SIZE>	_payload;
+};
+
+// Work-stealing scheduler. The thread that calls create() becomes worker 0 and the rest are spawned.
+// Jobs may only be created, run and waited on from those threads. Jobs come from a per-thread ring,
+// so a Job* stays valid until MAX_JOB_COUNT more jobs have been created on the same thread. Work that
+// nobody waits on within that window goes through runBackground() instead.
+class JobSystem
+{
+public:
+
+	static constexpr uint32_t	MAX_JOB_COUNT	= 4096;
+
+	JobSystem( void );
+	~JobSystem( void );
+
+	bool			create( const uint32_t threadCount ) noexcept;
+	void			destroy( void ) noexcept;
+
+	// The job starts unscheduled. A child has to be created before its parent completes: ahead of running the
+	// parent, or from inside it.
+	Job*			createJob( Job* parent, const JobFunction function ) noexcept;
+
+	// The closure is stored inline, so it must be small and trivially destructible (capture by reference or pointer).
+	template<typename Function>
+	Job*			createJob( Job* parent, Function&& function ) noexcept;
+
+	void			run( Job* job ) noexcept;
+
+	// Runs other jobs until the job and all of its children are complete, so it is safe to call from inside a job.
+	void			wait( const Job* job ) noexcept;
+	bool			isComplete( const Job* job ) const noexcept;
+
+	// Calls function( first, count ) over [0, count) in batches of at most batchSize and waits for all of them.
+	template<typename Function>
+	void			parallelFor( const uint32_t count, const uint32_t batchSize, const Function& function ) noexcept;
+
+	// Fire-and-forget work kept on the heap rather than in a ring slot. Only the spawned workers pick it up, once
+	// they run out of jobs, so it never lands on worker 0; without spawned workers it runs here and now.
+	void			runBackground( std::function<void( void )>&& task ) noexcept;
+	// Blocks until every background task queued so far has finished.
+	void			waitBackground( void ) noexcept;
+
+	uint32_t		getThreadCount( void ) const noexcept;
+	uint32_t		getThreadIndex( void ) const noexcept;
+
+private:
+
+	struct alignas( 64 ) Worker
+	{
+		WorkStealingQueue						_queue;
+		std::array<Job, MAX_JOB_COUNT>			_jobs;
+		uint32_t								_allocatedJobs	= 0;
+		uint32_t								_randomState	= 0;
+	};
+
+	template<typename Function>
+	void			splitRange( Job& parent, uint32_t first, uint32_t count, const uint32_t batchSize, const Function& function ) noexcept;
+
+	void			workerLoop( const uint32_t threadIndex ) noexcept;
+	Job*			findJob( Worker& worker ) noexcept;
+	bool			runBackgroundTask( void ) noexcept;
+	void			execute( Job* job ) noexcept;
+	void			finish( Job* job ) noexcept;
+	void			sleep( const uint64_t observedGeneration ) noexcept;
+	Worker&			getCurrentWorker( void ) noexcept;
+
+	std::vector<std::unique_ptr<Worker>>		_workers;
+	std::vector<std::thread>					_threads;
+
+	// Bumped on every run(); idle workers sleep until it moves.
+	std::atomic<uint64_t>						_generation;
+	std::atomic<uint32_t>						_sleepingCount;
+	std::atomic<bool>							_quit;
+	std::mutex									_sleepMutex;
+	std::condition_variable						_wakeUp;
+
+	std::mutex									_backgroundMutex;
+	std::condition_variable						_backgroundIdle;
+	std::deque<std::function<void( void )>>		_backgroundTasks;
+	// Queued plus running.
+	uint32_t									_backgroundPending;
+};
+
+template<typename Function>
+Job* JobSystem::createJob( Job* parent, Function&& function ) noexcept
+{
+	typedef typename std::decay<Function>::type Closure;
+
+	static_assert( sizeof( Closure ) <= Job::PAYLOAD_SIZE, "job closure does not fit the inline payload" );
+	static_assert( alignof( Closure ) <= 8, "job closure is over-aligned" );
+	static_assert( std::is_trivially_destructible<Closure>::value, "job closure must be trivially destructible" );
+
+	// The cast picks the non-template overload instead of recursing into this one.
+	Job* job = createJob( parent, static_cast<JobFunction>( []( Job& self, void* data )
+	{
+		Closure& closure = *static_cast<Closure*>( data );
+
+		if constexpr ( std::is_invocable<Closure&, Job&>::value )
+		{
+			closure( self );
+		}
+		else
+		{
+			closure();
+		}
+	} ) );
+
+	new ( job->_payload.data() ) Closure( std::forward<Function>( function ) );
+
+	return job;
+}
+
+template<typename Function>
+void JobSystem::parallelFor( const uint32_t count, const uint32_t batchSize, const Function& function ) noexcept
+{
+	const uint32_t batch = std::max( batchSize, 1u );
+
+	Job* root = createJob( nullptr, [this, &function, count, batch]( Job& job )
+	{
+		splitRange( job, 0, count, batch, function );
+	} );
+
+	run( root );
+	wait( root );
+}
+
+template<typename Function>
+void JobSystem::splitRange( Job& parent, uint32_t first, uint32_t count, const uint32_t batchSize, const Function& function ) noexcept
+{
+	// Hands the upper halves to thieves and keeps splitting the lower half locally.
+	while ( batchSize < count )
+	{
+		const uint32_t half = count / 2;
+		const uint32_t childFirst = first + count - half;
+
+		Job* child = createJob( &parent, [this, &function, childFirst, half, batchSize]( Job& job )
+		{
+			splitRange( job, childFirst, half, batchSize, function );
+		} );
+
+		run( child );
+		count -= half;
+	}
+
+	if ( 0 < count )
+	{
+		function( first, count );
+	}
+}
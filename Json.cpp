@@ -0,0 +1,350 @@
+#include "pch.h"
+
+#include "Json.h"
+#include "TextParser.h"
+
+namespace
+{
+	// Guards the recursive descent against hostile nesting.
+	const uint32_t MAX_DEPTH = 64;
+
+	const Json			NULL_VALUE;
+	const std::string	EMPTY_STRING;
+
+	void appendUtf8( std::string& value, const uint32_t codePoint ) noexcept
+	{
+		if ( 0x80 > codePoint )
+		{
+			value.push_back( static_cast<char>( codePoint ) );
+		}
+		else if ( 0x800 > codePoint )
+		{
+			value.push_back( static_cast<char>( 0xC0 | ( codePoint >> 6 ) ) );
+			value.push_back( static_cast<char>( 0x80 | ( codePoint & 0x3F ) ) );
+		}
+		else if ( 0x10000 > codePoint )
+		{
+			value.push_back( static_cast<char>( 0xE0 | ( codePoint >> 12 ) ) );
+			value.push_back( static_cast<char>( 0x80 | ( ( codePoint >> 6 ) & 0x3F ) ) );
+			value.push_back( static_cast<char>( 0x80 | ( codePoint & 0x3F ) ) );
+		}
+		else
+		{
+			value.push_back( static_cast<char>( 0xF0 | ( codePoint >> 18 ) ) );
+			value.push_back( static_cast<char>( 0x80 | ( ( codePoint >> 12 ) & 0x3F ) ) );
+			value.push_back( static_cast<char>( 0x80 | ( ( codePoint >> 6 ) & 0x3F ) ) );
+			value.push_back( static_cast<char>( 0x80 | ( codePoint & 0x3F ) ) );
+		}
+	}
+
+	bool parseHex4( const char* cursor, const char* end, uint32_t& value ) noexcept
+	{
+		if ( 4 > end - cursor )
+		{
+			return false;
+		}
+
+		value = 0;
+
+		for ( int ii = 0; ii < 4; ++ii )
+		{
+			const char character = cursor[ii];
+			value <<= 4;
+
+			if ( ( '0' <= character ) && ( character <= '9' ) )		value |= static_cast<uint32_t>( character - '0' );
+			else if ( ( 'a' <= character ) && ( character <= 'f' ) )	value |= static_cast<uint32_t>( character - 'a' + 10 );
+			else if ( ( 'A' <= character ) && ( character <= 'F' ) )	value |= static_cast<uint32_t>( character - 'A' + 10 );
+			else														return false;
+		}
+
+		return true;
+	}
+}
+
+Json::Json( void )
+	: _type{ Type::Null }
+	, _bool{ false }
+	, _number{ 0.0 }
+{
+
+}
+
+bool Json::parse( const char* begin, const char* end, Json& document ) noexcept
+{
+	const char* cursor = parseValue( begin, end, document, 0 );
+
+	if ( nullptr == cursor )
+	{
+		return false;
+	}
+
+	// Trailing padding is allowed (GLB pads its JSON chunk with spaces), anything else is not.
+	return end == skipWhitespace( cursor, end );
+}
+
+Json::Type Json::getType( void ) const noexcept
+{
+	return _type;
+}
+
+bool Json::isNull( void ) const noexcept
+{
+	return Type::Null == _type;
+}
+
+size_t Json::size( void ) const noexcept
+{
+	return ( ( Type::Array == _type ) || ( Type::Object == _type ) ) ? _values.size() : 0;
+}
+
+const Json& Json::operator[]( const char* key ) const noexcept
+{
+	if ( Type::Object != _type )
+	{
+		return NULL_VALUE;
+	}
+
+	for ( size_t ii = 0; ii < _keys.size(); ++ii )
+	{
+		if ( _keys[ii] == key )
+		{
+			return _values[ii];
+		}
+	}
+
+	return NULL_VALUE;
+}
+
+const Json& Json::operator[]( const size_t index ) const noexcept
+{
+	if ( ( ( Type::Array != _type ) && ( Type::Object != _type ) ) || ( _values.size() <= index ) )
+	{
+		return NULL_VALUE;
+	}
+
+	return _values[index];
+}
+
+const std::string& Json::getKey( const size_t index ) const noexcept
+{
+	return ( index < _keys.size() ) ? _keys[index] : EMPTY_STRING;
+}
+
+double Json::asNumber( const double fallback ) const noexcept
+{
+	return ( Type::Number == _type ) ? _number : fallback;
+}
+
+uint32_t Json::asUint( const uint32_t fallback ) const noexcept
+{
+	if ( ( Type::Number != _type ) || ( 0.0 > _number ) || ( static_cast<double>( UINT32_MAX ) < _number ) )
+	{
+		return fallback;
+	}
+
+	return static_cast<uint32_t>( _number );
+}
+
+bool Json::asBool( const bool fallback ) const noexcept
+{
+	return ( Type::Bool == _type ) ? _bool : fallback;
+}
+
+const std::string& Json::asString( void ) const noexcept
+{
+	return ( Type::String == _type ) ? _string : EMPTY_STRING;
+}
+
+const char* Json::parseValue( const char* cursor, const char* end, Json& value, const uint32_t depth ) noexcept
+{
+	cursor = skipWhitespace( cursor, end );
+
+	if ( ( cursor >= end ) || ( MAX_DEPTH < depth ) )
+	{
+		return nullptr;
+	}
+
+	switch ( *cursor )
+	{
+	case '{':
+		{
+			value._type = Type::Object;
+			cursor		= skipWhitespace( cursor + 1, end );
+
+			if ( ( cursor < end ) && ( '}' == *cursor ) )
+			{
+				return cursor + 1;
+			}
+
+			while ( cursor < end )
+			{
+				std::string key;
+				cursor = parseString( skipWhitespace( cursor, end ), end, key );
+				if ( nullptr == cursor )
+				{
+					return nullptr;
+				}
+
+				cursor = skipWhitespace( cursor, end );
+				if ( ( cursor >= end ) || ( ':' != *cursor ) )
+				{
+					return nullptr;
+				}
+
+				value._keys.push_back( std::move( key ) );
+				value._values.emplace_back();
+
+				cursor = parseValue( cursor + 1, end, value._values.back(), depth + 1 );
+				if ( nullptr == cursor )
+				{
+					return nullptr;
+				}
+
+				cursor = skipWhitespace( cursor, end );
+				if ( ( cursor < end ) && ( ',' == *cursor ) )
+				{
+					++cursor;
+					continue;
+				}
+
+				return ( ( cursor < end ) && ( '}' == *cursor ) ) ? cursor + 1 : nullptr;
+			}
+
+			return nullptr;
+		}
+
+	case '[':
+		{
+			value._type = Type::Array;
+			cursor		= skipWhitespace( cursor + 1, end );
+
+			if ( ( cursor < end ) && ( ']' == *cursor ) )
+			{
+				return cursor + 1;
+			}
+
+			while ( cursor < end )
+			{
+				value._values.emplace_back();
+
+				cursor = parseValue( cursor, end, value._values.back(), depth + 1 );
+				if ( nullptr == cursor )
+				{
+					return nullptr;
+				}
+
+				cursor = skipWhitespace( cursor, end );
+				if ( ( cursor < end ) && ( ',' == *cursor ) )
+				{
+					++cursor;
+					continue;
+				}
+
+				return ( ( cursor < end ) && ( ']' == *cursor ) ) ? cursor + 1 : nullptr;
+			}
+
+			return nullptr;
+		}
+
+	case '"':
+		value._type = Type::String;
+		return parseString( cursor, end, value._string );
+
+	case 't':
+		value._type = Type::Bool;
+		value._bool = true;
+		return ( ( 4 <= end - cursor ) && ( 0 == memcmp( cursor, "true", 4 ) ) ) ? cursor + 4 : nullptr;
+
+	case 'f':
+		value._type = Type::Bool;
+		value._bool = false;
+		return ( ( 5 <= end - cursor ) && ( 0 == memcmp( cursor, "false", 5 ) ) ) ? cursor + 5 : nullptr;
+
+	case 'n':
+		value._type = Type::Null;
+		return ( ( 4 <= end - cursor ) && ( 0 == memcmp( cursor, "null", 4 ) ) ) ? cursor + 4 : nullptr;
+
+	default:
+		value._type = Type::Number;
+		return TextParser::parseDouble( cursor, end, value._number );
+	}
+}
+
+const char* Json::parseString( const char* cursor, const char* end, std::string& value ) noexcept
+{
+	if ( ( cursor >= end ) || ( '"' != *cursor ) )
+	{
+		return nullptr;
+	}
+
+	for ( ++cursor; cursor < end; ++cursor )
+	{
+		const char character = *cursor;
+
+		if ( '"' == character )
+		{
+			return cursor + 1;
+		}
+
+		if ( '\\' != character )
+		{
+			value.push_back( character );
+			continue;
+		}
+
+		if ( ++cursor >= end )
+		{
+			return nullptr;
+		}
+
+		switch ( *cursor )
+		{
+		case '"':	value.push_back( '"' );		break;
+		case '\\':	value.push_back( '\\' );	break;
+		case '/':	value.push_back( '/' );		break;
+		case 'b':	value.push_back( '\b' );	break;
+		case 'f':	value.push_back( '\f' );	break;
+		case 'n':	value.push_back( '\n' );	break;
+		case 'r':	value.push_back( '\r' );	break;
+		case 't':	value.push_back( '\t' );	break;
+		case 'u':
+			{
+				uint32_t codePoint = 0;
+				if ( false == parseHex4( cursor + 1, end, codePoint ) )
+				{
+					return nullptr;
+				}
+
+				cursor += 4;
+
+				// Surrogate pair: the low half follows as another \u escape.
+				uint32_t lowSurrogate = 0;
+				if ( ( 0xD800 <= codePoint ) && ( codePoint < 0xDC00 ) &&
+					 ( 6 < end - cursor ) && ( '\\' == cursor[1] ) && ( 'u' == cursor[2] ) &&
+					 ( true == parseHex4( cursor + 3, end, lowSurrogate ) ) &&
+					 ( 0xDC00 <= lowSurrogate ) && ( lowSurrogate < 0xE000 ) )
+				{
+					codePoint	= 0x10000 + ( ( codePoint - 0xD800 ) << 10 ) + ( lowSurrogate - 0xDC00 );
+					cursor		+= 6;
+				}
+
+				appendUtf8( value, codePoint );
+				break;
+			}
+		default:
+			return nullptr;
+		}
+	}
+
+	return nullptr;
+}
+
+const char* Json::skipWhitespace( const char* cursor, const char* end ) noexcept
+{
+	while ( ( cursor < end ) && ( ( ' ' == *cursor ) || ( '\t' == *cursor ) || ( '\n' == *cursor ) || ( '\r' == *cursor ) ) )
+	{
+		++cursor;
+	}
+
+	return cursor;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+// Minimal JSON document model, enough to read glTF headers. Lookups of missing keys or
+// out-of-range indices return a shared null value, so chains like json["a"][0]["b"] never fail.
+class Json
+{
+public:
+
+	enum class Type : uint8_t
+	{
+		Null = 0,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	Json( void );
+
+	static bool			parse( const char* begin, const char* end, Json& document ) noexcept;
+
+	Type				getType( void ) const noexcept;
+	bool				isNull( void ) const noexcept;
+	size_t				size( void ) const noexcept;
+
+	const Json&			operator[]( const char* key ) const noexcept;
+	const Json&			operator[]( const size_t index ) const noexcept;
+	const std::string&	getKey( const size_t index ) const noexcept;
+
+	double				asNumber( const double fallback ) const noexcept;
+	uint32_t			asUint( const uint32_t fallback ) const noexcept;
+	bool				asBool( const bool fallback ) const noexcept;
+	const std::string&	asString( void ) const noexcept;
+
+private:
+
+	static const char*	parseValue( const char* cursor, const char* end, Json& value, const uint32_t depth ) noexcept;
+	static const char*	parseString( const char* cursor, const char* end, std::string& value ) noexcept;
+	static const char*	skipWhitespace( const char* cursor, const char* end ) noexcept;
+
+	Type					_type;
+	bool					_bool;
+	double					_number;
+	std::string				_string;
+
+	// Arrays use _values only; objects keep keys and values side by side.
+	std::vector<std::string>	_keys;
+	std::vector<Json>			_values;
+};
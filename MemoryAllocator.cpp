@@ -0,0 +1,457 @@
+#include "pch.h"
+
+#include "MemoryAllocator.h"
+
+namespace
+{
+	const VkDeviceSize	DEFAULT_BLOCK_SIZE		= 64ull * 1024 * 1024;
+	const VkDeviceSize	SMALL_HEAP_SIZE			= 1024ull * 1024 * 1024;
+}
+
+struct MemoryBlock
+{
+	MemoryBlock( const VkDeviceSize size )
+		: _tlsf{ size }
+	{
+
+	}
+
+	VkDeviceMemory		_memory				= VK_NULL_HANDLE;
+	uint32_t			_memoryTypeIndex	= 0;
+	ResourceKind		_kind				= ResourceKind::Linear;
+	void*				_mappedData			= nullptr;
+	Tlsf				_tlsf;
+};
+
+MemoryAllocator::MemoryAllocator( void )
+	: _physicalDevice{ VK_NULL_HANDLE }
+	, _device{ VK_NULL_HANDLE }
+	, _memoryProperties{}
+	, _limits{}
+	, _deviceMemoryCount{ 0 }
+{
+	_dedicatedCounts.fill( 0 );
+	_dedicatedBytes.fill( 0 );
+}
+
+MemoryAllocator::~MemoryAllocator( void )
+{
+
+}
+
+bool MemoryAllocator::create( const VkPhysicalDevice physicalDevice, const VkDevice device ) noexcept
+{
+	_physicalDevice		= physicalDevice;
+	_device				= device;
+
+	// Queried once; findMemoryType used to ask the driver on every lookup.
+	vkGetPhysicalDeviceMemoryProperties( _physicalDevice, &_memoryProperties );
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties( _physicalDevice, &properties );
+	_limits				= properties.limits;
+
+	return true;
+}
+
+void MemoryAllocator::destroy( void ) noexcept
+{
+	std::lock_guard<std::mutex> lock( _mutex );
+
+	for ( auto& pools : _pools )
+	{
+		for ( Pool& pool : pools )
+		{
+			for ( auto& block : pool._blocks )
+			{
+				if ( false == block->_tlsf.isEmpty() )
+				{
+					std::cerr << "memory allocator: block destroyed with " << block->_tlsf.getAllocationCount() << " live allocations" << std::endl;
+				}
+
+				destroyBlock( block.get() );
+			}
+
+			pool._blocks.clear();
+		}
+	}
+}
+
+uint32_t MemoryAllocator::findMemoryType( const uint32_t typeFilter, const VkMemoryPropertyFlags properties ) const noexcept
+{
+	for ( uint32_t ii = 0; ii < _memoryProperties.memoryTypeCount; ++ii ) 
+	{
+		if ( ( typeFilter & ( 1 << ii ) ) && 
+			 ( _memoryProperties.memoryTypes[ii].propertyFlags & properties ) == properties ) 
+		{
+			return ii;
+		}
+	}
+
+	return UINT32_MAX;
+}
+
+bool MemoryAllocator::allocate( const VkMemoryRequirements& requirements, const VkMemoryPropertyFlags properties, const ResourceKind kind, Allocation& allocation ) noexcept
+{
+	const uint32_t memoryTypeIndex = findMemoryType( requirements.memoryTypeBits, properties );
+	if ( UINT32_MAX == memoryTypeIndex )
+	{
+		return false;
+	}
+
+	VkDeviceSize size		= requirements.size;
+	VkDeviceSize alignment	= requirements.alignment;
+
+	// Flushes of non-coherent memory work on whole atoms, so neighbours must not share one.
+	const VkMemoryPropertyFlags typeFlags = _memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+	if ( ( typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT ) && ( 0 == ( typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT ) ) )
+	{
+		const VkDeviceSize atomSize = std::max<VkDeviceSize>( _limits.nonCoherentAtomSize, 1 );
+		alignment					= std::max( alignment, atomSize );
+		size						= ( size + atomSize - 1 ) / atomSize * atomSize;
+	}
+
+	std::lock_guard<std::mutex> lock( _mutex );
+
+	const VkDeviceSize blockSize = getBlockSize( memoryTypeIndex );
+	if ( blockSize / 2 < size )
+	{
+		return allocateDedicated( size, memoryTypeIndex, allocation );
+	}
+
+	Pool& pool = _pools[memoryTypeIndex][static_cast<size_t>( kind )];
+
+	MemoryBlock* target		= nullptr;
+	uint32_t node			= Tlsf::INVALID_NODE;
+	VkDeviceSize offset		= 0;
+
+	for ( auto& block : pool._blocks )
+	{
+		node = block->_tlsf.allocate( size, alignment, offset );
+		if ( Tlsf::INVALID_NODE != node )
+		{
+			target = block.get();
+			break;
+		}
+	}
+
+	if ( nullptr == target )
+	{
+		target = createBlock( blockSize, memoryTypeIndex );
+		if ( nullptr == target )
+		{
+			// The heap may still fit the resource on its own even if a whole new block does not.
+			return allocateDedicated( size, memoryTypeIndex, allocation );
+		}
+
+		target->_kind = kind;
+		pool._blocks.emplace_back( target );
+
+		node = target->_tlsf.allocate( size, alignment, offset );
+		if ( Tlsf::INVALID_NODE == node )
+		{
+			return false;
+		}
+	}
+
+	allocation._memory				= target->_memory;
+	allocation._offset				= offset;
+	allocation._size				= size;
+	allocation._mappedData			= ( nullptr != target->_mappedData ) ? static_cast<char*>( target->_mappedData ) + offset : nullptr;
+	allocation._memoryTypeIndex		= memoryTypeIndex;
+	allocation._block				= target;
+	allocation._node				= node;
+
+	return true;
+}
+
+void MemoryAllocator::free( Allocation& allocation ) noexcept
+{
+	if ( VK_NULL_HANDLE == allocation._memory )
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( _mutex );
+
+	if ( nullptr == allocation._block )
+	{
+		if ( nullptr != allocation._mappedData )
+		{
+			vkUnmapMemory( _device, allocation._memory );
+		}
+
+		vkFreeMemory( _device, allocation._memory, nullptr );
+
+		--_dedicatedCounts[allocation._memoryTypeIndex];
+		_dedicatedBytes[allocation._memoryTypeIndex] -= allocation._size;
+		--_deviceMemoryCount;
+	}
+	else
+	{
+		MemoryBlock* block = allocation._block;
+		block->_tlsf.free( allocation._node );
+
+		// Keep one empty block per pool around so a load/unload cycle does not thrash vkAllocateMemory.
+		Pool& pool = _pools[block->_memoryTypeIndex][static_cast<size_t>( block->_kind )];
+		if ( ( true == block->_tlsf.isEmpty() ) && ( 1 < pool._blocks.size() ) )
+		{
+			const auto found = std::find_if( pool._blocks.begin(), pool._blocks.end(), [block]( const std::unique_ptr<MemoryBlock>& candidate ) noexcept
+			{
+				return candidate.get() == block;
+			} );
+
+			destroyBlock( block );
+			pool._blocks.erase( found );
+		}
+	}
+
+	allocation = Allocation();
+}
+
+bool MemoryAllocator::createBuffer( const VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& allocation ) noexcept
+{
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType		= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size			= size;
+	bufferInfo.usage		= usage;
+	bufferInfo.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+
+	if ( VK_SUCCESS != vkCreateBuffer( _device, &bufferInfo, nullptr, &buffer ) )
+	{
+		return false;
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements( _device, buffer, &memRequirements );
+
+	if ( ( false == allocate( memRequirements, properties, ResourceKind::Linear, allocation ) ) ||
+		 ( VK_SUCCESS != vkBindBufferMemory( _device, buffer, allocation._memory, allocation._offset ) ) )
+	{
+		destroyBuffer( buffer, allocation );
+		return false;
+	}
+
+	return true;
+}
+
+void MemoryAllocator::destroyBuffer( VkBuffer& buffer, Allocation& allocation ) noexcept
+{
+	vkDestroyBuffer( _device, buffer, nullptr );
+	buffer = VK_NULL_HANDLE;
+
+	free( allocation );
+}
+
+bool MemoryAllocator::createImage( const VkImageCreateInfo& imageInfo, const VkMemoryPropertyFlags properties, VkImage& image, Allocation& allocation ) noexcept
+{
+	if ( VK_SUCCESS != vkCreateImage( _device, &imageInfo, nullptr, &image ) )
+	{
+		return false;
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements( _device, image, &memRequirements );
+
+	const ResourceKind kind = ( VK_IMAGE_TILING_OPTIMAL == imageInfo.tiling ) ? ResourceKind::Optimal : ResourceKind::Linear;
+
+	if ( ( false == allocate( memRequirements, properties, kind, allocation ) ) ||
+		 ( VK_SUCCESS != vkBindImageMemory( _device, image, allocation._memory, allocation._offset ) ) )
+	{
+		destroyImage( image, allocation );
+		return false;
+	}
+
+	return true;
+}
+
+void MemoryAllocator::destroyImage( VkImage& image, Allocation& allocation ) noexcept
+{
+	vkDestroyImage( _device, image, nullptr );
+	image = VK_NULL_HANDLE;
+
+	free( allocation );
+}
+
+bool MemoryAllocator::flush( const Allocation& allocation, const VkDeviceSize offset, const VkDeviceSize size ) const noexcept
+{
+	const VkMemoryPropertyFlags typeFlags = _memoryProperties.memoryTypes[allocation._memoryTypeIndex].propertyFlags;
+	if ( typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT )
+	{
+		return true;
+	}
+
+	const VkDeviceSize atomSize		= std::max<VkDeviceSize>( _limits.nonCoherentAtomSize, 1 );
+	const VkDeviceSize begin		= ( allocation._offset + offset ) / atomSize * atomSize;
+	const VkDeviceSize end			= std::min( allocation._offset + allocation._size, ( allocation._offset + offset + size + atomSize - 1 ) / atomSize * atomSize );
+
+	VkMappedMemoryRange range{};
+	range.sType						= VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory					= allocation._memory;
+	range.offset					= begin;
+	range.size						= end - begin;
+
+	return VK_SUCCESS == vkFlushMappedMemoryRanges( _device, 1, &range );
+}
+
+std::vector<HeapStatistics> MemoryAllocator::getHeapStatistics( void ) const noexcept
+{
+	std::lock_guard<std::mutex> lock( _mutex );
+
+	std::vector<HeapStatistics> statistics( _memoryProperties.memoryHeapCount );
+
+	for ( uint32_t ii = 0; ii < _memoryProperties.memoryHeapCount; ++ii )
+	{
+		statistics[ii]					= HeapStatistics{};
+		statistics[ii]._heapIndex		= ii;
+		statistics[ii]._heapSize		= _memoryProperties.memoryHeaps[ii].size;
+		statistics[ii]._isDeviceLocal	= 0 != ( _memoryProperties.memoryHeaps[ii].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT );
+	}
+
+	for ( uint32_t typeIndex = 0; typeIndex < _memoryProperties.memoryTypeCount; ++typeIndex )
+	{
+		HeapStatistics& heap			= statistics[_memoryProperties.memoryTypes[typeIndex].heapIndex];
+
+		heap._dedicatedAllocationCount	+= _dedicatedCounts[typeIndex];
+		heap._allocationCount			+= _dedicatedCounts[typeIndex];
+		heap._reservedBytes				+= _dedicatedBytes[typeIndex];
+		heap._usedBytes					+= _dedicatedBytes[typeIndex];
+
+		for ( const Pool& pool : _pools[typeIndex] )
+		{
+			for ( const auto& block : pool._blocks )
+			{
+				const Tlsf& tlsf		= block->_tlsf;
+
+				++heap._blockCount;
+				heap._allocationCount	+= tlsf.getAllocationCount();
+				heap._reservedBytes		+= tlsf.getSize();
+				heap._usedBytes			+= tlsf.getUsedSize();
+				heap._largestFreeRange	= std::max( heap._largestFreeRange, tlsf.getLargestFreeRange() );
+				heap._freeRangeCount	+= tlsf.getFreeRangeCount();
+			}
+		}
+	}
+
+	for ( HeapStatistics& heap : statistics )
+	{
+		const VkDeviceSize freeBytes	= heap._reservedBytes - heap._usedBytes;
+		heap._fragmentation				= ( 0 < freeBytes ) ? 1.0 - static_cast<double>( heap._largestFreeRange ) / static_cast<double>( freeBytes ) : 0.0;
+	}
+
+	return statistics;
+}
+
+void MemoryAllocator::printStatistics( void ) const noexcept
+{
+	const std::vector<HeapStatistics> statistics = getHeapStatistics();
+
+	std::cout << "memory allocator: " << _deviceMemoryCount << " device memory objects (limit " << _limits.maxMemoryAllocationCount << ")" << std::endl;
+
+	for ( const HeapStatistics& heap : statistics )
+	{
+		if ( 0 == heap._reservedBytes )
+		{
+			continue;
+		}
+
+		std::cout << "  heap " << heap._heapIndex << ( heap._isDeviceLocal ? " (device local)" : "" )
+				  << ": " << heap._blockCount << " blocks, " << heap._dedicatedAllocationCount << " dedicated, "
+				  << heap._allocationCount << " allocations, "
+				  << heap._usedBytes << " / " << heap._reservedBytes << " bytes used, "
+				  << heap._freeRangeCount << " free ranges, fragmentation " << heap._fragmentation << std::endl;
+	}
+}
+
+const VkPhysicalDeviceMemoryProperties& MemoryAllocator::getMemoryProperties( void ) const noexcept
+{
+	return _memoryProperties;
+}
+
+const VkPhysicalDeviceLimits& MemoryAllocator::getLimits( void ) const noexcept
+{
+	return _limits;
+}
+
+VkDeviceSize MemoryAllocator::getBlockSize( const uint32_t memoryTypeIndex ) const noexcept
+{
+	const VkDeviceSize heapSize = _memoryProperties.memoryHeaps[_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+
+	// Small heaps (integrated GPUs, the host-visible BAR window) would be exhausted by a few full-size blocks.
+	return ( heapSize <= SMALL_HEAP_SIZE ) ? std::max<VkDeviceSize>( heapSize / 8, 1 ) : DEFAULT_BLOCK_SIZE;
+}
+
+bool MemoryAllocator::allocateDedicated( const VkDeviceSize size, const uint32_t memoryTypeIndex, Allocation& allocation ) noexcept
+{
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType				= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize	= size;
+	allocInfo.memoryTypeIndex	= memoryTypeIndex;
+
+	VkDeviceMemory memory		= VK_NULL_HANDLE;
+	if ( VK_SUCCESS != vkAllocateMemory( _device, &allocInfo, nullptr, &memory ) ) 
+	{
+		return false;
+	}
+
+	void* mappedData = nullptr;
+	if ( _memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT )
+	{
+		vkMapMemory( _device, memory, 0, VK_WHOLE_SIZE, 0, &mappedData );
+	}
+
+	allocation._memory				= memory;
+	allocation._offset				= 0;
+	allocation._size				= size;
+	allocation._mappedData			= mappedData;
+	allocation._memoryTypeIndex		= memoryTypeIndex;
+	allocation._block				= nullptr;
+	allocation._node				= Tlsf::INVALID_NODE;
+
+	++_dedicatedCounts[memoryTypeIndex];
+	_dedicatedBytes[memoryTypeIndex] += size;
+	++_deviceMemoryCount;
+
+	return true;
+}
+
+MemoryBlock* MemoryAllocator::createBlock( const VkDeviceSize size, const uint32_t memoryTypeIndex ) noexcept
+{
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType				= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize	= size;
+	allocInfo.memoryTypeIndex	= memoryTypeIndex;
+
+	VkDeviceMemory memory		= VK_NULL_HANDLE;
+	if ( VK_SUCCESS != vkAllocateMemory( _device, &allocInfo, nullptr, &memory ) ) 
+	{
+		return nullptr;
+	}
+
+	MemoryBlock* block			= new MemoryBlock( size );
+	block->_memory				= memory;
+	block->_memoryTypeIndex		= memoryTypeIndex;
+
+	// Host-visible blocks stay mapped for their whole lifetime; mapping the same memory twice is not allowed anyway.
+	if ( _memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT )
+	{
+		vkMapMemory( _device, memory, 0, VK_WHOLE_SIZE, 0, &block->_mappedData );
+	}
+
+	++_deviceMemoryCount;
+
+	return block;
+}
+
+void MemoryAllocator::destroyBlock( MemoryBlock* block ) noexcept
+{
+	if ( nullptr != block->_mappedData )
+	{
+		vkUnmapMemory( _device, block->_memory );
+	}
+
+	vkFreeMemory( _device, block->_memory, nullptr );
+	block->_memory = VK_NULL_HANDLE;
+
+	--_deviceMemoryCount;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Tlsf.h"
+
+struct MemoryBlock;
+
+enum class ResourceKind : uint32_t
+{
+	Linear = 0,		// buffers and linear images
+	Optimal,		// optimally tiled images
+	Count
+};
+
+struct Allocation
+{
+	VkDeviceMemory		_memory				= VK_NULL_HANDLE;
+	VkDeviceSize		_offset				= 0;
+	VkDeviceSize		_size				= 0;
+	void*				_mappedData			= nullptr;
+	uint32_t			_memoryTypeIndex	= UINT32_MAX;
+
+	MemoryBlock*		_block				= nullptr;		// nullptr for dedicated allocations
+	uint32_t			_node				= Tlsf::INVALID_NODE;
+};
+
+struct HeapStatistics
+{
+	uint32_t			_heapIndex;
+	VkDeviceSize		_heapSize;
+	bool				_isDeviceLocal;
+
+	uint32_t			_blockCount;
+	uint32_t			_dedicatedAllocationCount;
+	uint32_t			_allocationCount;
+
+	VkDeviceSize		_reservedBytes;			// everything obtained from vkAllocateMemory
+	VkDeviceSize		_usedBytes;				// bytes handed out to resources
+	VkDeviceSize		_largestFreeRange;
+	uint32_t			_freeRangeCount;
+
+	// 0 when all free space in the blocks is one contiguous range, approaching 1 as it is scattered.
+	double				_fragmentation;
+};
+
+class MemoryAllocator
+{
+public:
+
+	MemoryAllocator( void );
+	~MemoryAllocator( void );
+
+	bool							create( const VkPhysicalDevice physicalDevice, const VkDevice device ) noexcept;
+	void							destroy( void ) noexcept;
+
+	uint32_t						findMemoryType( const uint32_t typeFilter, const VkMemoryPropertyFlags properties ) const noexcept;
+
+	bool							allocate( const VkMemoryRequirements& requirements, const VkMemoryPropertyFlags properties, const ResourceKind kind, Allocation& allocation ) noexcept;
+	void							free( Allocation& allocation ) noexcept;
+
+	bool							createBuffer( const VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& allocation ) noexcept;
+	void							destroyBuffer( VkBuffer& buffer, Allocation& allocation ) noexcept;
+
+	bool							createImage( const VkImageCreateInfo& imageInfo, const VkMemoryPropertyFlags properties, VkImage& image, Allocation& allocation ) noexcept;
+	void							destroyImage( VkImage& image, Allocation& allocation ) noexcept;
+
+	bool							flush( const Allocation& allocation, const VkDeviceSize offset, const VkDeviceSize size ) const noexcept;
+
+	std::vector<HeapStatistics>		getHeapStatistics( void ) const noexcept;
+	void							printStatistics( void ) const noexcept;
+
+	const VkPhysicalDeviceMemoryProperties&	getMemoryProperties( void ) const noexcept;
+	const VkPhysicalDeviceLimits&			getLimits( void ) const noexcept;
+
+private:
+
+	struct Pool
+	{
+		std::vector<std::unique_ptr<MemoryBlock>>	_blocks;
+	};
+
+	VkDeviceSize					getBlockSize( const uint32_t memoryTypeIndex ) const noexcept;
+	bool							allocateDedicated( const VkDeviceSize size, const uint32_t memoryTypeIndex, Allocation& allocation ) noexcept;
+	MemoryBlock*					createBlock( const VkDeviceSize size, const uint32_t memoryTypeIndex ) noexcept;
+	void							destroyBlock( MemoryBlock* block ) noexcept;
+
+	VkPhysicalDevice							_physicalDevice;
+	VkDevice									_device;
+	VkPhysicalDeviceMemoryProperties			_memoryProperties;
+	VkPhysicalDeviceLimits						_limits;
+
+	mutable std::mutex							_mutex;
+
+	// Buffers and optimal images live in separate pools, so bufferImageGranularity never has to be checked between neighbours.
+	std::array<std::array<Pool, static_cast<size_t>( ResourceKind::Count )>, VK_MAX_MEMORY_TYPES>	_pools;
+
+	std::array<uint32_t, VK_MAX_MEMORY_TYPES>		_dedicatedCounts;
+	std::array<VkDeviceSize, VK_MAX_MEMORY_TYPES>	_dedicatedBytes;
+	uint32_t									_deviceMemoryCount;
+};
@@ -0,0 +1,170 @@
+#include "pch.h"
+
+#include "Mesh.h"
+
+Mesh Mesh::createQuad( void ) noexcept
+{
+	Mesh mesh;
+
+	mesh._vertices =
+	{
+		{ { -0.5f, -0.5f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, 0.0f } },
+		{ { 0.5f, -0.5f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f, 0.0f } },
+		{ { 0.5f, 0.5f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 0.0f, 1.0f } },
+		{ { -0.5f, 0.5f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 1.0f, 1.0f } }
+	};
+
+	mesh._indices = 
+	{
+		0, 1, 2, 2, 3, 0
+	};
+
+	return mesh;
+}
+
+VkIndexType Mesh::getIndexType( void ) const noexcept
+{
+	// 0xFFFF stays unused so the choice remains valid if primitive restart is ever enabled.
+	return ( _vertices.size() <= UINT16_MAX ) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+void Mesh::computeMissingNormals( void ) noexcept
+{
+	std::vector<bool> isMissing( _vertices.size(), false );
+	bool hasMissing = false;
+
+	for ( size_t ii = 0; ii < _vertices.size(); ++ii )
+	{
+		const glm::vec3& normal = _vertices[ii].normal;
+
+		isMissing[ii]	= ( 0.0f == normal.x ) && ( 0.0f == normal.y ) && ( 0.0f == normal.z );
+		hasMissing		= hasMissing || isMissing[ii];
+	}
+
+	if ( false == hasMissing )
+	{
+		return;
+	}
+
+	for ( size_t ii = 0; ii + 2 < _indices.size(); ii += 3 )
+	{
+		const glm::vec3& a		= _vertices[_indices[ii]].position;
+		const glm::vec3& b		= _vertices[_indices[ii + 1]].position;
+		const glm::vec3& c		= _vertices[_indices[ii + 2]].position;
+
+		// The unnormalized cross product is already weighted by the triangle's area.
+		const float ab[3]		= { b.x - a.x, b.y - a.y, b.z - a.z };
+		const float ac[3]		= { c.x - a.x, c.y - a.y, c.z - a.z };
+		const float cross[3]	= { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+
+		for ( size_t corner = 0; corner < 3; ++corner )
+		{
+			const uint32_t index = _indices[ii + corner];
+
+			if ( true == isMissing[index] )
+			{
+				_vertices[index].normal.x += cross[0];
+				_vertices[index].normal.y += cross[1];
+				_vertices[index].normal.z += cross[2];
+			}
+		}
+	}
+
+	for ( size_t ii = 0; ii < _vertices.size(); ++ii )
+	{
+		glm::vec3& normal	= _vertices[ii].normal;
+		const float length	= std::sqrt( normal.x * normal.x + normal.y * normal.y + normal.z * normal.z );
+
+		if ( ( true == isMissing[ii] ) && ( 0.0f < length ) )
+		{
+			normal.x		/= length;
+			normal.y		/= length;
+			normal.z		/= length;
+		}
+	}
+}
+
+void Mesh::fitToClipVolume( void ) noexcept
+{
+	if ( true == _vertices.empty() )
+	{
+		return;
+	}
+
+	float minimum[3]	= { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maximum[3]	= { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	for ( const Vertex& vertex : _vertices )
+	{
+		const float position[3] = { vertex.position.x, vertex.position.y, vertex.position.z };
+
+		for ( int ii = 0; ii < 3; ++ii )
+		{
+			minimum[ii] = std::min( minimum[ii], position[ii] );
+			maximum[ii] = std::max( maximum[ii], position[ii] );
+		}
+	}
+
+	const float center[3]	= { ( minimum[0] + maximum[0] ) * 0.5f, ( minimum[1] + maximum[1] ) * 0.5f, ( minimum[2] + maximum[2] ) * 0.5f };
+	const float extentXY	= std::max( std::max( maximum[0] - minimum[0], maximum[1] - minimum[1] ), 1e-6f );
+	const float extentZ		= std::max( maximum[2] - minimum[2], 1e-6f );
+
+	// x and y keep their aspect ratio inside [-0.9, 0.9]; z goes to [0.1, 0.9] since Vulkan clips outside [0, 1].
+	// Meshes are authored Y-up and viewed from +Z, while Vulkan clip space is Y-down with depth growing
+	// away from the viewer, so Y and Z are both flipped.
+	const float scaleXY		= 1.8f / extentXY;
+	const float scaleZ		= 0.8f / extentZ;
+
+	for ( Vertex& vertex : _vertices )
+	{
+		vertex.position.x	= ( vertex.position.x - center[0] ) * scaleXY;
+		vertex.position.y	= ( center[1] - vertex.position.y ) * scaleXY;
+		vertex.position.z	= 0.5f + ( center[2] - vertex.position.z ) * scaleZ;
+
+		// Normals take the inverse transpose of the same scale.
+		glm::vec3& normal	= vertex.normal;
+		const float n[3]	= { normal.x / scaleXY, -normal.y / scaleXY, -normal.z / scaleZ };
+		const float length	= std::sqrt( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+
+		if ( 0.0f < length )
+		{
+			normal			= glm::vec3( n[0] / length, n[1] / length, n[2] / length );
+		}
+	}
+}
+
+glm::vec4 Mesh::getBoundingSphere( void ) const noexcept
+{
+	if ( true == _vertices.empty() )
+	{
+		return glm::vec4( 0.0f, 0.0f, 0.0f, 0.0f );
+	}
+
+	float minimum[3]	= { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maximum[3]	= { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	for ( const Vertex& vertex : _vertices )
+	{
+		const float position[3] = { vertex.position.x, vertex.position.y, vertex.position.z };
+
+		for ( int ii = 0; ii < 3; ++ii )
+		{
+			minimum[ii] = std::min( minimum[ii], position[ii] );
+			maximum[ii] = std::max( maximum[ii], position[ii] );
+		}
+	}
+
+	const float center[3]	= { ( minimum[0] + maximum[0] ) * 0.5f, ( minimum[1] + maximum[1] ) * 0.5f, ( minimum[2] + maximum[2] ) * 0.5f };
+	float radiusSquared		= 0.0f;
+
+	for ( const Vertex& vertex : _vertices )
+	{
+		const float x	= vertex.position.x - center[0];
+		const float y	= vertex.position.y - center[1];
+		const float z	= vertex.position.z - center[2];
+
+		radiusSquared	= std::max( radiusSquared, x * x + y * y + z * z );
+	}
+
+	return glm::vec4( center[0], center[1], center[2], std::sqrt( radiusSquared ) );
+}
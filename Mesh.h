@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Vertex.h"
+
+struct Mesh
+{
+	std::vector<Vertex>		_vertices;
+	std::vector<uint32_t>	_indices;
+
+	static Mesh		createQuad( void ) noexcept;
+
+	// 16-bit indices whenever every vertex is addressable by one, halving index fetch bandwidth.
+	VkIndexType		getIndexType( void ) const noexcept;
+
+	// Vertices without a normal get the area-weighted average of their triangles' normals.
+	void			computeMissingNormals( void ) noexcept;
+
+	// There is no camera yet, so loaded meshes are scaled and centered into the clip volume instead.
+	void			fitToClipVolume( void ) noexcept;
+
+	// Centered on the bounding box, so it is not minimal, but cheap and stable; center in xyz, radius in w.
+	glm::vec4		getBoundingSphere( void ) const noexcept;
+};
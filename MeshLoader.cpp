@@ -0,0 +1,1194 @@
+#include "pch.h"
+
+#include "MeshLoader.h"
+#include "Benchmark.h"
+#include "File.h"
+#include "Json.h"
+#include "JobSystem.h"
+#include "TextParser.h"
+
+namespace
+{
+	// Smaller chunks cost more in merging than they win in parallelism.
+	const size_t	MIN_OBJ_CHUNK_SIZE	= 256 * 1024;
+	const uint32_t	OBJ_CHUNKS_PER_THREAD	= 4;
+
+	const int32_t	NO_NORMAL			= INT32_MIN;
+	const uint32_t	POSITION_IS_LOCAL	= 1 << 0;
+	const uint32_t	NORMAL_IS_LOCAL		= 1 << 1;
+
+	const uint32_t	GLB_MAGIC			= 0x46546C67;
+	const uint32_t	GLB_CHUNK_JSON		= 0x4E4F534A;
+	const uint32_t	GLB_CHUNK_BIN		= 0x004E4942;
+
+	const uint32_t	GLTF_BYTE			= 5120;
+	const uint32_t	GLTF_UNSIGNED_BYTE	= 5121;
+	const uint32_t	GLTF_SHORT			= 5122;
+	const uint32_t	GLTF_UNSIGNED_SHORT	= 5123;
+	const uint32_t	GLTF_UNSIGNED_INT	= 5125;
+	const uint32_t	GLTF_FLOAT			= 5126;
+
+	const uint32_t	GLTF_TRIANGLES		= 4;
+	const uint32_t	GLTF_TRIANGLE_STRIP	= 5;
+	const uint32_t	GLTF_TRIANGLE_FAN	= 6;
+
+	// OBJ indices are resolved in two steps: relative (negative) indices can only be made global once
+	// every chunk's element counts are known, so until then they are stored relative to their chunk.
+	struct ObjCorner
+	{
+		int32_t		_position;
+		int32_t		_normal;
+		uint32_t	_flags;
+	};
+
+	struct ObjChunk
+	{
+		const char*				_begin			= nullptr;
+		const char*				_end			= nullptr;
+
+		// x y z r g b per position; r is negative when the line carried no color.
+		std::vector<float>		_positions;
+		std::vector<float>		_normals;
+		std::vector<ObjCorner>	_corners;
+
+		const char*				_error			= nullptr;
+		const char*				_errorPosition	= nullptr;
+	};
+
+	// Open-addressing hash table from a 64-bit key to a vertex index. The equality callback lets
+	// keys that are only hashes (glTF) confirm a match against the vertex itself.
+	class VertexTable
+	{
+	public:
+
+		explicit VertexTable( const size_t expectedCount )
+			: _count{ 0 }
+		{
+			size_t capacity = 16;
+			while ( capacity < expectedCount * 2 )
+			{
+				capacity *= 2;
+			}
+
+			_keys.assign( capacity, 0 );
+			_values.assign( capacity, EMPTY );
+		}
+
+		template<typename Equal>
+		uint32_t findOrInsert( const uint64_t key, const uint32_t value, const Equal& isSame ) noexcept
+		{
+			if ( _keys.size() < ( _count + 1 ) * 2 )
+			{
+				grow();
+			}
+
+			const size_t mask	= _keys.size() - 1;
+			size_t slot			= hash( key ) & mask;
+
+			while ( EMPTY != _values[slot] )
+			{
+				if ( ( key == _keys[slot] ) && ( true == isSame( _values[slot] ) ) )
+				{
+					return _values[slot];
+				}
+
+				slot			= ( slot + 1 ) & mask;
+			}
+
+			_keys[slot]			= key;
+			_values[slot]		= value;
+			++_count;
+
+			return value;
+		}
+
+	private:
+
+		static constexpr uint32_t	EMPTY = UINT32_MAX;
+
+		static size_t hash( const uint64_t key ) noexcept
+		{
+			uint64_t mixed	= key ^ ( key >> 33 );
+			mixed			*= 0xFF51AFD7ED558CCDull;
+			mixed			^= mixed >> 33;
+			return static_cast<size_t>( mixed );
+		}
+
+		void grow( void ) noexcept
+		{
+			std::vector<uint64_t> keys		= std::move( _keys );
+			std::vector<uint32_t> values	= std::move( _values );
+
+			_keys.assign( keys.size() * 2, 0 );
+			_values.assign( keys.size() * 2, EMPTY );
+
+			const size_t mask = _keys.size() - 1;
+
+			for ( size_t ii = 0; ii < keys.size(); ++ii )
+			{
+				if ( EMPTY == values[ii] )
+				{
+					continue;
+				}
+
+				size_t slot = hash( keys[ii] ) & mask;
+				while ( EMPTY != _values[slot] )
+				{
+					slot = ( slot + 1 ) & mask;
+				}
+
+				_keys[slot]		= keys[ii];
+				_values[slot]	= values[ii];
+			}
+		}
+
+		std::vector<uint64_t>	_keys;
+		std::vector<uint32_t>	_values;
+		size_t					_count;
+	};
+
+	bool hasExtension( const std::string& fileName, const char* extension ) noexcept
+	{
+		std::string actual = std::filesystem::path( fileName ).extension().string();
+		std::transform( actual.begin(), actual.end(), actual.begin(), []( const char character ) { return static_cast<char>( std::tolower( static_cast<unsigned char>( character ) ) ); } );
+
+		return actual == extension;
+	}
+
+	// Parses one "v", "v/vt", "v//vn" or "v/vt/vn" face reference.
+	const char* parseObjCorner( const char* cursor, const char* end, const ObjChunk& chunk, ObjCorner& corner ) noexcept
+	{
+		int32_t position	= 0;
+		int32_t normal		= 0;
+
+		cursor = TextParser::parseInt( cursor, end, position );
+		if ( ( nullptr == cursor ) || ( 0 == position ) )
+		{
+			return nullptr;
+		}
+
+		if ( ( cursor < end ) && ( '/' == *cursor ) )
+		{
+			++cursor;
+
+			if ( ( cursor < end ) && ( '/' != *cursor ) )
+			{
+				int32_t texcoord = 0;
+				cursor = TextParser::parseInt( cursor, end, texcoord );
+				if ( nullptr == cursor )
+				{
+					return nullptr;
+				}
+			}
+
+			if ( ( cursor < end ) && ( '/' == *cursor ) )
+			{
+				cursor = TextParser::parseInt( cursor + 1, end, normal );
+				if ( ( nullptr == cursor ) || ( 0 == normal ) )
+				{
+					return nullptr;
+				}
+			}
+		}
+
+		const int32_t localPositionCount	= static_cast<int32_t>( chunk._positions.size() / 6 );
+		const int32_t localNormalCount		= static_cast<int32_t>( chunk._normals.size() / 3 );
+
+		corner._flags		= 0;
+		corner._position	= ( 0 < position ) ? position - 1 : localPositionCount + position;
+		corner._flags		|= ( 0 < position ) ? 0 : POSITION_IS_LOCAL;
+
+		if ( 0 == normal )
+		{
+			corner._normal	= NO_NORMAL;
+		}
+		else
+		{
+			corner._normal	= ( 0 < normal ) ? normal - 1 : localNormalCount + normal;
+			corner._flags	|= ( 0 < normal ) ? 0 : NORMAL_IS_LOCAL;
+		}
+
+		return cursor;
+	}
+
+	void parseObjChunk( ObjChunk& chunk ) noexcept
+	{
+		std::vector<ObjCorner> face;
+
+		const char* end = chunk._end;
+
+		for ( const char* line = chunk._begin; line < end; )
+		{
+			const char* lineBegin	= line;
+			const char* newLine		= static_cast<const char*>( memchr( line, '\n', static_cast<size_t>( end - line ) ) );
+			const char* lineEnd		= ( nullptr == newLine ) ? end : newLine;
+			const char* cursor		= TextParser::skipSpaces( line, lineEnd );
+
+			line					= ( nullptr == newLine ) ? end : newLine + 1;
+
+			if ( lineEnd - cursor < 2 )
+			{
+				continue;
+			}
+
+			const bool isSeparator = ( ' ' == cursor[1] ) || ( '\t' == cursor[1] );
+
+			if ( ( 'v' == cursor[0] ) && ( true == isSeparator ) )
+			{
+				float values[6] = { 0.0f, 0.0f, 0.0f, -1.0f, -1.0f, -1.0f };
+
+				for ( int ii = 0; ii < 3; ++ii )
+				{
+					cursor = TextParser::parseFloat( TextParser::skipSpaces( ( 0 == ii ) ? cursor + 1 : cursor, lineEnd ), lineEnd, values[ii] );
+					if ( nullptr == cursor )
+					{
+						chunk._error			= "malformed vertex position";
+						chunk._errorPosition	= lineBegin;
+						return;
+					}
+				}
+
+				// Optional per-vertex color, a widespread extension of the format.
+				float color[3] = { 0.0f, 0.0f, 0.0f };
+				const char* colorCursor = cursor;
+
+				for ( int ii = 0; ( ii < 3 ) && ( nullptr != colorCursor ); ++ii )
+				{
+					colorCursor = TextParser::parseFloat( TextParser::skipSpaces( colorCursor, lineEnd ), lineEnd, color[ii] );
+				}
+
+				if ( nullptr != colorCursor )
+				{
+					values[3] = color[0];
+					values[4] = color[1];
+					values[5] = color[2];
+				}
+
+				chunk._positions.insert( chunk._positions.end(), values, values + 6 );
+			}
+			else if ( ( 'v' == cursor[0] ) && ( 'n' == cursor[1] ) )
+			{
+				cursor += 2;
+
+				for ( int ii = 0; ii < 3; ++ii )
+				{
+					float value = 0.0f;
+					cursor = TextParser::parseFloat( TextParser::skipSpaces( cursor, lineEnd ), lineEnd, value );
+					if ( nullptr == cursor )
+					{
+						chunk._error			= "malformed vertex normal";
+						chunk._errorPosition	= lineBegin;
+						return;
+					}
+
+					chunk._normals.push_back( value );
+				}
+			}
+			else if ( ( 'f' == cursor[0] ) && ( true == isSeparator ) )
+			{
+				face.clear();
+				cursor = TextParser::skipSpaces( cursor + 1, lineEnd );
+
+				while ( cursor < lineEnd )
+				{
+					ObjCorner corner{};
+					cursor = parseObjCorner( cursor, lineEnd, chunk, corner );
+					if ( nullptr == cursor )
+					{
+						chunk._error			= "malformed face";
+						chunk._errorPosition	= lineBegin;
+						return;
+					}
+
+					face.push_back( corner );
+					cursor = TextParser::skipSpaces( cursor, lineEnd );
+				}
+
+				// Polygons are triangulated as fans.
+				for ( size_t ii = 2; ii < face.size(); ++ii )
+				{
+					chunk._corners.push_back( face[0] );
+					chunk._corners.push_back( face[ii - 1] );
+					chunk._corners.push_back( face[ii] );
+				}
+			}
+		}
+	}
+
+	// Column-major 4x4 transform.
+	struct Transform
+	{
+		float	_m[16];
+	};
+
+	Transform multiply( const Transform& lhs, const Transform& rhs ) noexcept
+	{
+		Transform result{};
+
+		for ( int column = 0; column < 4; ++column )
+		{
+			for ( int row = 0; row < 4; ++row )
+			{
+				float sum = 0.0f;
+
+				for ( int kk = 0; kk < 4; ++kk )
+				{
+					sum += lhs._m[kk * 4 + row] * rhs._m[column * 4 + kk];
+				}
+
+				result._m[column * 4 + row] = sum;
+			}
+		}
+
+		return result;
+	}
+
+	Transform getIdentity( void ) noexcept
+	{
+		Transform identity{};
+		identity._m[0] = identity._m[5] = identity._m[10] = identity._m[15] = 1.0f;
+
+		return identity;
+	}
+
+	// Leaves the defaults in place when the array is missing or too short.
+	void readFloats( const Json& array, float* values, const size_t count ) noexcept
+	{
+		if ( count > array.size() )
+		{
+			return;
+		}
+
+		for ( size_t ii = 0; ii < count; ++ii )
+		{
+			values[ii] = static_cast<float>( array[ii].asNumber( values[ii] ) );
+		}
+	}
+
+	Transform getNodeTransform( const Json& node ) noexcept
+	{
+		const Json& matrix = node["matrix"];
+
+		if ( 16 == matrix.size() )
+		{
+			Transform transform = getIdentity();
+			readFloats( matrix, transform._m, 16 );
+
+			return transform;
+		}
+
+		const Json& translation	= node["translation"];
+		const Json& rotation	= node["rotation"];
+		const Json& scale		= node["scale"];
+
+		float t[3]	= { 0.0f, 0.0f, 0.0f };
+		float q[4]	= { 0.0f, 0.0f, 0.0f, 1.0f };
+		float s[3]	= { 1.0f, 1.0f, 1.0f };
+
+		readFloats( translation, t, 3 );
+		readFloats( rotation, q, 4 );
+		readFloats( scale, s, 3 );
+
+		const float x = q[0], y = q[1], z = q[2], w = q[3];
+
+		// T * R * S, with R from the unit quaternion (x, y, z, w).
+		Transform transform{};
+		transform._m[0]		= ( 1.0f - 2.0f * ( y * y + z * z ) ) * s[0];
+		transform._m[1]		= ( 2.0f * ( x * y + z * w ) ) * s[0];
+		transform._m[2]		= ( 2.0f * ( x * z - y * w ) ) * s[0];
+		transform._m[4]		= ( 2.0f * ( x * y - z * w ) ) * s[1];
+		transform._m[5]		= ( 1.0f - 2.0f * ( x * x + z * z ) ) * s[1];
+		transform._m[6]		= ( 2.0f * ( y * z + x * w ) ) * s[1];
+		transform._m[8]		= ( 2.0f * ( x * z + y * w ) ) * s[2];
+		transform._m[9]		= ( 2.0f * ( y * z - x * w ) ) * s[2];
+		transform._m[10]	= ( 1.0f - 2.0f * ( x * x + y * y ) ) * s[2];
+		transform._m[12]	= t[0];
+		transform._m[13]	= t[1];
+		transform._m[14]	= t[2];
+		transform._m[15]	= 1.0f;
+
+		return transform;
+	}
+
+	struct GlbPrimitive
+	{
+		const Json*				_primitive	= nullptr;
+		Transform				_transform;
+
+		std::vector<Vertex>		_vertices;
+		std::vector<uint32_t>	_indices;
+		const char*				_error		= nullptr;
+	};
+
+	struct GlbContext
+	{
+		Json					_document;
+		const unsigned char*	_bin		= nullptr;
+		size_t					_binSize	= 0;
+	};
+
+	uint32_t getComponentCount( const std::string& type ) noexcept
+	{
+		if ( "SCALAR" == type )	return 1;
+		if ( "VEC2" == type )	return 2;
+		if ( "VEC3" == type )	return 3;
+		if ( "VEC4" == type )	return 4;
+		return 0;
+	}
+
+	uint32_t getComponentSize( const uint32_t componentType ) noexcept
+	{
+		switch ( componentType )
+		{
+		case GLTF_BYTE:
+		case GLTF_UNSIGNED_BYTE:	return 1;
+		case GLTF_SHORT:
+		case GLTF_UNSIGNED_SHORT:	return 2;
+		case GLTF_UNSIGNED_INT:
+		case GLTF_FLOAT:			return 4;
+		default:					return 0;
+		}
+	}
+
+	float readComponent( const unsigned char* source, const uint32_t componentType, const bool isNormalized ) noexcept
+	{
+		switch ( componentType )
+		{
+		case GLTF_FLOAT:
+			{
+				float value;
+				memcpy( &value, source, sizeof( value ) );
+				return value;
+			}
+		case GLTF_UNSIGNED_BYTE:
+			return ( true == isNormalized ) ? source[0] / 255.0f : source[0];
+		case GLTF_BYTE:
+			{
+				const float value = static_cast<float>( static_cast<int8_t>( source[0] ) );
+				return ( true == isNormalized ) ? std::max( value / 127.0f, -1.0f ) : value;
+			}
+		case GLTF_UNSIGNED_SHORT:
+			{
+				uint16_t value;
+				memcpy( &value, source, sizeof( value ) );
+				return ( true == isNormalized ) ? value / 65535.0f : value;
+			}
+		case GLTF_SHORT:
+			{
+				int16_t value;
+				memcpy( &value, source, sizeof( value ) );
+				return ( true == isNormalized ) ? std::max( value / 32767.0f, -1.0f ) : value;
+			}
+		case GLTF_UNSIGNED_INT:
+			{
+				uint32_t value;
+				memcpy( &value, source, sizeof( value ) );
+				return static_cast<float>( value );
+			}
+		default:
+			return 0.0f;
+		}
+	}
+
+	uint32_t readIndex( const unsigned char* source, const uint32_t componentType ) noexcept
+	{
+		if ( GLTF_UNSIGNED_INT == componentType )
+		{
+			uint32_t value;
+			memcpy( &value, source, sizeof( value ) );
+			return value;
+		}
+
+		if ( GLTF_UNSIGNED_SHORT == componentType )
+		{
+			uint16_t value;
+			memcpy( &value, source, sizeof( value ) );
+			return value;
+		}
+
+		return source[0];
+	}
+
+	// Resolves an accessor to a strided view into the BIN chunk, validating every bound on the way.
+	const char* resolveAccessor( const GlbContext& context, const uint32_t accessorIndex, const unsigned char*& data, size_t& stride, uint32_t& count, uint32_t& componentCount, uint32_t& componentType, bool& isNormalized ) noexcept
+	{
+		const Json& accessor	= context._document["accessors"][accessorIndex];
+		if ( true == accessor.isNull() )
+		{
+			return "accessor index out of range";
+		}
+
+		if ( false == accessor["sparse"].isNull() )
+		{
+			return "sparse accessors are not supported";
+		}
+
+		const Json& bufferView	= context._document["bufferViews"][accessor["bufferView"].asUint( UINT32_MAX )];
+		if ( true == bufferView.isNull() )
+		{
+			return "accessor has no buffer view";
+		}
+
+		const Json& buffer		= context._document["buffers"][bufferView["buffer"].asUint( UINT32_MAX )];
+		if ( ( 0 != bufferView["buffer"].asUint( UINT32_MAX ) ) || ( false == buffer["uri"].isNull() ) )
+		{
+			return "only the GLB binary chunk is supported as a buffer";
+		}
+
+		count					= accessor["count"].asUint( 0 );
+		componentType			= accessor["componentType"].asUint( 0 );
+		componentCount			= getComponentCount( accessor["type"].asString() );
+		isNormalized			= accessor["normalized"].asBool( false );
+
+		const size_t elementSize	= static_cast<size_t>( getComponentSize( componentType ) ) * componentCount;
+		if ( 0 == elementSize )
+		{
+			return "unsupported accessor type";
+		}
+
+		const size_t viewOffset		= bufferView["byteOffset"].asUint( 0 );
+		const size_t viewLength		= bufferView["byteLength"].asUint( 0 );
+		const size_t accessorOffset	= accessor["byteOffset"].asUint( 0 );
+
+		stride						= bufferView["byteStride"].asUint( 0 );
+		stride						= ( 0 == stride ) ? elementSize : stride;
+
+		if ( ( context._binSize < viewOffset ) || ( context._binSize - viewOffset < viewLength ) )
+		{
+			return "buffer view exceeds the binary chunk";
+		}
+
+		if ( ( 0 < count ) && ( viewLength < accessorOffset + stride * ( count - 1 ) + elementSize ) )
+		{
+			return "accessor exceeds its buffer view";
+		}
+
+		data						= context._bin + viewOffset + accessorOffset;
+
+		return nullptr;
+	}
+
+	const char* readFloatAttribute( const GlbContext& context, const uint32_t accessorIndex, const uint32_t vertexCount, std::vector<float>& values, uint32_t& componentCount ) noexcept
+	{
+		const unsigned char* data	= nullptr;
+		size_t stride				= 0;
+		uint32_t count				= 0;
+		uint32_t componentType		= 0;
+		bool isNormalized			= false;
+
+		const char* error = resolveAccessor( context, accessorIndex, data, stride, count, componentCount, componentType, isNormalized );
+		if ( nullptr != error )
+		{
+			return error;
+		}
+
+		if ( ( UINT32_MAX != vertexCount ) && ( count != vertexCount ) )
+		{
+			return "attribute count differs from POSITION";
+		}
+
+		const uint32_t componentSize = getComponentSize( componentType );
+		values.resize( static_cast<size_t>( count ) * componentCount );
+
+		for ( uint32_t ii = 0; ii < count; ++ii )
+		{
+			for ( uint32_t jj = 0; jj < componentCount; ++jj )
+			{
+				values[static_cast<size_t>( ii ) * componentCount + jj] = readComponent( data + stride * ii + componentSize * jj, componentType, isNormalized );
+			}
+		}
+
+		return nullptr;
+	}
+
+	void decodePrimitive( const GlbContext& context, GlbPrimitive& item ) noexcept
+	{
+		const Json& primitive	= *item._primitive;
+		const Json& attributes	= primitive["attributes"];
+
+		std::vector<float> positions;
+		uint32_t positionComponents = 0;
+
+		item._error = readFloatAttribute( context, attributes["POSITION"].asUint( UINT32_MAX ), UINT32_MAX, positions, positionComponents );
+		if ( nullptr != item._error )
+		{
+			return;
+		}
+
+		if ( 3 != positionComponents )
+		{
+			item._error = "POSITION must be VEC3";
+			return;
+		}
+
+		const uint32_t vertexCount	= static_cast<uint32_t>( positions.size() / 3 );
+
+		std::vector<float> normals;
+		uint32_t normalComponents	= 0;
+
+		if ( false == attributes["NORMAL"].isNull() )
+		{
+			item._error = readFloatAttribute( context, attributes["NORMAL"].asUint( UINT32_MAX ), vertexCount, normals, normalComponents );
+			if ( nullptr != item._error )
+			{
+				return;
+			}
+		}
+
+		std::vector<float> colors;
+		uint32_t colorComponents	= 0;
+
+		if ( false == attributes["COLOR_0"].isNull() )
+		{
+			item._error = readFloatAttribute( context, attributes["COLOR_0"].asUint( UINT32_MAX ), vertexCount, colors, colorComponents );
+			if ( nullptr != item._error )
+			{
+				return;
+			}
+		}
+
+		// Normals go through the cofactor matrix, which is the inverse transpose scaled by the determinant;
+		// normalizing removes the scale, and the determinant's sign keeps mirrored normals pointing outward.
+		const float* m				= item._transform._m;
+		const float cofactor[9]		=
+		{
+			m[5] * m[10] - m[6] * m[9],		m[6] * m[8] - m[4] * m[10],		m[4] * m[9] - m[5] * m[8],
+			m[2] * m[9] - m[1] * m[10],		m[0] * m[10] - m[2] * m[8],		m[1] * m[8] - m[0] * m[9],
+			m[1] * m[6] - m[2] * m[5],		m[2] * m[4] - m[0] * m[6],		m[0] * m[5] - m[1] * m[4]
+		};
+		const float determinant		= m[0] * cofactor[0] + m[4] * cofactor[3] + m[8] * cofactor[6];
+
+		item._vertices.resize( vertexCount );
+
+		for ( uint32_t ii = 0; ii < vertexCount; ++ii )
+		{
+			const float* p		= &positions[static_cast<size_t>( ii ) * 3];
+			Vertex& vertex		= item._vertices[ii];
+
+			vertex.position.x	= m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+			vertex.position.y	= m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+			vertex.position.z	= m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+
+			if ( 3 == normalComponents )
+			{
+				const float* n	= &normals[static_cast<size_t>( ii ) * 3];
+				float world[3]	=
+				{
+					cofactor[0] * n[0] + cofactor[1] * n[1] + cofactor[2] * n[2],
+					cofactor[3] * n[0] + cofactor[4] * n[1] + cofactor[5] * n[2],
+					cofactor[6] * n[0] + cofactor[7] * n[1] + cofactor[8] * n[2]
+				};
+
+				const float length	= std::sqrt( world[0] * world[0] + world[1] * world[1] + world[2] * world[2] );
+				const float scale	= ( 0.0f < length ) ? std::copysign( 1.0f / length, determinant ) : 0.0f;
+
+				vertex.normal		= glm::vec3( world[0] * scale, world[1] * scale, world[2] * scale );
+			}
+			else
+			{
+				vertex.normal		= glm::vec3( 0.0f, 0.0f, 0.0f );
+			}
+
+			if ( 3 <= colorComponents )
+			{
+				const float* c	= &colors[static_cast<size_t>( ii ) * colorComponents];
+				vertex.color	= glm::vec3( c[0], c[1], c[2] );
+			}
+			else
+			{
+				vertex.color	= glm::vec3( 1.0f, 1.0f, 1.0f );
+			}
+		}
+
+		std::vector<uint32_t> indices;
+
+		if ( false == primitive["indices"].isNull() )
+		{
+			const unsigned char* data	= nullptr;
+			size_t stride				= 0;
+			uint32_t count				= 0;
+			uint32_t componentCount		= 0;
+			uint32_t componentType		= 0;
+			bool isNormalized			= false;
+
+			item._error = resolveAccessor( context, primitive["indices"].asUint( UINT32_MAX ), data, stride, count, componentCount, componentType, isNormalized );
+			if ( nullptr != item._error )
+			{
+				return;
+			}
+
+			if ( ( 1 != componentCount ) || ( GLTF_FLOAT == componentType ) || ( GLTF_BYTE == componentType ) || ( GLTF_SHORT == componentType ) )
+			{
+				item._error = "indices must be unsigned scalars";
+				return;
+			}
+
+			indices.resize( count );
+
+			for ( uint32_t ii = 0; ii < count; ++ii )
+			{
+				indices[ii] = readIndex( data + stride * ii, componentType );
+
+				if ( vertexCount <= indices[ii] )
+				{
+					item._error = "index out of range";
+					return;
+				}
+			}
+		}
+		else
+		{
+			indices.resize( vertexCount );
+			for ( uint32_t ii = 0; ii < vertexCount; ++ii )
+			{
+				indices[ii] = ii;
+			}
+		}
+
+		const uint32_t mode			= primitive["mode"].asUint( GLTF_TRIANGLES );
+		const bool flipWinding		= ( 0.0f > determinant );
+
+		auto addTriangle = [&]( const uint32_t a, const uint32_t b, const uint32_t c )
+		{
+			item._indices.push_back( a );
+			item._indices.push_back( ( true == flipWinding ) ? c : b );
+			item._indices.push_back( ( true == flipWinding ) ? b : c );
+		};
+
+		const size_t indexCount		= indices.size();
+
+		if ( GLTF_TRIANGLES == mode )
+		{
+			for ( size_t ii = 0; ii + 2 < indexCount; ii += 3 )
+			{
+				addTriangle( indices[ii], indices[ii + 1], indices[ii + 2] );
+			}
+		}
+		else if ( GLTF_TRIANGLE_STRIP == mode )
+		{
+			for ( size_t ii = 0; ii + 2 < indexCount; ++ii )
+			{
+				if ( 0 == ( ii & 1 ) )
+				{
+					addTriangle( indices[ii], indices[ii + 1], indices[ii + 2] );
+				}
+				else
+				{
+					addTriangle( indices[ii + 1], indices[ii], indices[ii + 2] );
+				}
+			}
+		}
+		else if ( GLTF_TRIANGLE_FAN == mode )
+		{
+			for ( size_t ii = 1; ii + 1 < indexCount; ++ii )
+			{
+				addTriangle( indices[0], indices[ii], indices[ii + 1] );
+			}
+		}
+		// Points and lines have nothing to contribute to a triangle mesh and are dropped.
+	}
+
+	uint64_t hashVertex( const Vertex& vertex ) noexcept
+	{
+		// FNV-1a over the raw bytes; equal vertices hash equally, the table confirms with memcmp.
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>( &vertex );
+		uint64_t hash = 0xCBF29CE484222325ull;
+
+		for ( size_t ii = 0; ii < sizeof( Vertex ); ++ii )
+		{
+			hash = ( hash ^ bytes[ii] ) * 0x100000001B3ull;
+		}
+
+		return hash;
+	}
+}
+
+double MeshLoadStatistics::getMegabytesPerSecond( void ) const noexcept
+{
+	return ( static_cast<double>( _fileBytes ) / ( 1024.0 * 1024.0 ) ) / ( std::max( _totalMs, 1e-3 ) / 1000.0 );
+}
+
+bool MeshLoader::load( const std::string& fileName, JobSystem& jobSystem, Mesh& mesh, MeshLoadStatistics& statistics ) noexcept
+{
+	const auto begin	= std::chrono::steady_clock::now();
+
+	statistics			= MeshLoadStatistics{};
+
+	MappedFile file;
+	if ( FileError::None != File::map( fileName, file ) )
+	{
+		return false;
+	}
+
+	statistics._readMs	= Benchmark::millisecondsSince( begin );
+
+	return parse( fileName, file, jobSystem, mesh, statistics );
+}
+
+bool MeshLoader::parse( const std::string& fileName, const MappedFile& file, JobSystem& jobSystem, Mesh& mesh, MeshLoadStatistics& statistics ) noexcept
+{
+	const auto begin	= std::chrono::steady_clock::now();
+
+	statistics._fileBytes = file.getSize();
+
+	if ( 0 == file.getSize() )
+	{
+		std::cerr << "mesh " << fileName << " is empty" << std::endl;
+		return false;
+	}
+
+	bool isLoaded		= false;
+
+	if ( true == hasExtension( fileName, ".obj" ) )
+	{
+		isLoaded		= loadObj( file.getData(), file.getSize(), jobSystem, mesh, statistics );
+	}
+	else if ( true == hasExtension( fileName, ".glb" ) )
+	{
+		isLoaded		= loadGlb( file.getData(), file.getSize(), jobSystem, mesh, statistics );
+	}
+	else
+	{
+		std::cerr << "unsupported mesh format: " << fileName << std::endl;
+		return false;
+	}
+
+	if ( false == isLoaded )
+	{
+		std::cerr << "failed to load mesh " << fileName << std::endl;
+		return false;
+	}
+
+	mesh.computeMissingNormals();
+
+	statistics._totalMs	= statistics._readMs + Benchmark::millisecondsSince( begin );
+
+	return true;
+}
+
+bool MeshLoader::loadObj( const char* data, const size_t size, JobSystem& jobSystem, Mesh& mesh, MeshLoadStatistics& statistics ) noexcept
+{
+	auto phaseBegin				= std::chrono::steady_clock::now();
+
+	const char* begin			= data;
+	const char* end				= begin + size;
+
+	// Chunks are cut at line boundaries so no statement straddles two of them.
+	const size_t targetCount	= static_cast<size_t>( jobSystem.getThreadCount() ) * OBJ_CHUNKS_PER_THREAD;
+	const size_t chunkSize		= std::max( MIN_OBJ_CHUNK_SIZE, size / std::max<size_t>( targetCount, 1 ) + 1 );
+
+	std::vector<ObjChunk> chunks;
+
+	for ( const char* cursor = begin; cursor < end; )
+	{
+		const char* chunkEnd	= ( static_cast<size_t>( end - cursor ) <= chunkSize ) ? end : TextParser::skipLine( cursor + chunkSize, end );
+
+		chunks.emplace_back();
+		chunks.back()._begin	= cursor;
+		chunks.back()._end		= chunkEnd;
+
+		cursor					= chunkEnd;
+	}
+
+	jobSystem.parallelFor( static_cast<uint32_t>( chunks.size() ), 1, [&chunks]( const uint32_t first, const uint32_t count )
+	{
+		for ( uint32_t ii = first; ii < first + count; ++ii )
+		{
+			parseObjChunk( chunks[ii] );
+		}
+	} );
+
+	statistics._parseMs			= Benchmark::millisecondsSince( phaseBegin );
+	phaseBegin					= std::chrono::steady_clock::now();
+
+	size_t positionCount		= 0;
+	size_t normalCount			= 0;
+	size_t cornerCount			= 0;
+
+	for ( const ObjChunk& chunk : chunks )
+	{
+		if ( nullptr != chunk._error )
+		{
+			const size_t lineNumber = 1 + static_cast<size_t>( std::count( begin, chunk._errorPosition, '\n' ) );
+			std::cerr << "obj: " << chunk._error << " on line " << lineNumber << std::endl;
+			return false;
+		}
+
+		positionCount			+= chunk._positions.size() / 6;
+		normalCount				+= chunk._normals.size() / 3;
+		cornerCount				+= chunk._corners.size();
+	}
+
+	if ( ( 0 == cornerCount ) || ( UINT32_MAX <= cornerCount ) || ( INT32_MAX <= positionCount ) || ( INT32_MAX <= normalCount ) )
+	{
+		std::cerr << "obj: no faces, or more than the 32-bit index range" << std::endl;
+		return false;
+	}
+
+	std::vector<float> positions;
+	std::vector<float> normals;
+	positions.reserve( positionCount * 6 );
+	normals.reserve( normalCount * 3 );
+
+	for ( const ObjChunk& chunk : chunks )
+	{
+		positions.insert( positions.end(), chunk._positions.begin(), chunk._positions.end() );
+		normals.insert( normals.end(), chunk._normals.begin(), chunk._normals.end() );
+	}
+
+	mesh._vertices.clear();
+	mesh._indices.clear();
+	mesh._vertices.reserve( positionCount );
+	mesh._indices.reserve( cornerCount );
+
+	VertexTable table( positionCount );
+
+	int64_t positionBase		= 0;
+	int64_t normalBase			= 0;
+
+	for ( const ObjChunk& chunk : chunks )
+	{
+		for ( const ObjCorner& corner : chunk._corners )
+		{
+			const int64_t position	= corner._position + ( ( 0 != ( corner._flags & POSITION_IS_LOCAL ) ) ? positionBase : 0 );
+			const int64_t normal	= ( NO_NORMAL == corner._normal ) ? -1 : corner._normal + ( ( 0 != ( corner._flags & NORMAL_IS_LOCAL ) ) ? normalBase : 0 );
+
+			if ( ( 0 > position ) || ( static_cast<int64_t>( positionCount ) <= position ) || ( static_cast<int64_t>( normalCount ) <= normal ) || ( ( NO_NORMAL != corner._normal ) && ( 0 > normal ) ) )
+			{
+				std::cerr << "obj: face index out of range" << std::endl;
+				return false;
+			}
+
+			// Position and normal indices are both below 2^31, so the key is exact and needs no further check.
+			const uint64_t key			= ( static_cast<uint64_t>( position ) << 32 ) | static_cast<uint32_t>( normal + 1 );
+			const uint32_t candidate	= static_cast<uint32_t>( mesh._vertices.size() );
+			const uint32_t index		= table.findOrInsert( key, candidate, []( const uint32_t ) { return true; } );
+
+			if ( index == candidate )
+			{
+				const float* p	= &positions[static_cast<size_t>( position ) * 6];
+
+				Vertex vertex{};
+				vertex.position	= glm::vec3( p[0], p[1], p[2] );
+
+				vertex.color	= ( 0.0f <= p[3] ) ? glm::vec3( p[3], p[4], p[5] ) : glm::vec3( 1.0f, 1.0f, 1.0f );
+
+				if ( 0 <= normal )
+				{
+					const float* n	= &normals[static_cast<size_t>( normal ) * 3];
+					vertex.normal	= glm::vec3( n[0], n[1], n[2] );
+				}
+				else
+				{
+					vertex.normal	= glm::vec3( 0.0f, 0.0f, 0.0f );
+				}
+
+				mesh._vertices.push_back( vertex );
+			}
+
+			mesh._indices.push_back( index );
+		}
+
+		positionBase			+= static_cast<int64_t>( chunk._positions.size() / 6 );
+		normalBase				+= static_cast<int64_t>( chunk._normals.size() / 3 );
+	}
+
+	statistics._cornerCount		= static_cast<uint32_t>( cornerCount );
+	statistics._buildMs			= Benchmark::millisecondsSince( phaseBegin );
+
+	return true;
+}
+
+bool MeshLoader::loadGlb( const char* data, const size_t size, JobSystem& jobSystem, Mesh& mesh, MeshLoadStatistics& statistics ) noexcept
+{
+	auto phaseBegin				= std::chrono::steady_clock::now();
+
+	const unsigned char* bytes	= reinterpret_cast<const unsigned char*>( data );
+
+	auto readUint32 = [bytes]( const size_t offset )
+	{
+		uint32_t value;
+		memcpy( &value, bytes + offset, sizeof( value ) );
+		return value;
+	};
+
+	if ( ( 20 > size ) || ( GLB_MAGIC != readUint32( 0 ) ) || ( 2 != readUint32( 4 ) ) || ( size < readUint32( 8 ) ) )
+	{
+		std::cerr << "glb: not a glTF 2.0 binary file" << std::endl;
+		return false;
+	}
+
+	const size_t jsonLength		= readUint32( 12 );
+	if ( ( GLB_CHUNK_JSON != readUint32( 16 ) ) || ( size - 20 < jsonLength ) )
+	{
+		std::cerr << "glb: missing or truncated JSON chunk" << std::endl;
+		return false;
+	}
+
+	GlbContext context;
+
+	if ( false == Json::parse( data + 20, data + 20 + jsonLength, context._document ) )
+	{
+		std::cerr << "glb: malformed JSON chunk" << std::endl;
+		return false;
+	}
+
+	// The BIN chunk is optional in the format, but every accessor we read lives in it.
+	const size_t binHeader		= 20 + ( ( jsonLength + 3 ) & ~size_t( 3 ) );
+	if ( binHeader + 8 <= size )
+	{
+		const size_t binLength	= readUint32( binHeader );
+		if ( ( GLB_CHUNK_BIN == readUint32( binHeader + 4 ) ) && ( binLength <= size - binHeader - 8 ) )
+		{
+			context._bin		= bytes + binHeader + 8;
+			context._binSize	= binLength;
+		}
+	}
+
+	const Json& document		= context._document;
+	const Json& nodes			= document["nodes"];
+	const Json& meshes			= document["meshes"];
+
+	// Walk the default scene (or, without scenes, every mesh untransformed) into a flat list of primitives.
+	std::vector<GlbPrimitive> items;
+
+	auto addMesh = [&]( const Json& meshJson, const Transform& transform )
+	{
+		const Json& primitives = meshJson["primitives"];
+
+		for ( size_t ii = 0; ii < primitives.size(); ++ii )
+		{
+			items.emplace_back();
+			items.back()._primitive	= &primitives[ii];
+			items.back()._transform	= transform;
+		}
+	};
+
+	const Json& scenes			= document["scenes"];
+
+	if ( 0 == scenes.size() )
+	{
+		for ( size_t ii = 0; ii < meshes.size(); ++ii )
+		{
+			addMesh( meshes[ii], getIdentity() );
+		}
+	}
+	else
+	{
+		const Json& roots		= scenes[document["scene"].asUint( 0 )]["nodes"];
+
+		// Children are pushed in reverse so primitives come out in document order.
+		std::vector<std::pair<uint32_t, Transform>> stack;
+		for ( size_t ii = roots.size(); ii > 0; --ii )
+		{
+			stack.emplace_back( roots[ii - 1].asUint( UINT32_MAX ), getIdentity() );
+		}
+
+		// Bounded by the node count, so a cyclic hierarchy cannot loop forever.
+		size_t visitBudget		= nodes.size() * 4 + 16;
+
+		while ( ( false == stack.empty() ) && ( 0 < visitBudget-- ) )
+		{
+			const auto [nodeIndex, parentTransform] = stack.back();
+			stack.pop_back();
+
+			const Json& node	= nodes[nodeIndex];
+			if ( true == node.isNull() )
+			{
+				std::cerr << "glb: node index out of range" << std::endl;
+				return false;
+			}
+
+			const Transform world = multiply( parentTransform, getNodeTransform( node ) );
+
+			if ( false == node["mesh"].isNull() )
+			{
+				addMesh( meshes[node["mesh"].asUint( UINT32_MAX )], world );
+			}
+
+			const Json& children = node["children"];
+			for ( size_t ii = children.size(); ii > 0; --ii )
+			{
+				stack.emplace_back( children[ii - 1].asUint( UINT32_MAX ), world );
+			}
+		}
+	}
+
+	if ( true == items.empty() )
+	{
+		std::cerr << "glb: the scene has no mesh primitives" << std::endl;
+		return false;
+	}
+
+	jobSystem.parallelFor( static_cast<uint32_t>( items.size() ), 1, [&context, &items]( const uint32_t first, const uint32_t count )
+	{
+		for ( uint32_t ii = first; ii < first + count; ++ii )
+		{
+			decodePrimitive( context, items[ii] );
+		}
+	} );
+
+	statistics._parseMs			= Benchmark::millisecondsSince( phaseBegin );
+	phaseBegin					= std::chrono::steady_clock::now();
+
+	size_t cornerCount			= 0;
+	size_t sourceVertexCount	= 0;
+
+	for ( const GlbPrimitive& item : items )
+	{
+		if ( nullptr != item._error )
+		{
+			std::cerr << "glb: " << item._error << std::endl;
+			return false;
+		}
+
+		cornerCount				+= item._indices.size();
+		sourceVertexCount		+= item._vertices.size();
+	}
+
+	if ( ( 0 == cornerCount ) || ( UINT32_MAX <= cornerCount ) )
+	{
+		std::cerr << "glb: no triangles, or more than the 32-bit index range" << std::endl;
+		return false;
+	}
+
+	mesh._vertices.clear();
+	mesh._indices.clear();
+	mesh._vertices.reserve( sourceVertexCount );
+	mesh._indices.reserve( cornerCount );
+
+	// Exporters often split vertices that end up identical once transformed, so merge across primitives too.
+	VertexTable table( sourceVertexCount );
+	std::vector<uint32_t> remap;
+
+	for ( const GlbPrimitive& item : items )
+	{
+		remap.resize( item._vertices.size() );
+
+		for ( size_t ii = 0; ii < item._vertices.size(); ++ii )
+		{
+			const Vertex& vertex		= item._vertices[ii];
+			const uint32_t candidate	= static_cast<uint32_t>( mesh._vertices.size() );
+
+			remap[ii] = table.findOrInsert( hashVertex( vertex ), candidate, [&mesh, &vertex]( const uint32_t existing )
+			{
+				return 0 == memcmp( &mesh._vertices[existing], &vertex, sizeof( Vertex ) );
+			} );
+
+			if ( remap[ii] == candidate )
+			{
+				mesh._vertices.push_back( vertex );
+			}
+		}
+
+		for ( const uint32_t index : item._indices )
+		{
+			mesh._indices.push_back( remap[index] );
+		}
+	}
+
+	statistics._cornerCount		= static_cast<uint32_t>( cornerCount );
+	statistics._buildMs			= Benchmark::millisecondsSince( phaseBegin );
+
+	return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Mesh.h"
+
+class JobSystem;
+class MappedFile;
+
+struct MeshLoadStatistics
+{
+	uint64_t	_fileBytes		= 0;
+	uint32_t	_cornerCount	= 0;
+	double		_readMs			= 0.0;
+	double		_parseMs		= 0.0;
+	double		_buildMs		= 0.0;
+	double		_totalMs		= 0.0;
+
+	double		getMegabytesPerSecond( void ) const noexcept;
+};
+
+// Loads Wavefront OBJ and binary glTF 2.0 (.glb) into one interleaved, indexed Mesh.
+// Parsing is spread over the job system; identical vertices are merged through a hash table.
+class MeshLoader
+{
+public:
+
+	static bool		load( const std::string& fileName, JobSystem& jobSystem, Mesh& mesh, MeshLoadStatistics& statistics ) noexcept;
+
+	// For files that were mapped ahead of time; fileName picks the format. Keeps statistics._readMs.
+	static bool		parse( const std::string& fileName, const MappedFile& file, JobSystem& jobSystem, Mesh& mesh, MeshLoadStatistics& statistics ) noexcept;
+
+private:
+
+	static bool		loadObj( const char* data, const size_t size, JobSystem& jobSystem, Mesh& mesh, MeshLoadStatistics& statistics ) noexcept;
+	static bool		loadGlb( const char* data, const size_t size, JobSystem& jobSystem, Mesh& mesh, MeshLoadStatistics& statistics ) noexcept;
+};
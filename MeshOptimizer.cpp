@@ -0,0 +1,419 @@
+#include "pch.h"
+
+#include "MeshOptimizer.h"
+#include "Benchmark.h"
+
+namespace
+{
+	// Forsyth's scoring constants, tuned for an LRU cache of 32 entries.
+	const uint32_t	FORSYTH_CACHE_SIZE		= 32;
+	const float		CACHE_DECAY_POWER		= 1.5f;
+	const float		LAST_TRIANGLE_SCORE		= 0.75f;
+	const float		VALENCE_BOOST_SCALE		= 2.0f;
+	const float		VALENCE_BOOST_POWER		= 0.5f;
+	const uint32_t	MAX_SCORED_VALENCE		= 32;
+
+	// Recent GPUs behave roughly like a small FIFO, so that is what the report simulates.
+	const uint32_t	ANALYZE_CACHE_SIZE		= 16;
+
+	// Overdraw clusters may cost up to 5% more vertex transforms than the cache-optimal order.
+	const double	ACMR_THRESHOLD			= 1.05;
+	const uint32_t	MIN_CLUSTER_TRIANGLES	= 32;
+
+	const uint32_t	NOT_CACHED				= UINT32_MAX;
+
+	struct VertexScoreTable
+	{
+		float	_cache[FORSYTH_CACHE_SIZE];
+		float	_valence[MAX_SCORED_VALENCE + 1];
+
+		VertexScoreTable( void ) noexcept
+		{
+			for ( uint32_t ii = 0; ii < FORSYTH_CACHE_SIZE; ++ii )
+			{
+				// The three most recent vertices score the same, so the order within the last triangle does not matter.
+				_cache[ii] = ( 3 > ii ) ? LAST_TRIANGLE_SCORE : std::pow( 1.0f - static_cast<float>( ii - 3 ) / static_cast<float>( FORSYTH_CACHE_SIZE - 3 ), CACHE_DECAY_POWER );
+			}
+
+			_valence[0] = 0.0f;
+			for ( uint32_t ii = 1; ii <= MAX_SCORED_VALENCE; ++ii )
+			{
+				_valence[ii] = VALENCE_BOOST_SCALE * std::pow( static_cast<float>( ii ), -VALENCE_BOOST_POWER );
+			}
+		}
+
+		float getScore( const uint32_t cachePosition, const uint32_t valence ) const noexcept
+		{
+			// Vertices with nothing left to draw must not attract triangles.
+			if ( 0 == valence )
+			{
+				return -1.0f;
+			}
+
+			const float cacheScore = ( NOT_CACHED == cachePosition ) ? 0.0f : _cache[cachePosition];
+
+			return cacheScore + _valence[std::min( valence, MAX_SCORED_VALENCE )];
+		}
+	};
+
+	const VertexScoreTable& getScoreTable( void ) noexcept
+	{
+		static const VertexScoreTable table;
+		return table;
+	}
+
+	struct Vector3
+	{
+		double	_x;
+		double	_y;
+		double	_z;
+	};
+
+	Vector3 toVector3( const glm::vec3& value ) noexcept
+	{
+		return Vector3{ value.x, value.y, value.z };
+	}
+}
+
+void MeshOptimizer::optimize( Mesh& mesh, MeshOptimizationStatistics& statistics ) noexcept
+{
+	const auto begin			= std::chrono::steady_clock::now();
+
+	statistics._before			= analyzeVertexCache( mesh._indices, mesh._vertices.size() );
+
+	optimizeVertexCache( mesh._indices, mesh._vertices.size() );
+	statistics._clusterCount	= optimizeOverdraw( mesh._indices, mesh._vertices );
+	optimizeVertexFetch( mesh._vertices, mesh._indices );
+
+	statistics._after			= analyzeVertexCache( mesh._indices, mesh._vertices.size() );
+	statistics._optimizeMs		= Benchmark::millisecondsSince( begin );
+}
+
+void MeshOptimizer::optimizeVertexCache( std::vector<uint32_t>& indices, const size_t vertexCount ) noexcept
+{
+	const size_t triangleCount	= indices.size() / 3;
+	if ( 0 == triangleCount )
+	{
+		return;
+	}
+
+	const VertexScoreTable& scores = getScoreTable();
+
+	// Per-vertex list of triangles not yet emitted, stored as one CSR array; the live part of each
+	// range shrinks as triangles are emitted, so its live count doubles as the remaining valence.
+	std::vector<uint32_t> adjacencyOffsets( vertexCount + 1, 0 );
+	for ( size_t ii = 0; ii < triangleCount * 3; ++ii )
+	{
+		++adjacencyOffsets[indices[ii] + 1];
+	}
+
+	for ( size_t ii = 0; ii < vertexCount; ++ii )
+	{
+		adjacencyOffsets[ii + 1] += adjacencyOffsets[ii];
+	}
+
+	std::vector<uint32_t> liveCounts( vertexCount, 0 );
+	std::vector<uint32_t> adjacency( triangleCount * 3 );
+
+	for ( size_t ii = 0; ii < triangleCount * 3; ++ii )
+	{
+		const uint32_t vertex = indices[ii];
+		adjacency[adjacencyOffsets[vertex] + liveCounts[vertex]++] = static_cast<uint32_t>( ii / 3 );
+	}
+
+	std::vector<uint32_t> cachePositions( vertexCount, NOT_CACHED );
+	std::vector<float> vertexScores( vertexCount );
+	std::vector<bool> isEmitted( triangleCount, false );
+
+	for ( size_t ii = 0; ii < vertexCount; ++ii )
+	{
+		vertexScores[ii] = scores.getScore( NOT_CACHED, liveCounts[ii] );
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve( triangleCount * 3 );
+
+	// Three slots past the cache size hold the vertices pushed out by the newest triangle.
+	uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+	uint32_t nextCache[FORSYTH_CACHE_SIZE + 3];
+	uint32_t cacheCount			= 0;
+
+	uint32_t bestTriangle		= UINT32_MAX;
+	size_t fallbackCursor		= 0;
+
+	for ( size_t emitted = 0; emitted < triangleCount; ++emitted )
+	{
+		// Nothing in the cache has triangles left: restart from the first unemitted triangle in input order.
+		if ( UINT32_MAX == bestTriangle )
+		{
+			while ( true == isEmitted[fallbackCursor] )
+			{
+				++fallbackCursor;
+			}
+
+			bestTriangle = static_cast<uint32_t>( fallbackCursor );
+		}
+
+		const uint32_t* triangle	= &indices[static_cast<size_t>( bestTriangle ) * 3];
+		result.insert( result.end(), triangle, triangle + 3 );
+		isEmitted[bestTriangle]		= true;
+
+		uint32_t nextCount			= 0;
+
+		for ( uint32_t corner = 0; corner < 3; ++corner )
+		{
+			const uint32_t vertex	= triangle[corner];
+
+			// Drop the triangle from its vertices' live ranges.
+			uint32_t* live			= &adjacency[adjacencyOffsets[vertex]];
+			uint32_t& liveCount		= liveCounts[vertex];
+
+			for ( uint32_t ii = 0; ii < liveCount; ++ii )
+			{
+				if ( bestTriangle == live[ii] )
+				{
+					live[ii] = live[--liveCount];
+					break;
+				}
+			}
+
+			// Degenerate triangles name a vertex twice; it only takes one cache slot.
+			if ( std::find( nextCache, nextCache + nextCount, vertex ) == nextCache + nextCount )
+			{
+				nextCache[nextCount++] = vertex;
+			}
+		}
+
+		for ( uint32_t ii = 0; ii < cacheCount; ++ii )
+		{
+			const uint32_t vertex = cache[ii];
+
+			if ( ( vertex != triangle[0] ) && ( vertex != triangle[1] ) && ( vertex != triangle[2] ) )
+			{
+				nextCache[nextCount++] = vertex;
+			}
+		}
+
+		std::copy( nextCache, nextCache + nextCount, cache );
+		cacheCount					= std::min( nextCount, FORSYTH_CACHE_SIZE );
+
+		// Rescore everything that moved, including the vertices that just fell out of the cache.
+		for ( uint32_t ii = 0; ii < nextCount; ++ii )
+		{
+			const uint32_t vertex	= cache[ii];
+			cachePositions[vertex]	= ( ii < cacheCount ) ? ii : NOT_CACHED;
+			vertexScores[vertex]	= scores.getScore( cachePositions[vertex], liveCounts[vertex] );
+		}
+
+		// Only triangles touching the cache changed score, so the next triangle is the best of those.
+		bestTriangle				= UINT32_MAX;
+		float bestScore				= -FLT_MAX;
+
+		for ( uint32_t ii = 0; ii < cacheCount; ++ii )
+		{
+			const uint32_t vertex	= cache[ii];
+			const uint32_t* live	= &adjacency[adjacencyOffsets[vertex]];
+
+			for ( uint32_t jj = 0; jj < liveCounts[vertex]; ++jj )
+			{
+				const uint32_t candidate	= live[jj];
+				const uint32_t* corners		= &indices[static_cast<size_t>( candidate ) * 3];
+				const float score			= vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+
+				if ( bestScore < score )
+				{
+					bestScore				= score;
+					bestTriangle			= candidate;
+				}
+			}
+		}
+	}
+
+	indices.swap( result );
+}
+
+uint32_t MeshOptimizer::optimizeOverdraw( std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices ) noexcept
+{
+	const size_t triangleCount	= indices.size() / 3;
+	if ( 0 == triangleCount )
+	{
+		return 0;
+	}
+
+	// Split the cache-ordered list into clusters, simulating the cache from empty at each cluster start.
+	// A cluster ends as soon as its own ACMR is within ACMR_THRESHOLD of the whole mesh's, which bounds
+	// what reordering the clusters can cost in vertex reuse.
+	const double acmrLimit		= analyzeVertexCache( indices, vertices.size() )._acmr * ACMR_THRESHOLD;
+
+	std::vector<uint32_t> clusterStarts( 1, 0 );
+	std::vector<uint32_t> timestamps( vertices.size(), 0 );
+	uint32_t time				= ANALYZE_CACHE_SIZE + 1;
+	size_t clusterMisses		= 0;
+
+	for ( size_t ii = 0; ii < triangleCount; ++ii )
+	{
+		for ( uint32_t corner = 0; corner < 3; ++corner )
+		{
+			const uint32_t vertex = indices[ii * 3 + corner];
+
+			if ( time - timestamps[vertex] > ANALYZE_CACHE_SIZE )
+			{
+				timestamps[vertex] = time++;
+				++clusterMisses;
+			}
+		}
+
+		const size_t clusterSize = ii + 1 - clusterStarts.back();
+
+		if ( ( ii + 1 < triangleCount ) && ( MIN_CLUSTER_TRIANGLES <= clusterSize ) && ( static_cast<double>( clusterMisses ) <= acmrLimit * static_cast<double>( clusterSize ) ) )
+		{
+			clusterStarts.push_back( static_cast<uint32_t>( ii + 1 ) );
+			clusterMisses	= 0;
+
+			// Jumping the clock past the cache size empties the simulated cache.
+			time			+= ANALYZE_CACHE_SIZE + 1;
+		}
+	}
+
+	const size_t clusterCount	= clusterStarts.size();
+	clusterStarts.push_back( static_cast<uint32_t>( triangleCount ) );
+
+	// Area-weighted centroid of the whole mesh, then per cluster a centroid and an average normal.
+	// Clusters facing away from the mesh center are drawn first: they tend to occlude the rest.
+	std::vector<Vector3> clusterCentroids( clusterCount, Vector3{ 0.0, 0.0, 0.0 } );
+	std::vector<Vector3> clusterNormals( clusterCount, Vector3{ 0.0, 0.0, 0.0 } );
+	std::vector<double> clusterAreas( clusterCount, 0.0 );
+
+	Vector3 meshCentroid		= { 0.0, 0.0, 0.0 };
+	double meshArea				= 0.0;
+
+	for ( size_t cluster = 0; cluster < clusterCount; ++cluster )
+	{
+		for ( uint32_t ii = clusterStarts[cluster]; ii < clusterStarts[cluster + 1]; ++ii )
+		{
+			const Vector3 a		= toVector3( vertices[indices[static_cast<size_t>( ii ) * 3]].position );
+			const Vector3 b		= toVector3( vertices[indices[static_cast<size_t>( ii ) * 3 + 1]].position );
+			const Vector3 c		= toVector3( vertices[indices[static_cast<size_t>( ii ) * 3 + 2]].position );
+
+			const Vector3 ab	= { b._x - a._x, b._y - a._y, b._z - a._z };
+			const Vector3 ac	= { c._x - a._x, c._y - a._y, c._z - a._z };
+			const Vector3 cross	= { ab._y * ac._z - ab._z * ac._y, ab._z * ac._x - ab._x * ac._z, ab._x * ac._y - ab._y * ac._x };
+			const double area	= std::sqrt( cross._x * cross._x + cross._y * cross._y + cross._z * cross._z );
+
+			Vector3& centroid	= clusterCentroids[cluster];
+			centroid._x			+= ( a._x + b._x + c._x ) * area;
+			centroid._y			+= ( a._y + b._y + c._y ) * area;
+			centroid._z			+= ( a._z + b._z + c._z ) * area;
+
+			// The unnormalized cross product is already area-weighted.
+			Vector3& normal		= clusterNormals[cluster];
+			normal._x			+= cross._x;
+			normal._y			+= cross._y;
+			normal._z			+= cross._z;
+
+			clusterAreas[cluster] += area;
+		}
+
+		meshCentroid._x			+= clusterCentroids[cluster]._x;
+		meshCentroid._y			+= clusterCentroids[cluster]._y;
+		meshCentroid._z			+= clusterCentroids[cluster]._z;
+		meshArea				+= clusterAreas[cluster];
+	}
+
+	const double meshScale		= ( 0.0 < meshArea ) ? 1.0 / ( meshArea * 3.0 ) : 0.0;
+	meshCentroid				= { meshCentroid._x * meshScale, meshCentroid._y * meshScale, meshCentroid._z * meshScale };
+
+	std::vector<double> sortKeys( clusterCount, 0.0 );
+
+	for ( size_t cluster = 0; cluster < clusterCount; ++cluster )
+	{
+		const double scale		= ( 0.0 < clusterAreas[cluster] ) ? 1.0 / ( clusterAreas[cluster] * 3.0 ) : 0.0;
+		const Vector3& centroid	= clusterCentroids[cluster];
+		const Vector3& normal	= clusterNormals[cluster];
+		const double length		= std::sqrt( normal._x * normal._x + normal._y * normal._y + normal._z * normal._z );
+
+		if ( 0.0 < length )
+		{
+			sortKeys[cluster]	= ( ( centroid._x * scale - meshCentroid._x ) * normal._x + ( centroid._y * scale - meshCentroid._y ) * normal._y + ( centroid._z * scale - meshCentroid._z ) * normal._z ) / length;
+		}
+	}
+
+	std::vector<uint32_t> order( clusterCount );
+	for ( size_t ii = 0; ii < clusterCount; ++ii )
+	{
+		order[ii] = static_cast<uint32_t>( ii );
+	}
+
+	std::stable_sort( order.begin(), order.end(), [&sortKeys]( const uint32_t lhs, const uint32_t rhs ) { return sortKeys[lhs] > sortKeys[rhs]; } );
+
+	std::vector<uint32_t> result;
+	result.reserve( indices.size() );
+
+	for ( const uint32_t cluster : order )
+	{
+		result.insert( result.end(), indices.begin() + static_cast<size_t>( clusterStarts[cluster] ) * 3, indices.begin() + static_cast<size_t>( clusterStarts[cluster + 1] ) * 3 );
+	}
+
+	indices.swap( result );
+
+	return static_cast<uint32_t>( clusterCount );
+}
+
+void MeshOptimizer::optimizeVertexFetch( std::vector<Vertex>& vertices, std::vector<uint32_t>& indices ) noexcept
+{
+	// Vertices are laid out in the order the index buffer first touches them; unreferenced ones are dropped.
+	std::vector<uint32_t> remap( vertices.size(), UINT32_MAX );
+	std::vector<Vertex> result;
+	result.reserve( vertices.size() );
+
+	for ( uint32_t& index : indices )
+	{
+		if ( UINT32_MAX == remap[index] )
+		{
+			remap[index] = static_cast<uint32_t>( result.size() );
+			result.push_back( vertices[index] );
+		}
+
+		index = remap[index];
+	}
+
+	vertices.swap( result );
+}
+
+VertexCacheStatistics MeshOptimizer::analyzeVertexCache( const std::vector<uint32_t>& indices, const size_t vertexCount ) noexcept
+{
+	VertexCacheStatistics statistics;
+
+	if ( ( 3 > indices.size() ) || ( 0 == vertexCount ) )
+	{
+		return statistics;
+	}
+
+	// A FIFO cache is simulated with insertion timestamps: an entry is resident while fewer than
+	// ANALYZE_CACHE_SIZE vertices have been inserted after it.
+	std::vector<uint32_t> timestamps( vertexCount, 0 );
+	std::vector<bool> isUsed( vertexCount, false );
+	uint32_t time			= ANALYZE_CACHE_SIZE + 1;
+	size_t misses			= 0;
+	size_t usedCount		= 0;
+
+	for ( const uint32_t index : indices )
+	{
+		if ( time - timestamps[index] > ANALYZE_CACHE_SIZE )
+		{
+			timestamps[index] = time++;
+			++misses;
+		}
+
+		if ( false == isUsed[index] )
+		{
+			isUsed[index] = true;
+			++usedCount;
+		}
+	}
+
+	statistics._acmr		= static_cast<double>( misses ) / static_cast<double>( indices.size() / 3 );
+	statistics._atvr		= static_cast<double>( misses ) / static_cast<double>( usedCount );
+
+	return statistics;
+}
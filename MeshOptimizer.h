@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Mesh.h"
+
+// Average cache miss ratio (transformed vertices per triangle) and average transform to
+// vertex ratio (transformed vertices per unique vertex) under a simulated FIFO post-transform cache.
+struct VertexCacheStatistics
+{
+	double		_acmr	= 0.0;
+	double		_atvr	= 0.0;
+};
+
+struct MeshOptimizationStatistics
+{
+	VertexCacheStatistics	_before;
+	VertexCacheStatistics	_after;
+	uint32_t				_clusterCount	= 0;
+	double					_optimizeMs		= 0.0;
+};
+
+// Reorders a triangle list for the GPU: triangles for post-transform cache reuse (Forsyth),
+// then cache-friendly clusters of triangles outside-in to cut overdraw, then vertices in
+// first-use order for fetch locality. The rendered result is unchanged.
+class MeshOptimizer
+{
+public:
+
+	static void						optimize( Mesh& mesh, MeshOptimizationStatistics& statistics ) noexcept;
+
+	static void						optimizeVertexCache( std::vector<uint32_t>& indices, const size_t vertexCount ) noexcept;
+	static uint32_t					optimizeOverdraw( std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices ) noexcept;
+	static void						optimizeVertexFetch( std::vector<Vertex>& vertices, std::vector<uint32_t>& indices ) noexcept;
+
+	static VertexCacheStatistics	analyzeVertexCache( const std::vector<uint32_t>& indices, const size_t vertexCount ) noexcept;
+};
@@ -0,0 +1,167 @@
+#include "pch.h"
+
+#include "Options.h"
+
+Options Options::parse( const int argc, char* argv[] ) noexcept
+{
+	Options options;
+
+	for ( int ii = 1; ii < argc; ++ii )
+	{
+		const std::string argument( argv[ii] );
+
+		if ( "--headless" == argument )
+		{
+			options._headless = true;
+		}
+		else if ( ( "--frames" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._frameCount = static_cast<uint32_t>( std::strtoul( argv[++ii], nullptr, 10 ) );
+		}
+		else if ( "--benchmark" == argument )
+		{
+			options._benchmark = true;
+		}
+		else if ( ( "--warmup" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._warmupFrames = static_cast<uint32_t>( std::strtoul( argv[++ii], nullptr, 10 ) );
+		}
+		else if ( ( "--benchmark-output" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._benchmarkOutput = argv[++ii];
+		}
+		else if ( ( "--frames-in-flight" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._framesInFlight = std::min( std::max( static_cast<uint32_t>( std::strtoul( argv[++ii], nullptr, 10 ) ), 1u ), MAX_FRAMES_IN_FLIGHT );
+		}
+		else if ( ( "--present-mode" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._presentMode = argv[++ii];
+		}
+		else if ( "--low-latency" == argument )
+		{
+			options._lowLatency = true;
+		}
+		else if ( ( "--samples" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._sampleCount = static_cast<uint32_t>( std::strtoul( argv[++ii], nullptr, 10 ) );
+		}
+		else if ( ( "--texture" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._textureFile = argv[++ii];
+		}
+		else if ( ( "--texture-budget" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._textureBudgetMB = static_cast<uint32_t>( std::strtoul( argv[++ii], nullptr, 10 ) );
+		}
+		else if ( ( "--texture-upload" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._textureUploadMB = std::max( static_cast<uint32_t>( std::strtoul( argv[++ii], nullptr, 10 ) ), 1u );
+		}
+		else if ( ( "--pipeline-cache" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._pipelineCacheFile = argv[++ii];
+		}
+		else if ( "--no-pipeline-cache" == argument )
+		{
+			options._pipelineCacheFile.clear();
+		}
+		else if ( "--pipeline-permutations" == argument )
+		{
+			options._pipelinePermutations = true;
+		}
+		else if ( ( "--record-threads" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._recordThreads = static_cast<uint32_t>( std::strtoul( argv[++ii], nullptr, 10 ) );
+		}
+		else if ( ( "--draws" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._drawCount = static_cast<uint32_t>( std::strtoul( argv[++ii], nullptr, 10 ) );
+		}
+		else if ( "--no-instancing" == argument )
+		{
+			options._instancing = false;
+		}
+		else if ( "--gpu-culling" == argument )
+		{
+			options._gpuCulling = true;
+		}
+		else if ( "--cpu-culling" == argument )
+		{
+			options._cpuCulling = true;
+		}
+		else if ( ( "--culling-kernel" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._cullingKernel	= argv[++ii];
+			options._cpuCulling		= true;
+		}
+		else if ( "--cull-benchmark" == argument )
+		{
+			options._cullBenchmark = true;
+		}
+		else if ( "--no-indirect-count" == argument )
+		{
+			options._indirectCount = false;
+		}
+		else if ( ( "--scene-extent" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._sceneExtent = std::max( std::strtof( argv[++ii], nullptr ), 1e-3f );
+		}
+		else if ( "--record-benchmark" == argument )
+		{
+			options._recordBenchmark = true;
+		}
+		else if ( "--dump-render-graph" == argument )
+		{
+			options._dumpRenderGraph = true;
+		}
+		else if ( ( "--particles" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._particleCount = static_cast<uint32_t>( std::strtoul( argv[++ii], nullptr, 10 ) );
+		}
+		else if ( "--particle-benchmark" == argument )
+		{
+			options._particleBenchmark = true;
+		}
+		else if ( ( "--job-threads" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._jobThreads = static_cast<uint32_t>( std::strtoul( argv[++ii], nullptr, 10 ) );
+		}
+		else if ( "--job-benchmark" == argument )
+		{
+			options._jobBenchmark = true;
+		}
+		else if ( ( "--mesh" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._meshFile = argv[++ii];
+		}
+		else if ( "--no-mesh-optimize" == argument )
+		{
+			options._optimizeMesh = false;
+		}
+		else if ( "--full-vertices" == argument )
+		{
+			options._compactVertices = false;
+		}
+		else if ( "--watch-shaders" == argument )
+		{
+			options._watchShaders = true;
+		}
+		else if ( ( "--shader-compiler" == argument ) && ( ii + 1 < argc ) )
+		{
+			options._shaderCompiler	= argv[++ii];
+			options._watchShaders	= true;
+		}
+		else
+		{
+			std::cerr << "unknown option: " << argument << std::endl;
+		}
+	}
+
+	if ( ( true == options._particleBenchmark ) && ( 0 == options._particleCount ) )
+	{
+		options._particleCount = BENCHMARK_PARTICLE_COUNT;
+	}
+
+	return options;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+struct Options
+{
+	bool			_headless			= false;
+	uint32_t		_frameCount			= 1000;
+
+	bool			_benchmark			= false;
+	uint32_t		_warmupFrames		= 100;
+	std::string		_benchmarkOutput;
+
+	// Frames the CPU may record ahead of the GPU, clamped to [1, MAX_FRAMES_IN_FLIGHT].
+	uint32_t		_framesInFlight		= 2;
+	// immediate, mailbox, fifo or fifo_relaxed; empty prefers mailbox and falls back to fifo.
+	std::string		_presentMode;
+	// Waits for the previous frame to finish before input is sampled, trading throughput for latency.
+	bool			_lowLatency			= false;
+
+	// MSAA samples per pixel, lowered to what the device supports for color and depth; 1 turns MSAA off.
+	uint32_t		_sampleCount		= 4;
+
+	// KTX2 (BCn, ETC2 or RGBA8) or TGA, streamed in while the scene renders; empty leaves the scene untextured.
+	std::string		_textureFile;
+	// Device memory the streamed textures may occupy, and the staging each frame may fill.
+	uint32_t		_textureBudgetMB	= 256;
+	uint32_t		_textureUploadMB	= 16;
+
+	std::string		_pipelineCacheFile	= "pipeline_cache.bin";
+	// Compiles every blend, cull and depth permutation of the scene shaders on the job threads at startup.
+	bool			_pipelinePermutations	= false;
+
+	// Most job threads recording draws at once; 0 uses every job thread.
+	uint32_t		_recordThreads		= 0;
+	// Objects in the scene, all copies of the mesh; they are merged into instanced draws unless instancing is off.
+	uint32_t		_drawCount			= 1;
+	bool			_instancing			= true;
+	// Objects are culled and their draws generated by a compute pass, then drawn with multi-draw indirect.
+	bool			_gpuCulling			= false;
+	bool			_indirectCount		= true;
+	// Objects outside the view are culled on the CPU before recording, with the named kernel (scalar, sse, avx2) or the best one.
+	bool			_cpuCulling			= false;
+	std::string		_cullingKernel;
+	bool			_cullBenchmark		= false;
+	// Half-width of the object grid in clip space; above 1 part of the scene is outside the view.
+	float			_sceneExtent		= 1.0f;
+	bool			_recordBenchmark	= false;
+	// Prints the compiled render graph: passes, barriers, render passes and transient memory.
+	bool			_dumpRenderGraph	= false;
+
+	// GPU-simulated particles drawn over the scene; 0 turns them off. The benchmark sweeps counts up to this
+	// many, BENCHMARK_PARTICLE_COUNT unless given.
+	uint32_t		_particleCount		= 0;
+	bool			_particleBenchmark	= false;
+
+	// 0 picks one job thread per hardware thread.
+	uint32_t		_jobThreads			= 0;
+	bool			_jobBenchmark		= false;
+
+	// OBJ or GLB; empty draws the built-in quad.
+	std::string		_meshFile;
+	bool			_optimizeMesh		= true;
+	bool			_compactVertices	= true;
+
+	// Rebuilds the pipeline when vert.spv/frag.spv change; with a compiler (glslc) the GLSL sources are watched too.
+	bool			_watchShaders		= false;
+	std::string		_shaderCompiler;
+
+	static const uint32_t	MAX_FRAMES_IN_FLIGHT = 8;
+	static const uint32_t	BENCHMARK_PARTICLE_COUNT = 4 * 1024 * 1024;
+
+	static Options	parse( const int argc, char* argv[] ) noexcept;
+};
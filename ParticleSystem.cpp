@@ -0,0 +1,481 @@
+#include "pch.h"
+
+#include "ParticleSystem.h"
+#include "File.h"
+#include "Benchmark.h"
+
+namespace
+{
+	const char* const SIMULATION_SHADER_FILE	= "./particles.spv";
+	const char* const VERTEX_SHADER_FILE		= "./particle_vert.spv";
+	const char* const FRAGMENT_SHADER_FILE		= "./particle_frag.spv";
+
+	const uint32_t PARTICLE_BINDING				= 0;
+
+	// Layout of the push constant block in particles.comp.
+	struct SimulationConstants
+	{
+		float		_deltaTime;
+		uint32_t	_particleCount;
+		uint32_t	_seed;
+	};
+
+	bool loadShader( const VkDevice device, const char* fileName, MappedFile& code, ShaderReflection& reflection, VkShaderModule& shaderModule ) noexcept
+	{
+		if ( FileError::None != File::map( fileName, code ) )
+		{
+			return false;
+		}
+
+		if ( ( 0 != ( code.getSize() % sizeof( uint32_t ) ) ) || ( false == reflection.reflect( code.getWords(), code.getWordCount() ) ) )
+		{
+			std::cerr << "particles: " << fileName << " is not a valid SPIR-V module" << std::endl;
+			return false;
+		}
+
+		VkShaderModuleCreateInfo moduleInfo{};
+		moduleInfo.sType		= VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleInfo.codeSize		= code.getSize();
+		moduleInfo.pCode		= code.getWords();
+
+		return VK_SUCCESS == vkCreateShaderModule( device, &moduleInfo, nullptr, &shaderModule );
+	}
+}
+
+ParticleSystem::ParticleSystem( void )
+	: _device{ VK_NULL_HANDLE }
+	, _allocator{ nullptr }
+	, _buffer{ VK_NULL_HANDLE }
+	, _particleCount{ 0 }
+	, _activeCount{ 0 }
+	, _isCleared{ false }
+	, _descriptorPool{ VK_NULL_HANDLE }
+	, _descriptorSet{ VK_NULL_HANDLE }
+	, _renderPipeline{ VK_NULL_HANDLE }
+	, _renderLayout{ VK_NULL_HANDLE }
+	, _pipelineCache{ nullptr }
+	, _layoutCache{ nullptr }
+	, _queryPool{ VK_NULL_HANDLE }
+	, _timestampPeriod{ 0.0f }
+	, _timestampMask{ ~0ull }
+{
+
+}
+
+bool ParticleSystem::create( const VkDevice device, MemoryAllocator& allocator, PipelineCache& pipelineCache, PipelineLayoutCache& layoutCache,
+							 const uint32_t particleCount, const uint32_t frameCount, const float timestampPeriod, const uint64_t timestampMask ) noexcept
+{
+	_device				= device;
+	_allocator			= &allocator;
+	_pipelineCache		= &pipelineCache;
+	_layoutCache		= &layoutCache;
+	_timestampPeriod	= timestampPeriod;
+	_timestampMask		= timestampMask;
+
+	if ( false == _simulation.load( SIMULATION_SHADER_FILE ) )
+	{
+		return false;
+	}
+
+	const ShaderReflection& reflection = _simulation.getReflection();
+	const std::vector<VkPushConstantRange>& pushConstantRanges = reflection.getPushConstantRanges();
+
+	if ( ( 1 != pushConstantRanges.size() ) || ( sizeof( SimulationConstants ) != pushConstantRanges[0].offset + pushConstantRanges[0].size ) || ( 1 != reflection.getBindings().size() ) )
+	{
+		std::cerr << "particles: " << SIMULATION_SHADER_FILE << " does not match the simulation interface" << std::endl;
+		return false;
+	}
+
+	// The whole buffer is one storage binding, and one dispatch covers it.
+	const VkPhysicalDeviceLimits& limits	= allocator.getLimits();
+	const uint64_t groupLimit				= static_cast<uint64_t>( limits.maxComputeWorkGroupCount[0] ) * reflection.getLocalSize()[0];
+	const uint64_t rangeLimit				= limits.maxStorageBufferRange / PARTICLE_STRIDE;
+
+	_particleCount			= static_cast<uint32_t>( std::min<uint64_t>( { particleCount, groupLimit, rangeLimit } ) );
+	_activeCount			= _particleCount;
+
+	if ( _particleCount < particleCount )
+	{
+		std::cout << "particles: lowered to " << _particleCount << ", the most one storage buffer binding and dispatch can hold" << std::endl;
+	}
+
+	if ( ( 0 == _particleCount ) ||
+		 ( false == allocator.createBuffer( getBufferSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+											VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _buffer, _allocation ) ) )
+	{
+		std::cerr << "particles: failed to create the particle buffer" << std::endl;
+		return false;
+	}
+
+	if ( ( false == _simulation.create( _device, pipelineCache, layoutCache, {} ) ) || ( false == createDescriptorSet() ) )
+	{
+		return false;
+	}
+
+	if ( 0.0f < timestampPeriod )
+	{
+		VkQueryPoolCreateInfo queryPoolInfo{};
+		queryPoolInfo.sType			= VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType		= VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount	= QUERIES_PER_FRAME * frameCount;
+
+		if ( VK_SUCCESS != vkCreateQueryPool( _device, &queryPoolInfo, nullptr, &_queryPool ) )
+		{
+			_queryPool = VK_NULL_HANDLE;
+		}
+	}
+
+	_timestampsWritten.assign( frameCount, false );
+
+	std::cout << "particles: " << _particleCount << " particles, " << getBufferSize() / ( 1024 * 1024 ) << " MB of state" << std::endl;
+
+	return true;
+}
+
+bool ParticleSystem::createDescriptorSet( void ) noexcept
+{
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type						= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount			= 1;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType						= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets					= 1;
+	poolInfo.poolSizeCount				= 1;
+	poolInfo.pPoolSizes					= &poolSize;
+
+	if ( VK_SUCCESS != vkCreateDescriptorPool( _device, &poolInfo, nullptr, &_descriptorPool ) )
+	{
+		return false;
+	}
+
+	const VkDescriptorSetLayout setLayout	= _simulation.getSetLayout( 0 );
+
+	VkDescriptorSetAllocateInfo allocateInfo{};
+	allocateInfo.sType					= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool			= _descriptorPool;
+	allocateInfo.descriptorSetCount		= 1;
+	allocateInfo.pSetLayouts			= &setLayout;
+
+	if ( VK_SUCCESS != vkAllocateDescriptorSets( _device, &allocateInfo, &_descriptorSet ) )
+	{
+		return false;
+	}
+
+	const VkDescriptorBufferInfo bufferInfo{ _buffer, 0, VK_WHOLE_SIZE };
+
+	VkWriteDescriptorSet write{};
+	write.sType							= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet						= _descriptorSet;
+	write.dstBinding					= PARTICLE_BINDING;
+	write.descriptorCount				= 1;
+	write.descriptorType				= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo					= &bufferInfo;
+
+	vkUpdateDescriptorSets( _device, 1, &write, 0, nullptr );
+
+	return true;
+}
+
+bool ParticleSystem::createRenderPipeline( const VkRenderPass renderPass, const uint32_t subpass, const VkSampleCountFlagBits samples,
+										   DeletionQueue& deletionQueue, const uint64_t frameNumber ) noexcept
+{
+	MappedFile vertCode;
+	MappedFile fragCode;
+	ShaderReflection reflection;
+	ShaderReflection fragReflection;
+	VkShaderModule vertModule = VK_NULL_HANDLE;
+	VkShaderModule fragModule = VK_NULL_HANDLE;
+
+	auto destroyModules = [this, &vertModule, &fragModule]( void )
+	{
+		vkDestroyShaderModule( _device, vertModule, nullptr );
+		vkDestroyShaderModule( _device, fragModule, nullptr );
+	};
+
+	if ( ( false == loadShader( _device, VERTEX_SHADER_FILE, vertCode, reflection, vertModule ) ) || ( false == loadShader( _device, FRAGMENT_SHADER_FILE, fragCode, fragReflection, fragModule ) ) )
+	{
+		destroyModules();
+		return false;
+	}
+
+	reflection.merge( fragReflection );
+
+	// Position, then velocity, straight from the simulation's Particle struct.
+	const VkVertexInputBindingDescription bindingDescription{ 0, PARTICLE_STRIDE, VK_VERTEX_INPUT_RATE_VERTEX };
+	const VkVertexInputAttributeDescription attributeDescriptions[] =
+	{
+		{ 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT, 0 },
+		{ 1, 0, VK_FORMAT_R32G32B32A32_SFLOAT, 16 }
+	};
+
+	_renderLayout = _layoutCache->getPipelineLayout( reflection );
+
+	if ( ( false == reflection.validateVertexInput( attributeDescriptions, static_cast<uint32_t>( std::size( attributeDescriptions ) ), ShaderReflection::MIN_VERTEX_INPUT_ATTRIBUTES ) ) || ( VK_NULL_HANDLE == _renderLayout ) )
+	{
+		destroyModules();
+		return false;
+	}
+
+	VkPipelineShaderStageCreateInfo shaderStages[2]{};
+	shaderStages[0].sType						= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage						= VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module						= vertModule;
+	shaderStages[0].pName						= "main";
+	shaderStages[1].sType						= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage						= VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module						= fragModule;
+	shaderStages[1].pName						= "main";
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType						= VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount	= 1;
+	vertexInputInfo.pVertexBindingDescriptions		= &bindingDescription;
+	vertexInputInfo.vertexAttributeDescriptionCount	= static_cast<uint32_t>( std::size( attributeDescriptions ) );
+	vertexInputInfo.pVertexAttributeDescriptions	= attributeDescriptions;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+	inputAssembly.sType							= VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology						= VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType							= VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount					= 1;
+	viewportState.scissorCount					= 1;
+
+	const VkDynamicState dynamicStates[]		= { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType							= VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount				= static_cast<uint32_t>( std::size( dynamicStates ) );
+	dynamicState.pDynamicStates					= dynamicStates;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType							= VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.polygonMode						= VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth						= 1.0f;
+	rasterizer.cullMode							= VK_CULL_MODE_NONE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType							= VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples			= samples;
+
+	// Tested against the scene but not written: the particles add up in any order.
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType							= VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable				= VK_TRUE;
+	depthStencil.depthWriteEnable				= VK_FALSE;
+	depthStencil.depthCompareOp					= VK_COMPARE_OP_LESS_OR_EQUAL;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.colorWriteMask			= VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable			= VK_TRUE;
+	colorBlendAttachment.srcColorBlendFactor	= VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstColorBlendFactor	= VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.colorBlendOp			= VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor	= VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.dstAlphaBlendFactor	= VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.alphaBlendOp			= VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType							= VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.attachmentCount				= 1;
+	colorBlending.pAttachments					= &colorBlendAttachment;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType							= VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount						= 2;
+	pipelineInfo.pStages						= shaderStages;
+	pipelineInfo.pVertexInputState				= &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState			= &inputAssembly;
+	pipelineInfo.pViewportState					= &viewportState;
+	pipelineInfo.pRasterizationState			= &rasterizer;
+	pipelineInfo.pMultisampleState				= &multisampling;
+	pipelineInfo.pDepthStencilState				= &depthStencil;
+	pipelineInfo.pColorBlendState				= &colorBlending;
+	pipelineInfo.pDynamicState					= &dynamicState;
+	pipelineInfo.layout							= _renderLayout;
+	pipelineInfo.renderPass						= renderPass;
+	pipelineInfo.subpass						= subpass;
+
+	VkPipeline pipeline							= VK_NULL_HANDLE;
+	const auto createBegin						= std::chrono::steady_clock::now();
+	const VkResult result						= vkCreateGraphicsPipelines( _device, _pipelineCache->getHandle(), 1, &pipelineInfo, nullptr, &pipeline );
+
+	destroyModules();
+
+	if ( VK_SUCCESS != result )
+	{
+		std::cerr << "particles: failed to create the render pipeline" << std::endl;
+		return false;
+	}
+
+	_pipelineCache->addCreateTime( Benchmark::millisecondsSince( createBegin ) );
+
+	if ( VK_NULL_HANDLE != _renderPipeline )
+	{
+		const VkDevice device		= _device;
+		const VkPipeline retired	= _renderPipeline;
+
+		deletionQueue.retire( frameNumber, [device, retired]( void ) { vkDestroyPipeline( device, retired, nullptr ); } );
+	}
+
+	_renderPipeline = pipeline;
+
+	return true;
+}
+
+void ParticleSystem::destroy( void ) noexcept
+{
+	if ( nullptr == _allocator )
+	{
+		return;
+	}
+
+	// Layouts belong to the layout cache.
+	if ( VK_NULL_HANDLE != _renderPipeline )
+	{
+		vkDestroyPipeline( _device, _renderPipeline, nullptr );
+	}
+
+	if ( VK_NULL_HANDLE != _queryPool )
+	{
+		vkDestroyQueryPool( _device, _queryPool, nullptr );
+	}
+
+	if ( VK_NULL_HANDLE != _descriptorPool )
+	{
+		vkDestroyDescriptorPool( _device, _descriptorPool, nullptr );
+	}
+
+	_simulation.destroy();
+	_allocator->destroyBuffer( _buffer, _allocation );
+
+	_renderPipeline		= VK_NULL_HANDLE;
+	_queryPool			= VK_NULL_HANDLE;
+	_descriptorPool		= VK_NULL_HANDLE;
+	_allocator			= nullptr;
+}
+
+void ParticleSystem::recordSimulation( const VkCommandBuffer commandBuffer, const uint32_t frame, const float deltaTime, const uint64_t frameNumber ) noexcept
+{
+	const uint32_t firstQuery = frame * QUERIES_PER_FRAME;
+
+	if ( VK_NULL_HANDLE != _queryPool )
+	{
+		vkCmdResetQueryPool( commandBuffer, _queryPool, firstQuery, QUERIES_PER_FRAME );
+		vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool, firstQuery );
+		_timestampsWritten[frame] = true;
+	}
+
+	// Zeroed particles have no life left, so the first step gives all of them a fresh one.
+	if ( false == _isCleared )
+	{
+		vkCmdFillBuffer( commandBuffer, _buffer, 0, VK_WHOLE_SIZE, 0 );
+
+		VkBufferMemoryBarrier clearBarrier{};
+		clearBarrier.sType					= VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		clearBarrier.srcAccessMask			= VK_ACCESS_TRANSFER_WRITE_BIT;
+		clearBarrier.dstAccessMask			= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		clearBarrier.srcQueueFamilyIndex	= VK_QUEUE_FAMILY_IGNORED;
+		clearBarrier.dstQueueFamilyIndex	= VK_QUEUE_FAMILY_IGNORED;
+		clearBarrier.buffer					= _buffer;
+		clearBarrier.offset					= 0;
+		clearBarrier.size					= VK_WHOLE_SIZE;
+
+		vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &clearBarrier, 0, nullptr );
+
+		_isCleared = true;
+	}
+
+	SimulationConstants constants{};
+	constants._deltaTime		= deltaTime;
+	constants._particleCount	= _activeCount;
+	constants._seed				= static_cast<uint32_t>( frameNumber * 0x9e3779b9u );
+
+	_simulation.bind( commandBuffer, 0, 1, &_descriptorSet );
+	_simulation.pushConstants( commandBuffer, &constants, sizeof( constants ) );
+	_simulation.dispatch( commandBuffer, _activeCount );
+
+	if ( VK_NULL_HANDLE != _queryPool )
+	{
+		vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, _queryPool, firstQuery + 1 );
+	}
+}
+
+void ParticleSystem::recordDraw( const VkCommandBuffer commandBuffer, const uint32_t frame, const VkExtent2D extent ) const noexcept
+{
+	const uint32_t firstQuery = frame * QUERIES_PER_FRAME;
+
+	// Inside the render pass the draw may overlap the scene's, so its time is approximate.
+	if ( VK_NULL_HANDLE != _queryPool )
+	{
+		vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool, firstQuery + 2 );
+	}
+
+	vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _renderPipeline );
+
+	const VkViewport viewport{ 0.0f, 0.0f, static_cast<float>( extent.width ), static_cast<float>( extent.height ), 0.0f, 1.0f };
+	vkCmdSetViewport( commandBuffer, 0, 1, &viewport );
+
+	const VkRect2D scissor{ { 0, 0 }, extent };
+	vkCmdSetScissor( commandBuffer, 0, 1, &scissor );
+
+	const VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers( commandBuffer, 0, 1, &_buffer, &offset );
+	vkCmdDraw( commandBuffer, _activeCount, 1, 0, 0 );
+
+	if ( VK_NULL_HANDLE != _queryPool )
+	{
+		vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool, firstQuery + 3 );
+	}
+}
+
+bool ParticleSystem::readTiming( const uint32_t frame, ParticleTiming& timing ) noexcept
+{
+	if ( ( VK_NULL_HANDLE == _queryPool ) || ( false == _timestampsWritten[frame] ) )
+	{
+		return false;
+	}
+
+	_timestampsWritten[frame] = false;
+
+	uint64_t timestamps[QUERIES_PER_FRAME] = {};
+	if ( VK_SUCCESS != vkGetQueryPoolResults( _device, _queryPool, frame * QUERIES_PER_FRAME, QUERIES_PER_FRAME, sizeof( timestamps ), timestamps, sizeof( uint64_t ), VK_QUERY_RESULT_64_BIT ) )
+	{
+		return false;
+	}
+
+	const uint64_t simulateTicks	= ( ( timestamps[1] & _timestampMask ) - ( timestamps[0] & _timestampMask ) ) & _timestampMask;
+	const uint64_t drawTicks		= ( ( timestamps[3] & _timestampMask ) - ( timestamps[2] & _timestampMask ) ) & _timestampMask;
+
+	timing._simulateMs	= static_cast<double>( simulateTicks ) * _timestampPeriod / 1000000.0;
+	timing._drawMs		= static_cast<double>( drawTicks ) * _timestampPeriod / 1000000.0;
+
+	return true;
+}
+
+void ParticleSystem::setActiveCount( const uint32_t count ) noexcept
+{
+	_activeCount = std::min( count, _particleCount );
+}
+
+uint32_t ParticleSystem::getActiveCount( void ) const noexcept
+{
+	return _activeCount;
+}
+
+uint32_t ParticleSystem::getParticleCount( void ) const noexcept
+{
+	return _particleCount;
+}
+
+VkBuffer ParticleSystem::getBuffer( void ) const noexcept
+{
+	return _buffer;
+}
+
+VkDeviceSize ParticleSystem::getBufferSize( void ) const noexcept
+{
+	return static_cast<VkDeviceSize>( _particleCount ) * PARTICLE_STRIDE;
+}
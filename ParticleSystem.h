@@ -0,0 +1,82 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+#include "DeletionQueue.h"
+#include "ComputePipeline.h"
+
+// GPU times of one frame's particle work, in milliseconds.
+struct ParticleTiming
+{
+	double		_simulateMs;
+	double		_drawMs;
+};
+
+// Particles simulated and drawn entirely on the device. One storage buffer holds every particle; a compute
+// pass integrates them in place each frame and respawns the dead ones, and the same buffer is bound as the
+// vertex buffer of a point-list draw. The CPU only records a dispatch and a draw, whatever the count.
+// The caller orders the two with the render graph, which also keeps the next frame's dispatch behind the
+// previous frame's draw.
+class ParticleSystem
+{
+public:
+
+	ParticleSystem( void );
+
+	// particleCount is lowered to what one storage buffer binding and one dispatch can cover. With a
+	// timestamp period, the simulation and the draw are timed on the GPU; the mask keeps the valid bits.
+	bool				create( const VkDevice device, MemoryAllocator& allocator, PipelineCache& pipelineCache, PipelineLayoutCache& layoutCache,
+								const uint32_t particleCount, const uint32_t frameCount, const float timestampPeriod, const uint64_t timestampMask ) noexcept;
+	// Built against the render pass and subpass the particles are drawn in; a previous pipeline is retired.
+	bool				createRenderPipeline( const VkRenderPass renderPass, const uint32_t subpass, const VkSampleCountFlagBits samples,
+											  DeletionQueue& deletionQueue, const uint64_t frameNumber ) noexcept;
+	// Only once the device no longer uses the particles.
+	void				destroy( void ) noexcept;
+
+	// Outside a render pass. The first recording also clears the buffer, from which every particle is born.
+	void				recordSimulation( const VkCommandBuffer commandBuffer, const uint32_t frame, const float deltaTime, const uint64_t frameNumber ) noexcept;
+	// Inside the subpass the render pipeline was built for.
+	void				recordDraw( const VkCommandBuffer commandBuffer, const uint32_t frame, const VkExtent2D extent ) const noexcept;
+
+	// Once the frame's previous submission has completed; false when it wrote no timestamps.
+	bool				readTiming( const uint32_t frame, ParticleTiming& timing ) noexcept;
+
+	// Simulates and draws only the first count particles, e.g. to measure how the cost scales.
+	void				setActiveCount( const uint32_t count ) noexcept;
+	uint32_t			getActiveCount( void ) const noexcept;
+	uint32_t			getParticleCount( void ) const noexcept;
+
+	VkBuffer			getBuffer( void ) const noexcept;
+	VkDeviceSize		getBufferSize( void ) const noexcept;
+
+private:
+
+	// std430 layout of Particle in particles.comp.
+	static const uint32_t	PARTICLE_STRIDE		= 32;
+	// Before and after the simulation, before and after the draw.
+	static const uint32_t	QUERIES_PER_FRAME	= 4;
+
+	bool				createDescriptorSet( void ) noexcept;
+
+	VkDevice							_device;
+	MemoryAllocator*					_allocator;
+
+	VkBuffer							_buffer;
+	Allocation							_allocation;
+	uint32_t							_particleCount;
+	uint32_t							_activeCount;
+	bool								_isCleared;
+
+	ComputePipeline						_simulation;
+	VkDescriptorPool					_descriptorPool;
+	VkDescriptorSet						_descriptorSet;
+
+	VkPipeline							_renderPipeline;
+	VkPipelineLayout					_renderLayout;
+	PipelineCache*						_pipelineCache;
+	PipelineLayoutCache*				_layoutCache;
+
+	VkQueryPool							_queryPool;
+	float								_timestampPeriod;
+	uint64_t							_timestampMask;
+	std::vector<bool>					_timestampsWritten;
+};
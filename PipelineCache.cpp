@@ -0,0 +1,174 @@
+#include "pch.h"
+
+#include "PipelineCache.h"
+#include "File.h"
+
+PipelineCache::PipelineCache( void )
+	: _device{ VK_NULL_HANDLE }
+	, _pipelineCache{ VK_NULL_HANDLE }
+	, _properties{}
+	, _loadedSize{ 0 }
+	, _createCount{ 0 }
+	, _createTime{ 0.0 }
+{
+
+}
+
+bool PipelineCache::create( const VkDevice device, const VkPhysicalDevice physicalDevice, const std::string& fileName ) noexcept
+{
+	_device		= device;
+	_fileName	= fileName;
+
+	vkGetPhysicalDeviceProperties( physicalDevice, &_properties );
+
+	// A missing file is a cold start, so it is opened quietly rather than through File::map.
+	MappedFile file;
+	if ( false == _fileName.empty() )
+	{
+		file.open( _fileName );
+	}
+
+	// A blob from another driver or device is not an error, it is just a cold start.
+	size_t dataSize = file.getSize();
+	if ( false == isCompatible( file.getData(), dataSize ) )
+	{
+		dataSize = 0;
+	}
+
+	VkPipelineCacheCreateInfo createInfo{};
+	createInfo.sType				= VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize		= dataSize;
+	createInfo.pInitialData			= ( 0 == dataSize ) ? nullptr : file.getData();
+
+	if ( VK_SUCCESS != vkCreatePipelineCache( _device, &createInfo, nullptr, &_pipelineCache ) )
+	{
+		// Fall back to an empty cache rather than refusing to start over a bad file.
+		createInfo.initialDataSize	= 0;
+		createInfo.pInitialData		= nullptr;
+		dataSize					= 0;
+
+		if ( VK_SUCCESS != vkCreatePipelineCache( _device, &createInfo, nullptr, &_pipelineCache ) )
+		{
+			return false;
+		}
+	}
+
+	_loadedSize = dataSize;
+
+	return true;
+}
+
+void PipelineCache::destroy( void ) noexcept
+{
+	if ( VK_NULL_HANDLE == _pipelineCache )
+	{
+		return;
+	}
+
+	save();
+	printStatistics();
+
+	vkDestroyPipelineCache( _device, _pipelineCache, nullptr );
+	_pipelineCache = VK_NULL_HANDLE;
+}
+
+bool PipelineCache::save( void ) const noexcept
+{
+	if ( ( VK_NULL_HANDLE == _pipelineCache ) || ( true == _fileName.empty() ) )
+	{
+		return false;
+	}
+
+	size_t dataSize = 0;
+	if ( VK_SUCCESS != vkGetPipelineCacheData( _device, _pipelineCache, &dataSize, nullptr ) )
+	{
+		return false;
+	}
+
+	std::vector<char> data( dataSize );
+	if ( VK_SUCCESS != vkGetPipelineCacheData( _device, _pipelineCache, &dataSize, data.data() ) )
+	{
+		return false;
+	}
+
+	// Write next to the destination and rename over it, so a crash mid-write never leaves a truncated cache behind.
+	const std::string temporaryFileName = _fileName + ".tmp";
+	{
+		std::ofstream file( temporaryFileName, std::ios::binary | std::ios::trunc );
+		if ( false == file.is_open() )
+		{
+			return false;
+		}
+
+		file.write( data.data(), static_cast<std::streamsize>( dataSize ) );
+		if ( false == file.good() )
+		{
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename( temporaryFileName, _fileName, error );
+	if ( error )
+	{
+		std::filesystem::remove( temporaryFileName, error );
+		return false;
+	}
+
+	return true;
+}
+
+void PipelineCache::addCreateTime( const double milliseconds ) noexcept
+{
+	std::lock_guard<std::mutex> lock( _statisticsMutex );
+
+	++_createCount;
+	_createTime += milliseconds;
+}
+
+void PipelineCache::printStatistics( void ) const noexcept
+{
+	std::cout << "pipeline cache: " << ( isWarm() ? "warm" : "cold" ) << " start, "
+			  << _loadedSize << " bytes loaded, "
+			  << _createCount << " pipelines created in " << _createTime << " ms" << std::endl;
+}
+
+VkPipelineCache PipelineCache::getHandle( void ) const noexcept
+{
+	return _pipelineCache;
+}
+
+bool PipelineCache::isWarm( void ) const noexcept
+{
+	return 0 < _loadedSize;
+}
+
+bool PipelineCache::isCompatible( const char* data, const size_t size ) const noexcept
+{
+	// VkPipelineCacheHeaderVersionOne: headerSize, headerVersion, vendorID, deviceID, pipelineCacheUUID.
+	const size_t headerSize = sizeof( uint32_t ) * 4 + VK_UUID_SIZE;
+	if ( size < headerSize )
+	{
+		return false;
+	}
+
+	uint32_t header[4];
+	memcpy( header, data, sizeof( header ) );
+
+	if ( ( header[0] < headerSize ) || ( size < header[0] ) )
+	{
+		return false;
+	}
+
+	if ( VK_PIPELINE_CACHE_HEADER_VERSION_ONE != header[1] )
+	{
+		return false;
+	}
+
+	if ( ( _properties.vendorID != header[2] ) || ( _properties.deviceID != header[3] ) )
+	{
+		return false;
+	}
+
+	return 0 == memcmp( data + sizeof( header ), _properties.pipelineCacheUUID, VK_UUID_SIZE );
+}
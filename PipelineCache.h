@@ -0,0 +1,35 @@
+#pragma once
+
+class PipelineCache
+{
+public:
+
+	PipelineCache( void );
+
+	bool				create( const VkDevice device, const VkPhysicalDevice physicalDevice, const std::string& fileName ) noexcept;
+	void				destroy( void ) noexcept;
+
+	bool				save( void ) const noexcept;
+
+	void				addCreateTime( const double milliseconds ) noexcept;
+	void				printStatistics( void ) const noexcept;
+
+	VkPipelineCache		getHandle( void ) const noexcept;
+	bool				isWarm( void ) const noexcept;
+
+private:
+
+	bool				isCompatible( const char* data, const size_t size ) const noexcept;
+
+	VkDevice						_device;
+	VkPipelineCache					_pipelineCache;
+	VkPhysicalDeviceProperties		_properties;
+	std::string						_fileName;
+
+	size_t							_loadedSize;
+
+	// Pipelines may be created off the render thread.
+	std::mutex						_statisticsMutex;
+	uint32_t						_createCount;
+	double							_createTime;
+};
@@ -0,0 +1,172 @@
+#include "pch.h"
+
+#include "PipelineLayoutCache.h"
+
+PipelineLayoutCache::PipelineLayoutCache( void )
+	: _device{ VK_NULL_HANDLE }
+	, _requestCount{ 0 }
+{
+
+}
+
+void PipelineLayoutCache::create( const VkDevice device ) noexcept
+{
+	_device = device;
+}
+
+void PipelineLayoutCache::destroy( void ) noexcept
+{
+	for ( const auto& entry : _pipelineLayouts )
+	{
+		vkDestroyPipelineLayout( _device, entry.second, nullptr );
+	}
+
+	for ( const auto& entry : _setLayouts )
+	{
+		vkDestroyDescriptorSetLayout( _device, entry.second, nullptr );
+	}
+
+	_pipelineLayouts.clear();
+	_setLayouts.clear();
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::getDescriptorSetLayout( const std::vector<VkDescriptorSetLayoutBinding>& bindings ) noexcept
+{
+	std::lock_guard<std::mutex> lock( _mutex );
+
+	return findDescriptorSetLayout( bindings );
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::getDescriptorSetLayout( const ShaderReflection& reflection, const uint32_t set ) noexcept
+{
+	std::lock_guard<std::mutex> lock( _mutex );
+
+	return findDescriptorSetLayout( getSetBindings( reflection, set ) );
+}
+
+std::vector<VkDescriptorSetLayoutBinding> PipelineLayoutCache::getSetBindings( const ShaderReflection& reflection, const uint32_t set ) noexcept
+{
+	std::vector<VkDescriptorSetLayoutBinding> setBindings;
+
+	for ( const ShaderBinding& shaderBinding : reflection.getBindings() )
+	{
+		if ( set != shaderBinding._set )
+		{
+			continue;
+		}
+
+		VkDescriptorSetLayoutBinding binding{};
+		binding.binding			= shaderBinding._binding;
+		binding.descriptorType	= shaderBinding._type;
+		binding.descriptorCount	= shaderBinding._count;
+		binding.stageFlags		= shaderBinding._stages;
+
+		setBindings.push_back( binding );
+	}
+
+	return setBindings;
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::findDescriptorSetLayout( const std::vector<VkDescriptorSetLayoutBinding>& bindings ) noexcept
+{
+	std::vector<uint64_t> key;
+	key.reserve( bindings.size() * 2 );
+
+	for ( const VkDescriptorSetLayoutBinding& binding : bindings )
+	{
+		key.push_back( ( static_cast<uint64_t>( binding.binding ) << 32 ) | static_cast<uint32_t>( binding.descriptorType ) );
+		key.push_back( ( static_cast<uint64_t>( binding.descriptorCount ) << 32 ) | binding.stageFlags );
+	}
+
+	auto existing = _setLayouts.find( key );
+	if ( _setLayouts.end() != existing )
+	{
+		return existing->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo createInfo{};
+	createInfo.sType			= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	createInfo.bindingCount		= static_cast<uint32_t>( bindings.size() );
+	createInfo.pBindings		= bindings.data();
+
+	VkDescriptorSetLayout setLayout;
+	if ( VK_SUCCESS != vkCreateDescriptorSetLayout( _device, &createInfo, nullptr, &setLayout ) )
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	_setLayouts.emplace( std::move( key ), setLayout );
+
+	return setLayout;
+}
+
+VkPipelineLayout PipelineLayoutCache::getPipelineLayout( const ShaderReflection& reflection ) noexcept
+{
+	std::lock_guard<std::mutex> lock( _mutex );
+
+	++_requestCount;
+
+	const std::vector<ShaderBinding>& bindings = reflection.getBindings();
+
+	uint32_t setCount = 0;
+	for ( const ShaderBinding& binding : bindings )
+	{
+		setCount = std::max( setCount, binding._set + 1 );
+	}
+
+	std::vector<VkDescriptorSetLayout> setLayouts( setCount, VK_NULL_HANDLE );
+
+	for ( uint32_t set = 0; set < setCount; ++set )
+	{
+		setLayouts[set] = findDescriptorSetLayout( getSetBindings( reflection, set ) );
+		if ( VK_NULL_HANDLE == setLayouts[set] )
+		{
+			return VK_NULL_HANDLE;
+		}
+	}
+
+	const std::vector<VkPushConstantRange>& pushConstantRanges = reflection.getPushConstantRanges();
+
+	// Set layouts are already deduplicated, so their handles identify them.
+	std::vector<uint64_t> key;
+	key.push_back( setLayouts.size() );
+
+	for ( const VkDescriptorSetLayout setLayout : setLayouts )
+	{
+		key.push_back( reinterpret_cast<uint64_t>( setLayout ) );
+	}
+
+	for ( const VkPushConstantRange& range : pushConstantRanges )
+	{
+		key.push_back( range.stageFlags );
+		key.push_back( ( static_cast<uint64_t>( range.offset ) << 32 ) | range.size );
+	}
+
+	auto existing = _pipelineLayouts.find( key );
+	if ( _pipelineLayouts.end() != existing )
+	{
+		return existing->second;
+	}
+
+	VkPipelineLayoutCreateInfo createInfo{};
+	createInfo.sType					= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	createInfo.setLayoutCount			= static_cast<uint32_t>( setLayouts.size() );
+	createInfo.pSetLayouts				= setLayouts.data();
+	createInfo.pushConstantRangeCount	= static_cast<uint32_t>( pushConstantRanges.size() );
+	createInfo.pPushConstantRanges		= pushConstantRanges.data();
+
+	VkPipelineLayout pipelineLayout;
+	if ( VK_SUCCESS != vkCreatePipelineLayout( _device, &createInfo, nullptr, &pipelineLayout ) )
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	_pipelineLayouts.emplace( std::move( key ), pipelineLayout );
+
+	return pipelineLayout;
+}
+
+void PipelineLayoutCache::printStatistics( void ) const noexcept
+{
+	std::cout << "pipeline layouts: " << _requestCount << " requested, " << _pipelineLayouts.size() << " created, " << _setLayouts.size() << " descriptor set layouts" << std::endl;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ShaderReflection.h"
+
+// Owns descriptor set layouts and pipeline layouts built from shader reflection. Identical layouts
+// are created once and shared, so pipelines with the same interface get the same handles.
+// Lookups are thread safe, so pipelines can be built off the render thread.
+class PipelineLayoutCache
+{
+public:
+
+	PipelineLayoutCache( void );
+
+	void					create( const VkDevice device ) noexcept;
+	void					destroy( void ) noexcept;
+
+	// Sets the shaders do not use are filled with empty layouts, as set numbers are positional.
+	VkPipelineLayout		getPipelineLayout( const ShaderReflection& reflection ) noexcept;
+	VkDescriptorSetLayout	getDescriptorSetLayout( const std::vector<VkDescriptorSetLayoutBinding>& bindings ) noexcept;
+	// The same handle getPipelineLayout() uses for that set, e.g. to allocate descriptor sets against.
+	VkDescriptorSetLayout	getDescriptorSetLayout( const ShaderReflection& reflection, const uint32_t set ) noexcept;
+
+	void					printStatistics( void ) const noexcept;
+
+private:
+
+	VkDescriptorSetLayout	findDescriptorSetLayout( const std::vector<VkDescriptorSetLayoutBinding>& bindings ) noexcept;
+
+	static std::vector<VkDescriptorSetLayoutBinding>	getSetBindings( const ShaderReflection& reflection, const uint32_t set ) noexcept;
+
+	VkDevice												_device;
+	std::mutex												_mutex;
+
+	// Keys are the layouts serialized to words, which gives ordering and equality for free.
+	std::map<std::vector<uint64_t>, VkDescriptorSetLayout>	_setLayouts;
+	std::map<std::vector<uint64_t>, VkPipelineLayout>		_pipelineLayouts;
+
+	uint32_t												_requestCount;
+};
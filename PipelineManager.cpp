@@ -0,0 +1,445 @@
+#include "pch.h"
+
+#include "PipelineManager.h"
+#include "Benchmark.h"
+
+static_assert( sizeof( PipelineKey ) == 14 * sizeof( uint32_t ), "pipeline keys are hashed as raw bytes, so they must not have padding" );
+
+bool PipelineKey::operator==( const PipelineKey& other ) const noexcept
+{
+	return 0 == memcmp( this, &other, sizeof( PipelineKey ) );
+}
+
+uint64_t PipelineKey::getHash( void ) const noexcept
+{
+	// FNV-1a over the raw bytes.
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>( this );
+	uint64_t hash = 0xCBF29CE484222325ull;
+
+	for ( size_t ii = 0; ii < sizeof( PipelineKey ); ++ii )
+	{
+		hash = ( hash ^ bytes[ii] ) * 0x100000001B3ull;
+	}
+
+	return hash;
+}
+
+PipelineManager::PipelineManager( void )
+	: _device{ VK_NULL_HANDLE }
+	, _pipelineCache{ nullptr }
+	, _jobSystem{ nullptr }
+{
+
+}
+
+void PipelineManager::create( const VkDevice device, PipelineCache& pipelineCache, JobSystem& jobSystem ) noexcept
+{
+	_device				= device;
+	_pipelineCache		= &pipelineCache;
+	_jobSystem			= &jobSystem;
+}
+
+void PipelineManager::destroy( void ) noexcept
+{
+	if ( VK_NULL_HANDLE == _device )
+	{
+		return;
+	}
+
+	// Queued compiles are cancelled; the tasks still run, find the claim taken and return.
+	for ( std::unique_ptr<Entry>& entry : _entries )
+	{
+		if ( false == entry->_isClaimed.exchange( true ) )
+		{
+			entry->_status.store( PipelineStatus::Failed, std::memory_order_release );
+		}
+	}
+
+	_jobSystem->waitBackground();
+
+	for ( std::unique_ptr<Entry>& entry : _entries )
+	{
+		vkDestroyPipeline( _device, entry->_pipeline, nullptr );
+	}
+
+	for ( std::unique_ptr<PipelineProgram>& program : _programs )
+	{
+		vkDestroyShaderModule( _device, program->_vertexModule, nullptr );
+		vkDestroyShaderModule( _device, program->_fragmentModule, nullptr );
+	}
+
+	_pipelines.clear();
+	_entries.clear();
+	_programs.clear();
+	_vertexInputs.clear();
+	_device = VK_NULL_HANDLE;
+}
+
+uint32_t PipelineManager::addProgram( PipelineProgram&& program ) noexcept
+{
+	_programs.push_back( std::make_unique<PipelineProgram>( std::move( program ) ) );
+
+	return static_cast<uint32_t>( _programs.size() - 1 );
+}
+
+uint32_t PipelineManager::addVertexInput( const std::vector<VkVertexInputBindingDescription>& bindings, const std::vector<VkVertexInputAttributeDescription>& attributes ) noexcept
+{
+	// Both descriptions are plain 32-bit fields, so byte equality is field equality.
+	for ( size_t ii = 0; ii < _vertexInputs.size(); ++ii )
+	{
+		const VertexInput& input = *_vertexInputs[ii];
+
+		if ( ( bindings.size() == input._bindings.size() ) && ( attributes.size() == input._attributes.size() ) &&
+			 ( 0 == memcmp( bindings.data(), input._bindings.data(), bindings.size() * sizeof( VkVertexInputBindingDescription ) ) ) &&
+			 ( 0 == memcmp( attributes.data(), input._attributes.data(), attributes.size() * sizeof( VkVertexInputAttributeDescription ) ) ) )
+		{
+			return static_cast<uint32_t>( ii );
+		}
+	}
+
+	_vertexInputs.push_back( std::make_unique<VertexInput>( VertexInput{ bindings, attributes } ) );
+
+	return static_cast<uint32_t>( _vertexInputs.size() - 1 );
+}
+
+VkPipelineLayout PipelineManager::getLayout( const uint32_t program ) const noexcept
+{
+	return ( program < _programs.size() ) ? _programs[program]->_layout : VK_NULL_HANDLE;
+}
+
+PipelineStatus PipelineManager::request( const PipelineKey& key, const VkRenderPass renderPass ) noexcept
+{
+	bool isNew		= false;
+	Entry* entry	= lookup( key, renderPass, isNew );
+
+	if ( nullptr == entry )
+	{
+		return PipelineStatus::Failed;
+	}
+
+	if ( false == isNew )
+	{
+		return entry->_status.load( std::memory_order_acquire );
+	}
+
+	// Without workers the compile would run right here anyway, on the critical path.
+	if ( _jobSystem->getThreadCount() <= 1 )
+	{
+		complete( *entry );
+		return entry->_status.load( std::memory_order_acquire );
+	}
+
+	// Compiles can sit queued behind slow ones for many frames, so they stay out of the job ring.
+	_jobSystem->runBackground( [this, entry]()
+	{
+		if ( false == entry->_isClaimed.exchange( true ) )
+		{
+			double milliseconds = 0.0;
+			const bool isCompiled = compile( *entry, milliseconds );
+
+			recordCompile( milliseconds, isCompiled, false );
+		}
+	} );
+
+	return PipelineStatus::Pending;
+}
+
+PipelineStatus PipelineManager::getStatus( const PipelineKey& key ) const noexcept
+{
+	const Entry* entry = findEntry( key );
+
+	return ( nullptr == entry ) ? PipelineStatus::Failed : entry->_status.load( std::memory_order_acquire );
+}
+
+VkPipeline PipelineManager::require( const PipelineKey& key, const VkRenderPass renderPass ) noexcept
+{
+	bool isNew		= false;
+	Entry* entry	= lookup( key, renderPass, isNew );
+
+	if ( nullptr == entry )
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	complete( *entry );
+
+	return ( PipelineStatus::Ready == entry->_status.load( std::memory_order_acquire ) ) ? entry->_pipeline : VK_NULL_HANDLE;
+}
+
+void PipelineManager::finish( void ) noexcept
+{
+	for ( const auto& pipeline : _pipelines )
+	{
+		complete( *pipeline.second );
+	}
+}
+
+void PipelineManager::retireProgram( const uint32_t program, DeletionQueue& deletionQueue, const uint64_t frameNumber ) noexcept
+{
+	if ( program >= _programs.size() )
+	{
+		return;
+	}
+
+	const VkDevice device = _device;
+
+	for ( auto it = _pipelines.begin(); it != _pipelines.end(); )
+	{
+		Entry& entry = *it->second;
+
+		if ( program != entry._key._program )
+		{
+			++it;
+			continue;
+		}
+
+		// A compile that has not started is dropped rather than finished.
+		if ( false == entry._isClaimed.exchange( true ) )
+		{
+			entry._status.store( PipelineStatus::Failed, std::memory_order_release );
+		}
+
+		while ( PipelineStatus::Pending == entry._status.load( std::memory_order_acquire ) )
+		{
+			std::this_thread::yield();
+		}
+
+		if ( VK_NULL_HANDLE != entry._pipeline )
+		{
+			const VkPipeline retired = entry._pipeline;
+			deletionQueue.retire( frameNumber, [device, retired]( void ) { vkDestroyPipeline( device, retired, nullptr ); } );
+			entry._pipeline = VK_NULL_HANDLE;
+		}
+
+		it = _pipelines.erase( it );
+	}
+
+	// Pipelines keep what they need from their modules.
+	PipelineProgram& retired = *_programs[program];
+	vkDestroyShaderModule( _device, retired._vertexModule, nullptr );
+	vkDestroyShaderModule( _device, retired._fragmentModule, nullptr );
+	retired._vertexModule		= VK_NULL_HANDLE;
+	retired._fragmentModule		= VK_NULL_HANDLE;
+}
+
+PipelineStatistics PipelineManager::getStatistics( void ) const noexcept
+{
+	std::lock_guard<std::mutex> lock( _statisticsMutex );
+
+	return _statistics;
+}
+
+void PipelineManager::printStatistics( void ) const noexcept
+{
+	const PipelineStatistics statistics = getStatistics();
+
+	std::cout << "pipelines: " << statistics._requestCount << " requests, " << statistics._deduplicatedCount << " deduplicated, "
+			  << statistics._failedCount << " failed; critical path: " << statistics._criticalCount << " compiled in " << statistics._criticalMs
+			  << " ms plus " << statistics._stallMs << " ms waiting on workers; background: " << statistics._backgroundCount << " compiled in "
+			  << statistics._backgroundMs << " ms" << std::endl;
+}
+
+PipelineManager::Entry* PipelineManager::findEntry( const PipelineKey& key ) const noexcept
+{
+	const auto it = _pipelines.find( key );
+
+	return ( _pipelines.end() == it ) ? nullptr : it->second;
+}
+
+PipelineManager::Entry* PipelineManager::lookup( const PipelineKey& key, const VkRenderPass renderPass, bool& isNew ) noexcept
+{
+	Entry* entry = findEntry( key );
+
+	{
+		std::lock_guard<std::mutex> lock( _statisticsMutex );
+
+		++_statistics._requestCount;
+		_statistics._deduplicatedCount += ( nullptr != entry ) ? 1 : 0;
+	}
+
+	isNew = ( nullptr == entry );
+
+	if ( false == isNew )
+	{
+		return entry;
+	}
+
+	if ( ( key._program >= _programs.size() ) || ( VK_NULL_HANDLE == _programs[key._program]->_vertexModule ) || ( key._vertexInput >= _vertexInputs.size() ) )
+	{
+		std::cerr << "pipelines: key names an unknown or retired program or vertex input" << std::endl;
+		return nullptr;
+	}
+
+	_entries.push_back( std::make_unique<Entry>() );
+
+	entry					= _entries.back().get();
+	entry->_key				= key;
+	entry->_program			= _programs[key._program].get();
+	entry->_vertexInput		= _vertexInputs[key._vertexInput].get();
+	entry->_renderPass		= renderPass;
+
+	_pipelines.emplace( key, entry );
+
+	return entry;
+}
+
+bool PipelineManager::compile( Entry& entry, double& milliseconds ) noexcept
+{
+	const PipelineKey& key						= entry._key;
+	const PipelineProgram& program				= *entry._program;
+	const VertexInput& vertexInput				= *entry._vertexInput;
+
+	VkSpecializationInfo vertSpecializationInfo{};
+	vertSpecializationInfo.mapEntryCount		= static_cast<uint32_t>( program._vertexEntries.size() );
+	vertSpecializationInfo.pMapEntries			= program._vertexEntries.data();
+	vertSpecializationInfo.dataSize				= program._vertexData.size() * sizeof( uint32_t );
+	vertSpecializationInfo.pData				= program._vertexData.data();
+
+	VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+	shaderStages[0].sType						= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage						= VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module						= program._vertexModule;
+	shaderStages[0].pName						= "main";
+	shaderStages[0].pSpecializationInfo			= ( true == program._vertexEntries.empty() ) ? nullptr : &vertSpecializationInfo;
+	shaderStages[1].sType						= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage						= VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module						= program._fragmentModule;
+	shaderStages[1].pName						= "main";
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType							= VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount	= static_cast<uint32_t>( vertexInput._bindings.size() );
+	vertexInputInfo.pVertexBindingDescriptions		= vertexInput._bindings.data();
+	vertexInputInfo.vertexAttributeDescriptionCount	= static_cast<uint32_t>( vertexInput._attributes.size() );
+	vertexInputInfo.pVertexAttributeDescriptions	= vertexInput._attributes.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+	inputAssembly.sType							= VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology						= key._topology;
+	inputAssembly.primitiveRestartEnable		= VK_FALSE;
+
+	// Viewport and scissor are set while recording, so pipelines survive swapchain resizes.
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType							= VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount					= 1;
+	viewportState.scissorCount					= 1;
+
+	const VkDynamicState dynamicStates[]		= { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType							= VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount				= static_cast<uint32_t>( std::size( dynamicStates ) );
+	dynamicState.pDynamicStates					= dynamicStates;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType							= VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.polygonMode						= key._polygonMode;
+	rasterizer.lineWidth						= 1.0f;
+	rasterizer.cullMode							= key._cullMode;
+	rasterizer.frontFace						= key._frontFace;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType							= VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples			= key._samples;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType							= VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable				= key._depthTest;
+	depthStencil.depthWriteEnable				= key._depthWrite;
+	depthStencil.depthCompareOp					= key._depthCompare;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.colorWriteMask			= VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable			= ( BlendMode::Opaque == key._blendMode ) ? VK_FALSE : VK_TRUE;
+	colorBlendAttachment.srcColorBlendFactor	= ( BlendMode::Alpha == key._blendMode ) ? VK_BLEND_FACTOR_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstColorBlendFactor	= ( BlendMode::Alpha == key._blendMode ) ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.colorBlendOp			= VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor	= ( BlendMode::Alpha == key._blendMode ) ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.dstAlphaBlendFactor	= ( BlendMode::Alpha == key._blendMode ) ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.alphaBlendOp			= VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType							= VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOp						= VK_LOGIC_OP_COPY;
+	colorBlending.attachmentCount				= 1;
+	colorBlending.pAttachments					= &colorBlendAttachment;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType							= VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount						= static_cast<uint32_t>( std::size( shaderStages ) );
+	pipelineInfo.pStages						= shaderStages;
+	pipelineInfo.pVertexInputState				= &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState			= &inputAssembly;
+	pipelineInfo.pViewportState					= &viewportState;
+	pipelineInfo.pRasterizationState			= &rasterizer;
+	pipelineInfo.pMultisampleState				= &multisampling;
+	pipelineInfo.pDepthStencilState				= &depthStencil;
+	pipelineInfo.pColorBlendState				= &colorBlending;
+	pipelineInfo.pDynamicState					= &dynamicState;
+	pipelineInfo.layout							= program._layout;
+	pipelineInfo.renderPass						= entry._renderPass;
+	pipelineInfo.subpass						= key._subpass;
+
+	// The driver synchronizes the pipeline cache, so workers share it without a lock.
+	const auto createBegin						= std::chrono::steady_clock::now();
+	const VkResult result						= vkCreateGraphicsPipelines( _device, _pipelineCache->getHandle(), 1, &pipelineInfo, nullptr, &entry._pipeline );
+
+	milliseconds								= Benchmark::millisecondsSince( createBegin );
+
+	if ( VK_SUCCESS != result )
+	{
+		entry._pipeline = VK_NULL_HANDLE;
+		entry._status.store( PipelineStatus::Failed, std::memory_order_release );
+		return false;
+	}
+
+	_pipelineCache->addCreateTime( milliseconds );
+	entry._status.store( PipelineStatus::Ready, std::memory_order_release );
+
+	return true;
+}
+
+void PipelineManager::recordCompile( const double milliseconds, const bool isCompiled, const bool isCritical ) noexcept
+{
+	std::lock_guard<std::mutex> lock( _statisticsMutex );
+
+	if ( true == isCritical )
+	{
+		++_statistics._criticalCount;
+		_statistics._criticalMs		+= milliseconds;
+	}
+	else
+	{
+		++_statistics._backgroundCount;
+		_statistics._backgroundMs	+= milliseconds;
+	}
+
+	_statistics._failedCount		+= ( true == isCompiled ) ? 0 : 1;
+}
+
+void PipelineManager::complete( Entry& entry ) noexcept
+{
+	if ( PipelineStatus::Pending != entry._status.load( std::memory_order_acquire ) )
+	{
+		return;
+	}
+
+	if ( false == entry._isClaimed.exchange( true ) )
+	{
+		double milliseconds = 0.0;
+		const bool isCompiled = compile( entry, milliseconds );
+
+		recordCompile( milliseconds, isCompiled, true );
+		return;
+	}
+
+	const auto waitBegin = std::chrono::steady_clock::now();
+
+	while ( PipelineStatus::Pending == entry._status.load( std::memory_order_acquire ) )
+	{
+		std::this_thread::yield();
+	}
+
+	std::lock_guard<std::mutex> lock( _statisticsMutex );
+	_statistics._stallMs += Benchmark::millisecondsSince( waitBegin );
+}
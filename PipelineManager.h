@@ -0,0 +1,154 @@
+#pragma once
+
+#include "PipelineCache.h"
+#include "JobSystem.h"
+#include "DeletionQueue.h"
+
+enum class BlendMode : uint32_t
+{
+	Opaque = 0,
+	Alpha,
+	Additive,
+	Count
+};
+
+enum class PipelineStatus : uint32_t
+{
+	Pending = 0,
+	Ready,
+	Failed
+};
+
+// Everything a graphics pipeline permutation varies by. Every field is 32 bits, so there is no padding and the
+// key is hashed and compared as raw bytes. The render pass is described by what makes passes compatible rather
+// than by its handle, so a recreated swapchain with the same formats finds the same pipelines.
+struct PipelineKey
+{
+	uint32_t				_program		= 0;
+	uint32_t				_vertexInput	= 0;
+	VkFormat				_colorFormat	= VK_FORMAT_UNDEFINED;
+	VkFormat				_depthFormat	= VK_FORMAT_UNDEFINED;
+	VkSampleCountFlagBits	_samples		= VK_SAMPLE_COUNT_1_BIT;
+	uint32_t				_subpass		= 0;
+	VkPrimitiveTopology		_topology		= VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkPolygonMode			_polygonMode	= VK_POLYGON_MODE_FILL;
+	VkCullModeFlags			_cullMode		= VK_CULL_MODE_BACK_BIT;
+	VkFrontFace				_frontFace		= VK_FRONT_FACE_CLOCKWISE;
+	BlendMode				_blendMode		= BlendMode::Opaque;
+	VkBool32				_depthTest		= VK_TRUE;
+	VkBool32				_depthWrite		= VK_TRUE;
+	VkCompareOp				_depthCompare	= VK_COMPARE_OP_LESS;
+
+	bool					operator==( const PipelineKey& other ) const noexcept;
+	uint64_t				getHash( void ) const noexcept;
+};
+
+struct PipelineKeyHash
+{
+	size_t operator()( const PipelineKey& key ) const noexcept
+	{
+		return static_cast<size_t>( key.getHash() );
+	}
+};
+
+// A vertex and fragment shader pair with its layout and vertex stage specialization. The manager takes ownership
+// of the modules.
+struct PipelineProgram
+{
+	VkShaderModule							_vertexModule		= VK_NULL_HANDLE;
+	VkShaderModule							_fragmentModule		= VK_NULL_HANDLE;
+	VkPipelineLayout						_layout				= VK_NULL_HANDLE;
+	std::vector<VkSpecializationMapEntry>	_vertexEntries;
+	std::vector<uint32_t>					_vertexData;
+};
+
+struct PipelineStatistics
+{
+	uint32_t		_requestCount		= 0;
+	uint32_t		_deduplicatedCount	= 0;
+	uint32_t		_criticalCount		= 0;
+	uint32_t		_backgroundCount	= 0;
+	uint32_t		_failedCount		= 0;
+	// Compiles on the render thread, plus its waits for compiles already running on a worker.
+	double			_criticalMs			= 0.0;
+	double			_stallMs			= 0.0;
+	double			_backgroundMs		= 0.0;
+};
+
+// Graphics pipeline permutations by hashed state key. Each distinct key is compiled once, on a worker, and later
+// requests for it share the result. Callers that cannot wait keep drawing with a placeholder until getStatus()
+// reports the permutation ready; require() compiles on the spot instead and charges the time to the critical path.
+// Requests are made from the render thread; compiles run as job system background tasks, which never land on it.
+class PipelineManager
+{
+public:
+
+	PipelineManager( void );
+
+	void					create( const VkDevice device, PipelineCache& pipelineCache, JobSystem& jobSystem ) noexcept;
+	// Waits for compiles in flight.
+	void					destroy( void ) noexcept;
+
+	uint32_t				addProgram( PipelineProgram&& program ) noexcept;
+	// Identical descriptions share an index.
+	uint32_t				addVertexInput( const std::vector<VkVertexInputBindingDescription>& bindings, const std::vector<VkVertexInputAttributeDescription>& attributes ) noexcept;
+	VkPipelineLayout		getLayout( const uint32_t program ) const noexcept;
+
+	// Queues the key on the workers unless it is known already. The render pass only has to be compatible with the key.
+	PipelineStatus			request( const PipelineKey& key, const VkRenderPass renderPass ) noexcept;
+	PipelineStatus			getStatus( const PipelineKey& key ) const noexcept;
+	// Compiles on the calling thread, or waits for the worker that already is.
+	VkPipeline				require( const PipelineKey& key, const VkRenderPass renderPass ) noexcept;
+
+	// Completes every outstanding compile, e.g. before the render passes they were queued against go away.
+	void					finish( void ) noexcept;
+	// Retires the program's pipelines and releases its modules; its keys become unknown.
+	void					retireProgram( const uint32_t program, DeletionQueue& deletionQueue, const uint64_t frameNumber ) noexcept;
+
+	PipelineStatistics		getStatistics( void ) const noexcept;
+	void					printStatistics( void ) const noexcept;
+
+private:
+
+	struct VertexInput
+	{
+		std::vector<VkVertexInputBindingDescription>	_bindings;
+		std::vector<VkVertexInputAttributeDescription>	_attributes;
+	};
+
+	struct Entry
+	{
+		PipelineKey					_key;
+		const PipelineProgram*		_program		= nullptr;
+		const VertexInput*			_vertexInput	= nullptr;
+		VkRenderPass				_renderPass		= VK_NULL_HANDLE;
+		VkPipeline					_pipeline		= VK_NULL_HANDLE;
+		// Whoever wins the claim, worker or render thread, compiles.
+		std::atomic<bool>			_isClaimed{ false };
+		std::atomic<PipelineStatus>	_status{ PipelineStatus::Pending };
+	};
+
+	Entry*					findEntry( const PipelineKey& key ) const noexcept;
+	// Counts the request and adds an entry for a new key; nullptr if the key names an unknown program or vertex input.
+	Entry*					lookup( const PipelineKey& key, const VkRenderPass renderPass, bool& isNew ) noexcept;
+	// Publishes the status last, after the pipeline handle.
+	bool					compile( Entry& entry, double& milliseconds ) noexcept;
+	void					recordCompile( const double milliseconds, const bool isCompiled, const bool isCritical ) noexcept;
+	// On the render thread: compiles the entry if no worker has claimed it, otherwise waits for that worker.
+	void					complete( Entry& entry ) noexcept;
+
+	VkDevice										_device;
+	PipelineCache*									_pipelineCache;
+	JobSystem*										_jobSystem;
+
+	std::vector<std::unique_ptr<PipelineProgram>>	_programs;
+	std::vector<std::unique_ptr<VertexInput>>		_vertexInputs;
+
+	// Entries live until destroy(), as a queued compile may still look at a retired one.
+	std::vector<std::unique_ptr<Entry>>				_entries;
+	std::unordered_map<PipelineKey, Entry*, PipelineKeyHash>	_pipelines;
+
+	// Workers add their compile times under the lock.
+	mutable std::mutex								_statisticsMutex;
+	PipelineStatistics								_statistics;
+};
@@ -0,0 +1,1281 @@
+#include "pch.h"
+
+#include "RenderGraph.h"
+
+namespace
+{
+	struct UsageInfo
+	{
+		VkPipelineStageFlags	_stages;
+		VkAccessFlags			_access;
+		VkImageLayout			_layout;
+		bool					_isWrite;
+		bool					_isAttachment;
+		const char*				_name;
+	};
+
+	// Indexed by ResourceUsage. Buffer-only usages have no layout.
+	const UsageInfo USAGE_INFOS[] =
+	{
+		{ VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,	VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,	VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,	true,	true,	"color" },
+		{ VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,	VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,	true,	true,	"depth" },
+		{ VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,	VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,	true,	true,	"resolve" },
+		{ VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,			VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,	false,	true,	"input" },
+		{ VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,			VK_ACCESS_SHADER_READ_BIT,					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,	false,	false,	"sampled" },
+		{ VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,				VK_ACCESS_SHADER_READ_BIT,					VK_IMAGE_LAYOUT_GENERAL,					false,	false,	"storageRead" },
+		{ VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,				VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,	VK_IMAGE_LAYOUT_GENERAL,		true,	false,	"storageWrite" },
+		{ VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,				VK_ACCESS_INDIRECT_COMMAND_READ_BIT,		VK_IMAGE_LAYOUT_UNDEFINED,					false,	false,	"indirect" },
+		{ VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,				VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,		VK_IMAGE_LAYOUT_UNDEFINED,					false,	false,	"vertex" },
+		{ VK_PIPELINE_STAGE_TRANSFER_BIT,					VK_ACCESS_TRANSFER_READ_BIT,				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,		false,	false,	"transferRead" },
+		{ VK_PIPELINE_STAGE_TRANSFER_BIT,					VK_ACCESS_TRANSFER_WRITE_BIT,				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,		true,	false,	"transferWrite" },
+		{ VK_PIPELINE_STAGE_HOST_BIT,						VK_ACCESS_HOST_READ_BIT,					VK_IMAGE_LAYOUT_GENERAL,					false,	false,	"host" },
+		{ VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,				0,											VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,			false,	false,	"present" }
+	};
+
+	static_assert( std::size( USAGE_INFOS ) == static_cast<size_t>( ResourceUsage::Count ), "every usage needs its info" );
+
+	const VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+									   VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+	// The usages a transient attachment image may have.
+	const VkImageUsageFlags ATTACHMENT_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+	const UsageInfo& getUsageInfo( const ResourceUsage usage ) noexcept
+	{
+		return USAGE_INFOS[static_cast<size_t>( usage )];
+	}
+
+	// Uses that do not care what the resource held before.
+	bool isOverwrite( const ResourceUsage usage, const bool clear ) noexcept
+	{
+		return ( true == clear ) || ( ResourceUsage::ResolveAttachment == usage ) || ( ResourceUsage::TransferWrite == usage );
+	}
+
+	bool hasStencil( const VkFormat format ) noexcept
+	{
+		return ( VK_FORMAT_D16_UNORM_S8_UINT == format ) || ( VK_FORMAT_D24_UNORM_S8_UINT == format ) || ( VK_FORMAT_D32_SFLOAT_S8_UINT == format );
+	}
+
+	VkImageAspectFlags getAspectMask( const VkFormat format ) noexcept
+	{
+		if ( ( VK_FORMAT_D16_UNORM == format ) || ( VK_FORMAT_X8_D24_UNORM_PACK32 == format ) || ( VK_FORMAT_D32_SFLOAT == format ) )
+		{
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+		}
+
+		return ( true == hasStencil( format ) ) ? ( VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT ) : VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+
+	VkImageUsageFlags getImageUsage( const ResourceUsage usage ) noexcept
+	{
+		switch ( usage )
+		{
+		case ResourceUsage::ColorAttachment:	return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		case ResourceUsage::DepthAttachment:	return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		case ResourceUsage::ResolveAttachment:	return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		case ResourceUsage::InputAttachment:	return VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+		case ResourceUsage::Sampled:			return VK_IMAGE_USAGE_SAMPLED_BIT;
+		case ResourceUsage::StorageRead:		return VK_IMAGE_USAGE_STORAGE_BIT;
+		case ResourceUsage::StorageWrite:		return VK_IMAGE_USAGE_STORAGE_BIT;
+		case ResourceUsage::TransferRead:		return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		case ResourceUsage::TransferWrite:		return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		default:								return 0;
+		}
+	}
+
+	const char* getLayoutName( const VkImageLayout layout ) noexcept
+	{
+		switch ( layout )
+		{
+		case VK_IMAGE_LAYOUT_UNDEFINED:							return "undefined";
+		case VK_IMAGE_LAYOUT_GENERAL:							return "general";
+		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:			return "colorAttachment";
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:	return "depthAttachment";
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:			return "shaderReadOnly";
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:				return "transferSrc";
+		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:				return "transferDst";
+		case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:					return "present";
+		default:												return "other";
+		}
+	}
+
+	const char* getLoadOpName( const VkAttachmentLoadOp loadOp ) noexcept
+	{
+		return ( VK_ATTACHMENT_LOAD_OP_CLEAR == loadOp ) ? "clear" : ( ( VK_ATTACHMENT_LOAD_OP_LOAD == loadOp ) ? "load" : "dontCare" );
+	}
+
+	const char* getStoreOpName( const VkAttachmentStoreOp storeOp ) noexcept
+	{
+		return ( VK_ATTACHMENT_STORE_OP_STORE == storeOp ) ? "store" : "dontCare";
+	}
+
+	// Dependencies between the same two subpasses are folded into one.
+	void addDependency( std::vector<VkSubpassDependency>& dependencies, const uint32_t srcSubpass, const uint32_t dstSubpass, const VkPipelineStageFlags srcStages, const VkAccessFlags srcAccess,
+						const VkPipelineStageFlags dstStages, const VkAccessFlags dstAccess ) noexcept
+	{
+		// Dependencies inside the render pass only ever cover the same pixels, which keeps tiled GPUs on chip.
+		const VkDependencyFlags flags = ( ( VK_SUBPASS_EXTERNAL != srcSubpass ) && ( VK_SUBPASS_EXTERNAL != dstSubpass ) ) ? VK_DEPENDENCY_BY_REGION_BIT : 0;
+
+		for ( VkSubpassDependency& dependency : dependencies )
+		{
+			if ( ( srcSubpass == dependency.srcSubpass ) && ( dstSubpass == dependency.dstSubpass ) )
+			{
+				dependency.srcStageMask		|= srcStages;
+				dependency.srcAccessMask	|= srcAccess;
+				dependency.dstStageMask		|= dstStages;
+				dependency.dstAccessMask	|= dstAccess;
+				return;
+			}
+		}
+
+		VkSubpassDependency dependency{};
+		dependency.srcSubpass		= srcSubpass;
+		dependency.dstSubpass		= dstSubpass;
+		dependency.srcStageMask		= srcStages;
+		dependency.srcAccessMask	= srcAccess;
+		dependency.dstStageMask		= dstStages;
+		dependency.dstAccessMask	= dstAccess;
+		dependency.dependencyFlags	= flags;
+
+		dependencies.push_back( dependency );
+	}
+}
+
+RenderGraph::RenderGraph( void )
+	: _device{ VK_NULL_HANDLE }
+	, _allocator{ nullptr }
+{
+
+}
+
+void RenderGraph::create( const VkDevice device, MemoryAllocator& allocator ) noexcept
+{
+	_device		= device;
+	_allocator	= &allocator;
+}
+
+void RenderGraph::destroy( void ) noexcept
+{
+	detachObjects()();
+}
+
+void RenderGraph::retire( DeletionQueue& deletionQueue, const uint64_t frame ) noexcept
+{
+	deletionQueue.retire( frame, detachObjects() );
+}
+
+std::function<void( void )> RenderGraph::detachObjects( void ) noexcept
+{
+	std::vector<VkRenderPass> renderPasses;
+	std::vector<VkFramebuffer> framebuffers;
+	std::vector<VkImage> images;
+	std::vector<VkImageView> views;
+	std::vector<Allocation> allocations;
+
+	for ( const Group& group : _groups )
+	{
+		if ( VK_NULL_HANDLE != group._renderPass )
+		{
+			renderPasses.push_back( group._renderPass );
+		}
+
+		for ( const auto& entry : group._framebuffers )
+		{
+			framebuffers.push_back( entry.second );
+		}
+	}
+
+	for ( const Resource& resource : _resources )
+	{
+		if ( ( true == resource._isImage ) && ( false == resource._isImported ) )
+		{
+			images.push_back( resource._image );
+			views.push_back( resource._view );
+		}
+	}
+
+	for ( const MemorySlot& slot : _slots )
+	{
+		allocations.push_back( slot._allocation );
+	}
+
+	_resources.clear();
+	_passes.clear();
+	_groups.clear();
+	_slots.clear();
+	_finalBarriers = BarrierBatch{};
+
+	const VkDevice device			= _device;
+	MemoryAllocator* allocator		= _allocator;
+
+	return [device, allocator, renderPasses, framebuffers, images, views, allocations]( void ) mutable
+	{
+		for ( const VkFramebuffer framebuffer : framebuffers )
+		{
+			vkDestroyFramebuffer( device, framebuffer, nullptr );
+		}
+
+		for ( const VkRenderPass renderPass : renderPasses )
+		{
+			vkDestroyRenderPass( device, renderPass, nullptr );
+		}
+
+		for ( size_t ii = 0; ii < images.size(); ++ii )
+		{
+			vkDestroyImageView( device, views[ii], nullptr );
+			vkDestroyImage( device, images[ii], nullptr );
+		}
+
+		for ( Allocation& allocation : allocations )
+		{
+			allocator->free( allocation );
+		}
+	};
+}
+
+RenderGraphResource RenderGraph::importImage( const std::string& name, const VkFormat format, const VkExtent2D extent, const VkSampleCountFlagBits samples, const VkPipelineStageFlags initialStages ) noexcept
+{
+	Resource resource;
+	resource._name			= name;
+	resource._isImage		= true;
+	resource._isImported	= true;
+	resource._format		= format;
+	resource._extent		= extent;
+	resource._samples		= samples;
+	resource._initialStages	= initialStages;
+
+	_resources.push_back( resource );
+	return static_cast<RenderGraphResource>( _resources.size() - 1 );
+}
+
+RenderGraphResource RenderGraph::createImage( const std::string& name, const VkFormat format, const VkExtent2D extent, const VkSampleCountFlagBits samples ) noexcept
+{
+	Resource resource;
+	resource._name			= name;
+	resource._isImage		= true;
+	resource._format		= format;
+	resource._extent		= extent;
+	resource._samples		= samples;
+
+	_resources.push_back( resource );
+	return static_cast<RenderGraphResource>( _resources.size() - 1 );
+}
+
+RenderGraphResource RenderGraph::importBuffer( const std::string& name ) noexcept
+{
+	Resource resource;
+	resource._name			= name;
+	resource._isImported	= true;
+
+	_resources.push_back( resource );
+	return static_cast<RenderGraphResource>( _resources.size() - 1 );
+}
+
+void RenderGraph::setPersistent( const RenderGraphResource resource ) noexcept
+{
+	_resources[resource]._isPersistent = true;
+}
+
+void RenderGraph::setOutput( const RenderGraphResource resource, const ResourceUsage finalUsage ) noexcept
+{
+	_resources[resource]._isOutput		= true;
+	_resources[resource]._finalUsage	= finalUsage;
+}
+
+uint32_t RenderGraph::addPass( const std::string& name, const PassType type, RecordPassCallback record ) noexcept
+{
+	Pass pass;
+	pass._name		= name;
+	pass._type		= type;
+	pass._record	= std::move( record );
+
+	_passes.push_back( std::move( pass ) );
+	return static_cast<uint32_t>( _passes.size() - 1 );
+}
+
+void RenderGraph::use( const uint32_t pass, const RenderGraphResource resource, const ResourceUsage usage ) noexcept
+{
+	_passes[pass]._uses.push_back( Use{ resource, usage, false, VkClearValue{}, resource } );
+}
+
+void RenderGraph::clear( const uint32_t pass, const RenderGraphResource resource, const ResourceUsage usage, const VkClearValue& value ) noexcept
+{
+	_passes[pass]._uses.push_back( Use{ resource, usage, true, value, resource } );
+}
+
+void RenderGraph::resolve( const uint32_t pass, const RenderGraphResource source, const RenderGraphResource target ) noexcept
+{
+	_passes[pass]._uses.push_back( Use{ target, ResourceUsage::ResolveAttachment, false, VkClearValue{}, source } );
+}
+
+void RenderGraph::setSecondaryContents( const uint32_t pass ) noexcept
+{
+	_passes[pass]._secondaryContents = true;
+}
+
+bool RenderGraph::compile( void ) noexcept
+{
+	cullPasses();
+
+	if ( ( false == buildGroups() ) || ( false == allocateTransients() ) )
+	{
+		return false;
+	}
+
+	std::vector<ResourceState> states( _resources.size() );
+	for ( size_t ii = 0; ii < _resources.size(); ++ii )
+	{
+		states[ii] = getInitialState( static_cast<RenderGraphResource>( ii ) );
+	}
+
+	for ( uint32_t ii = 0; ii < static_cast<uint32_t>( _groups.size() ); ++ii )
+	{
+		Group& group = _groups[ii];
+
+		if ( true == group._isRenderPass )
+		{
+			if ( false == buildRenderPass( ii, states ) )
+			{
+				return false;
+			}
+
+			continue;
+		}
+
+		for ( const Use& use : _passes[group._passes[0]]._uses )
+		{
+			addBarrier( group._barriers, use._resource, states[use._resource], use._usage );
+		}
+	}
+
+	// Outputs the render passes have not already left in their final layout.
+	for ( size_t ii = 0; ii < _resources.size(); ++ii )
+	{
+		if ( true == _resources[ii]._isOutput )
+		{
+			addBarrier( _finalBarriers, static_cast<RenderGraphResource>( ii ), states[ii], _resources[ii]._finalUsage );
+		}
+	}
+
+	return true;
+}
+
+void RenderGraph::cullPasses( void ) noexcept
+{
+	// Walking backwards, a pass is needed when it writes something needed later; what it reads is then needed
+	// from the passes before it. A pass that overwrites a resource makes earlier writers of it unnecessary.
+	std::vector<bool> needed( _resources.size(), false );
+
+	for ( size_t ii = 0; ii < _resources.size(); ++ii )
+	{
+		needed[ii] = _resources[ii]._isOutput;
+	}
+
+	for ( size_t ii = _passes.size(); 0 < ii--; )
+	{
+		Pass& pass		= _passes[ii];
+		pass._isCulled	= true;
+
+		for ( const Use& use : pass._uses )
+		{
+			if ( ( true == getUsageInfo( use._usage )._isWrite ) && ( true == needed[use._resource] ) )
+			{
+				pass._isCulled = false;
+			}
+		}
+
+		if ( true == pass._isCulled )
+		{
+			continue;
+		}
+
+		for ( const Use& use : pass._uses )
+		{
+			if ( true == isOverwrite( use._usage, use._clear ) )
+			{
+				needed[use._resource] = false;
+			}
+		}
+
+		for ( const Use& use : pass._uses )
+		{
+			if ( false == isOverwrite( use._usage, use._clear ) )
+			{
+				needed[use._resource] = true;
+			}
+		}
+	}
+}
+
+bool RenderGraph::buildGroups( void ) noexcept
+{
+	for ( uint32_t ii = 0; ii < static_cast<uint32_t>( _passes.size() ); ++ii )
+	{
+		Pass& pass = _passes[ii];
+
+		if ( true == pass._isCulled )
+		{
+			continue;
+		}
+
+		if ( ( true == _groups.empty() ) || ( false == canMerge( _groups.back(), pass ) ) )
+		{
+			Group group;
+			group._isRenderPass = ( PassType::Graphics == pass._type );
+
+			for ( const Use& use : pass._uses )
+			{
+				if ( true == getUsageInfo( use._usage )._isAttachment )
+				{
+					group._extent = _resources[use._resource]._extent;
+				}
+			}
+
+			if ( ( true == group._isRenderPass ) && ( 0 == group._extent.width ) )
+			{
+				std::cerr << "render graph: graphics pass " << pass._name << " has no attachments" << std::endl;
+				return false;
+			}
+
+			_groups.push_back( std::move( group ) );
+		}
+
+		Group& group	= _groups.back();
+		pass._group		= static_cast<uint32_t>( _groups.size() - 1 );
+		pass._subpass	= static_cast<uint32_t>( group._passes.size() );
+		group._passes.push_back( ii );
+
+		for ( const Use& use : pass._uses )
+		{
+			Resource& resource	= _resources[use._resource];
+			resource._firstGroup	= std::min( resource._firstGroup, pass._group );
+			resource._lastGroup		= ( NO_GROUP == resource._lastGroup ) ? pass._group : std::max( resource._lastGroup, pass._group );
+
+			if ( ( true == getUsageInfo( use._usage )._isAttachment ) && ( ( resource._extent.width != group._extent.width ) || ( resource._extent.height != group._extent.height ) ) )
+			{
+				std::cerr << "render graph: attachments of pass " << pass._name << " differ in size" << std::endl;
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool RenderGraph::canMerge( const Group& group, const Pass& pass ) const noexcept
+{
+	if ( ( false == group._isRenderPass ) || ( PassType::Graphics != pass._type ) )
+	{
+		return false;
+	}
+
+	// A subpass can only see what earlier subpasses produced through attachments; anything else needs a
+	// barrier outside the render pass.
+	for ( const Use& use : pass._uses )
+	{
+		const UsageInfo& info = getUsageInfo( use._usage );
+
+		if ( ( true == info._isAttachment ) && ( ( _resources[use._resource]._extent.width != group._extent.width ) || ( _resources[use._resource]._extent.height != group._extent.height ) ) )
+		{
+			return false;
+		}
+
+		for ( const uint32_t earlier : group._passes )
+		{
+			for ( const Use& earlierUse : _passes[earlier]._uses )
+			{
+				if ( ( earlierUse._resource == use._resource ) &&
+					 ( ( false == info._isAttachment ) || ( false == getUsageInfo( earlierUse._usage )._isAttachment ) ) &&
+					 ( ( true == info._isWrite ) || ( true == getUsageInfo( earlierUse._usage )._isWrite ) ) )
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+bool RenderGraph::allocateTransients( void ) noexcept
+{
+	std::vector<RenderGraphResource> transients;
+
+	for ( uint32_t ii = 0; ii < static_cast<uint32_t>( _resources.size() ); ++ii )
+	{
+		Resource& resource = _resources[ii];
+
+		if ( ( false == resource._isImage ) || ( true == resource._isImported ) || ( NO_GROUP == resource._firstGroup ) )
+		{
+			continue;
+		}
+
+		VkImageUsageFlags usage = ( true == resource._isOutput ) ? getImageUsage( resource._finalUsage ) : 0;
+
+		for ( const Pass& pass : _passes )
+		{
+			for ( const Use& use : pass._uses )
+			{
+				if ( ( false == pass._isCulled ) && ( ii == use._resource ) )
+				{
+					usage |= getImageUsage( use._usage );
+				}
+			}
+		}
+
+		// Attachments that live and die inside one render pass never need backing memory on tiled GPUs.
+		resource._isTransientAttachment = ( false == resource._isOutput ) && ( resource._firstGroup == resource._lastGroup ) && ( 0 == ( usage & ~ATTACHMENT_USAGE ) );
+
+		if ( true == resource._isTransientAttachment )
+		{
+			usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		}
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType			= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType		= VK_IMAGE_TYPE_2D;
+		imageInfo.format		= resource._format;
+		imageInfo.extent		= { resource._extent.width, resource._extent.height, 1 };
+		imageInfo.mipLevels		= 1;
+		imageInfo.arrayLayers	= 1;
+		imageInfo.samples		= resource._samples;
+		imageInfo.tiling		= VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage			= usage;
+		imageInfo.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout	= VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if ( VK_SUCCESS != vkCreateImage( _device, &imageInfo, nullptr, &resource._image ) )
+		{
+			std::cerr << "render graph: failed to create " << resource._name << std::endl;
+			return false;
+		}
+
+		vkGetImageMemoryRequirements( _device, resource._image, &resource._requirements );
+		transients.push_back( ii );
+	}
+
+	// Largest first, each into the first slot whose images all live in other groups.
+	std::stable_sort( transients.begin(), transients.end(), [this]( const RenderGraphResource lhs, const RenderGraphResource rhs ) { return _resources[rhs]._requirements.size < _resources[lhs]._requirements.size; } );
+
+	for ( const RenderGraphResource transient : transients )
+	{
+		Resource& resource = _resources[transient];
+
+		for ( uint32_t ii = 0; ( ii < _slots.size() ) && ( UINT32_MAX == resource._slot ); ++ii )
+		{
+			MemorySlot& slot = _slots[ii];
+
+			const bool isOverlapping = std::any_of( slot._images.begin(), slot._images.end(), [this, &resource]( const RenderGraphResource occupant )
+			{
+				return ( _resources[occupant]._firstGroup <= resource._lastGroup ) && ( resource._firstGroup <= _resources[occupant]._lastGroup );
+			} );
+
+			if ( ( false == isOverlapping ) && ( slot._isTransient == resource._isTransientAttachment ) && ( 0 != ( slot._requirements.memoryTypeBits & resource._requirements.memoryTypeBits ) ) )
+			{
+				slot._requirements.size				= std::max( slot._requirements.size, resource._requirements.size );
+				slot._requirements.alignment		= std::max( slot._requirements.alignment, resource._requirements.alignment );
+				slot._requirements.memoryTypeBits	&= resource._requirements.memoryTypeBits;
+				slot._images.push_back( transient );
+				resource._slot						= ii;
+			}
+		}
+
+		if ( UINT32_MAX == resource._slot )
+		{
+			MemorySlot slot;
+			slot._requirements	= resource._requirements;
+			slot._isTransient	= resource._isTransientAttachment;
+			slot._images.push_back( transient );
+
+			resource._slot		= static_cast<uint32_t>( _slots.size() );
+			_slots.push_back( std::move( slot ) );
+		}
+	}
+
+	for ( MemorySlot& slot : _slots )
+	{
+		// Desktop GPUs have no lazily allocated memory and get ordinary device memory instead.
+		slot._isLazy = ( true == slot._isTransient ) &&
+					   ( true == _allocator->allocate( slot._requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, ResourceKind::Optimal, slot._allocation ) );
+
+		if ( ( false == slot._isLazy ) && ( false == _allocator->allocate( slot._requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceKind::Optimal, slot._allocation ) ) )
+		{
+			std::cerr << "render graph: failed to allocate transient memory" << std::endl;
+			return false;
+		}
+
+		for ( const RenderGraphResource image : slot._images )
+		{
+			Resource& resource = _resources[image];
+
+			if ( VK_SUCCESS != vkBindImageMemory( _device, resource._image, slot._allocation._memory, slot._allocation._offset ) )
+			{
+				return false;
+			}
+
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType								= VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image								= resource._image;
+			viewInfo.viewType							= VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format								= resource._format;
+			viewInfo.subresourceRange.aspectMask		= getAspectMask( resource._format );
+			viewInfo.subresourceRange.levelCount		= 1;
+			viewInfo.subresourceRange.layerCount		= 1;
+
+			if ( VK_SUCCESS != vkCreateImageView( _device, &viewInfo, nullptr, &resource._view ) )
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+RenderGraph::ResourceState RenderGraph::getInitialState( const RenderGraphResource resource ) const noexcept
+{
+	const Resource& candidate = _resources[resource];
+	ResourceState state;
+
+	// Imported buffers come with whatever the host or earlier submissions put in them.
+	if ( false == candidate._isImage )
+	{
+		state._hasContent	= true;
+
+		// Where the previous execution left it: its writes are not visible yet, and its reads precede any write.
+		if ( true == candidate._isPersistent )
+		{
+			for ( const Pass& pass : _passes )
+			{
+				for ( const Use& use : pass._uses )
+				{
+					if ( ( false == pass._isCulled ) && ( resource == use._resource ) )
+					{
+						applyUse( state, use._usage, VK_IMAGE_LAYOUT_UNDEFINED );
+					}
+				}
+			}
+
+			state._visibleStages	= 0;
+			state._visibleAccess	= 0;
+		}
+
+		return state;
+	}
+
+	if ( ( true == candidate._isImported ) || ( UINT32_MAX == candidate._slot ) )
+	{
+		state._writeStages	= candidate._initialStages;
+		return state;
+	}
+
+	// A transient image's memory was last used by one of the images sharing it, in this frame or the one
+	// before, so its first use waits for every use of them.
+	for ( const RenderGraphResource occupant : _slots[candidate._slot]._images )
+	{
+		for ( const Pass& pass : _passes )
+		{
+			for ( const Use& use : pass._uses )
+			{
+				if ( ( false == pass._isCulled ) && ( occupant == use._resource ) )
+				{
+					state._writeStages	|= getUsageInfo( use._usage )._stages;
+					state._writeAccess	|= getUsageInfo( use._usage )._access & WRITE_ACCESS;
+				}
+			}
+		}
+	}
+
+	return state;
+}
+
+bool RenderGraph::getSource( const ResourceState& state, const ResourceUsage usage, const bool isTransition, VkPipelineStageFlags& srcStages, VkAccessFlags& srcAccess ) noexcept
+{
+	const UsageInfo& info = getUsageInfo( usage );
+
+	srcAccess = state._writeAccess;
+
+	// Writes also wait for the reads before them; reads only for the last write, unless they already see it.
+	if ( ( true == info._isWrite ) || ( true == isTransition ) )
+	{
+		srcStages = state._writeStages | state._readStages;
+		return ( 0 != srcStages ) || ( true == isTransition );
+	}
+
+	srcStages = state._writeStages;
+
+	const bool isVisible = ( ( state._visibleStages & info._stages ) == info._stages ) && ( ( state._visibleAccess & info._access ) == info._access );
+	return ( 0 != srcStages ) && ( false == isVisible );
+}
+
+void RenderGraph::applyUse( ResourceState& state, const ResourceUsage usage, const VkImageLayout layout ) noexcept
+{
+	const UsageInfo& info = getUsageInfo( usage );
+
+	if ( true == info._isWrite )
+	{
+		state._writeStages		= info._stages;
+		state._writeAccess		= info._access & WRITE_ACCESS;
+		state._readStages		= 0;
+		state._visibleStages	= info._stages;
+		state._visibleAccess	= info._access;
+		state._hasContent		= true;
+	}
+	else
+	{
+		state._readStages		|= info._stages;
+		state._visibleStages	|= info._stages;
+		state._visibleAccess	|= info._access;
+	}
+
+	state._layout = layout;
+}
+
+void RenderGraph::addBarrier( BarrierBatch& batch, const RenderGraphResource resource, ResourceState& state, const ResourceUsage usage ) const noexcept
+{
+	const UsageInfo& info		= getUsageInfo( usage );
+	const bool isImage			= _resources[resource]._isImage;
+	const VkImageLayout layout	= ( true == isImage ) ? info._layout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VkPipelineStageFlags srcStages	= 0;
+	VkAccessFlags srcAccess			= 0;
+
+	if ( true == getSource( state, usage, ( true == isImage ) && ( layout != state._layout ), srcStages, srcAccess ) )
+	{
+		batch._srcStages	|= ( 0 != srcStages ) ? srcStages : static_cast<VkPipelineStageFlags>( VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT );
+		batch._dstStages	|= info._stages;
+		batch._barriers.push_back( Barrier{ resource, srcAccess, info._access, state._layout, layout } );
+	}
+
+	applyUse( state, usage, layout );
+}
+
+bool RenderGraph::isNeededAfter( const RenderGraphResource resource, const uint32_t group ) const noexcept
+{
+	if ( true == _resources[resource]._isOutput )
+	{
+		return true;
+	}
+
+	// The first later use decides: an overwrite does not need the old contents.
+	for ( uint32_t ii = group + 1; ii < static_cast<uint32_t>( _groups.size() ); ++ii )
+	{
+		for ( const uint32_t pass : _groups[ii]._passes )
+		{
+			for ( const Use& use : _passes[pass]._uses )
+			{
+				if ( resource == use._resource )
+				{
+					return false == isOverwrite( use._usage, use._clear );
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+bool RenderGraph::buildRenderPass( const uint32_t groupIndex, std::vector<ResourceState>& states ) noexcept
+{
+	Group& group = _groups[groupIndex];
+
+	// Per attachment: the subpass and usage of its last use so far in this render pass.
+	std::vector<uint32_t> lastSubpass;
+	std::vector<ResourceUsage> lastUsage;
+
+	struct SubpassReferences
+	{
+		std::vector<VkAttachmentReference>	_colors;
+		std::vector<VkAttachmentReference>	_inputs;
+		VkAttachmentReference				_depth		= { VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED };
+		// Resolve targets by the resource they resolve, then lined up with _colors.
+		std::vector<std::pair<RenderGraphResource, VkAttachmentReference>>	_resolves;
+		std::vector<VkAttachmentReference>	_resolveTargets;
+	};
+
+	std::vector<SubpassReferences> references( group._passes.size() );
+
+	for ( uint32_t subpass = 0; subpass < static_cast<uint32_t>( group._passes.size() ); ++subpass )
+	{
+		const Pass& pass = _passes[group._passes[subpass]];
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_FLAG_BITS_MAX_ENUM;
+
+		for ( const Use& use : pass._uses )
+		{
+			const UsageInfo& info	= getUsageInfo( use._usage );
+			ResourceState& state	= states[use._resource];
+
+			// Everything that is not an attachment is synchronized before the render pass begins.
+			if ( false == info._isAttachment )
+			{
+				addBarrier( group._barriers, use._resource, state, use._usage );
+				continue;
+			}
+
+			const Resource& resource = _resources[use._resource];
+
+			// Color and depth attachments are rendered to together and share a sample count; resolve targets are single-sampled.
+			const bool isRendered = ( ResourceUsage::ColorAttachment == use._usage ) || ( ResourceUsage::DepthAttachment == use._usage );
+
+			if ( ( true == isRendered ) && ( VK_SAMPLE_COUNT_FLAG_BITS_MAX_ENUM != samples ) && ( samples != resource._samples ) )
+			{
+				std::cerr << "render graph: attachments of pass " << pass._name << " differ in sample count" << std::endl;
+				return false;
+			}
+
+			samples = ( true == isRendered ) ? resource._samples : samples;
+
+			auto existing				= std::find( group._attachments.begin(), group._attachments.end(), use._resource );
+			const uint32_t attachment	= static_cast<uint32_t>( existing - group._attachments.begin() );
+			VkPipelineStageFlags srcStages	= 0;
+			VkAccessFlags srcAccess			= 0;
+
+			if ( group._attachments.end() == existing )
+			{
+				// First use in this render pass: the attachment is loaded, cleared or its contents discarded.
+				VkAttachmentDescription description{};
+				description.format			= resource._format;
+				description.samples			= resource._samples;
+				description.loadOp			= ( true == use._clear ) ? VK_ATTACHMENT_LOAD_OP_CLEAR :
+											  ( ( ( false == isOverwrite( use._usage, false ) ) && ( true == state._hasContent ) ) ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE );
+				description.storeOp			= VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				description.stencilLoadOp	= ( true == hasStencil( resource._format ) ) ? description.loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				description.stencilStoreOp	= VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				description.initialLayout	= ( VK_ATTACHMENT_LOAD_OP_LOAD == description.loadOp ) ? state._layout : VK_IMAGE_LAYOUT_UNDEFINED;
+				description.finalLayout		= info._layout;
+
+				if ( VK_IMAGE_LAYOUT_UNDEFINED == description.initialLayout )
+				{
+					state._layout = VK_IMAGE_LAYOUT_UNDEFINED;
+				}
+
+				if ( true == getSource( state, use._usage, description.initialLayout != info._layout, srcStages, srcAccess ) )
+				{
+					addDependency( group._dependencies, VK_SUBPASS_EXTERNAL, subpass, ( 0 != srcStages ) ? srcStages : static_cast<VkPipelineStageFlags>( VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT ), srcAccess, info._stages, info._access );
+				}
+
+				group._attachments.push_back( use._resource );
+				group._attachmentDescriptions.push_back( description );
+				group._clearValues.push_back( use._clearValue );
+				lastSubpass.push_back( subpass );
+				lastUsage.push_back( use._usage );
+			}
+			else
+			{
+				// Later subpasses wait for the earlier ones that touched the attachment.
+				const UsageInfo& previous = getUsageInfo( lastUsage[attachment] );
+
+				if ( ( lastSubpass[attachment] != subpass ) && ( ( true == previous._isWrite ) || ( true == info._isWrite ) || ( previous._layout != info._layout ) ) )
+				{
+					addDependency( group._dependencies, lastSubpass[attachment], subpass, previous._stages, previous._access & WRITE_ACCESS, info._stages, info._access );
+				}
+
+				lastSubpass[attachment]		= subpass;
+				lastUsage[attachment]		= use._usage;
+				group._attachmentDescriptions[attachment].finalLayout = info._layout;
+			}
+
+			applyUse( state, use._usage, info._layout );
+
+			const VkAttachmentReference reference = { attachment, info._layout };
+
+			switch ( use._usage )
+			{
+			case ResourceUsage::ColorAttachment:	references[subpass]._colors.push_back( reference );	break;
+			case ResourceUsage::InputAttachment:	references[subpass]._inputs.push_back( reference );	break;
+			case ResourceUsage::ResolveAttachment:	references[subpass]._resolves.emplace_back( use._resolveSource, reference );	break;
+			default:								references[subpass]._depth = reference;				break;
+			}
+		}
+
+		SubpassReferences& subpassReferences = references[subpass];
+
+		if ( false == subpassReferences._resolves.empty() )
+		{
+			subpassReferences._resolveTargets.assign( subpassReferences._colors.size(), VkAttachmentReference{ VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED } );
+
+			for ( const auto& resolve : subpassReferences._resolves )
+			{
+				auto color = std::find_if( subpassReferences._colors.begin(), subpassReferences._colors.end(), [&group, &resolve]( const VkAttachmentReference& reference )
+				{
+					return group._attachments[reference.attachment] == resolve.first;
+				} );
+
+				if ( ( subpassReferences._colors.end() == color ) || ( VK_SAMPLE_COUNT_1_BIT == _resources[resolve.first]._samples ) )
+				{
+					std::cerr << "render graph: pass " << pass._name << " resolves something that is not one of its multisampled color attachments" << std::endl;
+					return false;
+				}
+
+				subpassReferences._resolveTargets[color - subpassReferences._colors.begin()] = resolve.second;
+			}
+		}
+	}
+
+	for ( uint32_t ii = 0; ii < static_cast<uint32_t>( group._attachments.size() ); ++ii )
+	{
+		const RenderGraphResource resource		= group._attachments[ii];
+		VkAttachmentDescription& description	= group._attachmentDescriptions[ii];
+		ResourceState& state					= states[resource];
+
+		if ( true == isNeededAfter( resource, groupIndex ) )
+		{
+			description.storeOp			= VK_ATTACHMENT_STORE_OP_STORE;
+			description.stencilStoreOp	= ( true == hasStencil( description.format ) ) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		}
+		else
+		{
+			state._hasContent			= false;
+		}
+
+		// An output's last render pass leaves it in its final layout, so no barrier is needed after the frame.
+		const Resource& candidate = _resources[resource];
+
+		if ( ( true == candidate._isOutput ) && ( groupIndex == candidate._lastGroup ) )
+		{
+			const UsageInfo& previous	= getUsageInfo( lastUsage[ii] );
+			const UsageInfo& finalInfo	= getUsageInfo( candidate._finalUsage );
+
+			description.finalLayout		= finalInfo._layout;
+			addDependency( group._dependencies, lastSubpass[ii], VK_SUBPASS_EXTERNAL, previous._stages, previous._access & WRITE_ACCESS, finalInfo._stages, finalInfo._access );
+			applyUse( state, candidate._finalUsage, finalInfo._layout );
+		}
+
+		state._layout = description.finalLayout;
+	}
+
+	std::vector<VkSubpassDescription> subpasses( group._passes.size() );
+
+	for ( size_t ii = 0; ii < subpasses.size(); ++ii )
+	{
+		subpasses[ii].pipelineBindPoint			= VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpasses[ii].colorAttachmentCount		= static_cast<uint32_t>( references[ii]._colors.size() );
+		subpasses[ii].pColorAttachments			= references[ii]._colors.data();
+		subpasses[ii].pResolveAttachments		= ( false == references[ii]._resolveTargets.empty() ) ? references[ii]._resolveTargets.data() : nullptr;
+		subpasses[ii].inputAttachmentCount		= static_cast<uint32_t>( references[ii]._inputs.size() );
+		subpasses[ii].pInputAttachments			= references[ii]._inputs.data();
+		subpasses[ii].pDepthStencilAttachment	= ( VK_ATTACHMENT_UNUSED != references[ii]._depth.attachment ) ? &references[ii]._depth : nullptr;
+	}
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType				= VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount		= static_cast<uint32_t>( group._attachmentDescriptions.size() );
+	renderPassInfo.pAttachments			= group._attachmentDescriptions.data();
+	renderPassInfo.subpassCount			= static_cast<uint32_t>( subpasses.size() );
+	renderPassInfo.pSubpasses			= subpasses.data();
+	renderPassInfo.dependencyCount		= static_cast<uint32_t>( group._dependencies.size() );
+	renderPassInfo.pDependencies		= group._dependencies.data();
+
+	return VK_SUCCESS == vkCreateRenderPass( _device, &renderPassInfo, nullptr, &group._renderPass );
+}
+
+void RenderGraph::setImage( const RenderGraphResource resource, const VkImage image, const VkImageView view ) noexcept
+{
+	_resources[resource]._image		= image;
+	_resources[resource]._view		= view;
+}
+
+void RenderGraph::setBuffer( const RenderGraphResource resource, const VkBuffer buffer, const VkDeviceSize offset, const VkDeviceSize size ) noexcept
+{
+	_resources[resource]._buffer	= buffer;
+	_resources[resource]._offset	= offset;
+	_resources[resource]._size		= size;
+}
+
+VkRenderPass RenderGraph::getRenderPass( const uint32_t pass ) const noexcept
+{
+	return ( true == isCulled( pass ) ) ? VK_NULL_HANDLE : _groups[_passes[pass]._group]._renderPass;
+}
+
+uint32_t RenderGraph::getSubpass( const uint32_t pass ) const noexcept
+{
+	return _passes[pass]._subpass;
+}
+
+VkFramebuffer RenderGraph::getFramebuffer( const uint32_t pass ) noexcept
+{
+	return ( true == isCulled( pass ) ) ? VK_NULL_HANDLE : getGroupFramebuffer( _groups[_passes[pass]._group] );
+}
+
+bool RenderGraph::isCulled( const uint32_t pass ) const noexcept
+{
+	return ( _passes.size() <= pass ) || ( true == _passes[pass]._isCulled );
+}
+
+VkFramebuffer RenderGraph::getGroupFramebuffer( Group& group ) noexcept
+{
+	// Imported images change from frame to frame, so there is one framebuffer per combination of views.
+	std::vector<VkImageView> views;
+	views.reserve( group._attachments.size() );
+
+	for ( const RenderGraphResource attachment : group._attachments )
+	{
+		views.push_back( _resources[attachment]._view );
+	}
+
+	auto existing = group._framebuffers.find( views );
+	if ( group._framebuffers.end() != existing )
+	{
+		return existing->second;
+	}
+
+	VkFramebufferCreateInfo framebufferInfo{};
+	framebufferInfo.sType				= VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass			= group._renderPass;
+	framebufferInfo.attachmentCount		= static_cast<uint32_t>( views.size() );
+	framebufferInfo.pAttachments		= views.data();
+	framebufferInfo.width				= group._extent.width;
+	framebufferInfo.height				= group._extent.height;
+	framebufferInfo.layers				= 1;
+
+	VkFramebuffer framebuffer = VK_NULL_HANDLE;
+	if ( VK_SUCCESS != vkCreateFramebuffer( _device, &framebufferInfo, nullptr, &framebuffer ) )
+	{
+		std::cerr << "render graph: failed to create a framebuffer" << std::endl;
+		return VK_NULL_HANDLE;
+	}
+
+	group._framebuffers.emplace( std::move( views ), framebuffer );
+
+	return framebuffer;
+}
+
+void RenderGraph::execute( const VkCommandBuffer commandBuffer ) noexcept
+{
+	for ( Group& group : _groups )
+	{
+		recordBarriers( commandBuffer, group._barriers );
+
+		if ( false == group._isRenderPass )
+		{
+			_passes[group._passes[0]]._record( commandBuffer );
+			continue;
+		}
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType				= VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass			= group._renderPass;
+		renderPassInfo.framebuffer			= getGroupFramebuffer( group );
+		renderPassInfo.renderArea.offset	= { 0, 0 };
+		renderPassInfo.renderArea.extent	= group._extent;
+		renderPassInfo.clearValueCount		= static_cast<uint32_t>( group._clearValues.size() );
+		renderPassInfo.pClearValues			= group._clearValues.data();
+
+		for ( size_t ii = 0; ii < group._passes.size(); ++ii )
+		{
+			const Pass& pass					= _passes[group._passes[ii]];
+			const VkSubpassContents contents	= ( true == pass._secondaryContents ) ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+
+			if ( 0 == ii )
+			{
+				vkCmdBeginRenderPass( commandBuffer, &renderPassInfo, contents );
+			}
+			else
+			{
+				vkCmdNextSubpass( commandBuffer, contents );
+			}
+
+			pass._record( commandBuffer );
+		}
+
+		vkCmdEndRenderPass( commandBuffer );
+	}
+
+	recordBarriers( commandBuffer, _finalBarriers );
+}
+
+void RenderGraph::recordBarriers( const VkCommandBuffer commandBuffer, const BarrierBatch& batch ) const noexcept
+{
+	if ( true == batch._barriers.empty() )
+	{
+		return;
+	}
+
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	std::vector<VkBufferMemoryBarrier> bufferBarriers;
+
+	for ( const Barrier& barrier : batch._barriers )
+	{
+		const Resource& resource = _resources[barrier._resource];
+
+		if ( true == resource._isImage )
+		{
+			VkImageMemoryBarrier imageBarrier{};
+			imageBarrier.sType							= VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			imageBarrier.srcAccessMask					= barrier._srcAccess;
+			imageBarrier.dstAccessMask					= barrier._dstAccess;
+			imageBarrier.oldLayout						= barrier._oldLayout;
+			imageBarrier.newLayout						= barrier._newLayout;
+			imageBarrier.srcQueueFamilyIndex			= VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.dstQueueFamilyIndex			= VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.image							= resource._image;
+			imageBarrier.subresourceRange.aspectMask	= getAspectMask( resource._format );
+			imageBarrier.subresourceRange.levelCount	= 1;
+			imageBarrier.subresourceRange.layerCount	= 1;
+
+			imageBarriers.push_back( imageBarrier );
+		}
+		else if ( VK_NULL_HANDLE != resource._buffer )
+		{
+			VkBufferMemoryBarrier bufferBarrier{};
+			bufferBarrier.sType							= VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			bufferBarrier.srcAccessMask					= barrier._srcAccess;
+			bufferBarrier.dstAccessMask					= barrier._dstAccess;
+			bufferBarrier.srcQueueFamilyIndex			= VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.dstQueueFamilyIndex			= VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.buffer						= resource._buffer;
+			bufferBarrier.offset						= resource._offset;
+			bufferBarrier.size							= resource._size;
+
+			bufferBarriers.push_back( bufferBarrier );
+		}
+	}
+
+	vkCmdPipelineBarrier( commandBuffer, batch._srcStages, batch._dstStages, 0, 0, nullptr,
+						  static_cast<uint32_t>( bufferBarriers.size() ), bufferBarriers.data(), static_cast<uint32_t>( imageBarriers.size() ), imageBarriers.data() );
+}
+
+VkDeviceSize RenderGraph::getTransientBytes( void ) const noexcept
+{
+	VkDeviceSize bytes = 0;
+
+	for ( const MemorySlot& slot : _slots )
+	{
+		bytes += slot._requirements.size;
+	}
+
+	return bytes;
+}
+
+VkDeviceSize RenderGraph::getLazyBytes( void ) const noexcept
+{
+	VkDeviceSize bytes = 0;
+
+	for ( const MemorySlot& slot : _slots )
+	{
+		bytes += ( true == slot._isLazy ) ? slot._requirements.size : 0;
+	}
+
+	return bytes;
+}
+
+VkDeviceSize RenderGraph::getUnaliasedTransientBytes( void ) const noexcept
+{
+	VkDeviceSize bytes = 0;
+
+	for ( const MemorySlot& slot : _slots )
+	{
+		for ( const RenderGraphResource image : slot._images )
+		{
+			bytes += _resources[image]._requirements.size;
+		}
+	}
+
+	return bytes;
+}
+
+void RenderGraph::dump( std::ostream& stream ) const noexcept
+{
+	const size_t keptCount = std::count_if( _passes.begin(), _passes.end(), []( const Pass& pass ) { return false == pass._isCulled; } );
+
+	stream << "render graph: " << keptCount << " of " << _passes.size() << " passes kept, " << _groups.size() << " groups" << std::endl;
+
+	for ( const Pass& pass : _passes )
+	{
+		stream << "  pass " << pass._name << " (" << ( ( PassType::Graphics == pass._type ) ? "graphics" : "compute" ) << "): ";
+
+		if ( true == pass._isCulled )
+		{
+			stream << "culled" << std::endl;
+			continue;
+		}
+
+		stream << "group " << pass._group;
+		if ( PassType::Graphics == pass._type )
+		{
+			stream << ", subpass " << pass._subpass;
+		}
+
+		for ( const Use& use : pass._uses )
+		{
+			stream << ( ( &use == &pass._uses.front() ) ? " uses " : ", " ) << _resources[use._resource]._name << " as " << getUsageInfo( use._usage )._name << ( ( true == use._clear ) ? " (clear)" : "" );
+		}
+
+		stream << std::endl;
+	}
+
+	auto dumpBarriers = [this, &stream]( const char* label, const BarrierBatch& batch )
+	{
+		if ( true == batch._barriers.empty() )
+		{
+			return;
+		}
+
+		stream << "    " << label << " stages 0x" << std::hex << batch._srcStages << " -> 0x" << batch._dstStages << std::dec << std::endl;
+
+		for ( const Barrier& barrier : batch._barriers )
+		{
+			stream << "      " << _resources[barrier._resource]._name << ": access 0x" << std::hex << barrier._srcAccess << " -> 0x" << barrier._dstAccess << std::dec;
+
+			if ( true == _resources[barrier._resource]._isImage )
+			{
+				stream << ", " << getLayoutName( barrier._oldLayout ) << " -> " << getLayoutName( barrier._newLayout );
+			}
+
+			stream << std::endl;
+		}
+	};
+
+	for ( size_t ii = 0; ii < _groups.size(); ++ii )
+	{
+		const Group& group = _groups[ii];
+
+		stream << "  group " << ii << ": " << ( ( true == group._isRenderPass ) ? "render pass" : "compute" );
+		for ( const uint32_t pass : group._passes )
+		{
+			stream << " " << _passes[pass]._name;
+		}
+		stream << std::endl;
+
+		dumpBarriers( "barrier", group._barriers );
+
+		for ( size_t jj = 0; jj < group._attachments.size(); ++jj )
+		{
+			const VkAttachmentDescription& description = group._attachmentDescriptions[jj];
+
+			stream << "    attachment " << jj << " " << _resources[group._attachments[jj]]._name << ": " << getLoadOpName( description.loadOp ) << "/" << getStoreOpName( description.storeOp )
+				   << ", " << getLayoutName( description.initialLayout ) << " -> " << getLayoutName( description.finalLayout ) << ", " << description.samples << "x" << std::endl;
+		}
+
+		for ( const VkSubpassDependency& dependency : group._dependencies )
+		{
+			stream << "    dependency ";
+			( VK_SUBPASS_EXTERNAL == dependency.srcSubpass ) ? ( stream << "external" ) : ( stream << dependency.srcSubpass );
+			stream << " -> ";
+			( VK_SUBPASS_EXTERNAL == dependency.dstSubpass ) ? ( stream << "external" ) : ( stream << dependency.dstSubpass );
+			stream << ": stages 0x" << std::hex << dependency.srcStageMask << " -> 0x" << dependency.dstStageMask << ", access 0x" << dependency.srcAccessMask << " -> 0x" << dependency.dstAccessMask << std::dec << std::endl;
+		}
+	}
+
+	dumpBarriers( "final barrier", _finalBarriers );
+
+	size_t transientCount = 0;
+	for ( const MemorySlot& slot : _slots )
+	{
+		transientCount += slot._images.size();
+
+		stream << "  memory " << ( &slot - _slots.data() ) << ": " << slot._requirements.size << " bytes" << ( ( true == slot._isLazy ) ? " lazily allocated" : "" ) << " for";
+		for ( const RenderGraphResource image : slot._images )
+		{
+			stream << " " << _resources[image]._name << " (groups " << _resources[image]._firstGroup << "-" << _resources[image]._lastGroup << ")";
+		}
+		stream << std::endl;
+	}
+
+	const VkDeviceSize aliasedBytes		= getTransientBytes();
+	const VkDeviceSize unaliasedBytes	= getUnaliasedTransientBytes();
+
+	stream << "  transient memory: " << transientCount << " images in " << _slots.size() << " allocations, " << aliasedBytes << " bytes instead of " << unaliasedBytes
+		   << " (" << ( unaliasedBytes - aliasedBytes ) << " saved by aliasing), " << getLazyBytes() << " lazily allocated" << std::endl;
+}
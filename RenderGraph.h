@@ -0,0 +1,233 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+#include "DeletionQueue.h"
+
+// How a pass uses a resource; each implies the pipeline stage, access and image layout of that use.
+enum class ResourceUsage : uint32_t
+{
+	ColorAttachment = 0,
+	DepthAttachment,
+	ResolveAttachment,	// written by resolving a multisampled color attachment at the end of the subpass
+	InputAttachment,	// read in a later subpass of the same render pass
+	Sampled,			// read by the fragment shader
+	StorageRead,		// read by a compute shader
+	StorageWrite,		// written (and possibly read) by a compute shader
+	IndirectRead,
+	VertexRead,
+	TransferRead,
+	TransferWrite,
+	HostRead,			// only as the final usage of an output
+	Present,			// only as the final usage of an output
+	Count
+};
+
+enum class PassType : uint32_t
+{
+	Graphics = 0,
+	Compute
+};
+
+typedef uint32_t RenderGraphResource;
+
+// Records a pass into the frame's primary command buffer; graphics passes run inside their subpass.
+typedef std::function<void( VkCommandBuffer commandBuffer )> RecordPassCallback;
+
+// The frame as a graph of passes that declare the resources they use, in execution order. compile() drops
+// passes nothing needs, merges adjacent graphics passes into subpasses of one render pass, works out every
+// barrier, layout transition and subpass dependency, and gives transient images memory shared between
+// images whose lifetimes do not overlap. Imported resources (swapchain images, per-frame buffers) are bound
+// before each frame's execute().
+class RenderGraph
+{
+public:
+
+	RenderGraph( void );
+
+	void					create( const VkDevice device, MemoryAllocator& allocator ) noexcept;
+	// Destroys the compiled objects right away; only once the device no longer uses them.
+	void					destroy( void ) noexcept;
+	// Hands the compiled objects to the deletion queue and clears the graph for a new declaration.
+	void					retire( DeletionQueue& deletionQueue, const uint64_t frame ) noexcept;
+
+	// initialStages must finish before the image's first use, e.g. the stage its acquire semaphore is waited on at.
+	RenderGraphResource		importImage( const std::string& name, const VkFormat format, const VkExtent2D extent, const VkSampleCountFlagBits samples, const VkPipelineStageFlags initialStages ) noexcept;
+	RenderGraphResource		createImage( const std::string& name, const VkFormat format, const VkExtent2D extent, const VkSampleCountFlagBits samples ) noexcept;
+	RenderGraphResource		importBuffer( const std::string& name ) noexcept;
+
+	// An imported buffer whose contents carry over between executions, e.g. simulation state: its first use
+	// waits for the last uses of the previous execution.
+	void					setPersistent( const RenderGraphResource resource ) noexcept;
+	// Outputs keep the passes producing them alive and are left ready for their final usage after the frame.
+	void					setOutput( const RenderGraphResource resource, const ResourceUsage finalUsage ) noexcept;
+
+	uint32_t				addPass( const std::string& name, const PassType type, RecordPassCallback record ) noexcept;
+	void					use( const uint32_t pass, const RenderGraphResource resource, const ResourceUsage usage ) noexcept;
+	// An attachment use that clears the attachment instead of loading it.
+	void					clear( const uint32_t pass, const RenderGraphResource resource, const ResourceUsage usage, const VkClearValue& value ) noexcept;
+	// The pass resolves its multisampled color attachment source into target, which is not loaded.
+	void					resolve( const uint32_t pass, const RenderGraphResource source, const RenderGraphResource target ) noexcept;
+	// The pass executes secondary command buffers in its subpass.
+	void					setSecondaryContents( const uint32_t pass ) noexcept;
+
+	bool					compile( void ) noexcept;
+	void					dump( std::ostream& stream ) const noexcept;
+
+	// Imported resources are bound per frame, before getFramebuffer() and execute().
+	void					setImage( const RenderGraphResource resource, const VkImage image, const VkImageView view ) noexcept;
+	void					setBuffer( const RenderGraphResource resource, const VkBuffer buffer, const VkDeviceSize offset, const VkDeviceSize size ) noexcept;
+
+	// For graphics pipelines and secondary command buffer inheritance.
+	VkRenderPass			getRenderPass( const uint32_t pass ) const noexcept;
+	uint32_t				getSubpass( const uint32_t pass ) const noexcept;
+	VkFramebuffer			getFramebuffer( const uint32_t pass ) noexcept;
+	bool					isCulled( const uint32_t pass ) const noexcept;
+
+	void					execute( const VkCommandBuffer commandBuffer ) noexcept;
+
+	// Transient image memory with and without aliasing, and the part of it that is lazily allocated.
+	VkDeviceSize			getTransientBytes( void ) const noexcept;
+	VkDeviceSize			getUnaliasedTransientBytes( void ) const noexcept;
+	VkDeviceSize			getLazyBytes( void ) const noexcept;
+
+private:
+
+	static const uint32_t	NO_GROUP = UINT32_MAX;
+
+	struct Resource
+	{
+		std::string				_name;
+		bool					_isImage		= false;
+		bool					_isImported		= false;
+		VkFormat				_format			= VK_FORMAT_UNDEFINED;
+		VkExtent2D				_extent			= {};
+		VkSampleCountFlagBits	_samples		= VK_SAMPLE_COUNT_1_BIT;
+		VkPipelineStageFlags	_initialStages	= 0;
+
+		bool					_isOutput		= false;
+		bool					_isPersistent	= false;
+		ResourceUsage			_finalUsage		= ResourceUsage::Count;
+
+		// Bound per frame for imported resources, created by compile() for transient images.
+		VkImage					_image			= VK_NULL_HANDLE;
+		VkImageView				_view			= VK_NULL_HANDLE;
+		VkBuffer				_buffer			= VK_NULL_HANDLE;
+		VkDeviceSize			_offset			= 0;
+		VkDeviceSize			_size			= VK_WHOLE_SIZE;
+
+		// Groups between the first and last use; transient images only share memory outside of them.
+		uint32_t				_firstGroup		= NO_GROUP;
+		uint32_t				_lastGroup		= NO_GROUP;
+		uint32_t				_slot			= UINT32_MAX;
+		VkMemoryRequirements	_requirements	= {};
+		// Only ever an attachment of one render pass, so its contents never reach memory on tiled GPUs.
+		bool					_isTransientAttachment	= false;
+	};
+
+	struct Use
+	{
+		RenderGraphResource		_resource;
+		ResourceUsage			_usage;
+		bool					_clear;
+		VkClearValue			_clearValue;
+		RenderGraphResource		_resolveSource;
+	};
+
+	struct Pass
+	{
+		std::string				_name;
+		PassType				_type;
+		RecordPassCallback		_record;
+		std::vector<Use>		_uses;
+		bool					_secondaryContents	= false;
+		bool					_isCulled			= false;
+		uint32_t				_group				= NO_GROUP;
+		uint32_t				_subpass			= 0;
+	};
+
+	struct Barrier
+	{
+		RenderGraphResource		_resource;
+		VkAccessFlags			_srcAccess;
+		VkAccessFlags			_dstAccess;
+		VkImageLayout			_oldLayout;
+		VkImageLayout			_newLayout;
+	};
+
+	struct BarrierBatch
+	{
+		VkPipelineStageFlags	_srcStages		= 0;
+		VkPipelineStageFlags	_dstStages		= 0;
+		std::vector<Barrier>	_barriers;
+	};
+
+	// One compute pass, or graphics passes merged into the subpasses of one render pass.
+	struct Group
+	{
+		std::vector<uint32_t>						_passes;
+		bool										_isRenderPass	= false;
+		VkExtent2D									_extent			= {};
+		BarrierBatch								_barriers;
+
+		VkRenderPass								_renderPass		= VK_NULL_HANDLE;
+		std::vector<RenderGraphResource>			_attachments;
+		std::vector<VkAttachmentDescription>		_attachmentDescriptions;
+		std::vector<VkSubpassDependency>			_dependencies;
+		std::vector<VkClearValue>					_clearValues;
+		std::map<std::vector<VkImageView>, VkFramebuffer>	_framebuffers;
+	};
+
+	// Memory shared by transient images whose lifetimes do not overlap. Transient attachments only share with
+	// each other and get lazily allocated memory where the device has it.
+	struct MemorySlot
+	{
+		std::vector<RenderGraphResource>	_images;
+		VkMemoryRequirements				_requirements	= {};
+		bool								_isTransient	= false;
+		bool								_isLazy			= false;
+		Allocation							_allocation;
+	};
+
+	// Where a resource stands between passes while barriers are worked out.
+	struct ResourceState
+	{
+		VkImageLayout			_layout			= VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags	_writeStages	= 0;
+		VkAccessFlags			_writeAccess	= 0;
+		// Reads since the last write, which the next write has to wait for.
+		VkPipelineStageFlags	_readStages		= 0;
+		// Stages and access the last write has already been made visible to.
+		VkPipelineStageFlags	_visibleStages	= 0;
+		VkAccessFlags			_visibleAccess	= 0;
+		bool					_hasContent		= false;
+	};
+
+	void					cullPasses( void ) noexcept;
+	bool					buildGroups( void ) noexcept;
+	bool					canMerge( const Group& group, const Pass& pass ) const noexcept;
+	bool					allocateTransients( void ) noexcept;
+	ResourceState			getInitialState( const RenderGraphResource resource ) const noexcept;
+	bool					buildRenderPass( const uint32_t groupIndex, std::vector<ResourceState>& states ) noexcept;
+	void					addBarrier( BarrierBatch& batch, const RenderGraphResource resource, ResourceState& state, const ResourceUsage usage ) const noexcept;
+	bool					isNeededAfter( const RenderGraphResource resource, const uint32_t group ) const noexcept;
+
+	// What a use has to wait for, if anything; a layout transition counts as a write.
+	static bool				getSource( const ResourceState& state, const ResourceUsage usage, const bool isTransition, VkPipelineStageFlags& srcStages, VkAccessFlags& srcAccess ) noexcept;
+	static void				applyUse( ResourceState& state, const ResourceUsage usage, const VkImageLayout layout ) noexcept;
+
+	void					recordBarriers( const VkCommandBuffer commandBuffer, const BarrierBatch& batch ) const noexcept;
+	VkFramebuffer			getGroupFramebuffer( Group& group ) noexcept;
+	// Moves every Vulkan object the graph created into a function that destroys them, and clears the graph.
+	std::function<void( void )>	detachObjects( void ) noexcept;
+
+	VkDevice								_device;
+	MemoryAllocator*						_allocator;
+
+	std::vector<Resource>					_resources;
+	std::vector<Pass>						_passes;
+
+	std::vector<Group>						_groups;
+	std::vector<MemorySlot>					_slots;
+	// Leaves the outputs in their final state after the last group.
+	BarrierBatch							_finalBarriers;
+};
@@ -0,0 +1,791 @@
+#include "pch.h"
+
+#include "ShaderReflection.h"
+
+namespace
+{
+	const uint32_t SPIRV_MAGIC					= 0x07230203;
+	const uint32_t SPIRV_HEADER_WORDS			= 5;
+
+	// Opcodes, decorations, storage classes and execution models from the SPIR-V specification.
+	const uint32_t OP_NAME						= 5;
+	const uint32_t OP_ENTRY_POINT				= 15;
+	const uint32_t OP_EXECUTION_MODE			= 16;
+	const uint32_t OP_TYPE_BOOL					= 20;
+	const uint32_t OP_TYPE_INT					= 21;
+	const uint32_t OP_TYPE_FLOAT				= 22;
+	const uint32_t OP_TYPE_VECTOR				= 23;
+	const uint32_t OP_TYPE_MATRIX				= 24;
+	const uint32_t OP_TYPE_IMAGE				= 25;
+	const uint32_t OP_TYPE_SAMPLER				= 26;
+	const uint32_t OP_TYPE_SAMPLED_IMAGE		= 27;
+	const uint32_t OP_TYPE_ARRAY				= 28;
+	const uint32_t OP_TYPE_RUNTIME_ARRAY		= 29;
+	const uint32_t OP_TYPE_STRUCT				= 30;
+	const uint32_t OP_TYPE_POINTER				= 32;
+	const uint32_t OP_CONSTANT					= 43;
+	const uint32_t OP_SPEC_CONSTANT_TRUE		= 48;
+	const uint32_t OP_SPEC_CONSTANT_FALSE		= 49;
+	const uint32_t OP_SPEC_CONSTANT				= 50;
+	const uint32_t OP_FUNCTION					= 54;
+	const uint32_t OP_VARIABLE					= 59;
+	const uint32_t OP_DECORATE					= 71;
+	const uint32_t OP_MEMBER_DECORATE			= 72;
+
+	const uint32_t EXECUTION_MODE_LOCAL_SIZE	= 17;
+
+	const uint32_t DECORATION_SPEC_ID			= 1;
+	const uint32_t DECORATION_BLOCK				= 2;
+	const uint32_t DECORATION_BUFFER_BLOCK		= 3;
+	const uint32_t DECORATION_ARRAY_STRIDE		= 6;
+	const uint32_t DECORATION_MATRIX_STRIDE		= 7;
+	const uint32_t DECORATION_BUILT_IN			= 11;
+	const uint32_t DECORATION_LOCATION			= 30;
+	const uint32_t DECORATION_BINDING			= 33;
+	const uint32_t DECORATION_DESCRIPTOR_SET	= 34;
+	const uint32_t DECORATION_OFFSET			= 35;
+
+	const uint32_t STORAGE_UNIFORM_CONSTANT		= 0;
+	const uint32_t STORAGE_INPUT				= 1;
+	const uint32_t STORAGE_UNIFORM				= 2;
+	const uint32_t STORAGE_PUSH_CONSTANT		= 9;
+	const uint32_t STORAGE_STORAGE_BUFFER		= 12;
+
+	const uint32_t IMAGE_DIM_BUFFER				= 5;
+	const uint32_t IMAGE_DIM_SUBPASS_DATA		= 6;
+
+	const uint32_t NOT_SET						= UINT32_MAX;
+
+	struct SpirvMember
+	{
+		uint32_t	_type			= 0;
+		uint32_t	_offset			= 0;
+		uint32_t	_matrixStride	= 0;
+	};
+
+	// Everything the reflection needs to know about one result id.
+	struct SpirvId
+	{
+		uint32_t					_opcode			= 0;
+		std::string					_name;
+
+		// Types: scalar width and signedness, element type and count for vectors, matrices and arrays.
+		uint32_t					_width			= 0;
+		bool						_isSigned		= false;
+		uint32_t					_elementType	= 0;
+		uint32_t					_elementCount	= 0;
+		uint32_t					_lengthId		= 0;
+		uint32_t					_imageDim		= 0;
+		uint32_t					_imageSampled	= 0;
+		std::vector<SpirvMember>	_members;
+
+		// Pointers and variables.
+		uint32_t					_storageClass	= 0;
+		uint32_t					_type			= 0;
+
+		// Constants: the first value word.
+		uint32_t					_value			= 0;
+
+		// Decorations.
+		uint32_t					_location		= NOT_SET;
+		uint32_t					_set			= NOT_SET;
+		uint32_t					_binding		= NOT_SET;
+		uint32_t					_specId			= NOT_SET;
+		uint32_t					_arrayStride	= 0;
+		bool						_isBuiltIn		= false;
+		bool						_isBlock		= false;
+		bool						_isBufferBlock	= false;
+	};
+
+	std::string readString( const uint32_t* words, const uint32_t wordCount ) noexcept
+	{
+		std::string value;
+
+		for ( uint32_t ii = 0; ii < wordCount; ++ii )
+		{
+			for ( uint32_t byte = 0; byte < 4; ++byte )
+			{
+				const char character = static_cast<char>( ( words[ii] >> ( byte * 8 ) ) & 0xFF );
+				if ( '\0' == character )
+				{
+					return value;
+				}
+
+				value.push_back( character );
+			}
+		}
+
+		return value;
+	}
+
+	VkShaderStageFlagBits getStage( const uint32_t executionModel ) noexcept
+	{
+		switch ( executionModel )
+		{
+		case 0:		return VK_SHADER_STAGE_VERTEX_BIT;
+		case 1:		return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case 2:		return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case 3:		return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case 4:		return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case 5:		return VK_SHADER_STAGE_COMPUTE_BIT;
+		default:	return static_cast<VkShaderStageFlagBits>( 0 );
+		}
+	}
+
+	// 32-bit vertex input formats by scalar kind (float, int, uint) and component count.
+	VkFormat getInputFormat( const SpirvId& scalar, const uint32_t componentCount ) noexcept
+	{
+		static const VkFormat FLOAT_FORMATS[]	= { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		static const VkFormat SINT_FORMATS[]	= { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		static const VkFormat UINT_FORMATS[]	= { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+		if ( ( 32 != scalar._width ) || ( 1 > componentCount ) || ( 4 < componentCount ) )
+		{
+			return VK_FORMAT_UNDEFINED;
+		}
+
+		if ( OP_TYPE_FLOAT == scalar._opcode )
+		{
+			return FLOAT_FORMATS[componentCount - 1];
+		}
+
+		return ( true == scalar._isSigned ) ? SINT_FORMATS[componentCount - 1] : UINT_FORMATS[componentCount - 1];
+	}
+
+	enum class NumericKind
+	{
+		Float,
+		Signed,
+		Unsigned
+	};
+
+	// Normalized and scaled formats are read as floats; only the integer formats are not.
+	NumericKind getNumericKind( const VkFormat format ) noexcept
+	{
+		switch ( format )
+		{
+		case VK_FORMAT_R8_SINT:				case VK_FORMAT_R8G8_SINT:			case VK_FORMAT_R8G8B8A8_SINT:
+		case VK_FORMAT_R16_SINT:			case VK_FORMAT_R16G16_SINT:			case VK_FORMAT_R16G16B16A16_SINT:
+		case VK_FORMAT_R32_SINT:			case VK_FORMAT_R32G32_SINT:			case VK_FORMAT_R32G32B32_SINT:
+		case VK_FORMAT_R32G32B32A32_SINT:
+			return NumericKind::Signed;
+
+		case VK_FORMAT_R8_UINT:				case VK_FORMAT_R8G8_UINT:			case VK_FORMAT_R8G8B8A8_UINT:
+		case VK_FORMAT_R16_UINT:			case VK_FORMAT_R16G16_UINT:			case VK_FORMAT_R16G16B16A16_UINT:
+		case VK_FORMAT_R32_UINT:			case VK_FORMAT_R32G32_UINT:			case VK_FORMAT_R32G32B32_UINT:
+		case VK_FORMAT_R32G32B32A32_UINT:
+			return NumericKind::Unsigned;
+
+		default:
+			return NumericKind::Float;
+		}
+	}
+
+	// Components a vertex format supplies; 0 for formats this does not know, which are not checked.
+	uint32_t getComponentCount( const VkFormat format ) noexcept
+	{
+		switch ( format )
+		{
+		case VK_FORMAT_R8_UNORM:			case VK_FORMAT_R8_SNORM:			case VK_FORMAT_R8_UINT:				case VK_FORMAT_R8_SINT:
+		case VK_FORMAT_R16_UNORM:			case VK_FORMAT_R16_SNORM:			case VK_FORMAT_R16_UINT:			case VK_FORMAT_R16_SINT:
+		case VK_FORMAT_R16_SFLOAT:			case VK_FORMAT_R32_UINT:			case VK_FORMAT_R32_SINT:			case VK_FORMAT_R32_SFLOAT:
+			return 1;
+
+		case VK_FORMAT_R8G8_UNORM:			case VK_FORMAT_R8G8_SNORM:			case VK_FORMAT_R8G8_UINT:			case VK_FORMAT_R8G8_SINT:
+		case VK_FORMAT_R16G16_UNORM:		case VK_FORMAT_R16G16_SNORM:		case VK_FORMAT_R16G16_UINT:			case VK_FORMAT_R16G16_SINT:
+		case VK_FORMAT_R16G16_SFLOAT:		case VK_FORMAT_R32G32_UINT:			case VK_FORMAT_R32G32_SINT:			case VK_FORMAT_R32G32_SFLOAT:
+			return 2;
+
+		case VK_FORMAT_R32G32B32_UINT:		case VK_FORMAT_R32G32B32_SINT:		case VK_FORMAT_R32G32B32_SFLOAT:
+			return 3;
+
+		case VK_FORMAT_R8G8B8A8_UNORM:		case VK_FORMAT_R8G8B8A8_SNORM:		case VK_FORMAT_R8G8B8A8_UINT:		case VK_FORMAT_R8G8B8A8_SINT:
+		case VK_FORMAT_R16G16B16A16_UNORM:	case VK_FORMAT_R16G16B16A16_SNORM:	case VK_FORMAT_R16G16B16A16_UINT:	case VK_FORMAT_R16G16B16A16_SINT:
+		case VK_FORMAT_R16G16B16A16_SFLOAT:	case VK_FORMAT_R32G32B32A32_UINT:	case VK_FORMAT_R32G32B32A32_SINT:	case VK_FORMAT_R32G32B32A32_SFLOAT:
+		case VK_FORMAT_A2B10G10R10_UNORM_PACK32:	case VK_FORMAT_A2B10G10R10_SNORM_PACK32:
+			return 4;
+
+		default:
+			return 0;
+		}
+	}
+
+	// Byte size of a type laid out with explicit offsets and strides, as blocks are.
+	uint32_t getTypeSize( const std::vector<SpirvId>& ids, const uint32_t typeId, const uint32_t matrixStride, const uint32_t depth ) noexcept
+	{
+		if ( ( ids.size() <= typeId ) || ( 16 < depth ) )
+		{
+			return 0;
+		}
+
+		const SpirvId& type = ids[typeId];
+
+		switch ( type._opcode )
+		{
+		case OP_TYPE_BOOL:
+			return 4;
+
+		case OP_TYPE_INT:
+		case OP_TYPE_FLOAT:
+			return type._width / 8;
+
+		case OP_TYPE_VECTOR:
+			return type._elementCount * getTypeSize( ids, type._elementType, 0, depth + 1 );
+
+		case OP_TYPE_MATRIX:
+			return type._elementCount * matrixStride;
+
+		case OP_TYPE_ARRAY:
+			return ( type._lengthId < ids.size() ) ? ids[type._lengthId]._value * type._arrayStride : 0;
+
+		case OP_TYPE_STRUCT:
+			{
+				uint32_t size = 0;
+				for ( const SpirvMember& member : type._members )
+				{
+					size = std::max( size, member._offset + getTypeSize( ids, member._type, member._matrixStride, depth + 1 ) );
+				}
+
+				return size;
+			}
+
+		default:
+			return 0;
+		}
+	}
+}
+
+ShaderReflection::ShaderReflection( void )
+	: _stages{ 0 }
+	, _localSize{ 1, 1, 1 }
+{
+
+}
+
+bool ShaderReflection::reflect( const uint32_t* words, const size_t moduleWordCount ) noexcept
+{
+	*this = ShaderReflection();
+
+	if ( SPIRV_HEADER_WORDS > moduleWordCount )
+	{
+		std::cerr << "spirv: module is shorter than its header" << std::endl;
+		return false;
+	}
+
+	if ( SPIRV_MAGIC != words[0] )
+	{
+		std::cerr << "spirv: bad magic number" << std::endl;
+		return false;
+	}
+
+	const uint32_t bound = words[3];
+	// Every id is defined by an instruction of at least two words, so a larger bound is corrupt.
+	if ( moduleWordCount < bound )
+	{
+		std::cerr << "spirv: implausible id bound " << bound << std::endl;
+		return false;
+	}
+
+	std::vector<SpirvId> ids( bound );
+	std::vector<uint32_t> variables;
+
+	auto isValidId = [bound]( const uint32_t id ) { return id < bound; };
+
+	// Everything the interface needs is declared before the first function body.
+	for ( size_t offset = SPIRV_HEADER_WORDS; offset < moduleWordCount; )
+	{
+		const uint32_t* instruction	= &words[offset];
+		const uint32_t wordCount	= instruction[0] >> 16;
+		const uint32_t opcode		= instruction[0] & 0xFFFF;
+
+		if ( ( 0 == wordCount ) || ( moduleWordCount - offset < wordCount ) )
+		{
+			std::cerr << "spirv: truncated instruction at word " << offset << std::endl;
+			return false;
+		}
+
+		offset += wordCount;
+
+		if ( OP_FUNCTION == opcode )
+		{
+			break;
+		}
+
+		switch ( opcode )
+		{
+		case OP_ENTRY_POINT:
+			if ( 3 <= wordCount )
+			{
+				const VkShaderStageFlagBits stage = getStage( instruction[1] );
+				_entryPoints.push_back( ShaderEntryPoint{ readString( instruction + 3, wordCount - 3 ), stage } );
+				_stages |= stage;
+			}
+			break;
+
+		case OP_EXECUTION_MODE:
+			if ( ( 6 <= wordCount ) && ( EXECUTION_MODE_LOCAL_SIZE == instruction[2] ) )
+			{
+				_localSize = { instruction[3], instruction[4], instruction[5] };
+			}
+			break;
+
+		case OP_NAME:
+			if ( ( 2 <= wordCount ) && ( true == isValidId( instruction[1] ) ) )
+			{
+				ids[instruction[1]]._name = readString( instruction + 2, wordCount - 2 );
+			}
+			break;
+
+		case OP_DECORATE:
+			if ( ( 3 <= wordCount ) && ( true == isValidId( instruction[1] ) ) )
+			{
+				SpirvId& target			= ids[instruction[1]];
+				const uint32_t literal	= ( 4 <= wordCount ) ? instruction[3] : 0;
+
+				switch ( instruction[2] )
+				{
+				case DECORATION_SPEC_ID:			target._specId			= literal;	break;
+				case DECORATION_BLOCK:				target._isBlock			= true;		break;
+				case DECORATION_BUFFER_BLOCK:		target._isBufferBlock	= true;		break;
+				case DECORATION_ARRAY_STRIDE:		target._arrayStride		= literal;	break;
+				case DECORATION_BUILT_IN:			target._isBuiltIn		= true;		break;
+				case DECORATION_LOCATION:			target._location		= literal;	break;
+				case DECORATION_BINDING:			target._binding			= literal;	break;
+				case DECORATION_DESCRIPTOR_SET:		target._set				= literal;	break;
+				default:																break;
+				}
+			}
+			break;
+
+		case OP_MEMBER_DECORATE:
+			if ( ( 5 <= wordCount ) && ( true == isValidId( instruction[1] ) ) && ( 1024 > instruction[2] ) )
+			{
+				std::vector<SpirvMember>& members = ids[instruction[1]]._members;
+				if ( members.size() <= instruction[2] )
+				{
+					members.resize( instruction[2] + 1 );
+				}
+
+				if ( DECORATION_OFFSET == instruction[3] )
+				{
+					members[instruction[2]]._offset			= instruction[4];
+				}
+				else if ( DECORATION_MATRIX_STRIDE == instruction[3] )
+				{
+					members[instruction[2]]._matrixStride	= instruction[4];
+				}
+			}
+			break;
+
+		case OP_TYPE_BOOL:
+		case OP_TYPE_SAMPLER:
+			if ( ( 2 <= wordCount ) && ( true == isValidId( instruction[1] ) ) )
+			{
+				ids[instruction[1]]._opcode = opcode;
+			}
+			break;
+
+		case OP_TYPE_INT:
+		case OP_TYPE_FLOAT:
+			if ( ( 3 <= wordCount ) && ( true == isValidId( instruction[1] ) ) )
+			{
+				SpirvId& type		= ids[instruction[1]];
+				type._opcode		= opcode;
+				type._width			= instruction[2];
+				type._isSigned		= ( OP_TYPE_FLOAT == opcode ) || ( ( 4 <= wordCount ) && ( 0 != instruction[3] ) );
+			}
+			break;
+
+		case OP_TYPE_VECTOR:
+		case OP_TYPE_MATRIX:
+			if ( ( 4 <= wordCount ) && ( true == isValidId( instruction[1] ) ) )
+			{
+				SpirvId& type		= ids[instruction[1]];
+				type._opcode		= opcode;
+				type._elementType	= instruction[2];
+				type._elementCount	= instruction[3];
+			}
+			break;
+
+		case OP_TYPE_IMAGE:
+			if ( ( 8 <= wordCount ) && ( true == isValidId( instruction[1] ) ) )
+			{
+				SpirvId& type		= ids[instruction[1]];
+				type._opcode		= opcode;
+				type._imageDim		= instruction[3];
+				type._imageSampled	= instruction[7];
+			}
+			break;
+
+		case OP_TYPE_SAMPLED_IMAGE:
+		case OP_TYPE_RUNTIME_ARRAY:
+			if ( ( 3 <= wordCount ) && ( true == isValidId( instruction[1] ) ) )
+			{
+				SpirvId& type		= ids[instruction[1]];
+				type._opcode		= opcode;
+				type._elementType	= instruction[2];
+			}
+			break;
+
+		case OP_TYPE_ARRAY:
+			if ( ( 4 <= wordCount ) && ( true == isValidId( instruction[1] ) ) )
+			{
+				SpirvId& type		= ids[instruction[1]];
+				type._opcode		= opcode;
+				type._elementType	= instruction[2];
+				type._lengthId		= instruction[3];
+			}
+			break;
+
+		case OP_TYPE_STRUCT:
+			if ( ( 2 <= wordCount ) && ( true == isValidId( instruction[1] ) ) )
+			{
+				SpirvId& type		= ids[instruction[1]];
+				type._opcode		= opcode;
+
+				// Member decorations may come first, so only the types are filled in here.
+				if ( type._members.size() < wordCount - 2 )
+				{
+					type._members.resize( wordCount - 2 );
+				}
+
+				for ( uint32_t ii = 2; ii < wordCount; ++ii )
+				{
+					type._members[ii - 2]._type = instruction[ii];
+				}
+			}
+			break;
+
+		case OP_TYPE_POINTER:
+			if ( ( 4 <= wordCount ) && ( true == isValidId( instruction[1] ) ) )
+			{
+				SpirvId& type		= ids[instruction[1]];
+				type._opcode		= opcode;
+				type._storageClass	= instruction[2];
+				type._type			= instruction[3];
+			}
+			break;
+
+		case OP_CONSTANT:
+		case OP_SPEC_CONSTANT:
+		case OP_SPEC_CONSTANT_TRUE:
+		case OP_SPEC_CONSTANT_FALSE:
+			if ( ( 3 <= wordCount ) && ( true == isValidId( instruction[2] ) ) )
+			{
+				SpirvId& constant	= ids[instruction[2]];
+				constant._opcode	= opcode;
+				constant._type		= instruction[1];
+				constant._value		= ( 4 <= wordCount ) ? instruction[3] : ( ( OP_SPEC_CONSTANT_TRUE == opcode ) ? 1 : 0 );
+			}
+			break;
+
+		case OP_VARIABLE:
+			if ( ( 4 <= wordCount ) && ( true == isValidId( instruction[2] ) ) )
+			{
+				SpirvId& variable		= ids[instruction[2]];
+				variable._opcode		= opcode;
+				variable._type			= instruction[1];
+				variable._storageClass	= instruction[3];
+				variables.push_back( instruction[2] );
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	if ( true == _entryPoints.empty() )
+	{
+		std::cerr << "spirv: module has no entry point" << std::endl;
+		return false;
+	}
+
+	auto getType = [&ids, bound]( const uint32_t id ) -> const SpirvId&
+	{
+		static const SpirvId NONE;
+		return ( id < bound ) ? ids[id] : NONE;
+	};
+
+	for ( const uint32_t variableId : variables )
+	{
+		const SpirvId& variable	= ids[variableId];
+		const SpirvId& pointer	= getType( variable._type );
+		const SpirvId* type		= &getType( pointer._type );
+
+		if ( ( STORAGE_INPUT == variable._storageClass ) && ( 0 != ( _stages & VK_SHADER_STAGE_VERTEX_BIT ) ) )
+		{
+			if ( ( true == variable._isBuiltIn ) || ( NOT_SET == variable._location ) || ( true == type->_isBlock ) )
+			{
+				continue;
+			}
+
+			// Matrices take one location per column.
+			const uint32_t columnCount	= ( OP_TYPE_MATRIX == type->_opcode ) ? type->_elementCount : 1;
+			const SpirvId& column		= ( OP_TYPE_MATRIX == type->_opcode ) ? getType( type->_elementType ) : *type;
+			const bool isVector			= ( OP_TYPE_VECTOR == column._opcode );
+			const VkFormat format		= getInputFormat( ( true == isVector ) ? getType( column._elementType ) : column, ( true == isVector ) ? column._elementCount : 1 );
+
+			for ( uint32_t ii = 0; ii < columnCount; ++ii )
+			{
+				_inputs.push_back( ShaderInput{ variable._name, variable._location + ii, format } );
+			}
+		}
+		else if ( STORAGE_PUSH_CONSTANT == variable._storageClass )
+		{
+			uint32_t begin	= UINT32_MAX;
+			for ( const SpirvMember& member : type->_members )
+			{
+				begin		= std::min( begin, member._offset );
+			}
+
+			const uint32_t end = getTypeSize( ids, pointer._type, 0, 0 );
+
+			if ( begin < end )
+			{
+				_pushConstantRanges.push_back( VkPushConstantRange{ _stages, begin, end - begin } );
+			}
+		}
+		else if ( ( STORAGE_UNIFORM_CONSTANT == variable._storageClass ) || ( STORAGE_UNIFORM == variable._storageClass ) || ( STORAGE_STORAGE_BUFFER == variable._storageClass ) )
+		{
+			if ( ( NOT_SET == variable._set ) || ( NOT_SET == variable._binding ) )
+			{
+				continue;
+			}
+
+			// Arrays of resources become one binding with a descriptor count; runtime-sized ones get a single descriptor.
+			uint32_t count = 1;
+			if ( OP_TYPE_ARRAY == type->_opcode )
+			{
+				count	= std::max( getType( type->_lengthId )._value, 1u );
+				type	= &getType( type->_elementType );
+			}
+			else if ( OP_TYPE_RUNTIME_ARRAY == type->_opcode )
+			{
+				type	= &getType( type->_elementType );
+			}
+
+			VkDescriptorType descriptorType;
+
+			if ( STORAGE_STORAGE_BUFFER == variable._storageClass )
+			{
+				descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			}
+			else if ( STORAGE_UNIFORM == variable._storageClass )
+			{
+				descriptorType = ( true == type->_isBufferBlock ) ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			}
+			else if ( OP_TYPE_SAMPLED_IMAGE == type->_opcode )
+			{
+				descriptorType = ( IMAGE_DIM_BUFFER == getType( type->_elementType )._imageDim ) ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			}
+			else if ( OP_TYPE_SAMPLER == type->_opcode )
+			{
+				descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+			}
+			else if ( OP_TYPE_IMAGE == type->_opcode )
+			{
+				// Sampled == 2 marks images used without a sampler, i.e. storage images.
+				const bool isStorage = ( 2 == type->_imageSampled );
+
+				if ( IMAGE_DIM_SUBPASS_DATA == type->_imageDim )
+				{
+					descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+				}
+				else if ( IMAGE_DIM_BUFFER == type->_imageDim )
+				{
+					descriptorType = ( true == isStorage ) ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+				}
+				else
+				{
+					descriptorType = ( true == isStorage ) ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+				}
+			}
+			else
+			{
+				std::cerr << "spirv: unsupported resource type for binding " << variable._set << "." << variable._binding << std::endl;
+				continue;
+			}
+
+			_bindings.push_back( ShaderBinding{ variable._name, variable._set, variable._binding, descriptorType, count, _stages } );
+		}
+	}
+
+	for ( const SpirvId& id : ids )
+	{
+		if ( ( NOT_SET != id._specId ) && ( ( OP_SPEC_CONSTANT == id._opcode ) || ( OP_SPEC_CONSTANT_TRUE == id._opcode ) || ( OP_SPEC_CONSTANT_FALSE == id._opcode ) ) )
+		{
+			// Booleans are specialized through a VkBool32.
+			const uint32_t size = std::max( getTypeSize( ids, id._type, 0, 0 ), 4u );
+			_specializationConstants.push_back( ShaderSpecializationConstant{ id._name, id._specId, size, id._value } );
+		}
+	}
+
+	std::sort( _inputs.begin(), _inputs.end(), []( const ShaderInput& lhs, const ShaderInput& rhs ) { return lhs._location < rhs._location; } );
+	std::sort( _bindings.begin(), _bindings.end(), []( const ShaderBinding& lhs, const ShaderBinding& rhs ) { return ( lhs._set < rhs._set ) || ( ( lhs._set == rhs._set ) && ( lhs._binding < rhs._binding ) ); } );
+
+	return true;
+}
+
+void ShaderReflection::merge( const ShaderReflection& other ) noexcept
+{
+	_stages |= other._stages;
+	_entryPoints.insert( _entryPoints.end(), other._entryPoints.begin(), other._entryPoints.end() );
+	_inputs.insert( _inputs.end(), other._inputs.begin(), other._inputs.end() );
+
+	for ( const ShaderBinding& binding : other._bindings )
+	{
+		auto existing = std::find_if( _bindings.begin(), _bindings.end(), [&binding]( const ShaderBinding& candidate ) { return ( candidate._set == binding._set ) && ( candidate._binding == binding._binding ); } );
+
+		if ( _bindings.end() == existing )
+		{
+			_bindings.push_back( binding );
+			continue;
+		}
+
+		if ( ( existing->_type != binding._type ) || ( existing->_count != binding._count ) )
+		{
+			std::cerr << "spirv: stages disagree on binding " << binding._set << "." << binding._binding << std::endl;
+		}
+
+		existing->_stages |= binding._stages;
+	}
+
+	// Stages that share the same block share one range.
+	for ( const VkPushConstantRange& range : other._pushConstantRanges )
+	{
+		auto existing = std::find_if( _pushConstantRanges.begin(), _pushConstantRanges.end(), [&range]( const VkPushConstantRange& candidate ) { return ( candidate.offset == range.offset ) && ( candidate.size == range.size ); } );
+
+		if ( _pushConstantRanges.end() == existing )
+		{
+			_pushConstantRanges.push_back( range );
+		}
+		else
+		{
+			existing->stageFlags |= range.stageFlags;
+		}
+	}
+
+	for ( const ShaderSpecializationConstant& constant : other._specializationConstants )
+	{
+		if ( nullptr == findSpecializationConstant( constant._id ) )
+		{
+			_specializationConstants.push_back( constant );
+		}
+	}
+
+	std::sort( _bindings.begin(), _bindings.end(), []( const ShaderBinding& lhs, const ShaderBinding& rhs ) { return ( lhs._set < rhs._set ) || ( ( lhs._set == rhs._set ) && ( lhs._binding < rhs._binding ) ); } );
+}
+
+bool ShaderReflection::validateVertexInput( const VkVertexInputAttributeDescription* attributes, const uint32_t attributeCount, const uint32_t maxLocations,
+											  const uint64_t expandedLocations ) const noexcept
+{
+	bool isValid = true;
+
+	for ( const ShaderInput& input : _inputs )
+	{
+		if ( maxLocations <= input._location )
+		{
+			std::cerr << "vertex input '" << input._name << "' at location " << input._location << " is beyond the device's " << maxLocations << " vertex attributes" << std::endl;
+			isValid = false;
+			continue;
+		}
+
+		// The mask only covers the first 64 locations.
+		const bool isExpanded = ( input._location < 64 ) && ( 0 != ( expandedLocations & ( 1ull << input._location ) ) );
+
+		const VkVertexInputAttributeDescription* attribute = std::find_if( attributes, attributes + attributeCount, [&input]( const VkVertexInputAttributeDescription& candidate ) { return candidate.location == input._location; } );
+
+		if ( attributes + attributeCount == attribute )
+		{
+			std::cerr << "vertex input '" << input._name << "' at location " << input._location << " has no vertex attribute" << std::endl;
+			isValid = false;
+		}
+		else if ( getNumericKind( attribute->format ) != getNumericKind( input._format ) )
+		{
+			std::cerr << "vertex input '" << input._name << "' at location " << input._location << " reads format " << attribute->format << " as the wrong numeric type" << std::endl;
+			isValid = false;
+		}
+		else if ( ( false == isExpanded ) && ( 0 != getComponentCount( attribute->format ) ) &&
+				  ( getComponentCount( attribute->format ) < getComponentCount( input._format ) ) )
+		{
+			std::cerr << "vertex input '" << input._name << "' at location " << input._location << " reads " << getComponentCount( input._format )
+					  << " components from format " << attribute->format << ", which has " << getComponentCount( attribute->format ) << std::endl;
+			isValid = false;
+		}
+	}
+
+	return isValid;
+}
+
+const ShaderSpecializationConstant* ShaderReflection::findSpecializationConstant( const uint32_t id ) const noexcept
+{
+	for ( const ShaderSpecializationConstant& constant : _specializationConstants )
+	{
+		if ( id == constant._id )
+		{
+			return &constant;
+		}
+	}
+
+	return nullptr;
+}
+
+bool ShaderReflection::makeDynamic( const uint32_t set, const uint32_t binding ) noexcept
+{
+	for ( ShaderBinding& candidate : _bindings )
+	{
+		if ( ( set != candidate._set ) || ( binding != candidate._binding ) )
+		{
+			continue;
+		}
+
+		if ( VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER == candidate._type )
+		{
+			candidate._type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		}
+		else if ( VK_DESCRIPTOR_TYPE_STORAGE_BUFFER == candidate._type )
+		{
+			candidate._type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		}
+
+		return ( VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC == candidate._type ) || ( VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC == candidate._type );
+	}
+
+	return false;
+}
+
+VkShaderStageFlags ShaderReflection::getStages( void ) const noexcept
+{
+	return _stages;
+}
+
+const std::array<uint32_t, 3>& ShaderReflection::getLocalSize( void ) const noexcept
+{
+	return _localSize;
+}
+
+const std::vector<ShaderEntryPoint>& ShaderReflection::getEntryPoints( void ) const noexcept
+{
+	return _entryPoints;
+}
+
+const std::vector<ShaderInput>& ShaderReflection::getInputs( void ) const noexcept
+{
+	return _inputs;
+}
+
+const std::vector<ShaderBinding>& ShaderReflection::getBindings( void ) const noexcept
+{
+	return _bindings;
+}
+
+const std::vector<VkPushConstantRange>& ShaderReflection::getPushConstantRanges( void ) const noexcept
+{
+	return _pushConstantRanges;
+}
+
+const std::vector<ShaderSpecializationConstant>& ShaderReflection::getSpecializationConstants( void ) const noexcept
+{
+	return _specializationConstants;
+}
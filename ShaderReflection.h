@@ -0,0 +1,80 @@
+#pragma once
+
+struct ShaderEntryPoint
+{
+	std::string				_name;
+	VkShaderStageFlagBits	_stage;
+};
+
+struct ShaderInput
+{
+	std::string				_name;
+	uint32_t				_location;
+	VkFormat				_format;
+};
+
+struct ShaderBinding
+{
+	std::string				_name;
+	uint32_t				_set;
+	uint32_t				_binding;
+	VkDescriptorType		_type;
+	uint32_t				_count;
+	VkShaderStageFlags		_stages;
+};
+
+struct ShaderSpecializationConstant
+{
+	std::string				_name;
+	uint32_t				_id;
+	uint32_t				_size;
+	uint32_t				_defaultValue;
+};
+
+// Reads the interface of a SPIR-V module straight from its word stream: entry points, vertex
+// inputs, descriptor bindings, push constant ranges, specialization constants and the workgroup size.
+// Reflections of several stages merge into the interface of a whole pipeline.
+class ShaderReflection
+{
+public:
+
+	// The maxVertexInputAttributes every device supports, for callers without the device's own limit at hand.
+	static const uint32_t	MIN_VERTEX_INPUT_ATTRIBUTES	= 16;
+
+	ShaderReflection( void );
+
+	// The words are read in place, so they must be 4-byte aligned (as a MappedFile is).
+	bool												reflect( const uint32_t* words, const size_t moduleWordCount ) noexcept;
+	void												merge( const ShaderReflection& other ) noexcept;
+
+	// Every input the shader reads needs a location below maxLocations (the device's maxVertexInputAttributes) and an
+	// attribute there with a matching numeric type and at least as many components. Locations set in expandedLocations
+	// may read more; Vulkan fills the missing ones in with 0, and 1 for alpha.
+	bool												validateVertexInput( const VkVertexInputAttributeDescription* attributes, const uint32_t attributeCount, const uint32_t maxLocations,
+																		 const uint64_t expandedLocations = 0 ) const noexcept;
+
+	const ShaderSpecializationConstant*					findSpecializationConstant( const uint32_t id ) const noexcept;
+
+	// SPIR-V does not say whether a buffer is bound with a dynamic offset, so the application marks the ones that are.
+	// Fails when there is no uniform or storage buffer at that binding.
+	bool												makeDynamic( const uint32_t set, const uint32_t binding ) noexcept;
+
+	VkShaderStageFlags									getStages( void ) const noexcept;
+	// A compute shader's literal local_size; 1x1x1 for other stages. Sizes set through specialization are not followed.
+	const std::array<uint32_t, 3>&						getLocalSize( void ) const noexcept;
+	const std::vector<ShaderEntryPoint>&				getEntryPoints( void ) const noexcept;
+	const std::vector<ShaderInput>&						getInputs( void ) const noexcept;
+	const std::vector<ShaderBinding>&					getBindings( void ) const noexcept;
+	const std::vector<VkPushConstantRange>&				getPushConstantRanges( void ) const noexcept;
+	const std::vector<ShaderSpecializationConstant>&	getSpecializationConstants( void ) const noexcept;
+
+private:
+
+	VkShaderStageFlags							_stages;
+	std::array<uint32_t, 3>						_localSize;
+	std::vector<ShaderEntryPoint>				_entryPoints;
+	std::vector<ShaderInput>					_inputs;
+	std::vector<ShaderBinding>					_bindings;
+	std::vector<VkPushConstantRange>			_pushConstantRanges;
+	std::vector<ShaderSpecializationConstant>	_specializationConstants;
+};
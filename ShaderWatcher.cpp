@@ -0,0 +1,264 @@
+#include "pch.h"
+
+#include "ShaderWatcher.h"
+#include "Benchmark.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// One spelling per file, so "./vert.spv" from the code matches "vert.spv" from the directory watch.
+	std::string normalizePath( const std::filesystem::path& path ) noexcept
+	{
+		return path.lexically_normal().string();
+	}
+
+	std::string getDirectory( const std::string& fileName ) noexcept
+	{
+		const std::filesystem::path parent = std::filesystem::path( fileName ).parent_path();
+
+		return ( true == parent.empty() ) ? std::string( "." ) : parent.string();
+	}
+}
+
+ShaderWatcher::ShaderWatcher( void )
+	: _quit{ false }
+#ifdef __linux__
+	, _inotify{ -1 }
+#endif
+{
+
+}
+
+ShaderWatcher::~ShaderWatcher( void )
+{
+	stop();
+}
+
+bool ShaderWatcher::start( const std::vector<WatchedShader>& shaders, const std::string& compiler, const ShaderChangedCallback& callback ) noexcept
+{
+	stop();
+
+	_compiler	= compiler;
+	_callback	= callback;
+	_shaders.clear();
+
+	std::vector<std::string> files;
+
+	for ( const WatchedShader& shader : shaders )
+	{
+		_shaders.push_back( WatchedShader{ normalizePath( shader._source ), normalizePath( shader._binary ) } );
+		files.push_back( _shaders.back()._binary );
+
+		if ( false == _compiler.empty() )
+		{
+			files.push_back( _shaders.back()._source );
+		}
+	}
+
+#ifdef __linux__
+	_inotify = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+	if ( -1 == _inotify )
+	{
+		std::cerr << "shader watcher: inotify is not available" << std::endl;
+		return false;
+	}
+
+	// Directories rather than files, so that editors that save by renaming a new file over the old one are seen.
+	for ( const std::string& file : files )
+	{
+		const std::string directory	= getDirectory( file );
+		const int watch				= inotify_add_watch( _inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO );
+
+		if ( -1 == watch )
+		{
+			std::cerr << "shader watcher: cannot watch " << directory << std::endl;
+			stop();
+			return false;
+		}
+
+		_directories[watch] = directory;
+	}
+#else
+	for ( const std::string& file : files )
+	{
+		std::error_code error;
+		_writeTimes[file] = std::filesystem::last_write_time( file, error );
+	}
+#endif
+
+	_quit	= false;
+	_thread	= std::thread( &ShaderWatcher::watchLoop, this );
+
+	std::cout << "shader watcher: watching " << files.size() << " files" << ( ( true == _compiler.empty() ) ? "" : ", recompiling sources with " ) << _compiler << std::endl;
+
+	return true;
+}
+
+void ShaderWatcher::stop( void ) noexcept
+{
+	_quit = true;
+
+	if ( true == _thread.joinable() )
+	{
+		_thread.join();
+	}
+
+#ifdef __linux__
+	if ( -1 != _inotify )
+	{
+		close( _inotify );
+		_inotify = -1;
+	}
+
+	_directories.clear();
+#else
+	_writeTimes.clear();
+#endif
+}
+
+void ShaderWatcher::watchLoop( void ) noexcept
+{
+	std::set<std::string> changedFiles;
+
+	while ( true == waitForChanges( changedFiles ) )
+	{
+		bool isCompiled	= false;
+		bool isChanged	= false;
+
+		for ( const WatchedShader& shader : _shaders )
+		{
+			if ( ( false == _compiler.empty() ) && ( 0 != changedFiles.count( shader._source ) ) )
+			{
+				const bool isBinaryWritten = compile( shader );
+
+				isCompiled	|= isBinaryWritten;
+				isChanged	|= isBinaryWritten;
+			}
+			else if ( 0 != changedFiles.count( shader._binary ) )
+			{
+				isChanged	= true;
+			}
+		}
+
+		changedFiles.clear();
+
+		// The compiler's own writes to the binaries are already accounted for.
+		if ( true == isCompiled )
+		{
+			collectChanges( 0, changedFiles );
+			changedFiles.clear();
+		}
+
+		if ( true == isChanged )
+		{
+			_callback();
+		}
+	}
+}
+
+bool ShaderWatcher::waitForChanges( std::set<std::string>& changedFiles ) noexcept
+{
+	while ( false == _quit )
+	{
+		collectChanges( POLL_INTERVAL_MS, changedFiles );
+
+		if ( false == changedFiles.empty() )
+		{
+			std::this_thread::sleep_for( std::chrono::milliseconds( SETTLE_MS ) );
+			collectChanges( 0, changedFiles );
+
+			return false == _quit;
+		}
+	}
+
+	return false;
+}
+
+void ShaderWatcher::collectChanges( const uint32_t timeoutMs, std::set<std::string>& changedFiles ) noexcept
+{
+#ifdef __linux__
+	pollfd descriptor{};
+	descriptor.fd		= _inotify;
+	descriptor.events	= POLLIN;
+
+	if ( 0 >= poll( &descriptor, 1, static_cast<int>( timeoutMs ) ) )
+	{
+		return;
+	}
+
+	alignas( inotify_event ) char buffer[4096];
+
+	while ( true )
+	{
+		const ssize_t length = read( _inotify, buffer, sizeof( buffer ) );
+		if ( 0 >= length )
+		{
+			break;
+		}
+
+		for ( ssize_t offset = 0; offset < length; )
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>( buffer + offset );
+			offset += sizeof( inotify_event ) + event->len;
+
+			auto directory = _directories.find( event->wd );
+			if ( ( 0 == event->len ) || ( _directories.end() == directory ) )
+			{
+				continue;
+			}
+
+			const std::string file = normalizePath( std::filesystem::path( directory->second ) / event->name );
+
+			for ( const WatchedShader& shader : _shaders )
+			{
+				if ( ( file == shader._binary ) || ( ( file == shader._source ) && ( false == _compiler.empty() ) ) )
+				{
+					changedFiles.insert( file );
+				}
+			}
+		}
+	}
+#else
+	std::this_thread::sleep_for( std::chrono::milliseconds( timeoutMs ) );
+
+	for ( auto& entry : _writeTimes )
+	{
+		std::error_code error;
+		const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time( entry.first, error );
+
+		// A file that is missing mid-save is picked up once it is back.
+		if ( ( false == static_cast<bool>( error ) ) && ( writeTime != entry.second ) )
+		{
+			entry.second = writeTime;
+			changedFiles.insert( entry.first );
+		}
+	}
+#endif
+}
+
+bool ShaderWatcher::compile( const WatchedShader& shader ) const noexcept
+{
+	const auto begin = std::chrono::steady_clock::now();
+
+	std::string command = "\"" + _compiler + "\" \"" + shader._source + "\" -o \"" + shader._binary + "\"";
+#ifdef _WIN32
+	// cmd.exe strips the outermost pair of quotes.
+	command = "\"" + command + "\"";
+#endif
+
+	const int result = std::system( command.c_str() );
+	if ( 0 != result )
+	{
+		std::cerr << "shader: compiling " << shader._source << " failed (" << result << "), keeping the current pipeline" << std::endl;
+		return false;
+	}
+
+	std::cout << "shader: compiled " << shader._source << " in " << Benchmark::millisecondsSince( begin ) << " ms" << std::endl;
+
+	return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// A GLSL source and the SPIR-V binary compiled from it.
+struct WatchedShader
+{
+	std::string		_source;
+	std::string		_binary;
+};
+
+typedef std::function<void( void )> ShaderChangedCallback;
+
+// Watches shader files on a background thread. When a source changes and a compiler is configured it
+// is recompiled there; whenever a binary changes the callback runs, also on that thread.
+// Linux uses inotify on the containing directories; other platforms poll the modification times.
+class ShaderWatcher
+{
+public:
+
+	ShaderWatcher( void );
+	~ShaderWatcher( void );
+
+	// An empty compiler only reloads binaries that were rebuilt externally (e.g. by compile.bat).
+	bool				start( const std::vector<WatchedShader>& shaders, const std::string& compiler, const ShaderChangedCallback& callback ) noexcept;
+	void				stop( void ) noexcept;
+
+private:
+
+	// Editors save in bursts (write, rename, chmod); changes are collected for this long after the first one.
+	static const uint32_t	SETTLE_MS			= 100;
+	static const uint32_t	POLL_INTERVAL_MS	= 250;
+
+	void				watchLoop( void ) noexcept;
+
+	// Blocks until something changed or stop() was called; fills in the changed files.
+	bool				waitForChanges( std::set<std::string>& changedFiles ) noexcept;
+	void				collectChanges( const uint32_t timeoutMs, std::set<std::string>& changedFiles ) noexcept;
+	bool				compile( const WatchedShader& shader ) const noexcept;
+
+	std::vector<WatchedShader>				_shaders;
+	std::string								_compiler;
+	ShaderChangedCallback					_callback;
+
+	std::thread								_thread;
+	std::atomic<bool>						_quit;
+
+#ifdef __linux__
+	int										_inotify;
+	// Watch descriptor and directory, with the watched file names in it.
+	std::map<int, std::string>				_directories;
+#else
+	std::map<std::string, std::filesystem::file_time_type>	_writeTimes;
+#endif
+};
@@ -0,0 +1,233 @@
+#include "pch.h"
+
+#include "TextParser.h"
+
+#include <charconv>
+#include <clocale>
+
+// Floating-point from_chars came well after C++17 itself; without it, strtod runs under a pinned "C" locale.
+#if !defined( __cpp_lib_to_chars )
+#ifdef _WIN32
+#include <stdlib.h>
+#elif defined( __APPLE__ )
+#include <xlocale.h>
+#else
+#include <locale.h>
+#endif
+#endif
+
+namespace
+{
+	// Every power of ten up to 1e22 is exact in a double, which is what makes the fast path correctly rounded.
+	const double EXACT_POWERS_OF_TEN[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	const uint64_t MAX_EXACT_MANTISSA = uint64_t( 1 ) << 53;
+
+	bool isDigit( const char character ) noexcept
+	{
+		return ( '0' <= character ) && ( character <= '9' );
+	}
+
+	// Correctly rounded and independent of the process locale. A leading '+' has been skipped already.
+	double parseSlow( const char* begin, const char* end, const bool isExponentPositive ) noexcept
+	{
+#if defined( __cpp_lib_to_chars )
+		double value						= 0.0;
+		const std::from_chars_result result	= std::from_chars( begin, end, value );
+
+		if ( std::errc::result_out_of_range == result.ec )
+		{
+			// Overflow and underflow, as strtod would report them.
+			const bool isNegative			= ( '-' == *begin );
+			value							= ( true == isExponentPositive ) ? HUGE_VAL : 0.0;
+			value							= ( true == isNegative ) ? -value : value;
+		}
+
+		return value;
+#else
+		// strtod reports overflow and underflow itself.
+		( void )isExponentPositive;
+
+#ifdef _WIN32
+		static const _locale_t cLocale		= _create_locale( LC_ALL, "C" );
+		const std::string token( begin, end );
+		return _strtod_l( token.c_str(), nullptr, cLocale );
+#else
+		static const locale_t cLocale		= newlocale( LC_ALL_MASK, "C", static_cast<locale_t>( 0 ) );
+		const std::string token( begin, end );
+		return strtod_l( token.c_str(), nullptr, cLocale );
+#endif
+#endif
+	}
+}
+
+const char* TextParser::skipSpaces( const char* cursor, const char* end ) noexcept
+{
+	while ( ( cursor < end ) && ( ( ' ' == *cursor ) || ( '\t' == *cursor ) || ( '\r' == *cursor ) ) )
+	{
+		++cursor;
+	}
+
+	return cursor;
+}
+
+const char* TextParser::skipLine( const char* cursor, const char* end ) noexcept
+{
+	const char* newLine = static_cast<const char*>( memchr( cursor, '\n', static_cast<size_t>( end - cursor ) ) );
+
+	return ( nullptr == newLine ) ? end : newLine + 1;
+}
+
+const char* TextParser::parseDouble( const char* cursor, const char* end, double& value ) noexcept
+{
+	const char* position	= cursor;
+	bool isNegative			= false;
+
+	if ( ( position < end ) && ( ( '-' == *position ) || ( '+' == *position ) ) )
+	{
+		isNegative			= ( '-' == *position );
+		++position;
+	}
+
+	// Up to 19 significant digits fit a uint64_t; anything past that only shifts the exponent.
+	uint64_t mantissa		= 0;
+	int32_t digitCount		= 0;
+	int32_t exponent		= 0;
+	bool hasDigits			= false;
+	bool isTruncated		= false;
+
+	for ( ; ( position < end ) && ( true == isDigit( *position ) ); ++position )
+	{
+		hasDigits			= true;
+
+		if ( ( 0 == mantissa ) && ( '0' == *position ) )
+		{
+			continue;
+		}
+
+		if ( 19 > digitCount )
+		{
+			mantissa		= mantissa * 10 + static_cast<uint64_t>( *position - '0' );
+			++digitCount;
+		}
+		else
+		{
+			++exponent;
+			isTruncated		= isTruncated || ( '0' != *position );
+		}
+	}
+
+	if ( ( position < end ) && ( '.' == *position ) )
+	{
+		for ( ++position; ( position < end ) && ( true == isDigit( *position ) ); ++position )
+		{
+			hasDigits		= true;
+
+			if ( ( 0 == mantissa ) && ( '0' == *position ) )
+			{
+				--exponent;
+			}
+			else if ( 19 > digitCount )
+			{
+				mantissa	= mantissa * 10 + static_cast<uint64_t>( *position - '0' );
+				++digitCount;
+				--exponent;
+			}
+			else
+			{
+				isTruncated	= isTruncated || ( '0' != *position );
+			}
+		}
+	}
+
+	if ( false == hasDigits )
+	{
+		return nullptr;
+	}
+
+	if ( ( position < end ) && ( ( 'e' == *position ) || ( 'E' == *position ) ) )
+	{
+		const char* exponentBegin	= position + 1;
+		bool isExponentNegative		= false;
+
+		if ( ( exponentBegin < end ) && ( ( '-' == *exponentBegin ) || ( '+' == *exponentBegin ) ) )
+		{
+			isExponentNegative		= ( '-' == *exponentBegin );
+			++exponentBegin;
+		}
+
+		// A bare 'e' is left for the caller, like strtod does.
+		if ( ( exponentBegin < end ) && ( true == isDigit( *exponentBegin ) ) )
+		{
+			int32_t explicitExponent = 0;
+
+			for ( position = exponentBegin; ( position < end ) && ( true == isDigit( *position ) ); ++position )
+			{
+				explicitExponent	= std::min( explicitExponent * 10 + ( *position - '0' ), 100000 );
+			}
+
+			exponent				+= ( true == isExponentNegative ) ? -explicitExponent : explicitExponent;
+		}
+	}
+
+	if ( 0 == mantissa )
+	{
+		value				= ( true == isNegative ) ? -0.0 : 0.0;
+		return position;
+	}
+
+	if ( ( false == isTruncated ) && ( mantissa <= MAX_EXACT_MANTISSA ) && ( -22 <= exponent ) && ( exponent <= 22 ) )
+	{
+		const double significand	= static_cast<double>( mantissa );
+		value						= ( 0 > exponent ) ? significand / EXACT_POWERS_OF_TEN[-exponent] : significand * EXACT_POWERS_OF_TEN[exponent];
+		value						= ( true == isNegative ) ? -value : value;
+		return position;
+	}
+
+	// Rare in mesh data: hand the token to the slow path for correct rounding.
+	value					= parseSlow( ( '+' == *cursor ) ? cursor + 1 : cursor, position, 0 < exponent );
+
+	return position;
+}
+
+const char* TextParser::parseFloat( const char* cursor, const char* end, float& value ) noexcept
+{
+	double result		= 0.0;
+	const char* next	= parseDouble( cursor, end, result );
+
+	value				= static_cast<float>( result );
+
+	return next;
+}
+
+const char* TextParser::parseInt( const char* cursor, const char* end, int32_t& value ) noexcept
+{
+	const char* position	= cursor;
+	bool isNegative			= false;
+
+	if ( ( position < end ) && ( ( '-' == *position ) || ( '+' == *position ) ) )
+	{
+		isNegative			= ( '-' == *position );
+		++position;
+	}
+
+	if ( ( position >= end ) || ( false == isDigit( *position ) ) )
+	{
+		return nullptr;
+	}
+
+	int64_t result			= 0;
+
+	for ( ; ( position < end ) && ( true == isDigit( *position ) ); ++position )
+	{
+		result				= std::min<int64_t>( result * 10 + ( *position - '0' ), INT32_MAX );
+	}
+
+	value					= static_cast<int32_t>( ( true == isNegative ) ? -result : result );
+
+	return position;
+}
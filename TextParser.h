@@ -0,0 +1,15 @@
+#pragma once
+
+// Locale-independent scanning over [cursor, end) ranges that need not be null-terminated.
+// The parse functions return the position just past what they consumed, or nullptr if nothing matched.
+class TextParser
+{
+public:
+
+	static const char*	skipSpaces( const char* cursor, const char* end ) noexcept;
+	static const char*	skipLine( const char* cursor, const char* end ) noexcept;
+
+	static const char*	parseDouble( const char* cursor, const char* end, double& value ) noexcept;
+	static const char*	parseFloat( const char* cursor, const char* end, float& value ) noexcept;
+	static const char*	parseInt( const char* cursor, const char* end, int32_t& value ) noexcept;
+};
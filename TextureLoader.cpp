@@ -0,0 +1,355 @@
+#include "pch.h"
+
+#include "TextureLoader.h"
+#include "Benchmark.h"
+
+namespace
+{
+	const unsigned char KTX2_IDENTIFIER[12]	= { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	const size_t KTX2_HEADER_SIZE			= 80;
+	const size_t KTX2_LEVEL_SIZE			= 24;
+
+	const size_t TGA_HEADER_SIZE			= 18;
+	const uint8_t TGA_TRUECOLOR				= 2;
+	const uint8_t TGA_TRUECOLOR_RLE			= 10;
+	const uint8_t TGA_TOP_LEFT				= 0x20;
+
+	bool hasExtension( const std::string& fileName, const char* extension ) noexcept
+	{
+		const size_t length = strlen( extension );
+
+		if ( fileName.size() < length )
+		{
+			return false;
+		}
+
+		return std::equal( extension, extension + length, fileName.end() - length, []( const char lhs, const char rhs )
+		{
+			return std::tolower( static_cast<unsigned char>( lhs ) ) == std::tolower( static_cast<unsigned char>( rhs ) );
+		} );
+	}
+
+	template<typename T>
+	T read( const unsigned char* bytes, const size_t offset ) noexcept
+	{
+		T value;
+		memcpy( &value, bytes + offset, sizeof( value ) );
+		return value;
+	}
+
+	size_t getLevelSize( const VkExtent2D extent, const TextureFormatInfo& info ) noexcept
+	{
+		const size_t blocksWide		= ( extent.width + info._blockWidth - 1 ) / info._blockWidth;
+		const size_t blocksHigh		= ( extent.height + info._blockHeight - 1 ) / info._blockHeight;
+
+		return blocksWide * blocksHigh * info._blockBytes;
+	}
+
+	VkExtent2D getLevelExtent( const VkExtent2D extent, const uint32_t level ) noexcept
+	{
+		return { std::max( extent.width >> level, 1u ), std::max( extent.height >> level, 1u ) };
+	}
+}
+
+const unsigned char* TextureData::getLevelData( const uint32_t level ) const noexcept
+{
+	return _data + _levels[level]._offset;
+}
+
+bool TextureLoader::load( const std::string& fileName, TextureData& texture ) noexcept
+{
+	const auto begin = std::chrono::steady_clock::now();
+
+	if ( FileError::None != File::map( fileName, texture._file ) )
+	{
+		return false;
+	}
+
+	const unsigned char* bytes	= reinterpret_cast<const unsigned char*>( texture._file.getData() );
+	const size_t size			= texture._file.getSize();
+	texture._fileBytes			= size;
+
+	bool isLoaded				= false;
+
+	if ( true == hasExtension( fileName, ".ktx2" ) )
+	{
+		isLoaded				= loadKtx2( bytes, size, texture );
+	}
+	else if ( true == hasExtension( fileName, ".tga" ) )
+	{
+		isLoaded				= loadTga( bytes, size, texture );
+
+		// The decoded pixels are all that is needed from here on.
+		texture._file.close();
+	}
+	else
+	{
+		std::cerr << "unsupported texture format: " << fileName << std::endl;
+		return false;
+	}
+
+	if ( false == isLoaded )
+	{
+		std::cerr << "failed to load texture " << fileName << std::endl;
+		return false;
+	}
+
+	texture._decodeMs			= Benchmark::millisecondsSince( begin );
+
+	return true;
+}
+
+void TextureLoader::makeSolid( const uint8_t red, const uint8_t green, const uint8_t blue, const uint8_t alpha, TextureData& texture ) noexcept
+{
+	texture._format			= VK_FORMAT_R8G8B8A8_UNORM;
+	texture._extent			= { 1, 1 };
+	texture._pixels			= { red, green, blue, alpha };
+	texture._data			= texture._pixels.data();
+	texture._levels			= { TextureLevel{ texture._extent, 0, 4 } };
+	texture._generateMips	= false;
+}
+
+bool TextureLoader::getFormatInfo( const VkFormat format, TextureFormatInfo& info ) noexcept
+{
+	switch ( format )
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+		info = { 1, 1, 4, false };
+		return true;
+
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC4_SNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+	case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+	case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+		info = { 4, 4, 8, true };
+		return true;
+
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC5_SNORM_BLOCK:
+	case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+	case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+	case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+	case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+		info = { 4, 4, 16, true };
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+uint32_t TextureLoader::getMipLevelCount( const VkExtent2D extent ) noexcept
+{
+	uint32_t count		= 1;
+	uint32_t largest	= std::max( extent.width, extent.height );
+
+	while ( 1 < largest )
+	{
+		largest >>= 1;
+		++count;
+	}
+
+	return count;
+}
+
+bool TextureLoader::loadKtx2( const unsigned char* bytes, const size_t size, TextureData& texture ) noexcept
+{
+	if ( ( size < KTX2_HEADER_SIZE ) || ( 0 != memcmp( bytes, KTX2_IDENTIFIER, sizeof( KTX2_IDENTIFIER ) ) ) )
+	{
+		std::cerr << "ktx2: not a KTX 2.0 file" << std::endl;
+		return false;
+	}
+
+	const VkFormat format				= static_cast<VkFormat>( read<uint32_t>( bytes, 12 ) );
+	const uint32_t width				= read<uint32_t>( bytes, 20 );
+	const uint32_t height				= read<uint32_t>( bytes, 24 );
+	const uint32_t depth				= read<uint32_t>( bytes, 28 );
+	const uint32_t layerCount			= read<uint32_t>( bytes, 32 );
+	const uint32_t faceCount			= read<uint32_t>( bytes, 36 );
+	const uint32_t levelCount			= read<uint32_t>( bytes, 40 );
+	const uint32_t supercompression		= read<uint32_t>( bytes, 44 );
+
+	// The payload goes to the GPU as it is, so it has to be in a format the device samples directly.
+	TextureFormatInfo info;
+
+	if ( false == getFormatInfo( format, info ) )
+	{
+		std::cerr << "ktx2: unsupported format " << format << "; BCn, ETC2/EAC and 8-bit RGBA are" << std::endl;
+		return false;
+	}
+
+	if ( 0 != supercompression )
+	{
+		std::cerr << "ktx2: supercompressed payloads (Basis, zstd) are not supported" << std::endl;
+		return false;
+	}
+
+	if ( ( 0 == width ) || ( 0 == height ) || ( 0 != depth ) || ( 1 < layerCount ) || ( 1 != faceCount ) )
+	{
+		std::cerr << "ktx2: only single 2D images are supported" << std::endl;
+		return false;
+	}
+
+	texture._format						= format;
+	texture._extent						= { width, height };
+
+	// A level count of 0 asks the loader to generate the chain, which the GPU can only do for uncompressed data.
+	const uint32_t storedLevels			= std::max( levelCount, 1u );
+
+	if ( ( storedLevels > getMipLevelCount( texture._extent ) ) || ( size < KTX2_HEADER_SIZE + storedLevels * KTX2_LEVEL_SIZE ) )
+	{
+		std::cerr << "ktx2: bad level index" << std::endl;
+		return false;
+	}
+
+	texture._levels.resize( storedLevels );
+
+	for ( uint32_t ii = 0; ii < storedLevels; ++ii )
+	{
+		const size_t entry				= KTX2_HEADER_SIZE + ii * KTX2_LEVEL_SIZE;
+		const uint64_t offset			= read<uint64_t>( bytes, entry );
+		const uint64_t length			= read<uint64_t>( bytes, entry + 8 );
+
+		TextureLevel& level				= texture._levels[ii];
+		level._extent					= getLevelExtent( texture._extent, ii );
+		level._offset					= static_cast<size_t>( offset );
+		level._size						= getLevelSize( level._extent, info );
+
+		if ( ( length != level._size ) || ( size < offset ) || ( size - offset < length ) )
+		{
+			std::cerr << "ktx2: level " << ii << " is truncated or has the wrong size" << std::endl;
+			return false;
+		}
+	}
+
+	texture._data						= bytes;
+	texture._generateMips				= ( 1 == storedLevels ) && ( false == info._isCompressed ) && ( 1 < getMipLevelCount( texture._extent ) );
+
+	return true;
+}
+
+bool TextureLoader::loadTga( const unsigned char* bytes, const size_t size, TextureData& texture ) noexcept
+{
+	if ( size < TGA_HEADER_SIZE )
+	{
+		std::cerr << "tga: truncated header" << std::endl;
+		return false;
+	}
+
+	const uint8_t idLength			= bytes[0];
+	const uint8_t colorMapType		= bytes[1];
+	const uint8_t imageType			= bytes[2];
+	const uint32_t width			= read<uint16_t>( bytes, 12 );
+	const uint32_t height			= read<uint16_t>( bytes, 14 );
+	const uint32_t bitsPerPixel		= bytes[16];
+	const uint8_t descriptor		= bytes[17];
+
+	if ( ( 0 != colorMapType ) || ( ( TGA_TRUECOLOR != imageType ) && ( TGA_TRUECOLOR_RLE != imageType ) ) || ( ( 24 != bitsPerPixel ) && ( 32 != bitsPerPixel ) ) )
+	{
+		std::cerr << "tga: only 24 and 32-bit true-color images are supported" << std::endl;
+		return false;
+	}
+
+	if ( ( 0 == width ) || ( 0 == height ) )
+	{
+		std::cerr << "tga: empty image" << std::endl;
+		return false;
+	}
+
+	const size_t texelCount			= static_cast<size_t>( width ) * height;
+	const size_t sourceBytes		= bitsPerPixel / 8;
+	const unsigned char* source		= bytes + TGA_HEADER_SIZE + idLength;
+	const unsigned char* end		= bytes + size;
+
+	texture._pixels.resize( texelCount * 4 );
+
+	// Texels are stored BGR(A); run-length packets repeat one texel, raw packets list them.
+	auto copyTexel = [&texture, sourceBytes]( const unsigned char* from, const size_t texel )
+	{
+		unsigned char* to	= texture._pixels.data() + texel * 4;
+		to[0]				= from[2];
+		to[1]				= from[1];
+		to[2]				= from[0];
+		to[3]				= ( 4 == sourceBytes ) ? from[3] : 255;
+	};
+
+	size_t texel = 0;
+
+	while ( texel < texelCount )
+	{
+		size_t runLength			= texelCount;
+		bool isRun					= false;
+
+		if ( TGA_TRUECOLOR_RLE == imageType )
+		{
+			if ( end <= source )
+			{
+				break;
+			}
+
+			isRun					= 0 != ( *source & 0x80 );
+			runLength				= ( *source & 0x7F ) + 1u;
+			++source;
+		}
+
+		runLength					= std::min( runLength, texelCount - texel );
+		const size_t packetBytes	= ( true == isRun ) ? sourceBytes : runLength * sourceBytes;
+
+		if ( static_cast<size_t>( end - source ) < packetBytes )
+		{
+			break;
+		}
+
+		for ( size_t ii = 0; ii < runLength; ++ii )
+		{
+			copyTexel( ( true == isRun ) ? source : source + ii * sourceBytes, texel + ii );
+		}
+
+		source						+= packetBytes;
+		texel						+= runLength;
+	}
+
+	if ( texel < texelCount )
+	{
+		std::cerr << "tga: truncated pixel data" << std::endl;
+		return false;
+	}
+
+	// Rows are stored bottom-up unless the descriptor says otherwise.
+	if ( 0 == ( descriptor & TGA_TOP_LEFT ) )
+	{
+		const size_t rowBytes		= static_cast<size_t>( width ) * 4;
+
+		for ( uint32_t row = 0; row < height / 2; ++row )
+		{
+			std::swap_ranges( texture._pixels.begin() + row * rowBytes, texture._pixels.begin() + ( row + 1 ) * rowBytes, texture._pixels.end() - ( row + 1 ) * rowBytes );
+		}
+	}
+
+	texture._format					= VK_FORMAT_R8G8B8A8_SRGB;
+	texture._extent					= { width, height };
+	texture._data					= texture._pixels.data();
+	texture._levels					= { TextureLevel{ texture._extent, 0, texture._pixels.size() } };
+	texture._generateMips			= 1 < getMipLevelCount( texture._extent );
+
+	return true;
+}
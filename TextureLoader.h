@@ -0,0 +1,61 @@
+#pragma once
+
+#include "File.h"
+
+// Texels or blocks of a format: uncompressed formats are 1x1 blocks of one texel.
+struct TextureFormatInfo
+{
+	uint32_t	_blockWidth		= 1;
+	uint32_t	_blockHeight	= 1;
+	uint32_t	_blockBytes		= 0;
+	bool		_isCompressed	= false;
+};
+
+struct TextureLevel
+{
+	VkExtent2D		_extent;
+	// Into TextureData::getData(); tightly packed rows of blocks.
+	size_t			_offset;
+	size_t			_size;
+};
+
+// A decoded texture: level 0 is the largest. Block-compressed payloads point into the mapped file and are
+// uploaded as they are; other sources are decoded into _pixels.
+struct TextureData
+{
+	VkFormat					_format				= VK_FORMAT_UNDEFINED;
+	VkExtent2D					_extent				= {};
+	std::vector<TextureLevel>	_levels;
+	// Only level 0 came with the source; the rest of the chain is generated on the GPU.
+	bool						_generateMips		= false;
+
+	MappedFile					_file;
+	std::vector<unsigned char>	_pixels;
+	const unsigned char*		_data				= nullptr;
+
+	uint64_t					_fileBytes			= 0;
+	double						_decodeMs			= 0.0;
+
+	const unsigned char*		getLevelData( const uint32_t level ) const noexcept;
+};
+
+// Reads KTX2 files with BCn, ETC2 or 8-bit RGBA payloads and uncompressed or RLE TGA files. Safe to run on
+// any thread; nothing here touches the device.
+class TextureLoader
+{
+public:
+
+	static bool		load( const std::string& fileName, TextureData& texture ) noexcept;
+
+	// A single texel of the given color, for use until a texture is resident.
+	static void		makeSolid( const uint8_t red, const uint8_t green, const uint8_t blue, const uint8_t alpha, TextureData& texture ) noexcept;
+
+	// False for formats the loader does not know.
+	static bool		getFormatInfo( const VkFormat format, TextureFormatInfo& info ) noexcept;
+	static uint32_t	getMipLevelCount( const VkExtent2D extent ) noexcept;
+
+private:
+
+	static bool		loadKtx2( const unsigned char* bytes, const size_t size, TextureData& texture ) noexcept;
+	static bool		loadTga( const unsigned char* bytes, const size_t size, TextureData& texture ) noexcept;
+};
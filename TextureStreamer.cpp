@@ -0,0 +1,713 @@
+#include "pch.h"
+
+#include "TextureStreamer.h"
+#include "JobSystem.h"
+#include "Benchmark.h"
+
+namespace
+{
+	// Offsets into the staging buffer suit every block size and optimalBufferCopyOffsetAlignment in practice.
+	const VkDeviceSize STAGING_ALIGNMENT	= 16;
+
+	VkDeviceSize alignUp( const VkDeviceSize value, const VkDeviceSize alignment ) noexcept
+	{
+		return ( value + alignment - 1 ) / alignment * alignment;
+	}
+}
+
+double TextureStreamingStatistics::getUploadMegabytesPerSecond( void ) const noexcept
+{
+	return ( 0.0 < _uploadMs ) ? ( static_cast<double>( _uploadedBytes ) / ( 1024.0 * 1024.0 ) ) / ( _uploadMs / 1000.0 ) : 0.0;
+}
+
+TextureStreamer::TextureStreamer( void )
+	: _physicalDevice{ VK_NULL_HANDLE }
+	, _device{ VK_NULL_HANDLE }
+	, _allocator{ nullptr }
+	, _jobSystem{ nullptr }
+	, _setLayout{ VK_NULL_HANDLE }
+	, _binding{ 0 }
+	, _frameCount{ 0 }
+	, _sampler{ VK_NULL_HANDLE }
+	, _descriptorPool{ VK_NULL_HANDLE }
+	, _stagingBuffer{ VK_NULL_HANDLE }
+	, _stagingBytesPerFrame{ 0 }
+	, _stagingCursor{ 0 }
+	, _memoryBudget{ 0 }
+	, _residentBytes{ 0 }
+	, _peakResidentBytes{ 0 }
+	, _uploadedBytes{ 0 }
+	, _generatedLevelCount{ 0 }
+	, _hasUploaded{ false }
+{
+
+}
+
+bool TextureStreamer::create( const VkPhysicalDevice physicalDevice, const VkDevice device, MemoryAllocator& allocator, JobSystem& jobSystem,
+							  const VkDescriptorSetLayout setLayout, const uint32_t binding, const uint32_t frameCount,
+							  const VkDeviceSize stagingBytesPerFrame, const VkDeviceSize memoryBudget ) noexcept
+{
+	_physicalDevice			= physicalDevice;
+	_device					= device;
+	_allocator				= &allocator;
+	_jobSystem				= &jobSystem;
+	_setLayout				= setLayout;
+	_binding				= binding;
+	_frameCount				= frameCount;
+	_stagingBytesPerFrame	= alignUp( stagingBytesPerFrame, STAGING_ALIGNMENT );
+	_memoryBudget			= memoryBudget;
+	_frames.resize( frameCount );
+
+	if ( false == _allocator->createBuffer( _stagingBytesPerFrame * frameCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _stagingBuffer, _stagingAllocation ) )
+	{
+		std::cerr << "texture streamer: failed to create the staging buffer" << std::endl;
+		return false;
+	}
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType				= VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter			= VK_FILTER_LINEAR;
+	samplerInfo.minFilter			= VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode			= VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU		= VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV		= VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW		= VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.maxLod				= VK_LOD_CLAMP_NONE;
+
+	if ( VK_SUCCESS != vkCreateSampler( _device, &samplerInfo, nullptr, &_sampler ) )
+	{
+		return false;
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type					= VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount		= MAX_TEXTURES * frameCount;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType					= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets				= MAX_TEXTURES * frameCount;
+	poolInfo.poolSizeCount			= 1;
+	poolInfo.pPoolSizes				= &poolSize;
+
+	if ( VK_SUCCESS != vkCreateDescriptorPool( _device, &poolInfo, nullptr, &_descriptorPool ) )
+	{
+		return false;
+	}
+
+	// The default texture goes through the same path as the rest, and is resident after the first frame.
+	if ( DEFAULT_TEXTURE != load( std::string() ) )
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void TextureStreamer::destroy( void ) noexcept
+{
+	if ( nullptr == _allocator )
+	{
+		return;
+	}
+
+	// The decodes have to finish before their textures go away.
+	_jobSystem->waitBackground();
+
+	for ( std::unique_ptr<Texture>& texture : _textures )
+	{
+		destroyImage( texture->_promotion._target );
+		destroyImage( texture->_current );
+	}
+
+	_textures.clear();
+
+	// Freeing the pool frees the sets with it.
+	vkDestroyDescriptorPool( _device, _descriptorPool, nullptr );
+	vkDestroySampler( _device, _sampler, nullptr );
+	_allocator->destroyBuffer( _stagingBuffer, _stagingAllocation );
+
+	_descriptorPool		= VK_NULL_HANDLE;
+	_sampler			= VK_NULL_HANDLE;
+	_allocator			= nullptr;
+}
+
+TextureHandle TextureStreamer::load( const std::string& fileName ) noexcept
+{
+	if ( MAX_TEXTURES <= _textures.size() )
+	{
+		std::cerr << "texture streamer: more than " << MAX_TEXTURES << " textures, showing " << fileName << " as the default" << std::endl;
+		return DEFAULT_TEXTURE;
+	}
+
+	std::unique_ptr<Texture> texture	= std::make_unique<Texture>();
+	texture->_fileName					= fileName;
+	texture->_loadTime					= std::chrono::steady_clock::now();
+	texture->_descriptorSets.resize( _frameCount, VK_NULL_HANDLE );
+	texture->_writtenViews.resize( _frameCount, VK_NULL_HANDLE );
+
+	const std::vector<VkDescriptorSetLayout> setLayouts( _frameCount, _setLayout );
+
+	VkDescriptorSetAllocateInfo allocateInfo{};
+	allocateInfo.sType					= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool			= _descriptorPool;
+	allocateInfo.descriptorSetCount		= _frameCount;
+	allocateInfo.pSetLayouts			= setLayouts.data();
+
+	if ( VK_SUCCESS != vkAllocateDescriptorSets( _device, &allocateInfo, texture->_descriptorSets.data() ) )
+	{
+		std::cerr << "texture streamer: failed to allocate descriptor sets for " << fileName << std::endl;
+		return DEFAULT_TEXTURE;
+	}
+
+	if ( true == fileName.empty() )
+	{
+		TextureLoader::makeSolid( 255, 255, 255, 255, texture->_data );
+		texture->_isDecoded				= true;
+		texture->_isDecodeDone			= true;
+	}
+	else
+	{
+		// A decode outlives many frames of jobs, so it stays out of the job ring. The task only sees the texture,
+		// which stays put in its unique_ptr.
+		Texture* decoded				= texture.get();
+
+		_jobSystem->runBackground( [decoded]()
+		{
+			decoded->_isDecoded			= TextureLoader::load( decoded->_fileName, decoded->_data );
+			decoded->_isDecodeDone.store( true, std::memory_order_release );
+		} );
+	}
+
+	_textures.push_back( std::move( texture ) );
+
+	return static_cast<TextureHandle>( _textures.size() - 1 );
+}
+
+void TextureStreamer::beginFrame( const uint32_t frame, const uint64_t frameNumber, DeletionQueue& deletionQueue ) noexcept
+{
+	FrameUploads& uploads	= _frames[frame];
+	uploads._startBarriers.clear();
+	uploads._levelCopies.clear();
+	uploads._bufferCopies.clear();
+	uploads._mipChains.clear();
+	uploads._finishBarriers.clear();
+
+	_stagingCursor			= 0;
+
+	pollDecodes();
+
+	// In load order, so the first textures finish first instead of all of them crawling in together.
+	for ( std::unique_ptr<Texture>& texture : _textures )
+	{
+		if ( ( TextureState::Streaming == texture->_state ) && ( false == stream( *texture, frame, frameNumber, deletionQueue ) ) )
+		{
+			break;
+		}
+	}
+
+	updateDescriptorSets( frame );
+}
+
+void TextureStreamer::pollDecodes( void ) noexcept
+{
+	for ( std::unique_ptr<Texture>& texture : _textures )
+	{
+		if ( TextureState::Decoding != texture->_state )
+		{
+			continue;
+		}
+
+		if ( false == texture->_isDecodeDone.load( std::memory_order_acquire ) )
+		{
+			continue;
+		}
+
+		if ( ( false == texture->_isDecoded ) || ( false == checkFormat( *texture ) ) )
+		{
+			texture->_state		= TextureState::Failed;
+			continue;
+		}
+
+		texture->_levelCount	= ( true == texture->_data._generateMips ) ? TextureLoader::getMipLevelCount( texture->_data._extent ) : static_cast<uint32_t>( texture->_data._levels.size() );
+		texture->_current._firstLevel = texture->_levelCount;
+		texture->_state			= TextureState::Streaming;
+	}
+}
+
+bool TextureStreamer::checkFormat( Texture& texture ) const noexcept
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties( _physicalDevice, &properties );
+
+	if ( ( properties.limits.maxImageDimension2D < texture._data._extent.width ) || ( properties.limits.maxImageDimension2D < texture._data._extent.height ) )
+	{
+		std::cerr << "texture " << texture._fileName << " is larger than the device supports" << std::endl;
+		return false;
+	}
+
+	// BCn is a desktop feature and ETC2 a mobile one; there is no transcoding to fall back on.
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties( _physicalDevice, texture._data._format, &formatProperties );
+
+	const VkFormatFeatureFlags sampled	= VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	const VkFormatFeatureFlags blit		= VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+
+	if ( sampled != ( formatProperties.optimalTilingFeatures & sampled ) )
+	{
+		std::cerr << "texture " << texture._fileName << ": the device cannot sample format " << texture._data._format << std::endl;
+		return false;
+	}
+
+	if ( ( true == texture._data._generateMips ) && ( blit != ( formatProperties.optimalTilingFeatures & blit ) ) )
+	{
+		std::cerr << "texture " << texture._fileName << ": the device cannot blit format " << texture._data._format << ", using the top level only" << std::endl;
+		texture._data._generateMips = false;
+	}
+
+	return true;
+}
+
+bool TextureStreamer::stream( Texture& texture, const uint32_t frame, const uint64_t frameNumber, DeletionQueue& deletionQueue ) noexcept
+{
+	FrameUploads& uploads		= _frames[frame];
+	Promotion& promotion		= texture._promotion;
+
+	if ( ( false == promotion._isActive ) && ( false == beginPromotion( texture, uploads ) ) )
+	{
+		return true;
+	}
+
+	TextureFormatInfo info;
+	TextureLoader::getFormatInfo( texture._data._format, info );
+
+	const VkDeviceSize frameBase	= _stagingBytesPerFrame * frame;
+
+	// Whole rows of blocks, as many as this frame's staging slice still holds.
+	while ( promotion._level < promotion._uploadEnd )
+	{
+		const TextureLevel& level	= texture._data._levels[promotion._level];
+		const uint32_t blocksWide	= ( level._extent.width + info._blockWidth - 1 ) / info._blockWidth;
+		const uint32_t blocksHigh	= ( level._extent.height + info._blockHeight - 1 ) / info._blockHeight;
+		const VkDeviceSize rowBytes	= static_cast<VkDeviceSize>( blocksWide ) * info._blockBytes;
+
+		if ( _stagingBytesPerFrame < rowBytes )
+		{
+			std::cerr << "texture " << texture._fileName << ": a row of level " << promotion._level << " does not fit the staging buffer" << std::endl;
+			texture._state			= TextureState::Failed;
+			destroyImage( promotion._target );
+			promotion._isActive		= false;
+			return true;
+		}
+
+		const VkDeviceSize offset	= alignUp( _stagingCursor, STAGING_ALIGNMENT );
+		const uint32_t rowCount		= static_cast<uint32_t>( std::min<VkDeviceSize>( blocksHigh - promotion._row, ( offset < _stagingBytesPerFrame ) ? ( _stagingBytesPerFrame - offset ) / rowBytes : 0 ) );
+
+		if ( 0 == rowCount )
+		{
+			return false;
+		}
+
+		const VkDeviceSize size		= rowBytes * rowCount;
+		memcpy( static_cast<char*>( _stagingAllocation._mappedData ) + frameBase + offset, texture._data.getLevelData( promotion._level ) + rowBytes * promotion._row, static_cast<size_t>( size ) );
+
+		const uint32_t firstTexelRow	= promotion._row * info._blockHeight;
+
+		BufferCopy copy;
+		copy._image										= promotion._target._image;
+		copy._region									= VkBufferImageCopy{};
+		copy._region.bufferOffset						= frameBase + offset;
+		copy._region.imageSubresource.aspectMask		= VK_IMAGE_ASPECT_COLOR_BIT;
+		copy._region.imageSubresource.mipLevel			= promotion._level - promotion._target._firstLevel;
+		copy._region.imageSubresource.layerCount		= 1;
+		copy._region.imageOffset						= { 0, static_cast<int32_t>( firstTexelRow ), 0 };
+		copy._region.imageExtent						= { level._extent.width, std::min( rowCount * info._blockHeight, level._extent.height - firstTexelRow ), 1 };
+		uploads._bufferCopies.push_back( copy );
+
+		if ( false == _hasUploaded )
+		{
+			_firstUploadTime		= std::chrono::steady_clock::now();
+			_hasUploaded			= true;
+		}
+
+		_stagingCursor				= offset + size;
+		_uploadedBytes				+= size;
+		promotion._row				+= rowCount;
+
+		if ( blocksHigh == promotion._row )
+		{
+			++promotion._level;
+			promotion._row			= 0;
+		}
+	}
+
+	finishPromotion( texture, uploads, frameNumber, deletionQueue );
+
+	return true;
+}
+
+bool TextureStreamer::beginPromotion( Texture& texture, FrameUploads& uploads ) noexcept
+{
+	Promotion& promotion		= texture._promotion;
+	const TextureImage& current	= texture._current;
+
+	// Generated chains come in whole. Otherwise the mip tail comes first, then one level per step.
+	uint32_t firstLevel			= 0;
+
+	if ( false == texture._data._generateMips )
+	{
+		firstLevel				= current._firstLevel - 1;
+
+		if ( VK_NULL_HANDLE == current._image )
+		{
+			while ( ( 0 < firstLevel ) && ( std::max( texture._data._levels[firstLevel - 1]._extent.width, texture._data._levels[firstLevel - 1]._extent.height ) <= MIP_TAIL_EXTENT ) )
+			{
+				--firstLevel;
+			}
+		}
+	}
+
+	if ( false == createImage( texture, firstLevel, promotion._target ) )
+	{
+		texture._state			= TextureState::Failed;
+		return false;
+	}
+
+	// Without sparse residency the old image stays until the new one replaces it, so both count for the moment.
+	const VkDeviceSize currentBytes	= ( VK_NULL_HANDLE != current._image ) ? current._allocation._size : 0;
+
+	if ( _memoryBudget < _residentBytes - currentBytes + promotion._target._allocation._size )
+	{
+		destroyImage( promotion._target );
+		texture._state			= TextureState::BudgetLimited;
+		std::cout << "texture " << texture._fileName << ": stopping at level " << current._firstLevel << ", the next level would exceed the budget" << std::endl;
+		return false;
+	}
+
+	const uint32_t targetLevels	= texture._levelCount - firstLevel;
+
+	promotion._level			= firstLevel;
+	promotion._row				= 0;
+	promotion._uploadEnd		= ( true == texture._data._generateMips ) ? 1 : std::min( current._firstLevel, texture._levelCount );
+	promotion._isActive			= true;
+
+	uploads._startBarriers.push_back( makeBarrier( promotion._target._image, 0, targetLevels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT ) );
+
+	if ( VK_NULL_HANDLE == current._image )
+	{
+		return true;
+	}
+
+	// The resident levels move over on the GPU; the current image goes back to being sampled afterwards.
+	const uint32_t currentLevels = texture._levelCount - current._firstLevel;
+
+	uploads._startBarriers.push_back( makeBarrier( current._image, 0, currentLevels, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT ) );
+	uploads._finishBarriers.push_back( makeBarrier( current._image, 0, currentLevels, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT ) );
+
+	for ( uint32_t level = current._firstLevel; level < texture._levelCount; ++level )
+	{
+		LevelCopy copy;
+		copy._source								= current._image;
+		copy._destination							= promotion._target._image;
+		copy._region								= VkImageCopy{};
+		copy._region.srcSubresource.aspectMask		= VK_IMAGE_ASPECT_COLOR_BIT;
+		copy._region.srcSubresource.mipLevel		= level - current._firstLevel;
+		copy._region.srcSubresource.layerCount		= 1;
+		copy._region.dstSubresource					= copy._region.srcSubresource;
+		copy._region.dstSubresource.mipLevel		= level - firstLevel;
+		copy._region.extent							= { texture._data._levels[level]._extent.width, texture._data._levels[level]._extent.height, 1 };
+
+		uploads._levelCopies.push_back( copy );
+	}
+
+	return true;
+}
+
+void TextureStreamer::finishPromotion( Texture& texture, FrameUploads& uploads, const uint64_t frameNumber, DeletionQueue& deletionQueue ) noexcept
+{
+	Promotion& promotion		= texture._promotion;
+	const uint32_t levelCount	= texture._levelCount - promotion._target._firstLevel;
+
+	if ( true == texture._data._generateMips )
+	{
+		uploads._mipChains.push_back( MipChain{ promotion._target._image, texture._data._extent, levelCount } );
+		_generatedLevelCount	+= levelCount - 1;
+	}
+	else
+	{
+		uploads._finishBarriers.push_back( makeBarrier( promotion._target._image, 0, levelCount, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT ) );
+	}
+
+	// Earlier frames may still sample the old image, and this frame copies out of it.
+	if ( VK_NULL_HANDLE != texture._current._image )
+	{
+		_residentBytes				-= texture._current._allocation._size;
+
+		const VkDevice device		= _device;
+		MemoryAllocator* allocator	= _allocator;
+		TextureImage retired		= texture._current;
+
+		deletionQueue.retire( frameNumber, [device, allocator, retired]( void ) mutable
+		{
+			vkDestroyImageView( device, retired._view, nullptr );
+			vkDestroyImage( device, retired._image, nullptr );
+			allocator->free( retired._allocation );
+		} );
+	}
+
+	texture._current			= promotion._target;
+	promotion._target			= TextureImage{};
+	promotion._isActive			= false;
+
+	_residentBytes				+= texture._current._allocation._size;
+	_peakResidentBytes			= std::max( _peakResidentBytes, _residentBytes );
+	_lastCompletionTime			= std::chrono::steady_clock::now();
+
+	if ( 0 == texture._current._firstLevel )
+	{
+		texture._state			= TextureState::Resident;
+
+		if ( false == texture._fileName.empty() )
+		{
+			std::cout << "texture " << texture._fileName << ": " << texture._data._extent.width << "x" << texture._data._extent.height << ", " << texture._levelCount << " levels"
+					  << ( ( true == texture._data._generateMips ) ? " (generated)" : "" ) << ", decoded in " << texture._data._decodeMs << " ms, resident "
+					  << Benchmark::millisecondsSince( texture._loadTime ) << " ms after loading started" << std::endl;
+		}
+
+		// Only the resident image is needed from here on.
+		texture._data._levels.clear();
+		texture._data._pixels	= std::vector<unsigned char>();
+		texture._data._file.close();
+	}
+}
+
+bool TextureStreamer::createImage( const Texture& texture, const uint32_t firstLevel, TextureImage& image ) noexcept
+{
+	const VkExtent2D extent			= texture._data._levels.empty() ? VkExtent2D{ 1, 1 } : texture._data._levels[0]._extent;
+	const uint32_t levelCount		= texture._levelCount - firstLevel;
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType					= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType				= VK_IMAGE_TYPE_2D;
+	imageInfo.format				= texture._data._format;
+	imageInfo.extent				= { std::max( extent.width >> firstLevel, 1u ), std::max( extent.height >> firstLevel, 1u ), 1 };
+	imageInfo.mipLevels				= levelCount;
+	imageInfo.arrayLayers			= 1;
+	imageInfo.samples				= VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling				= VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage					= VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageInfo.sharingMode			= VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout			= VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if ( VK_SUCCESS != vkCreateImage( _device, &imageInfo, nullptr, &image._image ) )
+	{
+		std::cerr << "texture " << texture._fileName << ": failed to create an image" << std::endl;
+		return false;
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements( _device, image._image, &requirements );
+
+	if ( ( false == _allocator->allocate( requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ResourceKind::Optimal, image._allocation ) ) ||
+		 ( VK_SUCCESS != vkBindImageMemory( _device, image._image, image._allocation._memory, image._allocation._offset ) ) )
+	{
+		std::cerr << "texture " << texture._fileName << ": failed to allocate image memory" << std::endl;
+		destroyImage( image );
+		return false;
+	}
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType							= VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image							= image._image;
+	viewInfo.viewType						= VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format							= texture._data._format;
+	viewInfo.subresourceRange.aspectMask	= VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.levelCount	= levelCount;
+	viewInfo.subresourceRange.layerCount	= 1;
+
+	if ( VK_SUCCESS != vkCreateImageView( _device, &viewInfo, nullptr, &image._view ) )
+	{
+		destroyImage( image );
+		return false;
+	}
+
+	image._firstLevel				= firstLevel;
+
+	return true;
+}
+
+void TextureStreamer::destroyImage( TextureImage& image ) noexcept
+{
+	if ( VK_NULL_HANDLE != image._view )
+	{
+		vkDestroyImageView( _device, image._view, nullptr );
+	}
+
+	if ( VK_NULL_HANDLE != image._image )
+	{
+		vkDestroyImage( _device, image._image, nullptr );
+	}
+
+	if ( VK_NULL_HANDLE != image._allocation._memory )
+	{
+		_allocator->free( image._allocation );
+	}
+
+	image = TextureImage{};
+}
+
+void TextureStreamer::updateDescriptorSets( const uint32_t frame ) noexcept
+{
+	// The frame's sets were last used by its previous submission, which has completed.
+	const VkImageView defaultView = _textures[DEFAULT_TEXTURE]->_current._view;
+
+	for ( std::unique_ptr<Texture>& texture : _textures )
+	{
+		const VkImageView view = ( VK_NULL_HANDLE != texture->_current._view ) ? texture->_current._view : defaultView;
+
+		if ( ( VK_NULL_HANDLE == view ) || ( view == texture->_writtenViews[frame] ) )
+		{
+			continue;
+		}
+
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.sampler				= _sampler;
+		imageInfo.imageView				= view;
+		imageInfo.imageLayout			= VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkWriteDescriptorSet write{};
+		write.sType						= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet					= texture->_descriptorSets[frame];
+		write.dstBinding				= _binding;
+		write.descriptorCount			= 1;
+		write.descriptorType			= VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.pImageInfo				= &imageInfo;
+
+		vkUpdateDescriptorSets( _device, 1, &write, 0, nullptr );
+
+		texture->_writtenViews[frame]	= view;
+	}
+}
+
+void TextureStreamer::recordUploads( const VkCommandBuffer commandBuffer, const uint32_t frame ) const noexcept
+{
+	const FrameUploads& uploads = _frames[frame];
+
+	if ( ( true == uploads._startBarriers.empty() ) && ( true == uploads._bufferCopies.empty() ) )
+	{
+		return;
+	}
+
+	// Earlier frames may be sampling the images whose levels are copied out.
+	vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+						  static_cast<uint32_t>( uploads._startBarriers.size() ), uploads._startBarriers.data() );
+
+	for ( const LevelCopy& copy : uploads._levelCopies )
+	{
+		vkCmdCopyImage( commandBuffer, copy._source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, copy._destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy._region );
+	}
+
+	for ( const BufferCopy& copy : uploads._bufferCopies )
+	{
+		vkCmdCopyBufferToImage( commandBuffer, _stagingBuffer, copy._image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy._region );
+	}
+
+	std::vector<VkImageMemoryBarrier> finishBarriers = uploads._finishBarriers;
+
+	// Each level is blitted from the one above it once that one is complete.
+	for ( const MipChain& chain : uploads._mipChains )
+	{
+		for ( uint32_t level = 1; level < chain._levelCount; ++level )
+		{
+			const VkImageMemoryBarrier barrier = makeBarrier( chain._image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT );
+			vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier );
+
+			VkImageBlit blit{};
+			blit.srcSubresource.aspectMask	= VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.srcSubresource.mipLevel	= level - 1;
+			blit.srcSubresource.layerCount	= 1;
+			blit.srcOffsets[1]				= { static_cast<int32_t>( std::max( chain._extent.width >> ( level - 1 ), 1u ) ), static_cast<int32_t>( std::max( chain._extent.height >> ( level - 1 ), 1u ) ), 1 };
+			blit.dstSubresource				= blit.srcSubresource;
+			blit.dstSubresource.mipLevel	= level;
+			blit.dstOffsets[1]				= { static_cast<int32_t>( std::max( chain._extent.width >> level, 1u ) ), static_cast<int32_t>( std::max( chain._extent.height >> level, 1u ) ), 1 };
+
+			vkCmdBlitImage( commandBuffer, chain._image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, chain._image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR );
+		}
+
+		finishBarriers.push_back( makeBarrier( chain._image, 0, chain._levelCount - 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT ) );
+		finishBarriers.push_back( makeBarrier( chain._image, chain._levelCount - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT ) );
+	}
+
+	if ( false == finishBarriers.empty() )
+	{
+		vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr,
+							  static_cast<uint32_t>( finishBarriers.size() ), finishBarriers.data() );
+	}
+}
+
+VkImageMemoryBarrier TextureStreamer::makeBarrier( const VkImage image, const uint32_t baseLevel, const uint32_t levelCount, const VkImageLayout oldLayout, const VkImageLayout newLayout,
+												   const VkAccessFlags srcAccess, const VkAccessFlags dstAccess ) noexcept
+{
+	VkImageMemoryBarrier barrier{};
+	barrier.sType							= VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask					= srcAccess;
+	barrier.dstAccessMask					= dstAccess;
+	barrier.oldLayout						= oldLayout;
+	barrier.newLayout						= newLayout;
+	barrier.srcQueueFamilyIndex				= VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex				= VK_QUEUE_FAMILY_IGNORED;
+	barrier.image							= image;
+	barrier.subresourceRange.aspectMask		= VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel	= baseLevel;
+	barrier.subresourceRange.levelCount		= levelCount;
+	barrier.subresourceRange.layerCount		= 1;
+
+	return barrier;
+}
+
+VkDescriptorSet TextureStreamer::getDescriptorSet( const TextureHandle texture, const uint32_t frame ) const noexcept
+{
+	return _textures[( texture < _textures.size() ) ? texture : DEFAULT_TEXTURE]->_descriptorSets[frame];
+}
+
+TextureStreamingStatistics TextureStreamer::getStatistics( void ) const noexcept
+{
+	TextureStreamingStatistics statistics;
+
+	// The default texture is not counted.
+	for ( size_t ii = DEFAULT_TEXTURE + 1; ii < _textures.size(); ++ii )
+	{
+		const Texture& texture = *_textures[ii];
+
+		++statistics._textureCount;
+		statistics._residentTextureCount	+= ( TextureState::Resident == texture._state ) ? 1 : 0;
+		statistics._budgetLimitedCount		+= ( TextureState::BudgetLimited == texture._state ) ? 1 : 0;
+		statistics._decodeMs				+= texture._data._decodeMs;
+	}
+
+	statistics._generatedLevelCount	= _generatedLevelCount;
+	statistics._uploadedBytes		= _uploadedBytes;
+	statistics._uploadMs			= ( true == _hasUploaded ) ? std::chrono::duration<double, std::milli>( _lastCompletionTime - _firstUploadTime ).count() : 0.0;
+	statistics._residentBytes		= _residentBytes;
+	statistics._peakResidentBytes	= _peakResidentBytes;
+	statistics._budgetBytes			= _memoryBudget;
+
+	return statistics;
+}
+
+void TextureStreamer::printStatistics( void ) const noexcept
+{
+	const TextureStreamingStatistics statistics = getStatistics();
+
+	if ( 0 == statistics._textureCount )
+	{
+		return;
+	}
+
+	const double megabyte = 1024.0 * 1024.0;
+
+	std::cout << "textures: " << statistics._residentTextureCount << " of " << statistics._textureCount << " fully resident, " << statistics._budgetLimitedCount << " held back by the budget, "
+			  << statistics._generatedLevelCount << " levels generated" << std::endl;
+	std::cout << "  decode " << statistics._decodeMs << " ms, uploaded " << statistics._uploadedBytes / megabyte << " MB in " << statistics._uploadMs << " ms ("
+			  << statistics.getUploadMegabytesPerSecond() << " MB/s at " << _stagingBytesPerFrame / megabyte << " MB per frame)" << std::endl;
+	std::cout << "  resident " << statistics._residentBytes / megabyte << " MB, peak " << statistics._peakResidentBytes / megabyte << " MB of a " << statistics._budgetBytes / megabyte << " MB budget" << std::endl;
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+#include "DeletionQueue.h"
+#include "TextureLoader.h"
+
+struct Job;
+class JobSystem;
+
+typedef uint32_t TextureHandle;
+
+struct TextureStreamingStatistics
+{
+	uint32_t		_textureCount			= 0;
+	// Textures with every level resident; the rest are still streaming, over budget or failed.
+	uint32_t		_residentTextureCount	= 0;
+	uint32_t		_budgetLimitedCount		= 0;
+	uint32_t		_generatedLevelCount	= 0;
+
+	uint64_t		_uploadedBytes			= 0;
+	// From the first upload to the last image becoming visible.
+	double			_uploadMs				= 0.0;
+	// Summed over the decode tasks.
+	double			_decodeMs				= 0.0;
+
+	VkDeviceSize	_residentBytes			= 0;
+	VkDeviceSize	_peakResidentBytes		= 0;
+	VkDeviceSize	_budgetBytes			= 0;
+
+	double			getUploadMegabytesPerSecond( void ) const noexcept;
+};
+
+// Loads textures in the background and streams them in smallest mip level first. Files are decoded as job system
+// background tasks; KTX2 block-compressed levels are copied to the GPU as they are, and uncompressed sources
+// upload their top level and have the rest of the chain blitted on the GPU. Every frame stages at most
+// its slice of a host-visible staging buffer, copying whole rows of blocks, so a large level takes several
+// frames. Without sparse residency a texture gains levels by moving to a larger image: the resident
+// levels are copied over on the GPU, the new ones uploaded, and the old image retired once the frames
+// sampling it have completed. Images only grow while the total stays within the memory budget.
+// Until a texture has an image, its descriptor sets show a 1x1 white texture.
+class TextureStreamer
+{
+public:
+
+	static const TextureHandle	DEFAULT_TEXTURE		= 0;
+
+	TextureStreamer( void );
+
+	bool					create( const VkPhysicalDevice physicalDevice, const VkDevice device, MemoryAllocator& allocator, JobSystem& jobSystem,
+									const VkDescriptorSetLayout setLayout, const uint32_t binding, const uint32_t frameCount,
+									const VkDeviceSize stagingBytesPerFrame, const VkDeviceSize memoryBudget ) noexcept;
+	// Only once the device no longer uses the textures; waits for decodes still running.
+	void					destroy( void ) noexcept;
+
+	// Starts decoding on the job system and returns right away; on failure the handle keeps showing the default texture.
+	TextureHandle			load( const std::string& fileName ) noexcept;
+
+	// Once the frame's previous submission has completed: picks up decoded textures, stages this frame's
+	// uploads, retires replaced images and points the frame's descriptor sets at the newest images.
+	void					beginFrame( const uint32_t frame, const uint64_t frameNumber, DeletionQueue& deletionQueue ) noexcept;
+	// Outside a render pass, ahead of the draws that sample the textures.
+	void					recordUploads( const VkCommandBuffer commandBuffer, const uint32_t frame ) const noexcept;
+
+	VkDescriptorSet			getDescriptorSet( const TextureHandle texture, const uint32_t frame ) const noexcept;
+
+	TextureStreamingStatistics	getStatistics( void ) const noexcept;
+	void					printStatistics( void ) const noexcept;
+
+private:
+
+	static const uint32_t	MAX_TEXTURES		= 64;
+	// Levels up to this size come in together with the first upload.
+	static const uint32_t	MIP_TAIL_EXTENT		= 64;
+
+	enum class TextureState : uint32_t
+	{
+		Decoding = 0,
+		Streaming,
+		Resident,
+		BudgetLimited,
+		Failed
+	};
+
+	struct TextureImage
+	{
+		VkImage				_image			= VK_NULL_HANDLE;
+		VkImageView			_view			= VK_NULL_HANDLE;
+		Allocation			_allocation;
+		// The source level that is the image's level 0.
+		uint32_t			_firstLevel		= 0;
+	};
+
+	// Moving to a larger image, possibly across several frames.
+	struct Promotion
+	{
+		TextureImage		_target;
+		// Next source level and block row to upload; levels from _uploadEnd on are copied from the current image.
+		uint32_t			_level			= 0;
+		uint32_t			_row			= 0;
+		uint32_t			_uploadEnd		= 0;
+		bool				_isActive		= false;
+	};
+
+	struct Texture
+	{
+		std::string						_fileName;
+		TextureState					_state			= TextureState::Decoding;
+		TextureData						_data;
+		bool							_isDecoded		= false;
+		// Set by the decode task as its last step.
+		std::atomic<bool>				_isDecodeDone{ false };
+		std::chrono::steady_clock::time_point	_loadTime;
+
+		// Levels in the finished texture, including generated ones.
+		uint32_t						_levelCount		= 0;
+		TextureImage					_current;
+		Promotion						_promotion;
+
+		std::vector<VkDescriptorSet>	_descriptorSets;
+		std::vector<VkImageView>		_writtenViews;
+	};
+
+	struct LevelCopy
+	{
+		VkImage				_source;
+		VkImage				_destination;
+		VkImageCopy			_region;
+	};
+
+	struct BufferCopy
+	{
+		VkImage				_image;
+		VkBufferImageCopy	_region;
+	};
+
+	struct MipChain
+	{
+		VkImage				_image;
+		VkExtent2D			_extent;
+		uint32_t			_levelCount;
+	};
+
+	// Everything beginFrame() staged for recordUploads(), in recording order.
+	struct FrameUploads
+	{
+		std::vector<VkImageMemoryBarrier>	_startBarriers;
+		std::vector<LevelCopy>				_levelCopies;
+		std::vector<BufferCopy>				_bufferCopies;
+		std::vector<MipChain>				_mipChains;
+		std::vector<VkImageMemoryBarrier>	_finishBarriers;
+	};
+
+	void					pollDecodes( void ) noexcept;
+	bool					checkFormat( Texture& texture ) const noexcept;
+	// False when nothing more can be staged this frame.
+	bool					stream( Texture& texture, const uint32_t frame, const uint64_t frameNumber, DeletionQueue& deletionQueue ) noexcept;
+	bool					beginPromotion( Texture& texture, FrameUploads& uploads ) noexcept;
+	void					finishPromotion( Texture& texture, FrameUploads& uploads, const uint64_t frameNumber, DeletionQueue& deletionQueue ) noexcept;
+	bool					createImage( const Texture& texture, const uint32_t firstLevel, TextureImage& image ) noexcept;
+	void					destroyImage( TextureImage& image ) noexcept;
+	void					updateDescriptorSets( const uint32_t frame ) noexcept;
+
+	static VkImageMemoryBarrier	makeBarrier( const VkImage image, const uint32_t baseLevel, const uint32_t levelCount, const VkImageLayout oldLayout, const VkImageLayout newLayout,
+											 const VkAccessFlags srcAccess, const VkAccessFlags dstAccess ) noexcept;
+
+	VkPhysicalDevice					_physicalDevice;
+	VkDevice							_device;
+	MemoryAllocator*					_allocator;
+	JobSystem*							_jobSystem;
+	VkDescriptorSetLayout				_setLayout;
+	uint32_t							_binding;
+	uint32_t							_frameCount;
+
+	VkSampler							_sampler;
+	VkDescriptorPool					_descriptorPool;
+
+	VkBuffer							_stagingBuffer;
+	Allocation							_stagingAllocation;
+	VkDeviceSize						_stagingBytesPerFrame;
+	VkDeviceSize						_stagingCursor;
+
+	std::vector<std::unique_ptr<Texture>>	_textures;
+	std::vector<FrameUploads>			_frames;
+
+	VkDeviceSize						_memoryBudget;
+	VkDeviceSize						_residentBytes;
+	VkDeviceSize						_peakResidentBytes;
+	uint64_t							_uploadedBytes;
+	uint32_t							_generatedLevelCount;
+	bool								_hasUploaded;
+	std::chrono::steady_clock::time_point	_firstUploadTime;
+	std::chrono::steady_clock::time_point	_lastCompletionTime;
+};
@@ -0,0 +1,354 @@
+#include "pch.h"
+
+#include "Tlsf.h"
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+namespace
+{
+	uint32_t findLowestBit( const uint64_t value ) noexcept
+	{
+#if defined( _MSC_VER )
+		unsigned long index = 0;
+		_BitScanForward64( &index, value );
+		return static_cast<uint32_t>( index );
+#else
+		return static_cast<uint32_t>( __builtin_ctzll( value ) );
+#endif
+	}
+
+	uint32_t findHighestBit( const uint64_t value ) noexcept
+	{
+#if defined( _MSC_VER )
+		unsigned long index = 0;
+		_BitScanReverse64( &index, value );
+		return static_cast<uint32_t>( index );
+#else
+		return 63 - static_cast<uint32_t>( __builtin_clzll( value ) );
+#endif
+	}
+}
+
+Tlsf::Tlsf( const uint64_t size )
+	: _size{ size }
+	, _usedSize{ 0 }
+	, _allocationCount{ 0 }
+	, _flBitmap{ 0 }
+{
+	_slBitmaps.fill( 0 );
+	_freeHeads.fill( INVALID_NODE );
+
+	insertFree( createNode( 0, size ) );
+}
+
+uint32_t Tlsf::allocate( const uint64_t size, const uint64_t requestedAlignment, uint64_t& offset ) noexcept
+{
+	if ( 0 == size )
+	{
+		return INVALID_NODE;
+	}
+
+	const uint64_t alignment = std::max<uint64_t>( requestedAlignment, 1 );
+
+	// Searching for size + alignment - 1 guarantees any node found can hold an aligned allocation.
+	const uint32_t node = findFreeNode( size + alignment - 1 );
+	if ( INVALID_NODE == node )
+	{
+		return INVALID_NODE;
+	}
+
+	removeFree( node );
+
+	const uint64_t nodeOffset		= _nodes[node]._offset;
+	const uint64_t alignedOffset	= ( nodeOffset + alignment - 1 ) / alignment * alignment;
+	const uint64_t padding			= alignedOffset - nodeOffset;
+
+	// Give the alignment padding back as its own free range in front of the allocation.
+	if ( 0 < padding )
+	{
+		const uint32_t front		= createNode( nodeOffset, padding );
+		_nodes[front]._prevPhysical	= _nodes[node]._prevPhysical;
+		_nodes[front]._nextPhysical	= node;
+
+		if ( INVALID_NODE != _nodes[node]._prevPhysical )
+		{
+			_nodes[_nodes[node]._prevPhysical]._nextPhysical = front;
+		}
+
+		_nodes[node]._prevPhysical	= front;
+		_nodes[node]._offset		= alignedOffset;
+		_nodes[node]._size			-= padding;
+
+		insertFree( front );
+	}
+
+	if ( size < _nodes[node]._size )
+	{
+		const uint32_t back			= createNode( alignedOffset + size, _nodes[node]._size - size );
+		_nodes[back]._prevPhysical	= node;
+		_nodes[back]._nextPhysical	= _nodes[node]._nextPhysical;
+
+		if ( INVALID_NODE != _nodes[node]._nextPhysical )
+		{
+			_nodes[_nodes[node]._nextPhysical]._prevPhysical = back;
+		}
+
+		_nodes[node]._nextPhysical	= back;
+		_nodes[node]._size			= size;
+
+		insertFree( back );
+	}
+
+	_nodes[node]._isFree			= false;
+	_usedSize						+= size;
+	++_allocationCount;
+
+	offset							= alignedOffset;
+
+	return node;
+}
+
+void Tlsf::free( const uint32_t node ) noexcept
+{
+	if ( ( _nodes.size() <= node ) || ( true == _nodes[node]._isFree ) )
+	{
+		return;
+	}
+
+	_usedSize	-= _nodes[node]._size;
+	--_allocationCount;
+
+	uint32_t merged = node;
+
+	const uint32_t prev = _nodes[merged]._prevPhysical;
+	if ( ( INVALID_NODE != prev ) && ( true == _nodes[prev]._isFree ) )
+	{
+		removeFree( prev );
+
+		_nodes[prev]._size			+= _nodes[merged]._size;
+		_nodes[prev]._nextPhysical	= _nodes[merged]._nextPhysical;
+
+		if ( INVALID_NODE != _nodes[merged]._nextPhysical )
+		{
+			_nodes[_nodes[merged]._nextPhysical]._prevPhysical = prev;
+		}
+
+		releaseNode( merged );
+		merged = prev;
+	}
+
+	const uint32_t next = _nodes[merged]._nextPhysical;
+	if ( ( INVALID_NODE != next ) && ( true == _nodes[next]._isFree ) )
+	{
+		removeFree( next );
+
+		_nodes[merged]._size			+= _nodes[next]._size;
+		_nodes[merged]._nextPhysical	= _nodes[next]._nextPhysical;
+
+		if ( INVALID_NODE != _nodes[next]._nextPhysical )
+		{
+			_nodes[_nodes[next]._nextPhysical]._prevPhysical = merged;
+		}
+
+		releaseNode( next );
+	}
+
+	insertFree( merged );
+}
+
+uint64_t Tlsf::getSize( void ) const noexcept
+{
+	return _size;
+}
+
+uint64_t Tlsf::getUsedSize( void ) const noexcept
+{
+	return _usedSize;
+}
+
+uint64_t Tlsf::getLargestFreeRange( void ) const noexcept
+{
+	if ( 0 == _flBitmap )
+	{
+		return 0;
+	}
+
+	const uint32_t fl		= findHighestBit( _flBitmap );
+	const uint32_t sl		= findHighestBit( _slBitmaps[fl] );
+
+	uint64_t largest		= 0;
+	for ( uint32_t node = _freeHeads[fl * SL_COUNT + sl]; INVALID_NODE != node; node = _nodes[node]._nextFree )
+	{
+		largest = std::max( largest, _nodes[node]._size );
+	}
+
+	return largest;
+}
+
+uint32_t Tlsf::getFreeRangeCount( void ) const noexcept
+{
+	uint32_t count = 0;
+
+	for ( const uint32_t head : _freeHeads )
+	{
+		for ( uint32_t node = head; INVALID_NODE != node; node = _nodes[node]._nextFree )
+		{
+			++count;
+		}
+	}
+
+	return count;
+}
+
+uint32_t Tlsf::getAllocationCount( void ) const noexcept
+{
+	return _allocationCount;
+}
+
+bool Tlsf::isEmpty( void ) const noexcept
+{
+	return 0 == _allocationCount;
+}
+
+void Tlsf::mapping( const uint64_t size, uint32_t& fl, uint32_t& sl ) noexcept
+{
+	if ( size < SL_COUNT )
+	{
+		fl = 0;
+		sl = static_cast<uint32_t>( size );
+		return;
+	}
+
+	const uint32_t log2	= findHighestBit( size );
+	fl					= log2 - SL_INDEX_LOG2 + 1;
+	sl					= static_cast<uint32_t>( size >> ( log2 - SL_INDEX_LOG2 ) ) ^ SL_COUNT;
+}
+
+uint32_t Tlsf::findFreeNode( const uint64_t size ) const noexcept
+{
+	// Round up to the next bin boundary so every node in the chosen bin is large enough.
+	uint64_t searchSize = size;
+	if ( SL_COUNT <= size )
+	{
+		const uint64_t round = ( uint64_t( 1 ) << ( findHighestBit( size ) - SL_INDEX_LOG2 ) ) - 1;
+		if ( UINT64_MAX - round < size )
+		{
+			return INVALID_NODE;
+		}
+
+		searchSize += round;
+	}
+
+	uint32_t fl = 0;
+	uint32_t sl = 0;
+	mapping( searchSize, fl, sl );
+
+	if ( FL_COUNT <= fl )
+	{
+		return INVALID_NODE;
+	}
+
+	uint32_t slBitmap = _slBitmaps[fl] & ( ~0u << sl );
+	if ( 0 == slBitmap )
+	{
+		const uint64_t flBitmap = ( FL_COUNT - 1 <= fl ) ? 0 : ( _flBitmap & ( ~uint64_t( 0 ) << ( fl + 1 ) ) );
+		if ( 0 == flBitmap )
+		{
+			return INVALID_NODE;
+		}
+
+		fl			= findLowestBit( flBitmap );
+		slBitmap	= _slBitmaps[fl];
+	}
+
+	sl = findLowestBit( slBitmap );
+
+	return _freeHeads[fl * SL_COUNT + sl];
+}
+
+uint32_t Tlsf::createNode( const uint64_t offset, const uint64_t size ) noexcept
+{
+	uint32_t node = INVALID_NODE;
+
+	if ( false == _unusedNodes.empty() )
+	{
+		node = _unusedNodes.back();
+		_unusedNodes.pop_back();
+	}
+	else
+	{
+		node = static_cast<uint32_t>( _nodes.size() );
+		_nodes.emplace_back();
+	}
+
+	_nodes[node] = { offset, size, INVALID_NODE, INVALID_NODE, INVALID_NODE, INVALID_NODE, false };
+
+	return node;
+}
+
+void Tlsf::releaseNode( const uint32_t node ) noexcept
+{
+	_unusedNodes.push_back( node );
+}
+
+void Tlsf::insertFree( const uint32_t node ) noexcept
+{
+	uint32_t fl = 0;
+	uint32_t sl = 0;
+	mapping( _nodes[node]._size, fl, sl );
+
+	uint32_t& head			= _freeHeads[fl * SL_COUNT + sl];
+
+	_nodes[node]._isFree	= true;
+	_nodes[node]._prevFree	= INVALID_NODE;
+	_nodes[node]._nextFree	= head;
+
+	if ( INVALID_NODE != head )
+	{
+		_nodes[head]._prevFree = node;
+	}
+
+	head					= node;
+	_flBitmap				|= uint64_t( 1 ) << fl;
+	_slBitmaps[fl]			|= 1u << sl;
+}
+
+void Tlsf::removeFree( const uint32_t node ) noexcept
+{
+	uint32_t fl = 0;
+	uint32_t sl = 0;
+	mapping( _nodes[node]._size, fl, sl );
+
+	const uint32_t prev = _nodes[node]._prevFree;
+	const uint32_t next = _nodes[node]._nextFree;
+
+	if ( INVALID_NODE != prev )
+	{
+		_nodes[prev]._nextFree = next;
+	}
+	else
+	{
+		_freeHeads[fl * SL_COUNT + sl] = next;
+	}
+
+	if ( INVALID_NODE != next )
+	{
+		_nodes[next]._prevFree = prev;
+	}
+
+	if ( INVALID_NODE == _freeHeads[fl * SL_COUNT + sl] )
+	{
+		_slBitmaps[fl] &= ~( 1u << sl );
+
+		if ( 0 == _slBitmaps[fl] )
+		{
+			_flBitmap &= ~( uint64_t( 1 ) << fl );
+		}
+	}
+
+	_nodes[node]._isFree	= false;
+	_nodes[node]._prevFree	= INVALID_NODE;
+	_nodes[node]._nextFree	= INVALID_NODE;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// Two-level segregated fit allocator over an abstract range [0, size).
+// It only hands out offsets; the owner decides what the range is backed by.
+class Tlsf
+{
+public:
+
+	static constexpr uint32_t	INVALID_NODE = UINT32_MAX;
+
+	explicit Tlsf( const uint64_t size );
+
+	uint32_t		allocate( const uint64_t size, const uint64_t requestedAlignment, uint64_t& offset ) noexcept;
+	void			free( const uint32_t node ) noexcept;
+
+	uint64_t		getSize( void ) const noexcept;
+	uint64_t		getUsedSize( void ) const noexcept;
+	uint64_t		getLargestFreeRange( void ) const noexcept;
+	uint32_t		getFreeRangeCount( void ) const noexcept;
+	uint32_t		getAllocationCount( void ) const noexcept;
+	bool			isEmpty( void ) const noexcept;
+
+private:
+
+	static constexpr uint32_t	SL_INDEX_LOG2	= 4;
+	static constexpr uint32_t	SL_COUNT		= 1 << SL_INDEX_LOG2;
+	static constexpr uint32_t	FL_COUNT		= 64;
+
+	struct Node
+	{
+		uint64_t	_offset;
+		uint64_t	_size;
+		uint32_t	_prevPhysical;
+		uint32_t	_nextPhysical;
+		uint32_t	_prevFree;
+		uint32_t	_nextFree;
+		bool		_isFree;
+	};
+
+	static void		mapping( const uint64_t size, uint32_t& fl, uint32_t& sl ) noexcept;
+
+	uint32_t		findFreeNode( const uint64_t size ) const noexcept;
+	uint32_t		createNode( const uint64_t offset, const uint64_t size ) noexcept;
+	void			releaseNode( const uint32_t node ) noexcept;
+	void			insertFree( const uint32_t node ) noexcept;
+	void			removeFree( const uint32_t node ) noexcept;
+
+	uint64_t								_size;
+	uint64_t								_usedSize;
+	uint32_t								_allocationCount;
+
+	std::vector<Node>						_nodes;
+	std::vector<uint32_t>					_unusedNodes;
+
+	uint64_t								_flBitmap;
+	std::array<uint32_t, FL_COUNT>			_slBitmaps;
+	std::array<uint32_t, FL_COUNT * SL_COUNT>	_freeHeads;
+};
@@ -0,0 +1,164 @@
+#include "pch.h"
+
+#include "UniformRing.h"
+
+namespace
+{
+	VkDeviceSize alignUp( const VkDeviceSize value, const VkDeviceSize alignment ) noexcept
+	{
+		return ( value + alignment - 1 ) / alignment * alignment;
+	}
+}
+
+UniformRing::UniformRing( void )
+	: _device{ VK_NULL_HANDLE }
+	, _allocator{ nullptr }
+	, _buffer{ VK_NULL_HANDLE }
+	, _alignment{ 1 }
+	, _range{ 0 }
+	, _frameSize{ 0 }
+	, _frameCount{ 0 }
+	, _frameBegin{ 0 }
+	, _cursor{ 0 }
+	, _descriptorPool{ VK_NULL_HANDLE }
+	, _descriptorSet{ VK_NULL_HANDLE }
+{
+
+}
+
+bool UniformRing::create( const VkDevice device, MemoryAllocator& allocator, const VkDescriptorSetLayout setLayout, const uint32_t binding,
+						  const VkDeviceSize range, const VkDeviceSize frameSize, const uint32_t frameCount ) noexcept
+{
+	_device			= device;
+	_allocator		= &allocator;
+
+	const VkPhysicalDeviceLimits& limits = _allocator->getLimits();
+
+	if ( limits.maxUniformBufferRange < range )
+	{
+		std::cerr << "uniform ring: blocks of " << range << " bytes exceed the device's uniform buffer range" << std::endl;
+		return false;
+	}
+
+	// Regions start on an aligned offset too, so every block in every frame is a valid dynamic offset.
+	_alignment		= std::max<VkDeviceSize>( limits.minUniformBufferOffsetAlignment, 1 );
+	_range			= range;
+	_frameSize		= alignUp( std::max( frameSize, range ), _alignment );
+	_frameCount		= frameCount;
+
+	// Device-local host-visible memory (resizable BAR, integrated GPUs) keeps the uniform reads on the device.
+	const VkDeviceSize size = _frameSize * _frameCount;
+
+	if ( ( false == _allocator->createBuffer( size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _buffer, _allocation ) ) &&
+		 ( false == _allocator->createBuffer( size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _buffer, _allocation ) ) )
+	{
+		return false;
+	}
+
+	if ( nullptr == _allocation._mappedData )
+	{
+		return false;
+	}
+
+	return createDescriptorSet( setLayout, binding );
+}
+
+bool UniformRing::createDescriptorSet( const VkDescriptorSetLayout setLayout, const uint32_t binding ) noexcept
+{
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type				= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	poolSize.descriptorCount	= 1;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType				= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets			= 1;
+	poolInfo.poolSizeCount		= 1;
+	poolInfo.pPoolSizes			= &poolSize;
+
+	if ( VK_SUCCESS != vkCreateDescriptorPool( _device, &poolInfo, nullptr, &_descriptorPool ) )
+	{
+		return false;
+	}
+
+	VkDescriptorSetAllocateInfo allocateInfo{};
+	allocateInfo.sType					= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool			= _descriptorPool;
+	allocateInfo.descriptorSetCount		= 1;
+	allocateInfo.pSetLayouts			= &setLayout;
+
+	if ( VK_SUCCESS != vkAllocateDescriptorSets( _device, &allocateInfo, &_descriptorSet ) )
+	{
+		return false;
+	}
+
+	// Written once: the base offset stays 0 and the dynamic offsets select the block.
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer					= _buffer;
+	bufferInfo.offset					= 0;
+	bufferInfo.range					= _range;
+
+	VkWriteDescriptorSet write{};
+	write.sType							= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet						= _descriptorSet;
+	write.dstBinding					= binding;
+	write.descriptorCount				= 1;
+	write.descriptorType				= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	write.pBufferInfo					= &bufferInfo;
+
+	vkUpdateDescriptorSets( _device, 1, &write, 0, nullptr );
+
+	return true;
+}
+
+void UniformRing::destroy( void ) noexcept
+{
+	if ( nullptr == _allocator )
+	{
+		return;
+	}
+
+	// Freeing the pool frees the set with it.
+	if ( VK_NULL_HANDLE != _descriptorPool )
+	{
+		vkDestroyDescriptorPool( _device, _descriptorPool, nullptr );
+		_descriptorPool		= VK_NULL_HANDLE;
+		_descriptorSet		= VK_NULL_HANDLE;
+	}
+
+	_allocator->destroyBuffer( _buffer, _allocation );
+}
+
+void UniformRing::beginFrame( const uint32_t frame ) noexcept
+{
+	_frameBegin		= _frameSize * frame;
+	_cursor			= _frameBegin;
+}
+
+void* UniformRing::allocate( const VkDeviceSize size, uint32_t& offset ) noexcept
+{
+	// A block must fit the descriptor's range, since that is all the shader can see past its offset.
+	if ( ( _range < size ) || ( _frameBegin + _frameSize < _cursor + _range ) )
+	{
+		return nullptr;
+	}
+
+	offset			= static_cast<uint32_t>( _cursor );
+	_cursor			+= alignUp( size, _alignment );
+
+	return static_cast<uint8_t*>( _allocation._mappedData ) + offset;
+}
+
+VkDescriptorSet UniformRing::getDescriptorSet( void ) const noexcept
+{
+	return _descriptorSet;
+}
+
+VkDeviceSize UniformRing::getAlignment( void ) const noexcept
+{
+	return _alignment;
+}
+
+uint32_t UniformRing::getFrameOffset( void ) const noexcept
+{
+	return static_cast<uint32_t>( _frameBegin );
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+
+// One persistently mapped uniform buffer with a region per frame in flight. Blocks are handed out front to
+// back within the current frame's region, each aligned to minUniformBufferOffsetAlignment, and all of them
+// are reached through a single dynamic uniform descriptor: a draw only passes its block's offset when it
+// binds the set. A region is only rewritten after its frame's fence has signaled.
+class UniformRing
+{
+public:
+
+	UniformRing( void );
+
+	// range is the largest block the shaders read through the descriptor.
+	bool				create( const VkDevice device, MemoryAllocator& allocator, const VkDescriptorSetLayout setLayout, const uint32_t binding,
+								const VkDeviceSize range, const VkDeviceSize frameSize, const uint32_t frameCount ) noexcept;
+	void				destroy( void ) noexcept;
+
+	// Starts handing out the frame's region from the front again.
+	void				beginFrame( const uint32_t frame ) noexcept;
+
+	// Returns nullptr once the frame's region is full; offset is what the block is bound with.
+	void*				allocate( const VkDeviceSize size, uint32_t& offset ) noexcept;
+
+	template<typename T>
+	T*					allocate( uint32_t& offset ) noexcept
+	{
+		return static_cast<T*>( allocate( sizeof( T ), offset ) );
+	}
+
+	VkDescriptorSet		getDescriptorSet( void ) const noexcept;
+	VkDeviceSize		getAlignment( void ) const noexcept;
+	// Where the current frame's region starts, as a dynamic offset.
+	uint32_t			getFrameOffset( void ) const noexcept;
+
+private:
+
+	bool				createDescriptorSet( const VkDescriptorSetLayout setLayout, const uint32_t binding ) noexcept;
+
+	VkDevice			_device;
+	MemoryAllocator*	_allocator;
+	VkBuffer			_buffer;
+	Allocation			_allocation;
+
+	VkDeviceSize		_alignment;
+	VkDeviceSize		_range;
+	VkDeviceSize		_frameSize;
+	uint32_t			_frameCount;
+
+	// The current frame's region is [_frameBegin, _frameBegin + _frameSize); _cursor is the next free byte.
+	VkDeviceSize		_frameBegin;
+	VkDeviceSize		_cursor;
+
+	VkDescriptorPool	_descriptorPool;
+	VkDescriptorSet		_descriptorSet;
+};
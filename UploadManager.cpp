@@ -0,0 +1,433 @@
+#include "pch.h"
+
+#include "UploadManager.h"
+
+UploadManager::UploadManager( void )
+	: _device{ VK_NULL_HANDLE }
+	, _allocator{ nullptr }
+	, _transferQueue{ VK_NULL_HANDLE }
+	, _transferFamily{ 0 }
+	, _graphicsQueue{ VK_NULL_HANDLE }
+	, _graphicsFamily{ 0 }
+	, _transferCommandPool{ VK_NULL_HANDLE }
+	, _graphicsCommandPool{ VK_NULL_HANDLE }
+	, _ringBuffer{ VK_NULL_HANDLE }
+	, _ringSize{ 0 }
+	, _ringHead{ 0 }
+	, _ringUsed{ 0 }
+	, _ringAlignment{ 16 }
+	, _currentBatch{ 0 }
+	, _nextTicket{ 1 }
+	, _completedTicket{ 0 }
+{
+
+}
+
+bool UploadManager::create( const VkDevice device, MemoryAllocator& allocator,
+							const VkQueue transferQueue, const uint32_t transferFamily,
+							const VkQueue graphicsQueue, const uint32_t graphicsFamily,
+							const VkDeviceSize ringSize ) noexcept
+{
+	_device				= device;
+	_allocator			= &allocator;
+	_transferQueue		= transferQueue;
+	_transferFamily		= transferFamily;
+	_graphicsQueue		= graphicsQueue;
+	_graphicsFamily		= graphicsFamily;
+	_ringSize			= ringSize;
+	_ringAlignment		= std::max<VkDeviceSize>( allocator.getLimits().optimalBufferCopyOffsetAlignment, 16 );
+
+	if ( false == allocator.createBuffer( _ringSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _ringBuffer, _ringAllocation ) )
+	{
+		return false;
+	}
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType							= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags							= VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex				= _transferFamily;
+
+	if ( VK_SUCCESS != vkCreateCommandPool( _device, &poolInfo, nullptr, &_transferCommandPool ) )
+	{
+		return false;
+	}
+
+	if ( true == isDedicatedTransferQueue() )
+	{
+		poolInfo.queueFamilyIndex			= _graphicsFamily;
+
+		if ( VK_SUCCESS != vkCreateCommandPool( _device, &poolInfo, nullptr, &_graphicsCommandPool ) )
+		{
+			return false;
+		}
+	}
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType							= VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType						= VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for ( Batch& batch : _batches )
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool				= _transferCommandPool;
+		allocInfo.level						= VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount		= 1;
+
+		if ( ( VK_SUCCESS != vkAllocateCommandBuffers( _device, &allocInfo, &batch._transferCommandBuffer ) ) ||
+			 ( VK_SUCCESS != vkCreateFence( _device, &fenceInfo, nullptr, &batch._fence ) ) )
+		{
+			return false;
+		}
+
+		if ( true == isDedicatedTransferQueue() )
+		{
+			allocInfo.commandPool			= _graphicsCommandPool;
+
+			if ( ( VK_SUCCESS != vkAllocateCommandBuffers( _device, &allocInfo, &batch._acquireCommandBuffer ) ) ||
+				 ( VK_SUCCESS != vkCreateSemaphore( _device, &semaphoreInfo, nullptr, &batch._transferSemaphore ) ) )
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void UploadManager::destroy( void ) noexcept
+{
+	if ( VK_NULL_HANDLE == _device )
+	{
+		return;
+	}
+
+	wait( flush() );
+
+	for ( Batch& batch : _batches )
+	{
+		vkDestroyFence( _device, batch._fence, nullptr );
+
+		if ( VK_NULL_HANDLE != batch._transferSemaphore )
+		{
+			vkDestroySemaphore( _device, batch._transferSemaphore, nullptr );
+		}
+	}
+
+	vkDestroyCommandPool( _device, _transferCommandPool, nullptr );
+
+	if ( VK_NULL_HANDLE != _graphicsCommandPool )
+	{
+		vkDestroyCommandPool( _device, _graphicsCommandPool, nullptr );
+	}
+
+	_allocator->destroyBuffer( _ringBuffer, _ringAllocation );
+
+	_device = VK_NULL_HANDLE;
+}
+
+UploadTicket UploadManager::upload( const VkBuffer dstBuffer, const VkDeviceSize dstOffset, const void* data, const VkDeviceSize size, const VkAccessFlags dstAccessMask ) noexcept
+{
+	std::lock_guard<std::mutex> lock( _mutex );
+
+	const char* source			= static_cast<const char*>( data );
+	VkDeviceSize uploaded		= 0;
+
+	while ( uploaded < size )
+	{
+		if ( ( false == _batches[_currentBatch]._isRecording ) && ( false == beginBatch() ) )
+		{
+			std::cerr << "upload manager: failed to begin a batch" << std::endl;
+			return 0;
+		}
+
+		// Uploads larger than the ring are split; each chunk becomes its own copy.
+		const VkDeviceSize chunk	= std::min( size - uploaded, _ringSize );
+		VkDeviceSize ringOffset		= 0;
+
+		if ( false == allocateRing( chunk, ringOffset ) )
+		{
+			if ( 0 < _batches[_currentBatch]._copyCount )
+			{
+				submitBatch();
+				continue;
+			}
+
+			// The open batch is empty, so the space is held by submitted batches: retire the oldest one.
+			const Batch* oldest = nullptr;
+			for ( const Batch& batch : _batches )
+			{
+				if ( ( true == batch._isPending ) && ( ( nullptr == oldest ) || ( batch._ticket < oldest->_ticket ) ) )
+				{
+					oldest = &batch;
+				}
+			}
+
+			if ( nullptr == oldest )
+			{
+				return 0;
+			}
+
+			const UploadTicket ticket = oldest->_ticket;
+			for ( Batch& batch : _batches )
+			{
+				if ( ( true == batch._isPending ) && ( batch._ticket == ticket ) )
+				{
+					vkWaitForFences( _device, 1, &batch._fence, VK_TRUE, UINT64_MAX );
+					retireBatch( batch );
+				}
+			}
+
+			continue;
+		}
+
+		Batch& batch				= _batches[_currentBatch];
+
+		memcpy( static_cast<char*>( _ringAllocation._mappedData ) + ringOffset, source + uploaded, static_cast<size_t>( chunk ) );
+
+		VkBufferCopy copyRegion{};
+		copyRegion.srcOffset		= ringOffset;
+		copyRegion.dstOffset		= dstOffset + uploaded;
+		copyRegion.size				= chunk;
+		vkCmdCopyBuffer( batch._transferCommandBuffer, _ringBuffer, dstBuffer, 1, &copyRegion );
+
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType				= VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask		= VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask		= dstAccessMask;
+		barrier.srcQueueFamilyIndex	= isDedicatedTransferQueue() ? _transferFamily : VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex	= isDedicatedTransferQueue() ? _graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer				= dstBuffer;
+		barrier.offset				= copyRegion.dstOffset;
+		barrier.size				= chunk;
+		batch._acquireBarriers.push_back( barrier );
+
+		++batch._copyCount;
+		uploaded					+= chunk;
+	}
+
+	return _batches[_currentBatch]._ticket;
+}
+
+UploadTicket UploadManager::flush( void ) noexcept
+{
+	std::lock_guard<std::mutex> lock( _mutex );
+
+	if ( ( true == _batches[_currentBatch]._isRecording ) && ( 0 < _batches[_currentBatch]._copyCount ) )
+	{
+		return submitBatch();
+	}
+
+	return _nextTicket - 1;
+}
+
+bool UploadManager::isComplete( const UploadTicket ticket ) noexcept
+{
+	std::lock_guard<std::mutex> lock( _mutex );
+
+	// Retire strictly in submission order, the staging ring is only ever freed from its tail.
+	while ( _completedTicket < ticket )
+	{
+		Batch* oldest = nullptr;
+		for ( Batch& batch : _batches )
+		{
+			if ( ( true == batch._isPending ) && ( ( nullptr == oldest ) || ( batch._ticket < oldest->_ticket ) ) )
+			{
+				oldest = &batch;
+			}
+		}
+
+		if ( ( nullptr == oldest ) || ( VK_SUCCESS != vkGetFenceStatus( _device, oldest->_fence ) ) )
+		{
+			break;
+		}
+
+		retireBatch( *oldest );
+	}
+
+	return ticket <= _completedTicket;
+}
+
+void UploadManager::wait( const UploadTicket ticket ) noexcept
+{
+	{
+		std::lock_guard<std::mutex> lock( _mutex );
+
+		if ( ( true == _batches[_currentBatch]._isRecording ) && ( _batches[_currentBatch]._ticket <= ticket ) && ( 0 < _batches[_currentBatch]._copyCount ) )
+		{
+			submitBatch();
+		}
+
+		for ( Batch& batch : _batches )
+		{
+			if ( ( true == batch._isPending ) && ( batch._ticket <= ticket ) )
+			{
+				vkWaitForFences( _device, 1, &batch._fence, VK_TRUE, UINT64_MAX );
+			}
+		}
+	}
+
+	isComplete( ticket );
+}
+
+bool UploadManager::isDedicatedTransferQueue( void ) const noexcept
+{
+	return _transferFamily != _graphicsFamily;
+}
+
+bool UploadManager::beginBatch( void ) noexcept
+{
+	Batch& batch = _batches[_currentBatch];
+
+	if ( true == batch._isPending )
+	{
+		// Retire everything up to this batch in order; the older fences were submitted first and are normally already signaled.
+		const UploadTicket ticket = batch._ticket;
+
+		for ( Batch& older : _batches )
+		{
+			if ( ( true == older._isPending ) && ( older._ticket <= ticket ) )
+			{
+				vkWaitForFences( _device, 1, &older._fence, VK_TRUE, UINT64_MAX );
+			}
+		}
+
+		for ( Batch& older : _batches )
+		{
+			if ( ( true == older._isPending ) && ( older._ticket <= ticket ) )
+			{
+				retireBatch( older );
+			}
+		}
+	}
+
+	vkResetFences( _device, 1, &batch._fence );
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags				= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if ( VK_SUCCESS != vkBeginCommandBuffer( batch._transferCommandBuffer, &beginInfo ) )
+	{
+		return false;
+	}
+
+	batch._ticket				= _nextTicket;
+	batch._ringBytes			= 0;
+	batch._copyCount			= 0;
+	batch._isRecording			= true;
+	batch._acquireBarriers.clear();
+
+	return true;
+}
+
+UploadTicket UploadManager::submitBatch( void ) noexcept
+{
+	Batch& batch = _batches[_currentBatch];
+
+	// One barrier call for the whole batch. On a dedicated queue these are the release half of the ownership transfer.
+	vkCmdPipelineBarrier( batch._transferCommandBuffer,
+						  VK_PIPELINE_STAGE_TRANSFER_BIT,
+						  isDedicatedTransferQueue() ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+						  0, 0, nullptr,
+						  static_cast<uint32_t>( batch._acquireBarriers.size() ), batch._acquireBarriers.data(),
+						  0, nullptr );
+
+	vkEndCommandBuffer( batch._transferCommandBuffer );
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType					= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount		= 1;
+	submitInfo.pCommandBuffers			= &batch._transferCommandBuffer;
+
+	if ( false == isDedicatedTransferQueue() )
+	{
+		vkQueueSubmit( _transferQueue, 1, &submitInfo, batch._fence );
+	}
+	else
+	{
+		submitInfo.signalSemaphoreCount	= 1;
+		submitInfo.pSignalSemaphores	= &batch._transferSemaphore;
+		vkQueueSubmit( _transferQueue, 1, &submitInfo, VK_NULL_HANDLE );
+
+		// Acquire half of the ownership transfer, on the graphics queue once the copies have landed.
+		for ( VkBufferMemoryBarrier& barrier : batch._acquireBarriers )
+		{
+			barrier.srcAccessMask		= 0;
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType					= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags					= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer( batch._acquireCommandBuffer, &beginInfo );
+		vkCmdPipelineBarrier( batch._acquireCommandBuffer,
+							  VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+							  0, 0, nullptr,
+							  static_cast<uint32_t>( batch._acquireBarriers.size() ), batch._acquireBarriers.data(),
+							  0, nullptr );
+		vkEndCommandBuffer( batch._acquireCommandBuffer );
+
+		const VkPipelineStageFlags waitStage	= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		VkSubmitInfo acquireInfo{};
+		acquireInfo.sType					= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquireInfo.waitSemaphoreCount		= 1;
+		acquireInfo.pWaitSemaphores			= &batch._transferSemaphore;
+		acquireInfo.pWaitDstStageMask		= &waitStage;
+		acquireInfo.commandBufferCount		= 1;
+		acquireInfo.pCommandBuffers			= &batch._acquireCommandBuffer;
+
+		vkQueueSubmit( _graphicsQueue, 1, &acquireInfo, batch._fence );
+	}
+
+	batch._isRecording		= false;
+	batch._isPending		= true;
+
+	_currentBatch			= ( _currentBatch + 1 ) % BATCH_COUNT;
+
+	return _nextTicket++;
+}
+
+void UploadManager::retireBatch( Batch& batch ) noexcept
+{
+	_ringUsed			-= batch._ringBytes;
+	_completedTicket	= std::max( _completedTicket, batch._ticket );
+
+	batch._ringBytes	= 0;
+	batch._isPending	= false;
+
+	if ( 0 == _ringUsed )
+	{
+		_ringHead = 0;
+	}
+}
+
+bool UploadManager::allocateRing( const VkDeviceSize size, VkDeviceSize& offset ) noexcept
+{
+	const VkDeviceSize alignedSize	= ( size + _ringAlignment - 1 ) / _ringAlignment * _ringAlignment;
+
+	// An allocation never wraps; the unused tail of the ring is charged to the batch as padding.
+	const VkDeviceSize padding		= ( _ringSize < _ringHead + alignedSize ) ? _ringSize - _ringHead : 0;
+
+	if ( _ringSize < _ringUsed + padding + std::min( alignedSize, _ringSize ) )
+	{
+		return false;
+	}
+
+	if ( 0 < padding )
+	{
+		_ringHead = 0;
+	}
+
+	offset							= _ringHead;
+	_ringHead						= std::min( _ringHead + alignedSize, _ringSize ) % _ringSize;
+
+	const VkDeviceSize consumed		= padding + std::min( alignedSize, _ringSize );
+	_ringUsed						+= consumed;
+	_batches[_currentBatch]._ringBytes += consumed;
+
+	return true;
+}
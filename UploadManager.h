@@ -0,0 +1,80 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+
+// Monotonic value that is reached once the batch an upload went into is visible to the graphics queue.
+typedef uint64_t UploadTicket;
+
+class UploadManager
+{
+public:
+
+	UploadManager( void );
+
+	bool				create( const VkDevice device, MemoryAllocator& allocator,
+								const VkQueue transferQueue, const uint32_t transferFamily,
+								const VkQueue graphicsQueue, const uint32_t graphicsFamily,
+								const VkDeviceSize ringSize ) noexcept;
+	void				destroy( void ) noexcept;
+
+	// Copies data into the staging ring and records the copy into the open batch; nothing is submitted yet.
+	UploadTicket		upload( const VkBuffer dstBuffer, const VkDeviceSize dstOffset, const void* data, const VkDeviceSize size, const VkAccessFlags dstAccessMask ) noexcept;
+
+	// Submits the open batch, if any, and returns the ticket that covers every upload made so far.
+	UploadTicket		flush( void ) noexcept;
+
+	bool				isComplete( const UploadTicket ticket ) noexcept;
+	void				wait( const UploadTicket ticket ) noexcept;
+
+	bool				isDedicatedTransferQueue( void ) const noexcept;
+
+private:
+
+	static const uint32_t	BATCH_COUNT = 4;
+
+	struct Batch
+	{
+		VkCommandBuffer						_transferCommandBuffer	= VK_NULL_HANDLE;
+		VkCommandBuffer						_acquireCommandBuffer	= VK_NULL_HANDLE;
+		VkSemaphore							_transferSemaphore		= VK_NULL_HANDLE;
+		VkFence								_fence					= VK_NULL_HANDLE;
+
+		UploadTicket						_ticket					= 0;
+		VkDeviceSize						_ringBytes				= 0;
+		uint32_t							_copyCount				= 0;
+		bool								_isRecording			= false;
+		bool								_isPending				= false;
+
+		std::vector<VkBufferMemoryBarrier>	_acquireBarriers;
+	};
+
+	bool				beginBatch( void ) noexcept;
+	UploadTicket		submitBatch( void ) noexcept;
+	void				retireBatch( Batch& batch ) noexcept;
+	bool				allocateRing( const VkDeviceSize size, VkDeviceSize& offset ) noexcept;
+
+	VkDevice							_device;
+	MemoryAllocator*					_allocator;
+
+	VkQueue								_transferQueue;
+	uint32_t							_transferFamily;
+	VkQueue								_graphicsQueue;
+	uint32_t							_graphicsFamily;
+
+	VkCommandPool						_transferCommandPool;
+	VkCommandPool						_graphicsCommandPool;
+
+	VkBuffer							_ringBuffer;
+	Allocation							_ringAllocation;
+	VkDeviceSize						_ringSize;
+	VkDeviceSize						_ringHead;
+	VkDeviceSize						_ringUsed;
+	VkDeviceSize						_ringAlignment;
+
+	std::array<Batch, BATCH_COUNT>		_batches;
+	uint32_t							_currentBatch;
+	UploadTicket						_nextTicket;
+	UploadTicket						_completedTicket;
+
+	std::mutex							_mutex;
+};
@@ -2,17 +2,92 @@
 
 #include "VKApplication.h"
 #include "File.h"
-#include "Vertex.h"
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+const VkDeviceSize UPLOAD_RING_SIZE = 16 * 1024 * 1024;
 
+// Matches constant_id 0 in base.vert.
+const uint32_t OCTAHEDRAL_NORMALS_CONSTANT_ID = 0;
 
-VKApplication::VKApplication( void )
-	: _window{ nullptr }
+// Instance data follows the vertex attributes at locations 0-2 in base.vert.
+const uint32_t INSTANCE_BINDING = 1;
+const uint32_t INSTANCE_FIRST_LOCATION = 3;
+const uint32_t INSTANCE_UPDATE_BATCH = 4096;
+
+// The DrawUniforms block in base.vert.
+const uint32_t UNIFORM_SET = 0;
+const uint32_t UNIFORM_BINDING = 0;
+
+// The albedo sampler in base.frag.
+const uint32_t TEXTURE_SET = 1;
+const uint32_t TEXTURE_BINDING = 0;
+
+// The particles advance by a fixed step per frame, as the uniforms animate by frame number.
+const float PARTICLE_TIME_STEP = 1.0f / 60.0f;
+
+// Indexed by VkPresentModeKHR; the names --present-mode accepts.
+const char* const PRESENT_MODE_NAMES[]		= { "immediate", "mailbox", "fifo", "fifo_relaxed" };
+
+const char* const VERTEX_SHADER_SOURCE		= "base.vert";
+const char* const VERTEX_SHADER_FILE		= "./vert.spv";
+const char* const FRAGMENT_SHADER_SOURCE	= "base.frag";
+const char* const FRAGMENT_SHADER_FILE		= "./frag.spv";
+
+
+VKApplication::VKApplication( const Options& options )
+	: _options{ options }
+	, _window{ nullptr }
 	, _vkInstance{ nullptr }
 	, _physicalDevice{ VK_NULL_HANDLE  }
+	, _surface{ VK_NULL_HANDLE }
+	, _swapChain{ VK_NULL_HANDLE }
+	, _backbufferResource{ 0 }
+	, _colorResource{ 0 }
+	, _depthResource{ 0 }
+	, _drawBufferResource{ 0 }
+	, _drawCountResource{ 0 }
+	, _particleResource{ 0 }
+	, _scenePass{ 0 }
+	, _particlePass{ 0 }
+	, _renderPass{ VK_NULL_HANDLE }
+	, _depthFormat{ VK_FORMAT_UNDEFINED }
+	, _sampleCount{ VK_SAMPLE_COUNT_1_BIT }
+	, _vertexInput{ 0 }
+	, _isReloading{ false }
+	, _hasPendingProgram{ false }
+	, _indexType{ VK_INDEX_TYPE_UINT32 }
+	, _vertexFormat{ ( true == options._compactVertices ) ? CompactVertexLayout::getFormat() : FullVertexLayout::getFormat() }
+	, _instanceCount{ 0 }
+	, _instanceBufferOffset{ 0 }
+	, _gpuCulling{ false }
+	, _drawIndexedIndirectCount{ nullptr }
+	, _visibleCount{ 0 }
+	, _cpuCulling{ false }
+	, _uniformSetLayout{ VK_NULL_HANDLE }
+	, _textureSetLayout{ VK_NULL_HANDLE }
+	, _texture{ TextureStreamer::DEFAULT_TEXTURE }
+	, _particles{ 0 < options._particleCount }
+	, _isMeasuringParticles{ false }
+	, _recordingFrame{ 0 }
+	, _framesInFlight{ options._framesInFlight }
 	, _currentFrame{ 0 }
+	, _frameNumber{ 0 }
+	, _framebufferResized{ false }
+	, _presentMode{ VK_PRESENT_MODE_FIFO_KHR }
+	, _timestampQueryPool{ VK_NULL_HANDLE }
+	, _timestampQueryCount{ 0 }
+	, _timestampPeriod{ 0.0f }
+	, _timestampMask{ ~0ull }
+	, _startupMs{ 0.0 }
 {
+	if ( true == _options._benchmark )
+	{
+		_benchmark.configure( _options._warmupFrames, _options._frameCount );
+	}
+
+	_recordDrawsCallback = [this]( VkCommandBuffer commandBuffer, const uint32_t firstDraw, const uint32_t drawCount )
+	{
+		recordDraws( commandBuffer, firstDraw, drawCount );
+	};
 
 }
 
@@ -21,22 +96,66 @@ VKApplication::~VKApplication( void )
 
 }
 
-void VKApplication::run( void ) noexcept
+bool VKApplication::run( void ) noexcept
 {
-	initializeWindow();
-	initializeVKApplication();
-	runLoop();
+	if ( false == _options._headless )
+	{
+		initializeWindow();
+	}
+
+	if ( false == initializeVKApplication() )
+	{
+		std::cerr << "failed to initialize vulkan" << std::endl;
+		return false;
+	}
+
+	bool isValid = true;
+
+	if ( true == _options._recordBenchmark )
+	{
+		runRecordingBenchmark();
+	}
+	else if ( ( true == _options._particleBenchmark ) && ( true == _particles ) )
+	{
+		runParticleBenchmark();
+	}
+	else
+	{
+		isValid = runLoop();
+	}
+
 	clean();
+
+	return isValid;
 }
 
 bool VKApplication::initializeVKApplication( void ) noexcept
 {
+	const auto startupBegin = std::chrono::steady_clock::now();
+
+	uint32_t jobThreadCount = _options._jobThreads;
+	if ( 0 == jobThreadCount )
+	{
+		jobThreadCount = std::max( std::thread::hardware_concurrency(), 1u );
+	}
+
+	if ( false == _jobSystem.create( jobThreadCount ) )
+	{
+		return false;
+	}
+
+	// The mesh file is read on the workers while the device and pipeline are set up; loadMesh() waits for it.
+	if ( false == _options._meshFile.empty() )
+	{
+		_meshRead.start( _options._meshFile, _jobSystem );
+	}
+
 	if ( false == createVKInstance() )
 	{
 		return false;
 	}
 
-	if ( false == createSurface() )
+	if ( ( false == _options._headless ) && ( false == createSurface() ) )
 	{
 		return false;
 	}
@@ -51,7 +170,28 @@ bool VKApplication::initializeVKApplication( void ) noexcept
 		return false;
 	}
 
-	if ( false == createSwapChain() )
+	if ( false == _allocator.create( _physicalDevice, _device ) )
+	{
+		return false;
+	}
+
+	if ( false == _pipelineCache.create( _device, _physicalDevice, _options._pipelineCacheFile ) )
+	{
+		return false;
+	}
+
+	_layoutCache.create( _device );
+	_pipelineManager.create( _device, _pipelineCache, _jobSystem );
+	_renderGraph.create( _device, _allocator );
+
+	if ( true == _options._headless )
+	{
+		if ( false == createOffscreenImages() )
+		{
+			return false;
+		}
+	}
+	else if ( false == createSwapChain() )
 	{
 		return false;
 	}
@@ -61,7 +201,7 @@ bool VKApplication::initializeVKApplication( void ) noexcept
 		return false;
 	}
 
-	if ( false == createRenderPass() )
+	if ( false == createRenderGraph() )
 	{
 		return false;
 	}
@@ -71,12 +211,28 @@ bool VKApplication::initializeVKApplication( void ) noexcept
 		return false;
 	}
 
-	if ( false == createFramebuffers() )
+	if ( false == createCommandRecorder() )
+	{
+		return false;
+	}
+
+	if ( false == createTimestampQueryPool() )
+	{
+		return false;
+	}
+
+	if ( ( true == _particles ) && ( false == createParticleSystem() ) )
+	{
+		return false;
+	}
+
+	if ( false == loadMesh() )
 	{
 		return false;
 	}
 
-	if ( false == createCommandPool() )
+	QueueFamilyIndices indices = findQueueFamilies( _physicalDevice );
+	if ( false == _uploadManager.create( _device, _allocator, _transferQueue, indices._transferFamily.value(), _graphicsQueue, indices._graphicsFamily.value(), UPLOAD_RING_SIZE ) )
 	{
 		return false;
 	}
@@ -91,16 +247,56 @@ bool VKApplication::initializeVKApplication( void ) noexcept
 		return false;
 	}
 
-	if ( false == createCommandBuffers() )
+	createDrawCommands();
+
+	if ( true == _gpuCulling )
+	{
+		if ( false == createGpuCuller() )
+		{
+			return false;
+		}
+	}
+	else if ( false == _instanceBuffer.create( _allocator, _instanceCount, _framesInFlight ) )
+	{
+		return false;
+	}
+	else if ( true == _options._cpuCulling )
+	{
+		createFrustumCuller();
+	}
+
+	if ( false == createUniformRing() )
+	{
+		return false;
+	}
+
+	if ( false == createTextureStreamer() )
 	{
 		return false;
 	}
 
+	// The meshes and any object data went into one batch; this is the only point at which loading waits for the GPU.
+	_uploadManager.wait( _uploadManager.flush() );
+
 	if ( false == createSyncObjects() )
 	{
 		return false;
 	}
 
+	_startupMs = Benchmark::millisecondsSince( startupBegin );
+	std::cout << "startup: " << _startupMs << " ms" << std::endl;
+	_pipelineManager.printStatistics();
+
+	std::cout << "frame pacing: " << ( ( true == _options._headless ) ? "headless" : PRESENT_MODE_NAMES[_presentMode] ) << ", " << _framesInFlight << " frames in flight"
+			  << ( ( true == _options._lowLatency ) ? ", low latency" : "" ) << std::endl;
+	std::cout << "render targets: " << _sampleCount << "x MSAA with depth, " << _renderGraph.getTransientBytes() << " bytes of transient attachments, "
+			  << _renderGraph.getLazyBytes() << " lazily allocated" << std::endl;
+
+	if ( true == _options._watchShaders )
+	{
+		startShaderWatcher();
+	}
+
 	return true;
 }
 
@@ -119,10 +315,6 @@ bool VKApplication::createVKInstance( void ) noexcept
 	createInfo.sType			= VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	createInfo.pApplicationInfo = &appInfo;
 
-	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions = nullptr;
-	glfwExtensions				= glfwGetRequiredInstanceExtensions( &glfwExtensionCount );
-
 	auto extensions						= getRequiredExtensions();
 	createInfo.enabledExtensionCount	= static_cast<uint32_t>( extensions.size() );
 	createInfo.ppEnabledExtensionNames	= extensions.data();
@@ -165,6 +357,9 @@ bool VKApplication::pickPhysicalDevice( void ) noexcept
 		return false;
 	}
 
+	_depthFormat	= findDepthFormat( _physicalDevice );
+	_sampleCount	= chooseSampleCount( _physicalDevice );
+
 	return true;
 }
 
@@ -174,6 +369,11 @@ bool VKApplication::isDeviceSuitable( const VkPhysicalDevice device ) const noex
 
 	bool extensionsSupported	= checkDeviceExtensionSupport( device );
 
+	if ( true == _options._headless )
+	{
+		return indices.isComplete() && ( true == extensionsSupported ) && ( VK_FORMAT_UNDEFINED != findOffscreenFormat( device ) );
+	}
+
 	bool swapChainAdequate = false;
 	if ( true == extensionsSupported) 
 	{
@@ -193,6 +393,7 @@ bool VKApplication::checkDeviceExtensionSupport( const VkPhysicalDevice device )
 	std::vector<VkExtensionProperties> availableExtensions( extensionCount );
 	vkEnumerateDeviceExtensionProperties( device, nullptr, &extensionCount, availableExtensions.data() );
 
+	const std::vector<const char*> deviceExtensions = getRequiredDeviceExtensions();
 	std::set<std::string> requiredExtensions( deviceExtensions.begin(), deviceExtensions.end() );
 
 	for ( const auto& extension : availableExtensions )
@@ -203,6 +404,88 @@ bool VKApplication::checkDeviceExtensionSupport( const VkPhysicalDevice device )
 	return requiredExtensions.empty();
 }
 
+bool VKApplication::isDeviceExtensionAvailable( const VkPhysicalDevice device, const char* extensionName ) const noexcept
+{
+	uint32_t extensionCount = 0;
+
+	vkEnumerateDeviceExtensionProperties( device, nullptr, &extensionCount, nullptr );
+
+	std::vector<VkExtensionProperties> availableExtensions( extensionCount );
+	vkEnumerateDeviceExtensionProperties( device, nullptr, &extensionCount, availableExtensions.data() );
+
+	return availableExtensions.end() != std::find_if( availableExtensions.begin(), availableExtensions.end(), [extensionName]( const VkExtensionProperties& extension )
+	{
+		return 0 == std::strcmp( extension.extensionName, extensionName );
+	} );
+}
+
+VkFormat VKApplication::findOffscreenFormat( const VkPhysicalDevice device ) const noexcept
+{
+	const VkFormat candidates[] =
+	{
+		VK_FORMAT_B8G8R8A8_SRGB,
+		VK_FORMAT_R8G8B8A8_SRGB,
+		VK_FORMAT_B8G8R8A8_UNORM,
+		VK_FORMAT_R8G8B8A8_UNORM
+	};
+
+	for ( const VkFormat format : candidates )
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties( device, format, &properties );
+
+		if ( properties.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT )
+		{
+			return format;
+		}
+	}
+
+	return VK_FORMAT_UNDEFINED;
+}
+
+VkFormat VKApplication::findDepthFormat( const VkPhysicalDevice device ) const noexcept
+{
+	// Every device supports D16 as a depth attachment; the others are preferred for their precision.
+	const VkFormat candidates[] =
+	{
+		VK_FORMAT_D32_SFLOAT,
+		VK_FORMAT_X8_D24_UNORM_PACK32,
+		VK_FORMAT_D16_UNORM
+	};
+
+	for ( const VkFormat format : candidates )
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties( device, format, &properties );
+
+		if ( properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT )
+		{
+			return format;
+		}
+	}
+
+	return VK_FORMAT_D16_UNORM;
+}
+
+VkSampleCountFlagBits VKApplication::chooseSampleCount( const VkPhysicalDevice device ) const noexcept
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties( device, &properties );
+
+	// The color and depth attachments are multisampled together, so both have to support the count.
+	const VkSampleCountFlags supported = properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts;
+
+	for ( uint32_t count = VK_SAMPLE_COUNT_64_BIT; VK_SAMPLE_COUNT_1_BIT < count; count /= 2 )
+	{
+		if ( ( count <= _options._sampleCount ) && ( 0 != ( supported & count ) ) )
+		{
+			return static_cast<VkSampleCountFlagBits>( count );
+		}
+	}
+
+	return VK_SAMPLE_COUNT_1_BIT;
+}
+
 QueueFamilyIndices VKApplication::findQueueFamilies( const VkPhysicalDevice device ) const noexcept
 {
 	QueueFamilyIndices indices;
@@ -216,13 +499,22 @@ QueueFamilyIndices VKApplication::findQueueFamilies( const VkPhysicalDevice devi
 	int ii = 0;
     for ( const auto& queueFamily : queueFamilies )
 	{
-        if ( queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT )
+		// Compute passes (culling, particles) are recorded into the frame's command buffer, so the graphics
+		// family has to run them too. Vulkan guarantees such a family when there is a graphics one.
+		const VkQueueFlags graphicsAndCompute = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+
+        if ( graphicsAndCompute == ( queueFamily.queueFlags & graphicsAndCompute ) )
 		{
             indices._graphicsFamily = ii;
+            indices._timestampValidBits = queueFamily.timestampValidBits;
         }
 
-		VkBool32 isPresentSupport		= false;
-		vkGetPhysicalDeviceSurfaceSupportKHR( device, ii, _surface, &isPresentSupport );
+		// Headless frames are retired by fences on the graphics queue, there is nothing to present to.
+		VkBool32 isPresentSupport		= _options._headless && ( queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT );
+		if ( false == _options._headless )
+		{
+			vkGetPhysicalDeviceSurfaceSupportKHR( device, ii, _surface, &isPresentSupport );
+		}
 
 		if ( true == isPresentSupport )
 		{
@@ -237,11 +529,33 @@ QueueFamilyIndices VKApplication::findQueueFamilies( const VkPhysicalDevice devi
         ii++;
     }
 
+	// A transfer-only family maps to the copy engine, so uploads there run alongside rendering.
+	for ( uint32_t jj = 0; jj < queueFamilyCount; ++jj )
+	{
+		const VkQueueFlags flags = queueFamilies[jj].queueFlags;
+
+		if ( ( flags & VK_QUEUE_TRANSFER_BIT ) && ( 0 == ( flags & ( VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT ) ) ) )
+		{
+			indices._transferFamily = jj;
+			break;
+		}
+	}
+
+	if ( false == indices._transferFamily.has_value() )
+	{
+		indices._transferFamily = indices._graphicsFamily;
+	}
+
 	return indices;
 }
 
 std::vector<const char*> VKApplication::getRequiredExtensions( void ) const noexcept
 {
+	if ( true == _options._headless )
+	{
+		return std::vector<const char*>();
+	}
+
 	uint32_t glfwExtensionCount		= 0;
 	const char** glfwExtensions		= nullptr;
 	glfwExtensions					= glfwGetRequiredInstanceExtensions( &glfwExtensionCount );
@@ -251,6 +565,16 @@ std::vector<const char*> VKApplication::getRequiredExtensions( void ) const noex
 	return extensions;
 }
 
+std::vector<const char*> VKApplication::getRequiredDeviceExtensions( void ) const noexcept
+{
+	if ( true == _options._headless )
+	{
+		return std::vector<const char*>();
+	}
+
+	return deviceExtensions;
+}
+
 SwapChainSupportDetails VKApplication::querySwapChainSupport( const VkPhysicalDevice device ) const noexcept
 {
 	SwapChainSupportDetails details;
@@ -294,6 +618,21 @@ VkSurfaceFormatKHR VKApplication::chooseSwapSurfaceFormat( const std::vector<VkS
 
 VkPresentModeKHR VKApplication::chooseSwapPresentMode( const std::vector<VkPresentModeKHR>& availablePresentModes ) const noexcept
 {
+	// FIFO is the one mode every surface supports, so a requested mode that is missing falls back to it.
+	if ( false == _options._presentMode.empty() )
+	{
+		for ( const auto& availablePresentMode : availablePresentModes )
+		{
+			if ( ( static_cast<size_t>( availablePresentMode ) < std::size( PRESENT_MODE_NAMES ) ) && ( _options._presentMode == PRESENT_MODE_NAMES[availablePresentMode] ) )
+			{
+				return availablePresentMode;
+			}
+		}
+
+		std::cerr << "present mode " << _options._presentMode << " is not available, using fifo" << std::endl;
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
+
 	for ( const auto& availablePresentMode : availablePresentModes )
 	{
 		if ( VK_PRESENT_MODE_MAILBOX_KHR == availablePresentMode ) 
@@ -329,23 +668,6 @@ VkExtent2D VKApplication::chooseSwapExtent(const VkSurfaceCapabilitiesKHR & capa
 	return actualExtent;
 }
 
-uint32_t VKApplication::findMemoryType( uint32_t typeFilter, VkMemoryPropertyFlags properties ) const noexcept
-{
-	VkPhysicalDeviceMemoryProperties memoryProperties;
-	vkGetPhysicalDeviceMemoryProperties( _physicalDevice, &memoryProperties );
-
-	for ( uint32_t ii = 0; ii < memoryProperties.memoryTypeCount; ++ii ) 
-	{
-		if ( ( typeFilter & ( 1 << ii ) ) && 
-			 ( memoryProperties.memoryTypes[ii].propertyFlags & properties ) == properties ) 
-		{
-			return ii;
-		}
-	}
-
-	return -1;
-}
-
 bool VKApplication::createLogicalDevice( void ) noexcept
 {
 	QueueFamilyIndices indices = findQueueFamilies( _physicalDevice );
@@ -353,7 +675,7 @@ bool VKApplication::createLogicalDevice( void ) noexcept
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	queueCreateInfos.clear();
 
-    std::set<uint32_t> uniqueQueueFamilies		= { indices._graphicsFamily.value(), indices._presentFamily.value() };
+    std::set<uint32_t> uniqueQueueFamilies		= { indices._graphicsFamily.value(), indices._presentFamily.value(), indices._transferFamily.value() };
 	
 	const float queuePriority = 1.0f;
 	for ( uint32_t queueFamily : uniqueQueueFamilies )
@@ -368,6 +690,34 @@ bool VKApplication::createLogicalDevice( void ) noexcept
 
 	VkPhysicalDeviceFeatures deviceFeatures{};
 
+	std::vector<const char*> deviceExtensions = getRequiredDeviceExtensions();
+	bool hasDrawIndirectCount = false;
+
+	// GPU culling needs one draw call per object from a single indirect call; without it the CPU keeps issuing the draws.
+	if ( true == _options._gpuCulling )
+	{
+		VkPhysicalDeviceFeatures supportedFeatures{};
+		vkGetPhysicalDeviceFeatures( _physicalDevice, &supportedFeatures );
+
+		_gpuCulling = GpuCuller::isSupported( supportedFeatures );
+
+		if ( true == _gpuCulling )
+		{
+			deviceFeatures.multiDrawIndirect			= VK_TRUE;
+			deviceFeatures.drawIndirectFirstInstance	= VK_TRUE;
+
+			hasDrawIndirectCount = ( true == _options._indirectCount ) && ( true == isDeviceExtensionAvailable( _physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME ) );
+			if ( true == hasDrawIndirectCount )
+			{
+				deviceExtensions.push_back( VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME );
+			}
+		}
+		else
+		{
+			std::cerr << "gpu culling: multiDrawIndirect or drawIndirectFirstInstance is not supported, drawing from the CPU" << std::endl;
+		}
+	}
+
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType							= VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
@@ -386,6 +736,12 @@ bool VKApplication::createLogicalDevice( void ) noexcept
 
 	vkGetDeviceQueue( _device, indices._graphicsFamily.value(), 0, &_graphicsQueue );
 	vkGetDeviceQueue( _device, indices._presentFamily.value(), 0, &_presentQueue );
+	vkGetDeviceQueue( _device, indices._transferFamily.value(), 0, &_transferQueue );
+
+	if ( true == hasDrawIndirectCount )
+	{
+		_drawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>( vkGetDeviceProcAddr( _device, "vkCmdDrawIndexedIndirectCountKHR" ) );
+	}
 
 	return true;
 }
@@ -445,10 +801,23 @@ bool VKApplication::createSwapChain( void ) noexcept
 	createInfo.presentMode						= presentMode;
 	createInfo.clipped							= VK_TRUE;
 
-	createInfo.oldSwapchain						= VK_NULL_HANDLE;
+	// Handing over the old swapchain lets the presentation engine reuse its resources.
+	createInfo.oldSwapchain						= _swapChain;
+
+	VkSwapchainKHR swapChain					= VK_NULL_HANDLE;
+	const VkResult result						= vkCreateSwapchainKHR( _device, &createInfo, nullptr, &swapChain );
+
+	// The old swapchain may still have presents queued from frames in flight.
+	if ( VK_NULL_HANDLE != _swapChain )
+	{
+		const VkDevice device			= _device;
+		const VkSwapchainKHR retired	= _swapChain;
+		_deletionQueue.retire( _frameNumber, [device, retired]( void ) { vkDestroySwapchainKHR( device, retired, nullptr ); } );
+	}
 
+	_swapChain									= swapChain;
 
-	if ( VK_SUCCESS != vkCreateSwapchainKHR( _device, &createInfo, nullptr, &_swapChain ) ) 
+	if ( VK_SUCCESS != result ) 
 	{
 		return false;
 	}
@@ -459,6 +828,7 @@ bool VKApplication::createSwapChain( void ) noexcept
 
 	_swapChainImageFormat						= surfaceFormat.format;
 	_swapChainExtent							= extent;
+	_presentMode								= presentMode;
 
 	return true;
 }
@@ -474,14 +844,94 @@ bool VKApplication::recreateSwapChain( void ) noexcept
 		glfwWaitEvents();
 	}
 
-	vkDeviceWaitIdle( _device );
+	// Frames in flight keep rendering to and presenting the old images; they are destroyed once those frames complete.
+	retireSwapChain();
+
+	const VkFormat previousFormat = _swapChainImageFormat;
+
+	if ( false == createSwapChain() )
+	{
+		return false;
+	}
+
+	if ( false == createImageViews() )
+	{
+		return false;
+	}
+
+	// Compiles still queued were queued against the current render pass, so they have to finish first.
+	_pipelineManager.finish();
+
+	// The graph's framebuffers and transient images are sized for the old swapchain; frames in flight still use them.
+	_renderGraph.retire( _deletionQueue, _frameNumber );
+
+	if ( false == createRenderGraph() )
+	{
+		return false;
+	}
+
+	// Viewport and scissor are dynamic, so pipelines only depend on the surface format; the new render pass is
+	// compatible with the old one otherwise. Pipelines for the old format stay cached in case it comes back.
+	if ( previousFormat != _swapChainImageFormat )
+	{
+		// A reload that finish() completed switches over first, so it is not lost with the old format.
+		applyPendingPipeline();
+
+		_sceneKey._colorFormat	= _swapChainImageFormat;
+		_graphicsPipeline		= _pipelineManager.require( _sceneKey, _renderPass );
+
+		if ( VK_NULL_HANDLE == _graphicsPipeline )
+		{
+			return false;
+		}
+
+		if ( true == _options._pipelinePermutations )
+		{
+			requestPermutations();
+		}
+
+		if ( ( true == _particles ) &&
+			 ( false == _particleSystem.createRenderPipeline( _renderGraph.getRenderPass( _particlePass ), _renderGraph.getSubpass( _particlePass ), _sampleCount, _deletionQueue, _frameNumber ) ) )
+		{
+			return false;
+		}
+	}
+
+	_imagesInFlight.assign( _swapChainImages.size(), VK_NULL_HANDLE );
+	_timestampsWritten.assign( _timestampsWritten.size(), false );
+
+	return true;
+}
+
+bool VKApplication::createOffscreenImages( void ) noexcept
+{
+	_swapChainImageFormat						= findOffscreenFormat( _physicalDevice );
+	_swapChainExtent							= { WIDTH, HEIGHT };
+
+	// One render target per frame in flight, so a target is only reused once its frame fence has signaled.
+	_swapChainImages.resize( _framesInFlight, VK_NULL_HANDLE );
+	_offscreenImageAllocations.resize( _framesInFlight );
 
-	createSwapChain();
-	createImageViews();
-	createRenderPass();
-	createGraphicsPipeline();
-	createFramebuffers();
-	createCommandBuffers();
+	for ( uint32_t ii = 0; ii < _framesInFlight; ++ii )
+	{
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType							= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType						= VK_IMAGE_TYPE_2D;
+		imageInfo.format						= _swapChainImageFormat;
+		imageInfo.extent						= { _swapChainExtent.width, _swapChainExtent.height, 1 };
+		imageInfo.mipLevels						= 1;
+		imageInfo.arrayLayers					= 1;
+		imageInfo.samples						= VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling						= VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage							= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageInfo.sharingMode					= VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout					= VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if ( false == _allocator.createImage( imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _swapChainImages[ii], _offscreenImageAllocations[ii] ) )
+		{
+			return false;
+		}
+	}
 
 	return true;
 }
@@ -518,476 +968,1319 @@ bool VKApplication::createImageViews( void ) noexcept
 	return true;
 }
 
-bool VKApplication::createRenderPass( void ) noexcept
+bool VKApplication::createRenderGraph( void ) noexcept
 {
-	VkAttachmentDescription colorAttachment{};
-	colorAttachment.format				= _swapChainImageFormat;
-	colorAttachment.samples				= VK_SAMPLE_COUNT_1_BIT;
-
-	colorAttachment.loadOp				= VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp				= VK_ATTACHMENT_STORE_OP_STORE;
+	// The acquire semaphore is waited on at the color attachment stage, so that is where the backbuffer becomes available.
+	_backbufferResource		= _renderGraph.importImage( "backbuffer", _swapChainImageFormat, _swapChainExtent, VK_SAMPLE_COUNT_1_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+	_renderGraph.setOutput( _backbufferResource, ( true == _options._headless ) ? ResourceUsage::TransferRead : ResourceUsage::Present );
 
-	colorAttachment.stencilLoadOp		= VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp		= VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	if ( true == _gpuCulling )
+	{
+		// The host reads the count back once the frame's fence has signaled.
+		_drawBufferResource	= _renderGraph.importBuffer( "draws" );
+		_drawCountResource	= _renderGraph.importBuffer( "drawCount" );
+		_renderGraph.setOutput( _drawCountResource, ResourceUsage::HostRead );
 
-	colorAttachment.initialLayout		= VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout			= VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		const uint32_t cullPass = _renderGraph.addPass( "cull", PassType::Compute, [this]( const VkCommandBuffer commandBuffer )
+		{
+			_gpuCuller.recordCulling( commandBuffer, _recordingFrame );
+		} );
 
-	VkAttachmentReference colorAttachmentReference{};
-	colorAttachmentReference.attachment = 0;
-	colorAttachmentReference.layout		= VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		_renderGraph.use( cullPass, _drawBufferResource, ResourceUsage::StorageWrite );
+		_renderGraph.use( cullPass, _drawCountResource, ResourceUsage::StorageWrite );
+	}
 
-	VkSubpassDescription subpass{};
-	subpass.pipelineBindPoint			= VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount		= 1;
-	subpass.pColorAttachments			= &colorAttachmentReference;
+	if ( true == _particles )
+	{
+		// Simulated in place, so each frame's dispatch also waits for the previous frame's draw.
+		_particleResource	= _renderGraph.importBuffer( "particles" );
+		_renderGraph.setPersistent( _particleResource );
 
-	VkRenderPassCreateInfo renderPassInfo{};
-	renderPassInfo.sType				= VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount		= 1;
-	renderPassInfo.pAttachments			= &colorAttachment;
-	renderPassInfo.subpassCount			= 1;
-	renderPassInfo.pSubpasses			= &subpass;
+		const uint32_t simulatePass = _renderGraph.addPass( "simulate", PassType::Compute, [this]( const VkCommandBuffer commandBuffer )
+		{
+			_particleSystem.recordSimulation( commandBuffer, _recordingFrame, PARTICLE_TIME_STEP, _frameNumber );
+		} );
 
-	if ( VK_SUCCESS != vkCreateRenderPass( _device, &renderPassInfo, nullptr, &_renderPass ) )
-	{
-		return false;
+		_renderGraph.use( simulatePass, _particleResource, ResourceUsage::StorageWrite );
 	}
 
-	return true;
-}
+	_scenePass = _renderGraph.addPass( "scene", PassType::Graphics, [this]( const VkCommandBuffer commandBuffer )
+	{
+		_commandRecorder.executeSecondaries( _recordingFrame, commandBuffer );
+	} );
 
-bool VKApplication::createGraphicsPipeline( void ) noexcept
-{
-	auto vertShaderCode				= File::readFile( "./vert.spv" );
-	auto fragShaderCode				= File::readFile( "./frag.spv" );
+	// Multisampled color and depth only live inside the scene pass: they are never stored, and only the resolved
+	// backbuffer leaves it. The graph makes them transient attachments in lazily allocated memory where there is some.
+	VkClearValue clearColor	= { 0.0f, 0.0f, 0.0f, 1.0f };
+	VkClearValue clearDepth	= {};
+	clearDepth.depthStencil	= { 1.0f, 0 };
 
-	VkShaderModule vertShaderModule = createShaderModule( vertShaderCode );
-	VkShaderModule fragShaderModule = createShaderModule( fragShaderCode );
+	_depthResource			= _renderGraph.createImage( "depth", _depthFormat, _swapChainExtent, _sampleCount );
+	_colorResource			= ( VK_SAMPLE_COUNT_1_BIT != _sampleCount ) ? _renderGraph.createImage( "color", _swapChainImageFormat, _swapChainExtent, _sampleCount ) : _backbufferResource;
 
-	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-	vertShaderStageInfo.sType		= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertShaderStageInfo.stage		= VK_SHADER_STAGE_VERTEX_BIT;
-	vertShaderStageInfo.module		= vertShaderModule;
-	vertShaderStageInfo.pName		= "main";
+	_renderGraph.clear( _scenePass, _depthResource, ResourceUsage::DepthAttachment, clearDepth );
+	_renderGraph.clear( _scenePass, _colorResource, ResourceUsage::ColorAttachment, clearColor );
+	_renderGraph.setSecondaryContents( _scenePass );
 
-	VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-	fragShaderStageInfo.sType		= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragShaderStageInfo.stage		= VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragShaderStageInfo.module		= fragShaderModule;
-	fragShaderStageInfo.pName		= "main";
+	if ( true == _gpuCulling )
+	{
+		_renderGraph.use( _scenePass, _drawBufferResource, ResourceUsage::IndirectRead );
+		_renderGraph.use( _scenePass, _drawCountResource, ResourceUsage::IndirectRead );
+	}
 
-	VkPipelineShaderStageCreateInfo shaderStages[]	= { vertShaderStageInfo, fragShaderStageInfo };
+	// The particles are drawn over the scene in a second subpass of its render pass, so the last pass resolves.
+	uint32_t lastPass		= _scenePass;
 
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-	vertexInputInfo.sType							= VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	if ( true == _particles )
+	{
+		_particlePass		= _renderGraph.addPass( "particles", PassType::Graphics, [this]( const VkCommandBuffer commandBuffer )
+		{
+			_particleSystem.recordDraw( commandBuffer, _recordingFrame, _swapChainExtent );
+		} );
+
+		_renderGraph.use( _particlePass, _depthResource, ResourceUsage::DepthAttachment );
+		_renderGraph.use( _particlePass, _colorResource, ResourceUsage::ColorAttachment );
+		_renderGraph.use( _particlePass, _particleResource, ResourceUsage::VertexRead );
+		lastPass			= _particlePass;
+	}
+
+	if ( VK_SAMPLE_COUNT_1_BIT != _sampleCount )
+	{
+		_renderGraph.resolve( lastPass, _colorResource, _backbufferResource );
+	}
+
+	if ( false == _renderGraph.compile() )
+	{
+		std::cerr << "failed to compile the render graph" << std::endl;
+		return false;
+	}
+
+	_renderPass = _renderGraph.getRenderPass( _scenePass );
+
+	if ( true == _options._dumpRenderGraph )
+	{
+		_renderGraph.dump( std::cout );
+	}
+
+	return true;
+}
+
+bool VKApplication::createGraphicsPipeline( void ) noexcept
+{
+	SceneProgram program;
+
+	if ( false == loadSceneProgram( program ) )
+	{
+		return false;
+	}
+
+	if ( false == acceptSetLayouts( program ) )
+	{
+		vkDestroyShaderModule( _device, program._program._vertexModule, nullptr );
+		vkDestroyShaderModule( _device, program._program._fragmentModule, nullptr );
+		return false;
+	}
+
+	std::vector<VkVertexInputBindingDescription> bindings;
+	std::vector<VkVertexInputAttributeDescription> attributes;
+	getSceneVertexInput( bindings, attributes );
+
+	_vertexInput		= _pipelineManager.addVertexInput( bindings, attributes );
+	_sceneKey			= getSceneKey( _pipelineManager.addProgram( std::move( program._program ) ) );
+	_pipelineLayout		= _pipelineManager.getLayout( _sceneKey._program );
+
+	// Nothing can be drawn without the scene pipeline, so it is compiled on the critical path; the permutations
+	// follow on the workers while the mesh and the rest of the device objects load.
+	_graphicsPipeline	= _pipelineManager.require( _sceneKey, _renderPass );
+
+	if ( VK_NULL_HANDLE == _graphicsPipeline )
+	{
+		return false;
+	}
+
+	if ( true == _options._pipelinePermutations )
+	{
+		requestPermutations();
+	}
+
+	return true;
+}
+
+void VKApplication::getSceneVertexInput( std::vector<VkVertexInputBindingDescription>& bindings, std::vector<VkVertexInputAttributeDescription>& attributes ) const noexcept
+{
+	// Mesh vertices on binding 0, per-instance data on its own binding.
+	bindings						= { _vertexFormat.getBindingDescription( 0 ), InstanceData::getBindingDescription( INSTANCE_BINDING ) };
+	const auto instanceAttributes	= InstanceData::getAttributeDescriptions( INSTANCE_BINDING, INSTANCE_FIRST_LOCATION );
+
+	attributes.assign( _vertexFormat._attributes, _vertexFormat._attributes + _vertexFormat._attributeCount );
+	attributes.insert( attributes.end(), instanceAttributes.begin(), instanceAttributes.end() );
+}
+
+PipelineKey VKApplication::getSceneKey( const uint32_t program ) const noexcept
+{
+	// The remaining defaults are the scene's own state: opaque triangles, back faces culled, depth tested and written.
+	PipelineKey key;
+	key._program		= program;
+	key._vertexInput	= _vertexInput;
+	key._colorFormat	= _swapChainImageFormat;
+	key._depthFormat	= _depthFormat;
+	key._samples		= _sampleCount;
+	key._subpass		= _renderGraph.getSubpass( _scenePass );
+
+	return key;
+}
+
+void VKApplication::requestPermutations( void ) noexcept
+{
+	const VkPrimitiveTopology topologies[]	= { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP };
+	const VkCullModeFlags cullModes[]		= { VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_FRONT_BIT, VK_CULL_MODE_NONE };
+	const VkBool32 depthWrites[]			= { VK_TRUE, VK_FALSE };
+
+	PipelineKey key = _sceneKey;
+
+	for ( const VkPrimitiveTopology topology : topologies )
+	{
+		for ( const VkCullModeFlags cullMode : cullModes )
+		{
+			for ( const VkBool32 depthWrite : depthWrites )
+			{
+				for ( uint32_t blendMode = 0; blendMode < static_cast<uint32_t>( BlendMode::Count ); ++blendMode )
+				{
+					key._topology	= topology;
+					key._cullMode	= cullMode;
+					key._depthWrite	= depthWrite;
+					key._blendMode	= static_cast<BlendMode>( blendMode );
+
+					_pipelineManager.request( key, _renderPass );
+				}
+			}
+		}
+	}
+}
+
+bool VKApplication::loadSceneProgram( SceneProgram& program ) noexcept
+{
+	// Also runs on the watcher thread for reloads, so it writes nothing but the thread-safe layout cache and the
+	// program; the set layouts are taken over by acceptSetLayouts() on the render thread.
+	// The modules are read straight from the mapped files, without a copy.
+	MappedFile vertShaderCode;
+	MappedFile fragShaderCode;
+
+	if ( ( false == loadShaderCode( VERTEX_SHADER_FILE, vertShaderCode ) ) || ( false == loadShaderCode( FRAGMENT_SHADER_FILE, fragShaderCode ) ) )
+	{
+		return false;
+	}
+
+	// The pipeline layout, specialization and vertex input checks all come from the shaders themselves.
+	ShaderReflection reflection;
+	ShaderReflection fragReflection;
+
+	if ( ( false == reflection.reflect( vertShaderCode.getWords(), vertShaderCode.getWordCount() ) ) || ( false == fragReflection.reflect( fragShaderCode.getWords(), fragShaderCode.getWordCount() ) ) )
+	{
+		return false;
+	}
+
+	reflection.merge( fragReflection );
+
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+	getSceneVertexInput( bindingDescriptions, attributeDescriptions );
+
+	// Octahedral normals are two components read into the shader's vec3 and unfolded there.
+	uint64_t expandedLocations = 0;
+
+	for ( const VkVertexInputAttributeDescription& attribute : attributeDescriptions )
+	{
+		if ( ( true == _vertexFormat._hasOctahedralNormals ) && ( Octahedral16Encoding::FORMAT == attribute.format ) && ( attribute.location < 64 ) )
+		{
+			expandedLocations |= 1ull << attribute.location;
+		}
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties( _physicalDevice, &properties );
+
+	if ( false == reflection.validateVertexInput( attributeDescriptions.data(), static_cast<uint32_t>( attributeDescriptions.size() ), properties.limits.maxVertexInputAttributes, expandedLocations ) )
+	{
+		return false;
+	}
+
+	// Only constants the shader actually declares are specialized.
+	const ShaderSpecializationConstant* octahedralNormalsConstant = reflection.findSpecializationConstant( OCTAHEDRAL_NORMALS_CONSTANT_ID );
+
+	if ( ( nullptr == octahedralNormalsConstant ) && ( true == _vertexFormat._hasOctahedralNormals ) )
+	{
+		std::cerr << "vertex shader cannot decode octahedral normals" << std::endl;
+		return false;
+	}
+
+	// The uniform block is bound with a dynamic offset per draw.
+	if ( false == reflection.makeDynamic( UNIFORM_SET, UNIFORM_BINDING ) )
+	{
+		std::cerr << "shaders declare no uniform block at set " << UNIFORM_SET << ", binding " << UNIFORM_BINDING << std::endl;
+		return false;
+	}
+
+	program._uniformSetLayout						= _layoutCache.getDescriptorSetLayout( reflection, UNIFORM_SET );
+	program._textureSetLayout						= _layoutCache.getDescriptorSetLayout( reflection, TEXTURE_SET );
+	program._program._layout						= _layoutCache.getPipelineLayout( reflection );
+
+	if ( ( VK_NULL_HANDLE == program._uniformSetLayout ) || ( VK_NULL_HANDLE == program._textureSetLayout ) || ( VK_NULL_HANDLE == program._program._layout ) )
+	{
+		return false;
+	}
+
+	VkShaderModule vertShaderModule = createShaderModule( vertShaderCode );
+	VkShaderModule fragShaderModule = createShaderModule( fragShaderCode );
+
+	if ( ( VK_NULL_HANDLE == vertShaderModule ) || ( VK_NULL_HANDLE == fragShaderModule ) )
+	{
+		vkDestroyShaderModule( _device, fragShaderModule, nullptr );
+		vkDestroyShaderModule( _device, vertShaderModule, nullptr );
+		return false;
+	}
+
+	program._program._vertexModule		= vertShaderModule;
+	program._program._fragmentModule	= fragShaderModule;
+
+	if ( nullptr != octahedralNormalsConstant )
+	{
+		program._program._vertexEntries.push_back( VkSpecializationMapEntry{ OCTAHEDRAL_NORMALS_CONSTANT_ID, 0, sizeof( VkBool32 ) } );
+		program._program._vertexData.push_back( ( true == _vertexFormat._hasOctahedralNormals ) ? VK_TRUE : VK_FALSE );
+	}
+
+	return true;
+}
+
+bool VKApplication::acceptSetLayouts( const SceneProgram& program ) noexcept
+{
+	// The uniform ring's descriptor set is allocated once against the first layout, so a reload cannot change it.
+	if ( ( VK_NULL_HANDLE != _uniformSetLayout ) && ( program._uniformSetLayout != _uniformSetLayout ) )
+	{
+		std::cerr << "shaders changed the layout of descriptor set " << UNIFORM_SET << std::endl;
+		return false;
+	}
+
+	// Likewise for the texture sets the streamer allocates.
+	if ( ( VK_NULL_HANDLE != _textureSetLayout ) && ( program._textureSetLayout != _textureSetLayout ) )
+	{
+		std::cerr << "shaders changed the layout of descriptor set " << TEXTURE_SET << std::endl;
+		return false;
+	}
+
+	_uniformSetLayout	= program._uniformSetLayout;
+	_textureSetLayout	= program._textureSetLayout;
+
+	return true;
+}
+
+bool VKApplication::createCommandRecorder( void ) noexcept
+{
+	QueueFamilyIndices queueFamilyIndices	= findQueueFamilies( _physicalDevice );
+
+	// Recording runs on the job threads, so by default it splits into as many slices as there are of them.
+	uint32_t threadCount					= _options._recordThreads;
+	if ( 0 == threadCount )
+	{
+		threadCount							= _jobSystem.getThreadCount();
+	}
+
+	return _commandRecorder.create( _device, queueFamilyIndices._graphicsFamily.value(), _framesInFlight, threadCount, _jobSystem );
+}
+
+bool VKApplication::createTimestampQueryPool( void ) noexcept
+{
+	if ( false == _benchmark.isEnabled() )
+	{
+		return true;
+	}
+
+	const uint32_t validBits				= findQueueFamilies( _physicalDevice )._timestampValidBits;
+
+	if ( 0 == validBits )
+	{
+		// GPU times are simply left out of the report.
+		return true;
+	}
+
+	_timestampMask							= ( 64 <= validBits ) ? ~0ull : ( ( 1ull << validBits ) - 1 );
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties( _physicalDevice, &properties );
+	_timestampPeriod						= properties.limits.timestampPeriod;
+
+	// Two timestamps bracket each frame's primary command buffer.
+	_timestampQueryCount					= _framesInFlight * 2;
+	_timestampsWritten.assign( _framesInFlight, false );
+
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	queryPoolInfo.sType						= VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType					= VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount				= _timestampQueryCount;
+
+	if ( VK_SUCCESS != vkCreateQueryPool( _device, &queryPoolInfo, nullptr, &_timestampQueryPool ) )
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool VKApplication::createSyncObjects( void ) noexcept
+{
+	_imageAvailableSemaphores.resize( _framesInFlight );
+	_renderFinishedSemaphores.resize( _framesInFlight );
+	_inFlightFences.resize( _framesInFlight );
+	_imagesInFlight.resize( _swapChainImages.size(), VK_NULL_HANDLE );
+	_submittedInputTimes.resize( _framesInFlight );
+	_submittedFrameNumbers.assign( _framesInFlight, 0 );
+	_submissionPending.assign( _framesInFlight, false );
+
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType								= VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType									= VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags									= VK_FENCE_CREATE_SIGNALED_BIT;
+
+	for ( uint32_t ii = 0; ii < _framesInFlight; ++ii ) 
+	{
+		if ( ( VK_SUCCESS != vkCreateSemaphore( _device, &semaphoreInfo, nullptr, &_imageAvailableSemaphores[ii] ) ) ||
+			 ( VK_SUCCESS != vkCreateSemaphore( _device, &semaphoreInfo, nullptr, &_renderFinishedSemaphores[ii] ) ) || 
+			 ( VK_SUCCESS != vkCreateFence( _device, &fenceInfo, nullptr, &_inFlightFences[ii] ) ) )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool VKApplication::loadMesh( void ) noexcept
+{
+	if ( true == _options._meshFile.empty() )
+	{
+		_mesh = Mesh::createQuad();
+	}
+	else
+	{
+		// Only the time spent blocked on the read counts; the rest overlapped with device setup.
+		const auto readBegin		= std::chrono::steady_clock::now();
+		_meshStatistics				= MeshLoadStatistics{};
+
+		if ( FileError::None != _meshRead.wait() )
+		{
+			return false;
+		}
+
+		_meshStatistics._readMs		= Benchmark::millisecondsSince( readBegin );
+
+		const bool isParsed			= MeshLoader::parse( _options._meshFile, _meshRead.getFile(), _jobSystem, _mesh, _meshStatistics );
+		_meshRead.getFile().close();
+
+		if ( false == isParsed )
+		{
+			return false;
+		}
+
+		std::cout << "mesh: " << _options._meshFile << ", " << _meshStatistics._fileBytes / ( 1024.0 * 1024.0 ) << " MB in " << _meshStatistics._totalMs << " ms ("
+			<< _meshStatistics.getMegabytesPerSecond() << " MB/s; read " << _meshStatistics._readMs << " ms, parse " << _meshStatistics._parseMs << " ms, build " << _meshStatistics._buildMs << " ms), "
+			<< _mesh._vertices.size() << " vertices from " << _meshStatistics._cornerCount << " corners, " << _mesh._indices.size() / 3 << " triangles" << std::endl;
+	}
+
+	// Runs on source coordinates, before fitting flips Y, so cluster normals still point outward.
+	if ( true == _options._optimizeMesh )
+	{
+		MeshOptimizer::optimize( _mesh, _meshOptimization );
+
+		std::cout << "mesh optimization: ACMR " << _meshOptimization._before._acmr << " -> " << _meshOptimization._after._acmr
+			<< ", ATVR " << _meshOptimization._before._atvr << " -> " << _meshOptimization._after._atvr
+			<< ", " << _meshOptimization._clusterCount << " overdraw clusters, " << _meshOptimization._optimizeMs << " ms" << std::endl;
+	}
+	else
+	{
+		_meshOptimization._before	= MeshOptimizer::analyzeVertexCache( _mesh._indices, _mesh._vertices.size() );
+		_meshOptimization._after	= _meshOptimization._before;
+	}
+
+	if ( false == _options._meshFile.empty() )
+	{
+		_mesh.fitToClipVolume();
+	}
+
+	_indexType = _mesh.getIndexType();
+
+	std::cout << "vertex layout: " << ( ( true == _options._compactVertices ) ? "compact" : "full" ) << ", " << _vertexFormat._stride << " bytes per vertex ("
+		<< FullVertexLayout::STRIDE << " full), " << ( ( VK_INDEX_TYPE_UINT16 == _indexType ) ? 16 : 32 ) << "-bit indices, "
+		<< ( _vertexFormat._stride * _mesh._vertices.size() + ( ( VK_INDEX_TYPE_UINT16 == _indexType ) ? 2 : 4 ) * _mesh._indices.size() ) / 1024 << " KiB" << std::endl;
+
+	return true;
+}
+
+bool VKApplication::createVertexBuffer( void ) noexcept
+{
+	const VkDeviceSize bufferSize = static_cast<VkDeviceSize>( _vertexFormat._stride ) * _mesh._vertices.size();
+
+	std::vector<unsigned char> packedVertices( static_cast<size_t>( bufferSize ) );
+	_vertexFormat._pack( _mesh._vertices.data(), _mesh._vertices.size(), packedVertices.data() );
 	
-	VkVertexInputBindingDescription bindingDescription						= Vertex::getBindingDescription();
-	std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions	= Vertex::getAttributeDescriptions();
+	if ( false == _allocator.createBuffer( bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vertexBuffer, _vertexBufferAllocation ) )
+	{
+		return false;
+	}
+
+	return 0 != _uploadManager.upload( _vertexBuffer, 0, packedVertices.data(), bufferSize, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT );
+}
+
+bool VKApplication::createIndexBuffer( void ) noexcept
+{
+	const void* indexData		= _mesh._indices.data();
+	VkDeviceSize bufferSize		= static_cast<VkDeviceSize>( sizeof( uint32_t ) * _mesh._indices.size() );
+
+	// The upload copies into the staging ring right away, so the narrowed copy only has to outlive the call.
+	std::vector<uint16_t> narrowIndices;
+	if ( VK_INDEX_TYPE_UINT16 == _indexType )
+	{
+		narrowIndices.assign( _mesh._indices.begin(), _mesh._indices.end() );
+		indexData				= narrowIndices.data();
+		bufferSize				= static_cast<VkDeviceSize>( sizeof( uint16_t ) * narrowIndices.size() );
+	}
 	
-	vertexInputInfo.vertexBindingDescriptionCount	= 1;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-	vertexInputInfo.pVertexBindingDescriptions		= &bindingDescription;
-	vertexInputInfo.pVertexAttributeDescriptions	= attributeDescriptions.data();
+	if ( false == _allocator.createBuffer( bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _indexBuffer, _indexBufferAllocation ) )
+	{
+		return false;
+	}
+
+	return 0 != _uploadManager.upload( _indexBuffer, 0, indexData, bufferSize, VK_ACCESS_INDEX_READ_BIT );
+}
 
-	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-	inputAssembly.sType								= VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssembly.topology							= VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssembly.primitiveRestartEnable			= VK_FALSE;
+void VKApplication::createDrawCommands( void ) noexcept
+{
+	DrawCommand drawCommand{};
+	drawCommand._indexCount					= static_cast<uint32_t>( _mesh._indices.size() );
+	drawCommand._firstIndex					= 0;
+	drawCommand._vertexOffset				= 0;
+	drawCommand._instanceCount				= 1;
+
+	// Every object repeats the same mesh, each with its own instance slot.
+	std::vector<DrawCommand> objects( std::max( _options._drawCount, 1u ), drawCommand );
+	for ( uint32_t ii = 0; ii < objects.size(); ++ii )
+	{
+		objects[ii]._firstInstance			= ii;
+	}
 
-	VkViewport viewport{};
-	viewport.x										= 0.0f;
-	viewport.y										= 0.0f;
-	viewport.width									= static_cast<float>( _swapChainExtent.width );
-	viewport.height									= static_cast<float>( _swapChainExtent.height );
-	viewport.minDepth								= 0.0f;
-	viewport.maxDepth								= 1.0f;
+	_instanceCount							= static_cast<uint32_t>( objects.size() );
+	_drawCommands							= ( true == _options._instancing ) ? mergeDraws( std::move( objects ) ) : std::move( objects );
 
-	VkRect2D scissor{};
-	scissor.offset									= { 0, 0 };
-	scissor.extent									= _swapChainExtent;
-
-	VkPipelineViewportStateCreateInfo viewportState{};
-	viewportState.sType								= VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportState.viewportCount						= 1;
-	viewportState.pViewports						= &viewport;
-	viewportState.scissorCount						= 1;
-	viewportState.pScissors							= &scissor;
-
-	VkPipelineRasterizationStateCreateInfo rasterizer{};
-	rasterizer.sType								= VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizer.depthClampEnable						= VK_FALSE;
-	rasterizer.rasterizerDiscardEnable				= VK_FALSE;
-	rasterizer.polygonMode							= VK_POLYGON_MODE_FILL;
-	rasterizer.lineWidth							= 1.0f;
-	rasterizer.cullMode								= VK_CULL_MODE_BACK_BIT;
-	rasterizer.frontFace							= VK_FRONT_FACE_CLOCKWISE;
-	rasterizer.depthBiasEnable						= VK_FALSE;
-
-	VkPipelineMultisampleStateCreateInfo multisampling{};
-	multisampling.sType								= VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampling.sampleShadingEnable				= VK_FALSE;
-	multisampling.rasterizationSamples				= VK_SAMPLE_COUNT_1_BIT;
-
-	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-	colorBlendAttachment.colorWriteMask				= VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable				= VK_FALSE;
-
-	VkPipelineColorBlendStateCreateInfo colorBlending{};
-	colorBlending.sType								= VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlending.logicOpEnable						= VK_FALSE;
-	colorBlending.logicOp							= VK_LOGIC_OP_COPY;
-	colorBlending.attachmentCount					= 1;
-	colorBlending.pAttachments						= &colorBlendAttachment;
-	colorBlending.blendConstants[0]					= 0.0f;
-	colorBlending.blendConstants[1]					= 0.0f;
-	colorBlending.blendConstants[2]					= 0.0f;
-	colorBlending.blendConstants[3]					= 0.0f;
-
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType						= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount				= 0;
-	pipelineLayoutInfo.pushConstantRangeCount		= 0;
-
-	if ( VK_SUCCESS != vkCreatePipelineLayout( _device, &pipelineLayoutInfo, nullptr, &_pipelineLayout) ) 
+	std::cout << "scene: " << _instanceCount << " instances in " << _drawCommands.size() << " draws" << std::endl;
+}
+
+std::vector<DrawCommand> VKApplication::mergeDraws( std::vector<DrawCommand> draws ) noexcept
+{
+	// There is a single pipeline, so draws of the same index range share everything but their instance data.
+	auto isSameMesh = []( const DrawCommand& lhs, const DrawCommand& rhs )
+	{
+		return ( lhs._indexCount == rhs._indexCount ) && ( lhs._firstIndex == rhs._firstIndex ) && ( lhs._vertexOffset == rhs._vertexOffset );
+	};
+
+	std::stable_sort( draws.begin(), draws.end(), []( const DrawCommand& lhs, const DrawCommand& rhs )
 	{
+		return std::tie( lhs._firstIndex, lhs._indexCount, lhs._vertexOffset ) < std::tie( rhs._firstIndex, rhs._indexCount, rhs._vertexOffset );
+	} );
+
+	// Instance slots follow the sorted order, so every merged draw reads one contiguous range.
+	std::vector<DrawCommand> merged;
+	uint32_t instance = 0;
+
+	for ( const DrawCommand& draw : draws )
+	{
+		if ( ( true == merged.empty() ) || ( false == isSameMesh( merged.back(), draw ) ) )
+		{
+			merged.push_back( draw );
+			merged.back()._firstInstance	= instance;
+			merged.back()._instanceCount	= 0;
+		}
+
+		merged.back()._instanceCount		+= draw._instanceCount;
+		instance							+= draw._instanceCount;
+	}
+
+	return merged;
+}
+
+bool VKApplication::createGpuCuller( void ) noexcept
+{
+	// The objects never move, so they are laid out once and the CPU does no per-object work after this.
+	const uint32_t columns		= static_cast<uint32_t>( std::ceil( std::sqrt( static_cast<double>( _instanceCount ) ) ) );
+	std::vector<InstanceData> objects( _instanceCount );
+
+	_jobSystem.parallelFor( _instanceCount, INSTANCE_UPDATE_BATCH, [&]( const uint32_t first, const uint32_t batchCount )
+	{
+		for ( uint32_t ii = first; ii < first + batchCount; ++ii )
+		{
+			objects[ii]			= placeInstance( ii, _instanceCount, columns, _options._sceneExtent, 1.0f );
+		}
+	} );
+
+	CulledMesh mesh{};
+	mesh._boundingSphere		= _mesh.getBoundingSphere();
+	mesh._indexCount			= static_cast<uint32_t>( _mesh._indices.size() );
+	mesh._firstIndex			= 0;
+	mesh._vertexOffset			= 0;
+
+	return _gpuCuller.create( _device, _allocator, _uploadManager, _pipelineCache, _layoutCache, objects, mesh, _framesInFlight, _drawIndexedIndirectCount );
+}
+
+void VKApplication::createFrustumCuller( void ) noexcept
+{
+	_cpuCulling					= true;
+
+	if ( false == _options._cullingKernel.empty() )
+	{
+		for ( uint32_t ii = 0; ii < static_cast<uint32_t>( CullingKernel::Count ); ++ii )
+		{
+			if ( _options._cullingKernel == FrustumCuller::getKernelName( static_cast<CullingKernel>( ii ) ) )
+			{
+				_frustumCuller.setKernel( static_cast<CullingKernel>( ii ) );
+			}
+		}
+	}
+
+	// Pulsing only shrinks an object towards its grid position, so a sphere around the position that
+	// reaches as far as the unpulsed mesh bounds it on every frame. Depth is not scaled per instance and
+	// the fitted mesh lies inside the clip volume's depth range, so only the side planes reject anything.
+	const glm::vec4 meshSphere	= _mesh.getBoundingSphere();
+	const float meshReach		= std::sqrt( meshSphere.x * meshSphere.x + meshSphere.y * meshSphere.y ) + meshSphere.w;
+	const uint32_t columns		= static_cast<uint32_t>( std::ceil( std::sqrt( static_cast<double>( _instanceCount ) ) ) );
+
+	_frustumCuller.resize( _instanceCount );
+
+	for ( uint32_t ii = 0; ii < _instanceCount; ++ii )
+	{
+		const glm::vec4 offsetScale = placeInstance( ii, _instanceCount, columns, _options._sceneExtent, 1.0f )._offsetScale;
+		_frustumCuller.setSphere( ii, glm::vec4( offsetScale.x, offsetScale.y, meshSphere.z + offsetScale.z, meshReach * offsetScale.w ) );
+	}
+
+	// Until the first frame is culled, e.g. in the recording benchmark, everything counts as visible.
+	_visibleDrawCommands		= _drawCommands;
+
+	std::cout << "cpu culling: " << _instanceCount << " objects, " << FrustumCuller::getKernelName( _frustumCuller.getKernel() ) << " kernel" << std::endl;
+}
+
+uint32_t VKApplication::cullObjects( void ) noexcept
+{
+	_visibleCount = _frustumCuller.cull( Frustum::getClipVolume(), _visibleObjects, &_jobSystem );
+
+	// Instance slots are ascending within and across draws, and so are the visible objects; each draw keeps
+	// the visible part of its range, packed to where those objects land in the instance buffer.
+	const auto visibleBegin		= _visibleObjects.begin();
+	const auto visibleEnd		= _visibleObjects.begin() + _visibleCount;
+	auto cursor					= visibleBegin;
+
+	_visibleDrawCommands.clear();
+
+	for ( const DrawCommand& draw : _drawCommands )
+	{
+		const auto first		= std::lower_bound( cursor, visibleEnd, draw._firstInstance );
+		cursor					= std::lower_bound( first, visibleEnd, draw._firstInstance + draw._instanceCount );
+
+		if ( first != cursor )
+		{
+			DrawCommand visibleDraw		= draw;
+			visibleDraw._firstInstance	= static_cast<uint32_t>( first - visibleBegin );
+			visibleDraw._instanceCount	= static_cast<uint32_t>( cursor - first );
+
+			_visibleDrawCommands.push_back( visibleDraw );
+		}
+	}
+
+	return _visibleCount;
+}
+
+bool VKApplication::createUniformRing( void ) noexcept
+{
+	// Culling only ever removes draws, so the unculled list bounds the blocks a frame needs.
+	const VkDeviceSize blockSize	= sizeof( DrawUniforms );
+	const VkDeviceSize alignment	= std::max<VkDeviceSize>( _allocator.getLimits().minUniformBufferOffsetAlignment, 1 );
+	const VkDeviceSize blockStride	= ( blockSize + alignment - 1 ) / alignment * alignment;
+	const size_t blockCount			= std::max<size_t>( _drawCommands.size(), 1 );
+
+	if ( false == _uniformRing.create( _device, _allocator, _uniformSetLayout, UNIFORM_BINDING, blockSize, blockStride * blockCount, _framesInFlight ) )
+	{
+		std::cerr << "failed to create the uniform ring" << std::endl;
 		return false;
 	}
 
-	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	// Frame 0's blocks are written up front for recordings made before the first frame, as in the recording benchmark.
+	updateUniforms( 0 );
 
-	pipelineInfo.sType								= VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount							= 2;
-	pipelineInfo.pStages							= shaderStages;
+	return true;
+}
 
-	pipelineInfo.pVertexInputState					= &vertexInputInfo;
-	pipelineInfo.pInputAssemblyState				= &inputAssembly;
-	pipelineInfo.pViewportState						= &viewportState;
-	pipelineInfo.pRasterizationState				= &rasterizer;
-	pipelineInfo.pMultisampleState					= &multisampling;
-	pipelineInfo.pDepthStencilState					= nullptr; // Optional
-	pipelineInfo.pColorBlendState					= &colorBlending;
-	pipelineInfo.pDynamicState						= nullptr; // Optional
+bool VKApplication::createParticleSystem( void ) noexcept
+{
+	// Timed with the frame's own timestamp support.
+	const float timestampPeriod = ( VK_NULL_HANDLE != _timestampQueryPool ) ? _timestampPeriod : 0.0f;
 
-	pipelineInfo.layout								= _pipelineLayout;
+	if ( false == _particleSystem.create( _device, _allocator, _pipelineCache, _layoutCache, _options._particleCount, _framesInFlight, timestampPeriod, _timestampMask ) )
+	{
+		std::cerr << "failed to create the particle system" << std::endl;
+		return false;
+	}
 
-	pipelineInfo.renderPass							= _renderPass;
-	pipelineInfo.subpass							= 0;
+	return _particleSystem.createRenderPipeline( _renderGraph.getRenderPass( _particlePass ), _renderGraph.getSubpass( _particlePass ), _sampleCount, _deletionQueue, _frameNumber );
+}
 
-	pipelineInfo.basePipelineHandle					= VK_NULL_HANDLE;
+bool VKApplication::createTextureStreamer( void ) noexcept
+{
+	const VkDeviceSize megabyte = 1024 * 1024;
 
-	if ( VK_SUCCESS != vkCreateGraphicsPipelines( _device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_graphicsPipeline ) ) 
+	if ( false == _textureStreamer.create( _physicalDevice, _device, _allocator, _jobSystem, _textureSetLayout, TEXTURE_BINDING, _framesInFlight,
+										   _options._textureUploadMB * megabyte, _options._textureBudgetMB * megabyte ) )
 	{
+		std::cerr << "failed to create the texture streamer" << std::endl;
 		return false;
 	}
 
-	vkDestroyShaderModule( _device, fragShaderModule, nullptr );
-	vkDestroyShaderModule( _device, vertShaderModule, nullptr );
+	// Decoding runs alongside the rest of startup and the first frames; until then the quad is untextured.
+	if ( false == _options._textureFile.empty() )
+	{
+		_texture = _textureStreamer.load( _options._textureFile );
+	}
 
 	return true;
 }
 
-bool VKApplication::createFramebuffers( void ) noexcept
+void VKApplication::updateUniforms( const uint32_t frame ) noexcept
 {
-	const int swapChainImageViewSize = static_cast<int>( _swapChainImageViews.size() );
+	// The light circles the view axis slowly, so the frame data really changes every frame.
+	const float time			= static_cast<float>( _frameNumber ) / 60.0f;
+	const float angle			= time * 0.5f;
+	const float sine			= std::sin( angle );
+	const float cosine			= std::cos( angle );
+
+	DrawUniforms uniforms{};
+	uniforms._lightDirection	= glm::vec4( -0.3f * cosine + 0.5f * sine, -0.3f * sine - 0.5f * cosine, -0.8f, 0.35f );
 
-	_swapChainFramebuffers.resize( swapChainImageViewSize );
+	const uint32_t drawCount	= getRecordedDrawCount();
+	_drawUniformOffsets.resize( drawCount );
+	_uniformRing.beginFrame( frame );
 
-	for ( int ii = 0; ii < swapChainImageViewSize; ++ii )
+	for ( uint32_t ii = 0; ii < drawCount; ++ii )
 	{
-		VkImageView attachments[] = 
+		// Draws get slightly different tints, so the per-draw blocks are visibly in use.
+		uniforms._tint			= glm::vec4( ( 0 != ( ii & 1 ) ) ? 0.85f : 1.0f, ( 0 != ( ii & 2 ) ) ? 0.85f : 1.0f, ( 0 != ( ii & 4 ) ) ? 0.85f : 1.0f, 1.0f );
+
+		// Whole-struct stores, as the memory may be write-combined.
+		DrawUniforms* block		= _uniformRing.allocate<DrawUniforms>( _drawUniformOffsets[ii] );
+
+		// The ring is sized for the draw count at creation; if that grows, the remaining draws share the last block.
+		// Without one they point at the start of this frame's region, never into a region another frame may be reading.
+		if ( nullptr == block )
 		{
-			_swapChainImageViews[ii]
-		};
-
-		VkFramebufferCreateInfo framebufferInfo{};
-		framebufferInfo.sType						= VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass					= _renderPass;
-		framebufferInfo.attachmentCount				= 1;
-		framebufferInfo.pAttachments				= attachments;
-		framebufferInfo.width						= _swapChainExtent.width;
-		framebufferInfo.height						= _swapChainExtent.height;
-		framebufferInfo.layers						= 1;
-
-		if ( VK_SUCCESS !=vkCreateFramebuffer( _device, &framebufferInfo, nullptr, &_swapChainFramebuffers[ii] ) ) 
+			std::cerr << "uniform ring: frame region full after " << ii << " of " << drawCount << " draws" << std::endl;
+			std::fill( _drawUniformOffsets.begin() + ii, _drawUniformOffsets.end(), ( 0 < ii ) ? _drawUniformOffsets[ii - 1] : _uniformRing.getFrameOffset() );
+			break;
+		}
+
+		*block					= uniforms;
+	}
+}
+
+void VKApplication::updateInstances( const uint32_t frame ) noexcept
+{
+	// Only visible objects are written, packed in the order the culled draws expect them.
+	const uint32_t count		= _instanceCount;
+	const uint32_t writeCount	= ( true == _cpuCulling ) ? cullObjects() : count;
+	const uint32_t* objects		= ( true == _cpuCulling ) ? _visibleObjects.data() : nullptr;
+
+	const uint32_t columns		= static_cast<uint32_t>( std::ceil( std::sqrt( static_cast<double>( count ) ) ) );
+	const float extent			= _options._sceneExtent;
+	const float time			= static_cast<float>( _frameNumber ) / 60.0f;
+	InstanceData* instances		= _instanceBuffer.getFrameData( frame );
+
+	_jobSystem.parallelFor( writeCount, INSTANCE_UPDATE_BATCH, [=]( const uint32_t first, const uint32_t batchCount )
+	{
+		for ( uint32_t ii = first; ii < first + batchCount; ++ii )
 		{
-			return false;
+			// Instances pulse slightly, so the data really changes every frame.
+			const uint32_t object	= ( nullptr != objects ) ? objects[ii] : ii;
+			const float pulse		= ( 1 < count ) ? 0.9f + 0.1f * std::sin( time * 2.0f + static_cast<float>( object ) * 0.37f ) : 1.0f;
+
+			// Sequential whole-struct stores, as the memory may be write-combined.
+			instances[ii]			= placeInstance( object, count, columns, extent, pulse );
 		}
+	} );
+
+	_instanceBufferOffset		= _instanceBuffer.getFrameOffset( frame );
+}
+
+InstanceData VKApplication::placeInstance( const uint32_t index, const uint32_t count, const uint32_t columns, const float extent, const float pulse ) noexcept
+{
+	// Instances sit on a square grid spanning [-extent, extent] in clip space. They keep the size they have at
+	// extent 1, so a larger extent spreads them beyond the view.
+	const float cellSize		= 2.0f * extent / static_cast<float>( columns );
+	const uint32_t column		= index % columns;
+	const uint32_t row			= index / columns;
+
+	const uint32_t red			= ( 1 < count ) ? 128 + column * 127 / columns : 255;
+	const uint32_t green		= ( 1 < count ) ? 128 + row * 127 / columns : 255;
+
+	return InstanceData{ glm::vec4( -extent + cellSize * ( column + 0.5f ), -extent + cellSize * ( row + 0.5f ), 0.0f, 0.5f * cellSize * pulse / extent ), red | ( green << 8 ) | ( 255u << 16 ) | ( 255u << 24 ) };
+}
+
+const std::vector<DrawCommand>& VKApplication::getFrameDrawCommands( void ) const noexcept
+{
+	return ( true == _cpuCulling ) ? _visibleDrawCommands : _drawCommands;
+}
+
+uint32_t VKApplication::getRecordedDrawCount( void ) const noexcept
+{
+	// GPU-driven draws are a single indirect call, so there is nothing to split across threads.
+	return ( true == _gpuCulling ) ? 1 : static_cast<uint32_t>( getFrameDrawCommands().size() );
+}
+
+bool VKApplication::loadShaderCode( const std::string& fileName, MappedFile& code ) const noexcept
+{
+	if ( FileError::None != File::map( fileName, code ) )
+	{
+		return false;
+	}
+
+	if ( ( 0 == code.getSize() ) || ( 0 != ( code.getSize() % sizeof( uint32_t ) ) ) )
+	{
+		std::cerr << "shader " << fileName << " is not a whole number of SPIR-V words (" << code.getSize() << " bytes)" << std::endl;
+		return false;
 	}
 
 	return true;
 }
 
-bool VKApplication::createCommandPool( void ) noexcept
+VkShaderModule VKApplication::createShaderModule( const MappedFile& code ) const noexcept
 {
-	QueueFamilyIndices queueFamilyIndices	= findQueueFamilies( _physicalDevice );
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType			= VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize			= code.getSize();
+	createInfo.pCode			= code.getWords();
 
-	VkCommandPoolCreateInfo poolInfo{};
-	poolInfo.sType							= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	poolInfo.queueFamilyIndex				= queueFamilyIndices._graphicsFamily.value();
-	poolInfo.flags							= 0; // Optional
+	VkShaderModule shaderModule = VK_NULL_HANDLE;
+	if ( VK_SUCCESS != vkCreateShaderModule( _device, &createInfo, nullptr, &shaderModule ) )
+	{
+		return VK_NULL_HANDLE;
+	}
 
-	if ( VK_SUCCESS != vkCreateCommandPool( _device, &poolInfo, nullptr, &_commandPool ) )
+	return shaderModule;
+}
+
+void VKApplication::initializeWindow( void ) noexcept
+{
+	const uint32_t WIDTH	= 800;
+	const uint32_t HEIGHT	= 600;
+
+	glfwInit();
+
+	glfwWindowHint( GLFW_CLIENT_API, GLFW_NO_API );
+	glfwWindowHint( GLFW_RESIZABLE, GLFW_TRUE );
+
+	_window = glfwCreateWindow( WIDTH, HEIGHT, "Vulkan", nullptr, nullptr );
+	glfwSetWindowUserPointer( _window, this );
+	glfwSetFramebufferSizeCallback( _window, framebufferResizeCallback );
+}
+
+bool VKApplication::runLoop( void ) noexcept
+{
+	const auto begin		= std::chrono::steady_clock::now();
+	uint32_t frameCount		= 0;
+	bool isValid			= true;
+
+	while ( true == isRunning( frameCount ) )
+	{
+		_benchmark.beginFrame();
+		runFrame();
+		++frameCount;
+	}
+
+	vkDeviceWaitIdle( _device );
+	pollCompletedFrames();
+
+	// Every frame culls the same static scene, so the last one is checked against the CPU's answer.
+	if ( ( true == _gpuCulling ) && ( 0 < frameCount ) )
+	{
+		_visibleCount = _gpuCuller.getVisibleCount( static_cast<uint32_t>( ( _currentFrame + _framesInFlight - 1 ) % _framesInFlight ) );
+
+		std::cout << "gpu culling: " << _visibleCount << " of " << _gpuCuller.getObjectCount() << " objects visible, " << _gpuCuller.getExpectedVisibleCount() << " expected" << std::endl;
+
+		if ( _gpuCuller.getExpectedVisibleCount() != _visibleCount )
+		{
+			std::cerr << "gpu culling: visible count does not match the CPU reference" << std::endl;
+			isValid = false;
+		}
+	}
+
+	if ( true == _options._headless )
+	{
+		const double elapsed = Benchmark::millisecondsSince( begin );
+		std::cout << "headless: " << frameCount << " frames in " << elapsed << " ms ("
+				  << ( frameCount * 1000.0 / std::max( elapsed, 1e-3 ) ) << " fps, "
+				  << ( static_cast<double>( frameCount ) * _instanceCount * 1000.0 / std::max( elapsed, 1e-3 ) ) << " instances/s)" << std::endl;
+	}
+
+	if ( true == _benchmark.isEnabled() )
+	{
+		writeBenchmarkReport();
+	}
+
+	return isValid;
+}
+
+void VKApplication::runFrame( void ) noexcept
+{
+	// Input is sampled once the frame is allowed to start, so waiting for the GPU does not age it.
+	waitForFrame();
+
+	if ( false == _options._headless )
+	{
+		glfwPollEvents();
+	}
+
+	_frameInputTime = std::chrono::steady_clock::now();
+
+	if ( true == _options._headless )
+	{
+		drawOffscreenFrame();
+	}
+	else
 	{
-		return false;
+		drawFrame();
 	}
 
-	return true;
+	_deletionQueue.collect( pollCompletedFrames() );
 }
 
-bool VKApplication::createCommandBuffers( void ) noexcept
+void VKApplication::runParticleBenchmark( void ) noexcept
 {
-	_commandBuffers.resize( _swapChainFramebuffers.size() );
+	const uint32_t warmupFrames			= std::max( _options._warmupFrames, _framesInFlight );
+	const uint32_t measuredFrames		= std::max( _options._frameCount, 1u );
+	const uint32_t particleCount		= _particleSystem.getParticleCount();
 
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.sType								= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.commandPool						= _commandPool;
-	allocInfo.level								= VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandBufferCount				= static_cast<uint32_t>( _commandBuffers.size() );
+	// Counts double up to the full buffer, which is always measured last.
+	std::vector<uint32_t> counts;
+	for ( uint32_t count = std::max( particleCount / 64, 1u ); count < particleCount; count *= 2 )
+	{
+		counts.push_back( count );
+	}
+	counts.push_back( particleCount );
 
-	if ( VK_SUCCESS != vkAllocateCommandBuffers( _device, &allocInfo, _commandBuffers.data() ) ) 
+	std::ofstream file;
+	if ( false == _options._benchmarkOutput.empty() )
 	{
-		return false;
+		file.open( _options._benchmarkOutput, std::ios::trunc );
+		if ( false == file.is_open() )
+		{
+			std::cerr << "failed to open " << _options._benchmarkOutput << std::endl;
+			return;
+		}
 	}
 
-	const int commandBufferSize					= static_cast<int>( _commandBuffers.size() );
+	std::ostream& stream = ( true == file.is_open() ) ? static_cast<std::ostream&>( file ) : std::cout;
 
-	for ( int ii = 0; ii < commandBufferSize; ++ii )
+	stream << "{\n";
+	stream << "  \"particleCount\": " << particleCount << ",\n";
+	stream << "  \"particles\": [\n";
+
+	// The whole frame runs at every count, so the numbers include sharing the GPU with the scene.
+	for ( size_t ii = 0; ii < counts.size(); ++ii )
 	{
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType							= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags							= 0; // Optional
-		beginInfo.pInheritanceInfo				= nullptr; // Optional
+		_particleSystem.setActiveCount( counts[ii] );
 
-		if ( VK_SUCCESS != vkBeginCommandBuffer( _commandBuffers[ii], &beginInfo ) ) 
+		for ( uint32_t frame = 0; frame < warmupFrames + measuredFrames; ++frame )
 		{
-			return false;
+			_isMeasuringParticles = ( warmupFrames <= frame );
+			runFrame();
 		}
 
-		VkRenderPassBeginInfo renderPassInfo{};
-		renderPassInfo.sType					= VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass				= _renderPass;
-		renderPassInfo.framebuffer				= _swapChainFramebuffers[ii];
-		renderPassInfo.renderArea.offset		= { 0, 0 };
-		renderPassInfo.renderArea.extent		= _swapChainExtent;
+		// The last frames' timings are read back once they have completed.
+		vkDeviceWaitIdle( _device );
+		for ( uint32_t frame = 0; frame < _framesInFlight; ++frame )
+		{
+			readParticleTiming( frame );
+		}
 
-		VkClearValue clearColor					= { 0.0f, 0.0f, 0.0f, 1.0f };
-		renderPassInfo.clearValueCount			= 1;
-		renderPassInfo.pClearValues				= &clearColor;
+		_isMeasuringParticles = false;
 
-		vkCmdBeginRenderPass( _commandBuffers[ii], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
+		const double simulateMs	= Benchmark::getMedian( _particleSimulateTimes );
+		const double drawMs		= Benchmark::getMedian( _particleDrawTimes );
 
-		vkCmdBindPipeline( _commandBuffers[ii], VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline );
+		stream << "    { \"count\": " << counts[ii] << ", \"simulateMs\": ";
+		Benchmark::writeSummary( stream, _particleSimulateTimes );
+		stream << ", \"drawMs\": ";
+		Benchmark::writeSummary( stream, _particleDrawTimes );
+		stream << ", \"particlesPerMs\": " << ( counts[ii] / std::max( simulateMs + drawMs, 1e-6 ) );
+		stream << ( ( ii + 1 < counts.size() ) ? " },\n" : " }\n" );
 
-		VkBuffer vertexBuffers[] = { _vertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers( _commandBuffers[ii], 0, 1, vertexBuffers, offsets );
+		std::cout << "particles: " << counts[ii] << " in " << simulateMs << " ms simulate, " << drawMs << " ms draw" << std::endl;
 
-		vkCmdBindIndexBuffer( _commandBuffers[ii], _indexBuffer, 0, VK_INDEX_TYPE_UINT16 );
+		_particleSimulateTimes.clear();
+		_particleDrawTimes.clear();
+	}
 
-		vkCmdDrawIndexed( _commandBuffers[ii], static_cast<uint32_t>( indices.size() ), 1, 0, 0, 0 );
+	stream << "  ]\n}" << std::endl;
 
-		vkCmdEndRenderPass( _commandBuffers[ii] );
+	vkDeviceWaitIdle( _device );
+	pollCompletedFrames();
+}
 
-		if ( VK_SUCCESS != vkEndCommandBuffer( _commandBuffers[ii]) ) 
+bool VKApplication::isRunning( const uint32_t frameCount ) const noexcept
+{
+	if ( true == _benchmark.isEnabled() )
+	{
+		if ( true == _benchmark.isFinished() )
 		{
 			return false;
 		}
 	}
+	else if ( true == _options._headless )
+	{
+		return frameCount < _options._frameCount;
+	}
 
-	return true;
+	return ( true == _options._headless ) || ( 0 == glfwWindowShouldClose( _window ) );
 }
 
-bool VKApplication::createSyncObjects( void ) noexcept
+void VKApplication::waitForFrame( void ) noexcept
 {
-	_imageAvailableSemaphores.resize( MAX_FRAMES_IN_FLIGHT );
-	_renderFinishedSemaphores.resize( MAX_FRAMES_IN_FLIGHT );
-	_inFlightFences.resize( MAX_FRAMES_IN_FLIGHT );
-	_imagesInFlight.resize( _swapChainImages.size(), VK_NULL_HANDLE );
-
+	// The frame's command pools and per-frame regions are reused below, so its previous submission has to be
+	// finished first. In low-latency mode the previous frame has to be finished as well, so that nothing is
+	// queued ahead when input is sampled: the CPU then waits as late as it can instead of running ahead.
+	const size_t previousFrame		= ( _currentFrame + _framesInFlight - 1 ) % _framesInFlight;
+	const VkFence fences[]			= { _inFlightFences[_currentFrame], _inFlightFences[previousFrame] };
+	const uint32_t fenceCount		= ( ( true == _options._lowLatency ) && ( previousFrame != _currentFrame ) ) ? 2 : 1;
+
+	const auto phaseBegin			= std::chrono::steady_clock::now();
+	vkWaitForFences( _device, fenceCount, fences, VK_TRUE, UINT64_MAX );
+	_benchmark.addPhaseTime( FramePhase::FenceWait, Benchmark::millisecondsSince( phaseBegin ) );
+
+	_deletionQueue.collect( pollCompletedFrames() );
+}
 
-	VkSemaphoreCreateInfo semaphoreInfo{};
-	semaphoreInfo.sType								= VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-	
-	VkFenceCreateInfo fenceInfo{};
-	fenceInfo.sType									= VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+uint64_t VKApplication::pollCompletedFrames( void ) noexcept
+{
+	// A fence is only seen signaled when it is polled, at the start and end of every frame, so the latency
+	// is accurate to about half a frame. Presentation itself cannot start before the fence signals.
+	const auto now					= std::chrono::steady_clock::now();
+	uint64_t firstIncompleteFrame	= _frameNumber;
 
-	for ( int ii = 0; ii < MAX_FRAMES_IN_FLIGHT; ++ii ) 
+	for ( uint32_t ii = 0; ii < _framesInFlight; ++ii )
 	{
-		if ( ( VK_SUCCESS != vkCreateSemaphore( _device, &semaphoreInfo, nullptr, &_imageAvailableSemaphores[ii] ) ) ||
-			 ( VK_SUCCESS != vkCreateSemaphore( _device, &semaphoreInfo, nullptr, &_renderFinishedSemaphores[ii] ) ) || 
-			 ( VK_SUCCESS != vkCreateFence( _device, &fenceInfo, nullptr, &_inFlightFences[ii] ) ) )
+		if ( false == _submissionPending[ii] )
 		{
-			return false;
+			continue;
+		}
+
+		if ( VK_SUCCESS == vkGetFenceStatus( _device, _inFlightFences[ii] ) )
+		{
+			_benchmark.addLatency( std::chrono::duration<double, std::milli>( now - _submittedInputTimes[ii] ).count() );
+			_submissionPending[ii]	= false;
+		}
+		else
+		{
+			// Fences are not assumed to signal in submission order: the oldest unfinished frame bounds what is done.
+			firstIncompleteFrame	= std::min( firstIncompleteFrame, _submittedFrameNumbers[ii] );
 		}
 	}
 
-	return true;
+	return firstIncompleteFrame;
 }
 
-bool VKApplication::createVertexBuffer( void ) noexcept
+void VKApplication::readGpuTimestamps( const uint32_t frame ) noexcept
 {
-	const VkDeviceSize bufferSize = static_cast<VkDeviceSize>( sizeof( vertices[0] ) * vertices.size() );
-	
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	createBuffer( bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory );
+	if ( ( VK_NULL_HANDLE == _timestampQueryPool ) || 
+		 ( _timestampsWritten.size() <= frame ) || 
+		 ( false == _timestampsWritten[frame] ) )
+	{
+		return;
+	}
 
-	void* data = nullptr;
-	
-	vkMapMemory( _device, stagingBufferMemory, 0, bufferSize, 0, &data );
-	memcpy( data, vertices.data(), static_cast<size_t>( bufferSize ) );
-	vkUnmapMemory( _device, stagingBufferMemory );
+	// Only called once the frame's previous submission is known to be complete, so this never blocks.
+	uint64_t timestamps[2] = { 0, 0 };
+	if ( VK_SUCCESS == vkGetQueryPoolResults( _device, _timestampQueryPool, frame * 2, 2, sizeof( timestamps ), timestamps, sizeof( uint64_t ), VK_QUERY_RESULT_64_BIT ) )
+	{
+		// Masked, the difference also comes out right across a wrap of the valid bits.
+		const uint64_t ticks = ( ( timestamps[1] & _timestampMask ) - ( timestamps[0] & _timestampMask ) ) & _timestampMask;
+		_benchmark.addGpuTime( static_cast<double>( ticks ) * _timestampPeriod / 1000000.0 );
+	}
 
-	createBuffer( bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vertexBuffer, _vertexBufferMemory );
+	_timestampsWritten[frame] = false;
+}
 
-	copyBuffer( stagingBuffer, _vertexBuffer, bufferSize );
+void VKApplication::readParticleTiming( const uint32_t frame ) noexcept
+{
+	ParticleTiming timing{};
 
-	vkDestroyBuffer( _device, stagingBuffer, nullptr );
-	vkFreeMemory( _device, stagingBufferMemory, nullptr );
+	// Kept while measuring only, so a long interactive run does not grow them.
+	if ( ( false == _particles ) || ( false == _particleSystem.readTiming( frame, timing ) ) ||
+		 ( ( false == _benchmark.isMeasuring() ) && ( false == _isMeasuringParticles ) ) )
+	{
+		return;
+	}
 
-	return true;
+	_particleSimulateTimes.push_back( timing._simulateMs );
+	_particleDrawTimes.push_back( timing._drawMs );
 }
 
-bool VKApplication::createIndexBuffer( void ) noexcept
+VkCommandBufferInheritanceInfo VKApplication::bindRenderGraph( const uint32_t frame, const uint32_t imageIndex ) noexcept
 {
-	const VkDeviceSize bufferSize = static_cast<VkDeviceSize>( sizeof( indices[0] ) * indices.size() );
-	
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	
-	createBuffer( bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory );
+	_renderGraph.setImage( _backbufferResource, _swapChainImages[imageIndex], _swapChainImageViews[imageIndex] );
 
-	void* data = nullptr;
-	vkMapMemory( _device, stagingBufferMemory, 0, bufferSize, 0, &data );
-	memcpy( data, indices.data(), static_cast<size_t>( bufferSize ) );
-	vkUnmapMemory( _device, stagingBufferMemory );
+	if ( true == _gpuCulling )
+	{
+		_renderGraph.setBuffer( _drawBufferResource, _gpuCuller.getDrawBuffer( frame ), 0, VK_WHOLE_SIZE );
+		_renderGraph.setBuffer( _drawCountResource, _gpuCuller.getCountBuffer(), _gpuCuller.getCountOffset( frame ), sizeof( uint32_t ) );
+	}
 
-	createBuffer( bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _indexBuffer, _indexBufferMemory );
+	if ( true == _particles )
+	{
+		_renderGraph.setBuffer( _particleResource, _particleSystem.getBuffer(), 0, _particleSystem.getBufferSize() );
+	}
 
-	copyBuffer( stagingBuffer, _indexBuffer, bufferSize );
+	_recordingFrame							= frame;
 
-	vkDestroyBuffer( _device, stagingBuffer, nullptr );
-	vkFreeMemory( _device, stagingBufferMemory, nullptr );
+	// The secondaries run inside the scene pass, so they inherit its render pass, subpass and framebuffer.
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType					= VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass				= _renderGraph.getRenderPass( _scenePass );
+	inheritanceInfo.subpass					= _renderGraph.getSubpass( _scenePass );
+	inheritanceInfo.framebuffer				= _renderGraph.getFramebuffer( _scenePass );
 
-	return true;
+	return inheritanceInfo;
 }
 
-VkShaderModule VKApplication::createShaderModule( const std::vector<char>& code ) const noexcept
+bool VKApplication::recordCommandBuffer( const uint32_t frame, const uint32_t imageIndex ) noexcept
 {
-	VkShaderModuleCreateInfo createInfo{};
-	createInfo.sType			= VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize			= code.size();
-	createInfo.pCode			= reinterpret_cast<const uint32_t*>( code.data() );
+	const VkCommandBufferInheritanceInfo inheritanceInfo = bindRenderGraph( frame, imageIndex );
 
-	VkShaderModule shaderModule;
-	if ( VK_SUCCESS != vkCreateShaderModule( _device, &createInfo, nullptr, &shaderModule ) )
+	if ( false == _commandRecorder.recordFrame( frame, inheritanceInfo, getRecordedDrawCount(), _recordDrawsCallback ) )
 	{
-		return shaderModule;
+		return false;
 	}
 
-	return shaderModule;
-}
+	const VkCommandBuffer commandBuffer		= _commandRecorder.getPrimaryCommandBuffer( frame );
 
-bool VKApplication::createBuffer( const VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory ) noexcept
-{
-	VkBufferCreateInfo bufferInfo{};
-	bufferInfo.sType		= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferInfo.size			= size;
-	bufferInfo.usage		= usage;
-	bufferInfo.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType							= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags							= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-	if ( VK_SUCCESS != vkCreateBuffer( _device, &bufferInfo, nullptr, &buffer ) )
+	if ( VK_SUCCESS != vkBeginCommandBuffer( commandBuffer, &beginInfo ) ) 
 	{
 		return false;
 	}
 
-	VkMemoryRequirements memRequirements;
-	vkGetBufferMemoryRequirements( _device, buffer, &memRequirements );
+	const uint32_t firstQuery				= frame * 2;
+	const bool writeTimestamps				= ( VK_NULL_HANDLE != _timestampQueryPool ) && ( firstQuery + 2 <= _timestampQueryCount );
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType				= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize	= memRequirements.size;
-	allocInfo.memoryTypeIndex	= findMemoryType(memRequirements.memoryTypeBits, properties);
-
-	if ( VK_SUCCESS != vkAllocateMemory( _device, &allocInfo, nullptr, &bufferMemory ) ) 
+	if ( true == writeTimestamps )
 	{
-		return false;
+		vkCmdResetQueryPool( commandBuffer, _timestampQueryPool, firstQuery, 2 );
+		vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _timestampQueryPool, firstQuery );
 	}
 
-	vkBindBufferMemory( _device, buffer, bufferMemory, 0 );
+	// Texture uploads stay outside the graph; they finish with barriers to the fragment shader of their own.
+	_textureStreamer.recordUploads( commandBuffer, frame );
 
-	return true;
+	// Culling, the scene pass and every barrier between them, as declared in createRenderGraph().
+	_renderGraph.execute( commandBuffer );
+
+	if ( true == writeTimestamps )
+	{
+		vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _timestampQueryPool, firstQuery + 1 );
+		_timestampsWritten[frame]			= true;
+	}
+
+	return VK_SUCCESS == vkEndCommandBuffer( commandBuffer );
 }
 
-void VKApplication::copyBuffer( VkBuffer srcBuffer, VkBuffer dstBuffer, const VkDeviceSize size ) noexcept
+void VKApplication::recordDraws( const VkCommandBuffer commandBuffer, const uint32_t firstDraw, const uint32_t drawCount ) const noexcept
 {
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.sType					= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level					= VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool			= _commandPool;
-	allocInfo.commandBufferCount	= 1;
+	// Secondary command buffers inherit no state, so each slice binds everything it uses.
+	vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline );
 
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers( _device, &allocInfo, &commandBuffer );
+	VkViewport viewport{};
+	viewport.x								= 0.0f;
+	viewport.y								= 0.0f;
+	viewport.width							= static_cast<float>( _swapChainExtent.width );
+	viewport.height							= static_cast<float>( _swapChainExtent.height );
+	viewport.minDepth						= 0.0f;
+	viewport.maxDepth						= 1.0f;
+	vkCmdSetViewport( commandBuffer, 0, 1, &viewport );
 
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.sType					= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags					= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VkRect2D scissor{};
+	scissor.offset							= { 0, 0 };
+	scissor.extent							= _swapChainExtent;
+	vkCmdSetScissor( commandBuffer, 0, 1, &scissor );
 
-	vkBeginCommandBuffer( commandBuffer, &beginInfo );
+	// Binding 1 points at this frame's region of the instance buffer, or at the static objects of the GPU-driven path.
+	VkBuffer vertexBuffers[]				= { _vertexBuffer, ( true == _gpuCulling ) ? _gpuCuller.getObjectBuffer() : _instanceBuffer.getHandle() };
+	VkDeviceSize offsets[]					= { 0, ( true == _gpuCulling ) ? 0 : _instanceBufferOffset };
+	vkCmdBindVertexBuffers( commandBuffer, 0, 2, vertexBuffers, offsets );
 
-	VkBufferCopy copyRegion{};
-	copyRegion.srcOffset			= 0; // Optional
-	copyRegion.dstOffset			= 0; // Optional
-	copyRegion.size					= size;
-	vkCmdCopyBuffer( commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion );
+	vkCmdBindIndexBuffer( commandBuffer, _indexBuffer, 0, _indexType );
 
-	vkEndCommandBuffer( commandBuffer );
+	const VkDescriptorSet uniformSet		= _uniformRing.getDescriptorSet();
+	const VkDescriptorSet textureSet		= _textureStreamer.getDescriptorSet( _texture, _recordingFrame );
+	vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, TEXTURE_SET, 1, &textureSet, 0, nullptr );
 
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount	= 1;
-	submitInfo.pCommandBuffers	= &commandBuffer;
+	if ( true == _gpuCulling )
+	{
+		vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, UNIFORM_SET, 1, &uniformSet, 1, &_drawUniformOffsets[0] );
+		_gpuCuller.recordDraws( commandBuffer, _recordingFrame );
+		return;
+	}
 
-	vkQueueSubmit( _graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE );
-	vkQueueWaitIdle( _graphicsQueue );
+	const std::vector<DrawCommand>& drawCommands = getFrameDrawCommands();
 
-	vkFreeCommandBuffers( _device, _commandPool, 1, &commandBuffer );
+	for ( uint32_t ii = firstDraw; ii < firstDraw + drawCount; ++ii )
+	{
+		// Rebinding the same set with a new offset is all a draw's uniforms cost.
+		vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, UNIFORM_SET, 1, &uniformSet, 1, &_drawUniformOffsets[ii] );
+
+		const DrawCommand& drawCommand		= drawCommands[ii];
+		vkCmdDrawIndexed( commandBuffer, drawCommand._indexCount, drawCommand._instanceCount, drawCommand._firstIndex, drawCommand._vertexOffset, drawCommand._firstInstance );
+	}
 }
 
-void VKApplication::initializeWindow( void ) noexcept
+void VKApplication::runRecordingBenchmark( void ) noexcept
 {
-	const uint32_t WIDTH	= 800;
-	const uint32_t HEIGHT	= 600;
+	const uint32_t warmupIterations			= 10;
+	const uint32_t measuredIterations		= std::max( _options._frameCount, 1u );
+	const uint32_t drawCount				= getRecordedDrawCount();
 
-	glfwInit();
+	const VkCommandBufferInheritanceInfo inheritanceInfo = bindRenderGraph( 0, 0 );
 
-	glfwWindowHint( GLFW_CLIENT_API, GLFW_NO_API );
-	glfwWindowHint( GLFW_RESIZABLE, GLFW_FALSE );
+	// Thread counts double up to the pool size, which is always measured last.
+	std::vector<uint32_t> threadCounts;
+	for ( uint32_t count = 1; count < _commandRecorder.getThreadCount(); count *= 2 )
+	{
+		threadCounts.push_back( count );
+	}
+	threadCounts.push_back( _commandRecorder.getThreadCount() );
 
-	_window = glfwCreateWindow( WIDTH, HEIGHT, "Vulkan", nullptr, nullptr );
-	glfwSetWindowUserPointer( _window, this );
-	glfwSetFramebufferSizeCallback( _window, framebufferResizeCallback );
+	std::vector<ScalingSample> samples;
+
+	// Nothing has been submitted yet, so frame 0's pools are free to be reset over and over.
+	for ( const uint32_t threadCount : threadCounts )
+	{
+		_commandRecorder.setActiveThreadCount( threadCount );
+
+		ScalingSample sample{};
+		sample._threadCount					= threadCount;
+
+		for ( uint32_t ii = 0; ii < warmupIterations + measuredIterations; ++ii )
+		{
+			const auto begin				= std::chrono::steady_clock::now();
+
+			if ( false == _commandRecorder.recordFrame( 0, inheritanceInfo, drawCount, _recordDrawsCallback ) )
+			{
+				std::cerr << "failed to record command buffers" << std::endl;
+				return;
+			}
+
+			if ( warmupIterations <= ii )
+			{
+				sample._times.push_back( Benchmark::millisecondsSince( begin ) );
+			}
+		}
+
+		samples.push_back( std::move( sample ) );
+	}
+
+	_commandRecorder.setActiveThreadCount( _commandRecorder.getThreadCount() );
+
+	std::ofstream file;
+	if ( false == _options._benchmarkOutput.empty() )
+	{
+		file.open( _options._benchmarkOutput, std::ios::trunc );
+		if ( false == file.is_open() )
+		{
+			std::cerr << "failed to open " << _options._benchmarkOutput << std::endl;
+			return;
+		}
+	}
+
+	std::ostream& stream = ( true == file.is_open() ) ? static_cast<std::ostream&>( file ) : std::cout;
+
+	stream << "{\n";
+	stream << "  \"drawCount\": " << drawCount << ",\n";
+	stream << "  \"recording\": ";
+	Benchmark::writeScaling( stream, drawCount, samples );
+	stream << "\n}" << std::endl;
 }
 
-void VKApplication::runLoop( void ) noexcept
+void VKApplication::writeBenchmarkReport( void ) const noexcept
 {
-	while ( !glfwWindowShouldClose( _window ) )
+	const PipelineStatistics pipelineStatistics = _pipelineManager.getStatistics();
+
+	BenchmarkContext context{};
+	context._headless				= _options._headless;
+	context._presentMode			= ( true == _options._headless ) ? "none" : PRESENT_MODE_NAMES[_presentMode];
+	context._framesInFlight			= _framesInFlight;
+	context._lowLatency				= _options._lowLatency;
+	context._sampleCount			= static_cast<uint32_t>( _sampleCount );
+	context._textureUploadMBps		= _textureStreamer.getStatistics().getUploadMegabytesPerSecond();
+	context._textureResidentBytes	= _textureStreamer.getStatistics()._residentBytes;
+	context._particleCount			= ( true == _particles ) ? _particleSystem.getActiveCount() : 0;
+	context._particleSimulateMs		= Benchmark::getMedian( _particleSimulateTimes );
+	context._particleDrawMs			= Benchmark::getMedian( _particleDrawTimes );
+	context._swapChainImageCount	= static_cast<uint32_t>( _swapChainImages.size() );
+	context._extent					= _swapChainExtent;
+	context._vertexCount			= static_cast<uint32_t>( _mesh._vertices.size() );
+	context._indexCount				= static_cast<uint32_t>( _mesh._indices.size() );
+	context._drawCount				= static_cast<uint32_t>( _drawCommands.size() );
+	context._instanceCount			= _instanceCount;
+	context._gpuCulling				= _gpuCulling;
+	context._visibleCount			= ( ( true == _gpuCulling ) || ( true == _cpuCulling ) ) ? _visibleCount : _instanceCount;
+	context._recordThreadCount		= _commandRecorder.getThreadCount();
+	context._startupMs				= _startupMs;
+	context._pipelineCriticalMs		= pipelineStatistics._criticalMs + pipelineStatistics._stallMs;
+	context._pipelineBackgroundMs	= pipelineStatistics._backgroundMs;
+	context._pipelineCount			= pipelineStatistics._criticalCount + pipelineStatistics._backgroundCount;
+	context._meshLoadMs				= _meshStatistics._totalMs;
+	context._meshMegabytesPerSecond	= _meshStatistics.getMegabytesPerSecond();
+	context._indexSize				= ( VK_INDEX_TYPE_UINT16 == _indexType ) ? 2 : 4;
+	context._vertexStride			= _vertexFormat._stride;
+	context._acmr					= _meshOptimization._after._acmr;
+	context._atvr					= _meshOptimization._after._atvr;
+
+	if ( true == _options._benchmarkOutput.empty() )
 	{
-		glfwPollEvents();
-		drawFrame();
+		_benchmark.writeJson( std::cout, context );
+		return;
 	}
 
-	vkDeviceWaitIdle( _device );
+	std::ofstream file( _options._benchmarkOutput, std::ios::trunc );
+	if ( false == file.is_open() )
+	{
+		std::cerr << "failed to open " << _options._benchmarkOutput << std::endl;
+		return;
+	}
+
+	_benchmark.writeJson( file, context );
 }
 
 void VKApplication::drawFrame( void ) noexcept
 {
-	//vkWaitForFences( _device, 1, &_inFlightFences[_currentFrame], VK_TRUE, UINT64_MAX );
+	// waitForFrame() has made sure the frame's previous submission is finished.
+	const uint32_t frame = static_cast<uint32_t>( _currentFrame );
+	readGpuTimestamps( frame );
+	readParticleTiming( frame );
+	applyPendingPipeline();
+
+	auto phaseBegin = std::chrono::steady_clock::now();
 
 	uint32_t imageIndex = 0;
 	VkResult result = vkAcquireNextImageKHR( _device, _swapChain, UINT64_MAX, _imageAvailableSemaphores[_currentFrame], VK_NULL_HANDLE, &imageIndex );
+	_benchmark.addPhaseTime( FramePhase::Acquire, Benchmark::millisecondsSince( phaseBegin ) );
+
 	if ( VK_ERROR_OUT_OF_DATE_KHR == result )
 	{
 		recreateSwapChain();
@@ -998,8 +2291,6 @@ void VKApplication::drawFrame( void ) noexcept
 		return;
 	}
 
-
-
 	if ( VK_NULL_HANDLE !=  _imagesInFlight[imageIndex] ) 
 	{
 		vkWaitForFences( _device, 1, &_imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX );
@@ -1007,6 +2298,25 @@ void VKApplication::drawFrame( void ) noexcept
 
 	_imagesInFlight[imageIndex]				= _inFlightFences[_currentFrame];
 
+	phaseBegin = std::chrono::steady_clock::now();
+
+	if ( false == _gpuCulling )
+	{
+		updateInstances( frame );
+	}
+
+	updateUniforms( frame );
+	_textureStreamer.beginFrame( frame, _frameNumber, _deletionQueue );
+
+	if ( false == recordCommandBuffer( frame, imageIndex ) )
+	{
+		return;
+	}
+
+	_benchmark.addPhaseTime( FramePhase::Record, Benchmark::millisecondsSince( phaseBegin ) );
+
+	const VkCommandBuffer commandBuffer		= _commandRecorder.getPrimaryCommandBuffer( frame );
+
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType						= VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
@@ -1017,7 +2327,7 @@ void VKApplication::drawFrame( void ) noexcept
 	submitInfo.pWaitDstStageMask			= waitStages;
 
 	submitInfo.commandBufferCount			= 1;
-	submitInfo.pCommandBuffers				= &_commandBuffers[imageIndex];
+	submitInfo.pCommandBuffers				= &commandBuffer;
 
 	VkSemaphore signalSemaphores[]			= { _renderFinishedSemaphores[_currentFrame] };
 	submitInfo.signalSemaphoreCount			= 1;
@@ -1025,11 +2335,19 @@ void VKApplication::drawFrame( void ) noexcept
 
 	vkResetFences( _device, 1, &_inFlightFences[_currentFrame] );
 
+	phaseBegin = std::chrono::steady_clock::now();
+
 	if ( VK_SUCCESS != vkQueueSubmit( _graphicsQueue, 1, &submitInfo, _inFlightFences[_currentFrame] ) ) 
 	{
 		return;
 	}
 
+	_submittedInputTimes[_currentFrame]		= _frameInputTime;
+	_submittedFrameNumbers[_currentFrame]	= _frameNumber;
+	_submissionPending[_currentFrame]		= true;
+
+	_benchmark.addPhaseTime( FramePhase::Submit, Benchmark::millisecondsSince( phaseBegin ) );
+
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType						= VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -1042,7 +2360,10 @@ void VKApplication::drawFrame( void ) noexcept
 
 	presentInfo.pImageIndices				= &imageIndex;
 
+	phaseBegin = std::chrono::steady_clock::now();
 	result = vkQueuePresentKHR( _presentQueue, &presentInfo );
+	_benchmark.addPhaseTime( FramePhase::Present, Benchmark::millisecondsSince( phaseBegin ) );
+
 	if ( ( VK_ERROR_OUT_OF_DATE_KHR == result ) || 
 		 ( VK_SUBOPTIMAL_KHR == result ) || 
 		 ( true == _framebufferResized ) ) 
@@ -1055,58 +2376,282 @@ void VKApplication::drawFrame( void ) noexcept
 		return;
 	}
 
-	_currentFrame = ( _currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	_currentFrame = ( _currentFrame + 1) % _framesInFlight;
+	++_frameNumber;
+}
+
+void VKApplication::drawOffscreenFrame( void ) noexcept
+{
+	// Without a presentation engine the frame fence, waited on in waitForFrame(), is the only throttle on the CPU.
+	// Offscreen targets are per frame in flight, so the frame index doubles as the image index.
+	const uint32_t frame					= static_cast<uint32_t>( _currentFrame );
+	readGpuTimestamps( frame );
+	readParticleTiming( frame );
+	applyPendingPipeline();
+
+	auto phaseBegin							= std::chrono::steady_clock::now();
+
+	if ( false == _gpuCulling )
+	{
+		updateInstances( frame );
+	}
+
+	updateUniforms( frame );
+	_textureStreamer.beginFrame( frame, _frameNumber, _deletionQueue );
+
+	if ( false == recordCommandBuffer( frame, frame ) )
+	{
+		return;
+	}
+
+	_benchmark.addPhaseTime( FramePhase::Record, Benchmark::millisecondsSince( phaseBegin ) );
+
+	const VkCommandBuffer commandBuffer		= _commandRecorder.getPrimaryCommandBuffer( frame );
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType						= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount			= 1;
+	submitInfo.pCommandBuffers				= &commandBuffer;
+
+	vkResetFences( _device, 1, &_inFlightFences[_currentFrame] );
+
+	phaseBegin								= std::chrono::steady_clock::now();
+
+	if ( VK_SUCCESS != vkQueueSubmit( _graphicsQueue, 1, &submitInfo, _inFlightFences[_currentFrame] ) )
+	{
+		return;
+	}
+
+	_submittedInputTimes[_currentFrame]		= _frameInputTime;
+	_submittedFrameNumbers[_currentFrame]	= _frameNumber;
+	_submissionPending[_currentFrame]		= true;
+
+	_benchmark.addPhaseTime( FramePhase::Submit, Benchmark::millisecondsSince( phaseBegin ) );
+
+	_currentFrame = ( _currentFrame + 1 ) % _framesInFlight;
+	++_frameNumber;
+}
+
+void VKApplication::startShaderWatcher( void ) noexcept
+{
+	const std::vector<WatchedShader> shaders =
+	{
+		{ VERTEX_SHADER_SOURCE,		VERTEX_SHADER_FILE },
+		{ FRAGMENT_SHADER_SOURCE,	FRAGMENT_SHADER_FILE }
+	};
+
+	// Hot reload is a development aid; the application runs on without it.
+	_shaderWatcher.start( shaders, _options._shaderCompiler, [this]( void )
+	{
+		rebuildGraphicsPipeline();
+	} );
+}
+
+void VKApplication::rebuildGraphicsPipeline( void ) noexcept
+{
+	// Runs on the watcher thread; the render thread keeps drawing with the current pipeline meanwhile.
+	SceneProgram program;
+
+	if ( false == loadSceneProgram( program ) )
+	{
+		std::cerr << "shader reload: failed, keeping the current pipeline" << std::endl;
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( _pendingProgramMutex );
+
+		// A program that was never picked up was never used either.
+		if ( true == _hasPendingProgram )
+		{
+			vkDestroyShaderModule( _device, _pendingProgram._program._vertexModule, nullptr );
+			vkDestroyShaderModule( _device, _pendingProgram._program._fragmentModule, nullptr );
+		}
+
+		_pendingProgram		= std::move( program );
+		_hasPendingProgram	= true;
+	}
+
+	std::cout << "shader reload: shaders loaded, compiling the pipeline in the background" << std::endl;
 }
 
+void VKApplication::applyPendingPipeline( void ) noexcept
+{
+	{
+		std::lock_guard<std::mutex> lock( _pendingProgramMutex );
+
+		if ( ( true == _hasPendingProgram ) && ( false == acceptSetLayouts( _pendingProgram ) ) )
+		{
+			std::cerr << "shader reload: failed, keeping the current pipeline" << std::endl;
+			vkDestroyShaderModule( _device, _pendingProgram._program._vertexModule, nullptr );
+			vkDestroyShaderModule( _device, _pendingProgram._program._fragmentModule, nullptr );
+			_pendingProgram		= SceneProgram{};
+			_hasPendingProgram	= false;
+		}
+
+		if ( true == _hasPendingProgram )
+		{
+			// A newer reload supersedes one still compiling.
+			if ( true == _isReloading )
+			{
+				_pipelineManager.retireProgram( _reloadKey._program, _deletionQueue, _frameNumber );
+			}
+
+			_reloadKey			= getSceneKey( _pipelineManager.addProgram( std::move( _pendingProgram._program ) ) );
+			_reloadBegin		= std::chrono::steady_clock::now();
+			_pendingProgram		= SceneProgram{};
+			_hasPendingProgram	= false;
+			_isReloading		= true;
+
+			_pipelineManager.request( _reloadKey, _renderPass );
+		}
+	}
+
+	if ( false == _isReloading )
+	{
+		return;
+	}
+
+	// The current pipeline stands in until the new one is ready.
+	const PipelineStatus status = _pipelineManager.getStatus( _reloadKey );
+
+	if ( PipelineStatus::Pending == status )
+	{
+		return;
+	}
+
+	_isReloading = false;
+
+	if ( PipelineStatus::Failed == status )
+	{
+		std::cerr << "shader reload: failed, keeping the current pipeline" << std::endl;
+		_pipelineManager.retireProgram( _reloadKey._program, _deletionQueue, _frameNumber );
+		return;
+	}
+
+	// The frames already submitted may still be using the old pipelines; the manager retires them.
+	_pipelineManager.retireProgram( _sceneKey._program, _deletionQueue, _frameNumber );
+
+	_sceneKey			= _reloadKey;
+	_graphicsPipeline	= _pipelineManager.require( _sceneKey, _renderPass );
+	_pipelineLayout		= _pipelineManager.getLayout( _sceneKey._program );
+
+	if ( true == _options._pipelinePermutations )
+	{
+		requestPermutations();
+	}
+
+	std::cout << "shader reload: pipeline switched after " << Benchmark::millisecondsSince( _reloadBegin ) << " ms" << std::endl;
+}
 
 void VKApplication::clean( void ) noexcept
 {
+	_shaderWatcher.stop();
+
 	cleanupSwapChain();
 
-	vkDestroyCommandPool( _device, _commandPool, nullptr );
+	// Compiles that have not started are dropped, as is a reload that was never picked up.
+	_pipelineManager.printStatistics();
+	_pipelineManager.destroy();
+
+	if ( true == _hasPendingProgram )
+	{
+		vkDestroyShaderModule( _device, _pendingProgram._program._vertexModule, nullptr );
+		vkDestroyShaderModule( _device, _pendingProgram._program._fragmentModule, nullptr );
+	}
+
+	_deletionQueue.flush();
+	_renderGraph.destroy();
+
+	if ( false == _options._headless )
+	{
+		vkDestroySwapchainKHR( _device, _swapChain, nullptr );
+	}
+
+	_commandRecorder.destroy();
+
+	if ( VK_NULL_HANDLE != _timestampQueryPool )
+	{
+		vkDestroyQueryPool( _device, _timestampQueryPool, nullptr );
+	}
 	
-	for ( int ii = 0; ii < MAX_FRAMES_IN_FLIGHT; ++ii ) 
+	for ( uint32_t ii = 0; ii < _framesInFlight; ++ii ) 
 	{
         vkDestroySemaphore( _device, _renderFinishedSemaphores[ii], nullptr );
         vkDestroySemaphore( _device, _imageAvailableSemaphores[ii], nullptr );
 		vkDestroyFence( _device, _inFlightFences[ii], nullptr );
     }
 
-	vkDestroyBuffer( _device, _indexBuffer, nullptr );
-	vkFreeMemory( _device, _indexBufferMemory, nullptr );
+	_uploadManager.destroy();
 
-	vkDestroyBuffer( _device, _vertexBuffer, nullptr );
-    vkFreeMemory( _device, _vertexBufferMemory, nullptr );
+	_textureStreamer.printStatistics();
+	_textureStreamer.destroy();
+	_particleSystem.destroy();
+	_gpuCuller.destroy();
+	_uniformRing.destroy();
+	_instanceBuffer.destroy();
+	_allocator.destroyBuffer( _indexBuffer, _indexBufferAllocation );
+	_allocator.destroyBuffer( _vertexBuffer, _vertexBufferAllocation );
+
+	_allocator.printStatistics();
+	_allocator.destroy();
+
+	_layoutCache.printStatistics();
+	_layoutCache.destroy();
+	_pipelineCache.destroy();
 
 	vkDestroyDevice( _device, nullptr );
-	vkDestroySurfaceKHR( _vkInstance, _surface, nullptr );
+
+	// Headless runs never enable VK_KHR_surface; the surface still has to go before the instance.
+	if ( false == _options._headless )
+	{
+		vkDestroySurfaceKHR( _vkInstance, _surface, nullptr );
+	}
+
 	vkDestroyInstance( _vkInstance, nullptr );
 
-	glfwDestroyWindow( _window );
-	glfwTerminate();
+	if ( false == _options._headless )
+	{
+		glfwDestroyWindow( _window );
+		glfwTerminate();
+	}
+
+	_jobSystem.destroy();
 }
 
 void VKApplication::cleanupSwapChain( void ) noexcept
 {
-	const int swapChainFramebuffersSize = static_cast<int>( _swapChainFramebuffers.size() );
 	const int swpaChainImageViewsSize	= static_cast<int>( _swapChainImageViews.size() );
 
-	for ( int ii = 0; ii < swapChainFramebuffersSize; ++ii )
+	for ( int ii = 0; ii < swpaChainImageViewsSize; ++ii )
 	{
-		vkDestroyFramebuffer(_device, _swapChainFramebuffers[ii], nullptr );
+		vkDestroyImageView( _device, _swapChainImageViews[ii], nullptr );
 	}
 
-	vkFreeCommandBuffers( _device, _commandPool, static_cast<uint32_t>( _commandBuffers.size()), _commandBuffers.data() );
-	vkDestroyPipeline( _device, _graphicsPipeline, nullptr );
-	vkDestroyPipelineLayout( _device, _pipelineLayout, nullptr );
-	vkDestroyRenderPass( _device, _renderPass, nullptr );
-
-	for ( int ii = 0; ii < swpaChainImageViewsSize; ++ii )
+	if ( true == _options._headless )
 	{
-		vkDestroyImageView( _device, _swapChainImageViews[ii], nullptr );
+		const int offscreenImageSize = static_cast<int>( _swapChainImages.size() );
+
+		for ( int ii = 0; ii < offscreenImageSize; ++ii )
+		{
+			_allocator.destroyImage( _swapChainImages[ii], _offscreenImageAllocations[ii] );
+		}
 	}
+}
+
+void VKApplication::retireSwapChain( void ) noexcept
+{
+	const VkDevice device = _device;
+
+	_deletionQueue.retire( _frameNumber, [device, imageViews = _swapChainImageViews]( void )
+	{
+		for ( const VkImageView imageView : imageViews )
+		{
+			vkDestroyImageView( device, imageView, nullptr );
+		}
+	} );
 
-	vkDestroySwapchainKHR( _device, _swapChain, nullptr );
+	_swapChainImageViews.clear();
 }
 
 void VKApplication::framebufferResizeCallback( GLFWwindow * window, int width, int height ) noexcept
@@ -3,6 +3,29 @@
 
 #include "pch.h"
 
+#include "Options.h"
+#include "Benchmark.h"
+#include "PipelineCache.h"
+#include "PipelineLayoutCache.h"
+#include "PipelineManager.h"
+#include "MemoryAllocator.h"
+#include "UploadManager.h"
+#include "CommandRecorder.h"
+#include "JobSystem.h"
+#include "MeshLoader.h"
+#include "MeshOptimizer.h"
+#include "VertexLayout.h"
+#include "File.h"
+#include "ShaderWatcher.h"
+#include "InstanceBuffer.h"
+#include "GpuCuller.h"
+#include "FrustumCuller.h"
+#include "UniformRing.h"
+#include "DeletionQueue.h"
+#include "RenderGraph.h"
+#include "TextureStreamer.h"
+#include "ParticleSystem.h"
+
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 
@@ -16,6 +39,9 @@ struct QueueFamilyIndices
 {
 	std::optional<uint32_t> _graphicsFamily;
 	std::optional<uint32_t> _presentFamily;
+	std::optional<uint32_t> _transferFamily;
+	// Of the graphics family's timestamps; 0 if it cannot write them.
+	uint32_t				_timestampValidBits	= 0;
 
 	bool isComplete( void ) noexcept
 	{
@@ -23,6 +49,22 @@ struct QueueFamilyIndices
 	}
 };
 
+struct DrawCommand
+{
+	uint32_t	_indexCount;
+	uint32_t	_firstIndex;
+	int32_t		_vertexOffset;
+	uint32_t	_firstInstance;
+	uint32_t	_instanceCount;
+};
+
+// Matches the DrawUniforms block in base.vert (std140).
+struct DrawUniforms
+{
+	glm::vec4	_lightDirection;	// clip-space direction towards the light in xyz, ambient term in w
+	glm::vec4	_tint;				// multiplies the lit color of the draw
+};
+
 struct SwapChainSupportDetails
 {
 	VkSurfaceCapabilitiesKHR			_capabilities;
@@ -30,14 +72,23 @@ struct SwapChainSupportDetails
 	std::vector<VkPresentModeKHR>		_presentModes;
 };
 
+// The scene shaders and the descriptor set layouts they declare, which are only taken over on the render thread.
+struct SceneProgram
+{
+	PipelineProgram						_program;
+	VkDescriptorSetLayout				_uniformSetLayout	= VK_NULL_HANDLE;
+	VkDescriptorSetLayout				_textureSetLayout	= VK_NULL_HANDLE;
+};
+
 class VKApplication
 {
 public:
 
-	VKApplication( void );
+	VKApplication( const Options& options );
 	~VKApplication( void );
 
-	void			run( void ) noexcept;
+	// False if initialization failed or a run-time check did not hold, e.g. GPU culling against the CPU reference.
+	bool			run( void ) noexcept;
 
 private:
 
@@ -47,51 +98,101 @@ private:
 	bool					pickPhysicalDevice( void ) noexcept;
 	bool					isDeviceSuitable( const VkPhysicalDevice device ) const noexcept;
 	bool					checkDeviceExtensionSupport( const VkPhysicalDevice device ) const noexcept;
+	bool					isDeviceExtensionAvailable( const VkPhysicalDevice device, const char* extensionName ) const noexcept;
+	VkFormat				findOffscreenFormat( const VkPhysicalDevice device ) const noexcept;
+	VkFormat				findDepthFormat( const VkPhysicalDevice device ) const noexcept;
+	VkSampleCountFlagBits	chooseSampleCount( const VkPhysicalDevice device ) const noexcept;
 
 	QueueFamilyIndices			findQueueFamilies( const VkPhysicalDevice device ) const noexcept;
 	std::vector<const char*>	getRequiredExtensions( void ) const noexcept;
+	std::vector<const char*>	getRequiredDeviceExtensions( void ) const noexcept;
 	SwapChainSupportDetails		querySwapChainSupport( const VkPhysicalDevice device) const noexcept;
 	VkSurfaceFormatKHR			chooseSwapSurfaceFormat( const std::vector<VkSurfaceFormatKHR>& availableFormats ) const noexcept;
 	VkPresentModeKHR			chooseSwapPresentMode( const std::vector<VkPresentModeKHR>& availablePresentModes ) const noexcept;
 	VkExtent2D					chooseSwapExtent( const VkSurfaceCapabilitiesKHR& capabilities ) const noexcept;
-	uint32_t					findMemoryType( uint32_t typeFilter, VkMemoryPropertyFlags properties ) const noexcept;
 
 	bool						createLogicalDevice( void ) noexcept;
 	bool						createSurface( void ) noexcept;
 	bool						createSwapChain( void ) noexcept;
 	bool						recreateSwapChain( void ) noexcept;
+	bool						createOffscreenImages( void ) noexcept;
 	bool						createImageViews( void ) noexcept;
-	bool						createRenderPass( void ) noexcept;
+	bool						createRenderGraph( void ) noexcept;
 	bool						createGraphicsPipeline( void ) noexcept;
-	bool						createFramebuffers( void ) noexcept;
-	bool						createCommandPool( void ) noexcept;
-	bool						createCommandBuffers( void ) noexcept;
+	bool						loadSceneProgram( SceneProgram& program ) noexcept;
+	// Adopts the program's set layouts, or rejects them if they differ from the ones already in use.
+	bool						acceptSetLayouts( const SceneProgram& program ) noexcept;
+	void						getSceneVertexInput( std::vector<VkVertexInputBindingDescription>& bindings, std::vector<VkVertexInputAttributeDescription>& attributes ) const noexcept;
+	PipelineKey					getSceneKey( const uint32_t program ) const noexcept;
+	// Every blend, cull, depth write and topology variant of the scene pipeline, compiled on the job threads.
+	void						requestPermutations( void ) noexcept;
+	bool						createCommandRecorder( void ) noexcept;
+	bool						createTimestampQueryPool( void ) noexcept;
 	bool						createSyncObjects( void ) noexcept;
 
+	bool						loadMesh( void ) noexcept;
 	bool						createVertexBuffer( void ) noexcept;
 	bool						createIndexBuffer( void ) noexcept;
+	void						createDrawCommands( void ) noexcept;
+	bool						createGpuCuller( void ) noexcept;
+	void						createFrustumCuller( void ) noexcept;
+	bool						createUniformRing( void ) noexcept;
+	bool						createTextureStreamer( void ) noexcept;
+	bool						createParticleSystem( void ) noexcept;
+	void						updateUniforms( const uint32_t frame ) noexcept;
+	uint32_t					cullObjects( void ) noexcept;
+	void						updateInstances( const uint32_t frame ) noexcept;
+	const std::vector<DrawCommand>&	getFrameDrawCommands( void ) const noexcept;
+	uint32_t					getRecordedDrawCount( void ) const noexcept;
 
-	VkShaderModule				createShaderModule( const std::vector<char>& code ) const noexcept;
-	
-	bool						createBuffer( const VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory ) noexcept;
-
-	void						copyBuffer( VkBuffer srcBuffer, VkBuffer dstBuffer, const VkDeviceSize size ) noexcept;
+	static std::vector<DrawCommand>	mergeDraws( std::vector<DrawCommand> draws ) noexcept;
+	static InstanceData			placeInstance( const uint32_t index, const uint32_t count, const uint32_t columns, const float extent, const float pulse ) noexcept;
 
-	void						runLoop( void ) noexcept;
+	bool						loadShaderCode( const std::string& fileName, MappedFile& code ) const noexcept;
+	VkShaderModule				createShaderModule( const MappedFile& code ) const noexcept;
+	
+	// False if the GPU cull counts disagree with the CPU reference.
+	bool						runLoop( void ) noexcept;
+	void						runFrame( void ) noexcept;
+	bool						isRunning( const uint32_t frameCount ) const noexcept;
+	void						waitForFrame( void ) noexcept;
+	uint64_t					pollCompletedFrames( void ) noexcept;
+	void						readGpuTimestamps( const uint32_t frame ) noexcept;
+	void						readParticleTiming( const uint32_t frame ) noexcept;
+	VkCommandBufferInheritanceInfo	bindRenderGraph( const uint32_t frame, const uint32_t imageIndex ) noexcept;
+	bool						recordCommandBuffer( const uint32_t frame, const uint32_t imageIndex ) noexcept;
+	void						recordDraws( const VkCommandBuffer commandBuffer, const uint32_t firstDraw, const uint32_t drawCount ) const noexcept;
+	void						runRecordingBenchmark( void ) noexcept;
+	// GPU time of the particle simulation and draw at doubling particle counts, for sizing effects.
+	void						runParticleBenchmark( void ) noexcept;
+	void						writeBenchmarkReport( void ) const noexcept;
 	void						drawFrame( void ) noexcept;
+	void						drawOffscreenFrame( void ) noexcept;
+
+	void						startShaderWatcher( void ) noexcept;
+	void						rebuildGraphicsPipeline( void ) noexcept;
+	void						applyPendingPipeline( void ) noexcept;
 	
 	void						clean( void ) noexcept;
 	void						cleanupSwapChain( void ) noexcept;
+	void						retireSwapChain( void ) noexcept;
 
 	static void					framebufferResizeCallback( GLFWwindow* window, int width, int height ) noexcept;
 
+	Options							_options;
+	JobSystem						_jobSystem;
+
 	GLFWwindow*						_window;
 	VkInstance						_vkInstance;
 	VkPhysicalDevice				_physicalDevice;
 	VkDevice						_device;
+	MemoryAllocator					_allocator;
 
 	VkQueue							_graphicsQueue;
 	VkQueue							_presentQueue;
+	VkQueue							_transferQueue;
+
+	UploadManager					_uploadManager;
 
 	VkSurfaceKHR					_surface;
 
@@ -100,27 +201,121 @@ private:
 	VkFormat						_swapChainImageFormat;
 	VkExtent2D						_swapChainExtent;
 	std::vector<VkImageView>		_swapChainImageViews;
+	std::vector<Allocation>			_offscreenImageAllocations;
 
+	// The frame's passes; _renderPass is the scene pass's render pass, which the graphics pipeline is built for.
+	RenderGraph						_renderGraph;
+	RenderGraphResource				_backbufferResource;
+	RenderGraphResource				_colorResource;
+	RenderGraphResource				_depthResource;
+	RenderGraphResource				_drawBufferResource;
+	RenderGraphResource				_drawCountResource;
+	RenderGraphResource				_particleResource;
+	uint32_t						_scenePass;
+	uint32_t						_particlePass;
 	VkRenderPass					_renderPass;
+	// The scene renders with depth, multisampled when _sampleCount is above one and resolved into the backbuffer.
+	VkFormat						_depthFormat;
+	VkSampleCountFlagBits			_sampleCount;
 	VkPipelineLayout				_pipelineLayout;
 	VkPipeline						_graphicsPipeline;
+	PipelineCache					_pipelineCache;
+	PipelineLayoutCache				_layoutCache;
+	PipelineManager					_pipelineManager;
+	uint32_t						_vertexInput;
+	PipelineKey						_sceneKey;
+
+	// Hot reload loads the shaders on the watcher thread and hands them over at the next frame boundary; the
+	// pipeline compiles on the job threads and replaces the current one once it is ready.
+	ShaderWatcher					_shaderWatcher;
+	PipelineKey						_reloadKey;
+	std::chrono::steady_clock::time_point	_reloadBegin;
+	bool							_isReloading;
+	std::mutex						_pendingProgramMutex;
+	SceneProgram					_pendingProgram;
+	bool							_hasPendingProgram;
+
+	// Replaced pipelines, swapchains, their views and render graphs wait here for the frames that may still use them.
+	DeletionQueue					_deletionQueue;
+
+	CommandRecorder					_commandRecorder;
+	RecordCallback					_recordDrawsCallback;
+	Mesh							_mesh;
+	MeshLoadStatistics				_meshStatistics;
+	MeshOptimizationStatistics		_meshOptimization;
+	FileReadRequest					_meshRead;
+	VkIndexType						_indexType;
+	VertexFormat					_vertexFormat;
+	std::vector<DrawCommand>		_drawCommands;
+	InstanceBuffer					_instanceBuffer;
+	uint32_t						_instanceCount;
+	VkDeviceSize					_instanceBufferOffset;
+
+	// Set when the device supports the GPU-driven path that was asked for.
+	bool							_gpuCulling;
+	GpuCuller						_gpuCuller;
+	PFN_vkCmdDrawIndexedIndirectCountKHR	_drawIndexedIndirectCount;
+	uint32_t						_visibleCount;
 
-	std::vector<VkFramebuffer>		_swapChainFramebuffers;
+	// CPU culling in front of recording, for the draws the CPU still issues itself.
+	bool							_cpuCulling;
+	FrustumCuller					_frustumCuller;
+	std::vector<uint32_t>			_visibleObjects;
+	std::vector<DrawCommand>		_visibleDrawCommands;
 
-	VkCommandPool					_commandPool;
-	std::vector<VkCommandBuffer>	_commandBuffers;
+	// Per-frame and per-draw uniforms, bound through one dynamic descriptor with an offset per draw.
+	UniformRing						_uniformRing;
+	VkDescriptorSetLayout			_uniformSetLayout;
+	std::vector<uint32_t>			_drawUniformOffsets;
+
+	// Every draw samples one streamed texture, the default white one unless --texture names a file.
+	TextureStreamer					_textureStreamer;
+	VkDescriptorSetLayout			_textureSetLayout;
+	TextureHandle					_texture;
+
+	// Simulated by a compute pass ahead of the scene and drawn in a subpass after it.
+	bool							_particles;
+	ParticleSystem					_particleSystem;
+	bool							_isMeasuringParticles;
+	std::vector<double>				_particleSimulateTimes;
+	std::vector<double>				_particleDrawTimes;
+	// The frame whose command buffers are being recorded, for the per-frame indirect buffers.
+	uint32_t						_recordingFrame;
 
 	std::vector<VkSemaphore>		_imageAvailableSemaphores;
 	std::vector<VkSemaphore>		_renderFinishedSemaphores;
 	std::vector<VkFence>			_inFlightFences;
 	std::vector<VkFence>			_imagesInFlight;
 
+	// Per-frame resources are created for this many frames; set from the options.
+	uint32_t						_framesInFlight;
 	size_t							_currentFrame;
+	// Frames submitted so far; frame N may reuse resources once frame N - _framesInFlight has completed.
+	uint64_t						_frameNumber;
 	bool							_framebufferResized;
 
+	VkPresentModeKHR				_presentMode;
+
+	// When the current frame sampled its input. Per frame in flight, what was last submitted with it, pending
+	// until its fence is seen signaled.
+	std::chrono::steady_clock::time_point				_frameInputTime;
+	std::vector<std::chrono::steady_clock::time_point>	_submittedInputTimes;
+	std::vector<uint64_t>								_submittedFrameNumbers;
+	std::vector<bool>									_submissionPending;
+
+	Benchmark						_benchmark;
+	VkQueryPool						_timestampQueryPool;
+	uint32_t						_timestampQueryCount;
+	float							_timestampPeriod;
+	// Bits above timestampValidBits are undefined.
+	uint64_t						_timestampMask;
+	std::vector<bool>				_timestampsWritten;
+
+	double							_startupMs;
+
 	VkBuffer						_vertexBuffer;
-	VkDeviceMemory					_vertexBufferMemory;
+	Allocation						_vertexBufferAllocation;
 
 	VkBuffer						_indexBuffer;
-	VkDeviceMemory					_indexBufferMemory;
+	Allocation						_indexBufferAllocation;
 };
@@ -1,48 +1,11 @@
 #pragma once
 
 
+// Full-precision vertex as meshes are loaded and processed on the CPU. What reaches the GPU is
+// packed from it by one of the layouts in VertexLayout.h.
 struct Vertex
 {
-	glm::vec2 position;
+	glm::vec3 position;
+	glm::vec3 normal;
 	glm::vec3 color;
-
-	static VkVertexInputBindingDescription getBindingDescription( void ) noexcept 
-	{
-		VkVertexInputBindingDescription bindingDescription{};
-		bindingDescription.binding		= 0;
-		bindingDescription.stride		= sizeof( Vertex );
-		bindingDescription.inputRate	= VK_VERTEX_INPUT_RATE_VERTEX;
-
-		return bindingDescription;
-	}
-
-	static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions( void ) noexcept 
-	{
-		std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
-
-		attributeDescriptions[0].binding	= 0;
-		attributeDescriptions[0].location	= 0;
-		attributeDescriptions[0].format		= VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[0].offset		= offsetof(Vertex, position);
-
-		attributeDescriptions[1].binding	= 0;
-		attributeDescriptions[1].location	= 1;
-		attributeDescriptions[1].format		= VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset		= offsetof(Vertex, color);
-
-		return attributeDescriptions;
-	}
 };
-
-static const std::vector<Vertex> vertices = 
-{
-	{ { -0.5f, -0.5f }, { 1.0f, 0.0f, 0.0f } },
-	{ { 0.5f, -0.5f }, { 0.0f, 1.0f, 0.0f } },
-	{ { 0.5f, 0.5f }, { 0.0f, 0.0f, 1.0f } },
-	{ { -0.5f, 0.5f }, { 1.0f, 1.0f, 1.0f } }
-};
-
-static const std::vector<uint16_t> indices = 
-{
-	0, 1, 2, 2, 3, 0
-};
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "pch.h"
+
+#include "VertexLayout.h"
+
+namespace
+{
+	// Round-to-nearest-even float to IEEE half conversion, with overflow going to infinity.
+	uint16_t toHalf( const float value ) noexcept
+	{
+		uint32_t bits;
+		memcpy( &bits, &value, sizeof( bits ) );
+
+		const uint16_t sign			= static_cast<uint16_t>( ( bits >> 16 ) & 0x8000 );
+		const uint32_t magnitude	= bits & 0x7FFFFFFF;
+
+		if ( 0x7F800000 < magnitude )
+		{
+			return sign | 0x7E00;
+		}
+
+		if ( 0x477FF000 <= magnitude )
+		{
+			return sign | 0x7C00;
+		}
+
+		// Below the smallest normal half the value is a plain multiple of 2^-24.
+		if ( 0x38800000 > magnitude )
+		{
+			return sign | static_cast<uint16_t>( std::lrint( std::fabs( value ) * 16777216.0f ) );
+		}
+
+		const uint32_t rounded		= magnitude + 0xFFF + ( ( magnitude >> 13 ) & 1 );
+		return sign | static_cast<uint16_t>( ( rounded - 0x38000000 ) >> 13 );
+	}
+
+	int16_t toSnorm16( const float value ) noexcept
+	{
+		return static_cast<int16_t>( std::lrint( std::min( std::max( value, -1.0f ), 1.0f ) * 32767.0f ) );
+	}
+}
+
+VkVertexInputBindingDescription VertexFormat::getBindingDescription( const uint32_t binding ) const noexcept
+{
+	return VkVertexInputBindingDescription{ binding, _stride, VK_VERTEX_INPUT_RATE_VERTEX };
+}
+
+void Float3Encoding::encode( const glm::vec3& value, unsigned char* destination ) noexcept
+{
+	const float packed[3] = { value.x, value.y, value.z };
+	memcpy( destination, packed, sizeof( packed ) );
+}
+
+void Half4Encoding::encode( const glm::vec3& value, unsigned char* destination ) noexcept
+{
+	const uint16_t packed[4] = { toHalf( value.x ), toHalf( value.y ), toHalf( value.z ), 0x3C00 };
+	memcpy( destination, packed, sizeof( packed ) );
+}
+
+void Unorm8x4Encoding::encode( const glm::vec3& value, unsigned char* destination ) noexcept
+{
+	const float components[3] = { value.x, value.y, value.z };
+
+	for ( int ii = 0; ii < 3; ++ii )
+	{
+		destination[ii] = static_cast<unsigned char>( std::lrint( std::min( std::max( components[ii], 0.0f ), 1.0f ) * 255.0f ) );
+	}
+
+	destination[3] = 255;
+}
+
+void Snorm8x4Encoding::encode( const glm::vec3& value, unsigned char* destination ) noexcept
+{
+	const float components[3] = { value.x, value.y, value.z };
+
+	for ( int ii = 0; ii < 3; ++ii )
+	{
+		const int8_t packed = static_cast<int8_t>( std::lrint( std::min( std::max( components[ii], -1.0f ), 1.0f ) * 127.0f ) );
+		memcpy( destination + ii, &packed, sizeof( packed ) );
+	}
+
+	destination[3] = 0;
+}
+
+void Octahedral16Encoding::encode( const glm::vec3& value, unsigned char* destination ) noexcept
+{
+	const float sum = std::fabs( value.x ) + std::fabs( value.y ) + std::fabs( value.z );
+
+	// Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the upper one.
+	float x = ( 0.0f < sum ) ? value.x / sum : 0.0f;
+	float y = ( 0.0f < sum ) ? value.y / sum : 0.0f;
+
+	if ( 0.0f > value.z )
+	{
+		const float foldedX = ( 1.0f - std::fabs( y ) ) * ( ( 0.0f <= x ) ? 1.0f : -1.0f );
+		const float foldedY = ( 1.0f - std::fabs( x ) ) * ( ( 0.0f <= y ) ? 1.0f : -1.0f );
+
+		x = foldedX;
+		y = foldedY;
+	}
+
+	const int16_t packed[2] = { toSnorm16( x ), toSnorm16( y ) };
+	memcpy( destination, packed, sizeof( packed ) );
+}
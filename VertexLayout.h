@@ -0,0 +1,194 @@
+#pragma once
+
+#include "Vertex.h"
+
+enum class VertexSemantic : uint32_t
+{
+	Position = 0,
+	Normal,
+	Color
+};
+
+// Encodings turn one float3 of the source Vertex into its packed GPU representation.
+// SIZE and ALIGNMENT describe the packed bytes; FORMAT is what the vertex input stage reads.
+struct Float3Encoding
+{
+	static constexpr uint32_t	SIZE		= 12;
+	static constexpr uint32_t	ALIGNMENT	= 4;
+	static constexpr VkFormat	FORMAT		= VK_FORMAT_R32G32B32_SFLOAT;
+
+	static void		encode( const glm::vec3& value, unsigned char* destination ) noexcept;
+};
+
+// Three halves plus w = 1; three-component 16-bit formats are rarely supported for vertex input.
+struct Half4Encoding
+{
+	static constexpr uint32_t	SIZE		= 8;
+	static constexpr uint32_t	ALIGNMENT	= 2;
+	static constexpr VkFormat	FORMAT		= VK_FORMAT_R16G16B16A16_SFLOAT;
+
+	static void		encode( const glm::vec3& value, unsigned char* destination ) noexcept;
+};
+
+// For values in [0, 1], such as colors; w = 1.
+struct Unorm8x4Encoding
+{
+	static constexpr uint32_t	SIZE		= 4;
+	static constexpr uint32_t	ALIGNMENT	= 1;
+	static constexpr VkFormat	FORMAT		= VK_FORMAT_R8G8B8A8_UNORM;
+
+	static void		encode( const glm::vec3& value, unsigned char* destination ) noexcept;
+};
+
+// For values in [-1, 1]; w = 0.
+struct Snorm8x4Encoding
+{
+	static constexpr uint32_t	SIZE		= 4;
+	static constexpr uint32_t	ALIGNMENT	= 1;
+	static constexpr VkFormat	FORMAT		= VK_FORMAT_R8G8B8A8_SNORM;
+
+	static void		encode( const glm::vec3& value, unsigned char* destination ) noexcept;
+};
+
+// Unit vectors folded onto the octahedron and stored as two snorm16; the shader unfolds them.
+struct Octahedral16Encoding
+{
+	static constexpr uint32_t	SIZE		= 4;
+	static constexpr uint32_t	ALIGNMENT	= 2;
+	static constexpr VkFormat	FORMAT		= VK_FORMAT_R16G16_SNORM;
+
+	static void		encode( const glm::vec3& value, unsigned char* destination ) noexcept;
+};
+
+template<VertexSemantic Semantic, typename Encoding>
+struct VertexAttribute
+{
+	static constexpr VertexSemantic	SEMANTIC = Semantic;
+	typedef Encoding				EncodingType;
+};
+
+// Runtime view of a layout, for code that picks the layout from options.
+struct VertexFormat
+{
+	uint32_t									_stride;
+	const VkVertexInputAttributeDescription*	_attributes;
+	uint32_t									_attributeCount;
+	bool										_hasOctahedralNormals;
+	void										( *_pack )( const Vertex* vertices, const size_t count, unsigned char* destination );
+
+	VkVertexInputBindingDescription				getBindingDescription( const uint32_t binding ) const noexcept;
+};
+
+// Byte offset of every attribute, each aligned to its encoding. A free function rather than a member
+// because a class's constexpr members cannot be evaluated inside its own definition.
+template<typename... Attributes>
+constexpr std::array<uint32_t, sizeof...( Attributes )> computeVertexOffsets( void ) noexcept
+{
+	constexpr uint32_t sizes[]		= { Attributes::EncodingType::SIZE... };
+	constexpr uint32_t alignments[]	= { Attributes::EncodingType::ALIGNMENT... };
+
+	std::array<uint32_t, sizeof...( Attributes )> offsets{};
+	uint32_t offset = 0;
+
+	for ( size_t ii = 0; ii < sizeof...( Attributes ); ++ii )
+	{
+		offset		= ( offset + alignments[ii] - 1 ) / alignments[ii] * alignments[ii];
+		offsets[ii]	= offset;
+		offset		+= sizes[ii];
+	}
+
+	return offsets;
+}
+
+// Rounded up to 4 bytes so every vertex starts on a fetch-friendly boundary.
+template<typename... Attributes>
+constexpr uint32_t computeVertexStride( void ) noexcept
+{
+	constexpr uint32_t sizes[] = { Attributes::EncodingType::SIZE... };
+
+	return ( computeVertexOffsets<Attributes...>()[sizeof...( Attributes ) - 1] + sizes[sizeof...( Attributes ) - 1] + 3 ) / 4 * 4;
+}
+
+template<typename... Attributes>
+constexpr std::array<VkVertexInputAttributeDescription, sizeof...( Attributes )> computeVertexAttributes( const uint32_t binding ) noexcept
+{
+	constexpr VkFormat formats[]	= { Attributes::EncodingType::FORMAT... };
+	constexpr auto offsets			= computeVertexOffsets<Attributes...>();
+
+	std::array<VkVertexInputAttributeDescription, sizeof...( Attributes )> descriptions{};
+
+	for ( uint32_t ii = 0; ii < sizeof...( Attributes ); ++ii )
+	{
+		descriptions[ii].location	= ii;
+		descriptions[ii].binding	= binding;
+		descriptions[ii].format		= formats[ii];
+		descriptions[ii].offset		= offsets[ii];
+	}
+
+	return descriptions;
+}
+
+// A vertex layout declared as a type list of attributes. Locations follow the list order; offsets,
+// stride and the Vulkan descriptions are all compile-time constants.
+template<typename... Attributes>
+class VertexLayout
+{
+public:
+
+	static_assert( 0 < sizeof...( Attributes ), "a vertex layout needs at least one attribute" );
+
+	static constexpr uint32_t												ATTRIBUTE_COUNT	= static_cast<uint32_t>( sizeof...( Attributes ) );
+	static constexpr std::array<uint32_t, ATTRIBUTE_COUNT>					OFFSETS			= computeVertexOffsets<Attributes...>();
+	static constexpr uint32_t												STRIDE			= computeVertexStride<Attributes...>();
+	static constexpr std::array<VkVertexInputAttributeDescription, ATTRIBUTE_COUNT>	ATTRIBUTES	= computeVertexAttributes<Attributes...>( 0 );
+
+	static constexpr VkVertexInputBindingDescription getBindingDescription( const uint32_t binding ) noexcept
+	{
+		return VkVertexInputBindingDescription{ binding, STRIDE, VK_VERTEX_INPUT_RATE_VERTEX };
+	}
+
+	static void pack( const Vertex* vertices, const size_t count, unsigned char* destination ) noexcept
+	{
+		for ( size_t ii = 0; ii < count; ++ii )
+		{
+			packVertex( vertices[ii], destination + ii * STRIDE, std::make_index_sequence<sizeof...( Attributes )>{} );
+		}
+	}
+
+	static VertexFormat getFormat( void ) noexcept
+	{
+		constexpr bool hasOctahedralNormals = ( ... || ( ( VertexSemantic::Normal == Attributes::SEMANTIC ) && std::is_same<typename Attributes::EncodingType, Octahedral16Encoding>::value ) );
+
+		return VertexFormat{ STRIDE, ATTRIBUTES.data(), ATTRIBUTE_COUNT, hasOctahedralNormals, &pack };
+	}
+
+private:
+
+	static const glm::vec3& getValue( const Vertex& vertex, const VertexSemantic semantic ) noexcept
+	{
+		switch ( semantic )
+		{
+		case VertexSemantic::Normal:	return vertex.normal;
+		case VertexSemantic::Color:		return vertex.color;
+		default:						return vertex.position;
+		}
+	}
+
+	template<size_t... Indices>
+	static void packVertex( const Vertex& vertex, unsigned char* destination, std::index_sequence<Indices...> ) noexcept
+	{
+		( Attributes::EncodingType::encode( getValue( vertex, Attributes::SEMANTIC ), destination + OFFSETS[Indices] ), ... );
+	}
+};
+
+// 36 bytes: the reference layout, bit-exact with the source data.
+typedef VertexLayout<
+	VertexAttribute<VertexSemantic::Position,	Float3Encoding>,
+	VertexAttribute<VertexSemantic::Color,		Float3Encoding>,
+	VertexAttribute<VertexSemantic::Normal,		Float3Encoding>>	FullVertexLayout;
+
+// 16 bytes: half positions are exact to about 1/2048 of the fitted mesh extent.
+typedef VertexLayout<
+	VertexAttribute<VertexSemantic::Position,	Half4Encoding>,
+	VertexAttribute<VertexSemantic::Color,		Unorm8x4Encoding>,
+	VertexAttribute<VertexSemantic::Normal,		Octahedral16Encoding>>	CompactVertexLayout;
@@ -0,0 +1,91 @@
+#include "pch.h"
+
+#include "WorkStealingQueue.h"
+
+WorkStealingQueue::WorkStealingQueue( void )
+	: _top{ 0 }
+	, _bottom{ 0 }
+{
+	for ( std::atomic<Job*>& job : _jobs )
+	{
+		job.store( nullptr, std::memory_order_relaxed );
+	}
+}
+
+bool WorkStealingQueue::push( Job* job ) noexcept
+{
+	const int64_t bottom	= _bottom.load( std::memory_order_relaxed );
+	const int64_t top		= _top.load( std::memory_order_acquire );
+
+	if ( static_cast<int64_t>( CAPACITY ) <= bottom - top )
+	{
+		return false;
+	}
+
+	// Release on the slot as well as the fence so the job's contents travel with the pointer; free on x86.
+	_jobs[bottom & MASK].store( job, std::memory_order_release );
+
+	// Publishes the slot before the new bottom becomes visible to thieves.
+	std::atomic_thread_fence( std::memory_order_release );
+	_bottom.store( bottom + 1, std::memory_order_relaxed );
+
+	return true;
+}
+
+Job* WorkStealingQueue::pop( void ) noexcept
+{
+	const int64_t bottom	= _bottom.load( std::memory_order_relaxed ) - 1;
+	_bottom.store( bottom, std::memory_order_relaxed );
+
+	// Orders the bottom reservation against the read of top; pairs with the fence in steal().
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	int64_t top				= _top.load( std::memory_order_relaxed );
+
+	if ( bottom < top )
+	{
+		_bottom.store( bottom + 1, std::memory_order_relaxed );
+		return nullptr;
+	}
+
+	Job* job				= _jobs[bottom & MASK].load( std::memory_order_relaxed );
+
+	if ( top == bottom )
+	{
+		// Last element: race thieves for it through top.
+		if ( false == _top.compare_exchange_strong( top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+		{
+			job				= nullptr;
+		}
+
+		_bottom.store( bottom + 1, std::memory_order_relaxed );
+	}
+
+	return job;
+}
+
+Job* WorkStealingQueue::steal( void ) noexcept
+{
+	int64_t top				= _top.load( std::memory_order_acquire );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	const int64_t bottom	= _bottom.load( std::memory_order_acquire );
+
+	if ( bottom <= top )
+	{
+		return nullptr;
+	}
+
+	Job* job				= _jobs[top & MASK].load( std::memory_order_acquire );
+
+	if ( false == _top.compare_exchange_strong( top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+	{
+		// Lost to the owner or another thief.
+		return nullptr;
+	}
+
+	return job;
+}
+
+bool WorkStealingQueue::isEmpty( void ) const noexcept
+{
+	return _bottom.load( std::memory_order_relaxed ) <= _top.load( std::memory_order_relaxed );
+}
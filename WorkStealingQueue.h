@@ -0,0 +1,31 @@
+#pragma once
+
+struct Job;
+
+// Chase-Lev deque (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models").
+// The owning thread pushes and pops at the bottom; any thread may steal from the top.
+class WorkStealingQueue
+{
+public:
+
+	static constexpr uint32_t	CAPACITY	= 4096;
+
+	WorkStealingQueue( void );
+
+	// Owner thread only. Fails when the queue is full.
+	bool			push( Job* job ) noexcept;
+	Job*			pop( void ) noexcept;
+
+	Job*			steal( void ) noexcept;
+
+	bool			isEmpty( void ) const noexcept;
+
+private:
+
+	static constexpr uint32_t	MASK		= CAPACITY - 1;
+
+	// Kept on separate cache lines so thieves hammering _top do not slow down the owner.
+	alignas( 64 ) std::atomic<int64_t>				_top;
+	alignas( 64 ) std::atomic<int64_t>				_bottom;
+	alignas( 64 ) std::array<std::atomic<Job*>, CAPACITY>	_jobs;
+};
@@ -1,12 +1,43 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(location = 0) in vec2 inPosition;
+// Set by the application when the vertex layout stores normals octahedron-encoded in two components.
+layout(constant_id = 0) const bool OCTAHEDRAL_NORMALS = false;
+
+layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec3 inNormal;
+
+// Per instance: clip-space offset in xyz and xy scale in w, and a color tint.
+layout(location = 3) in vec4 inOffsetScale;
+layout(location = 4) in vec4 inInstanceColor;
 
 layout(location = 0) out vec3 fragColor;
+// The vertex format has no texture coordinates, so the mesh's clip-space square is mapped onto the texture.
+layout(location = 1) out vec2 fragTexCoord;
+
+// One block per draw in the application's uniform ring, selected with a dynamic offset. The light is the
+// same for every draw of a frame, the tint differs per draw.
+layout(set = 0, binding = 0) uniform DrawUniforms {
+    vec4 lightDirection;    // clip-space direction towards the light in xyz, ambient term in w
+    vec4 tint;
+} uniforms;
+
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.x += (normal.x >= 0.0) ? -fold : fold;
+    normal.y += (normal.y >= 0.0) ? -fold : fold;
+    return normal;
+}
 
 void main() {
-    gl_Position = vec4(inPosition, 0.0, 1.0);
-    fragColor = inColor;
+    vec3 normal = OCTAHEDRAL_NORMALS ? decodeOctahedral(inNormal.xy) : inNormal;
+    float ambient = uniforms.lightDirection.w;
+    float lighting = ambient + (1.0 - ambient) * max(dot(normalize(normal), normalize(uniforms.lightDirection.xyz)), 0.0);
+
+    // Depth is only offset, so scaled copies stay inside the clip volume the mesh was fitted to.
+    gl_Position = vec4(inPosition.xy * inOffsetScale.w + inOffsetScale.xy, inPosition.z + inOffsetScale.z, 1.0);
+    fragColor = inColor * inInstanceColor.rgb * uniforms.tint.rgb * lighting;
+    fragTexCoord = inPosition.xy * 0.5 + 0.5;
 }
\ No newline at end of file
@@ -1,2 +1,6 @@
 C:\VulkanSDK\1.1.126.0\Bin32\glslc.exe base.vert -o vert.spv
-C:\VulkanSDK\1.1.126.0\Bin32\glslc.exe base.frag -o frag.spv
\ No newline at end of file
+C:\VulkanSDK\1.1.126.0\Bin32\glslc.exe base.frag -o frag.spv
+C:\VulkanSDK\1.1.126.0\Bin32\glslc.exe cull.comp -o cull.spv
+C:\VulkanSDK\1.1.126.0\Bin32\glslc.exe particles.comp -o particles.spv
+C:\VulkanSDK\1.1.126.0\Bin32\glslc.exe particle.vert -o particle_vert.spv
+C:\VulkanSDK\1.1.126.0\Bin32\glslc.exe particle.frag -o particle_frag.spv
\ No newline at end of file
@@ -1,12 +1,29 @@
+#include "pch.h"
+
+#include "Options.h"
 #include "VKApplication.h"
+#include "JobBenchmark.h"
+#include "CullingBenchmark.h"
 
 
 
-int main()
+int main( int argc, char* argv[] )
 {
-	VKApplication application;
+	const Options options = Options::parse( argc, argv );
+
+	if ( true == options._jobBenchmark )
+	{
+		JobBenchmark::run( options );
+		return 0;
+	}
+
+	if ( true == options._cullBenchmark )
+	{
+		CullingBenchmark::run( options );
+		return 0;
+	}
 
-	application.run();
+	VKApplication application( options );
 
-	return 0;
-}
\ No newline at end of file
+	return ( true == application.run() ) ? 0 : 1;
+}
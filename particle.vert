@@ -0,0 +1,17 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// The simulation's storage buffer bound as a vertex buffer: one point per particle.
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec4 inVelocity;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    // Hot and bright when born, fading to a dim red as the remaining life runs out.
+    float age = clamp(inPosition.w / max(inVelocity.w, 1e-3), 0.0, 1.0);
+
+    gl_Position = vec4(inPosition.xyz, 1.0);
+    gl_PointSize = 1.0;
+    fragColor = mix(vec3(0.05, 0.01, 0.0), vec3(1.0, 0.6, 0.2), age) * 0.25;
+}
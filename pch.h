@@ -6,13 +6,32 @@
 
 #include <iostream>
 #include <fstream>
+#include <filesystem>
 #include <stdexcept>
 #include <algorithm>
 #include <vector>
+#include <string>
+#include <chrono>
 #include <cstring>
 #include <cstdlib>
 #include <cstdint>
+#include <cctype>
+#include <cmath>
+#include <cfloat>
 #include <array>
 #include <optional>
 #include <set>
+#include <map>
+#include <unordered_map>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <utility>
+#include <tuple>
+#include <random>
+#include <type_traits>
 #include <stddef.h>
\ No newline at end of file